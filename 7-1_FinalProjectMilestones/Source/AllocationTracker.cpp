@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.cpp
+// ============
+// report heap allocations made while a frame is rendered
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationTracker.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the first allocating scopes are all reported, later ones only
+	// once per interval so a scope that keeps allocating does not flood
+	// the console
+	const uint64_t REPORT_FIRST = 10;
+	const uint64_t REPORT_INTERVAL = 300;
+
+	// set only on the thread with an open scope, the render loop, so
+	// the allocations of the other threads are not counted
+	thread_local bool g_bTracking = false;
+	// the scopes are opened and closed by the render loop thread, the
+	// only one that counts
+	uint64_t g_scopeAllocations = 0;
+	uint64_t g_scopeBytes = 0;
+	uint64_t g_totalAllocations = 0;
+	uint64_t g_allocatingScopes = 0;
+	int g_scopeDepth = 0;
+	const char* g_scopeName = NULL;
+}
+
+/***********************************************************
+ *  BeginScope()
+ *
+ *  This method starts counting the heap allocations.
+ ***********************************************************/
+void AllocationTracker::BeginScope(const char* name)
+{
+#ifdef TRACK_FRAME_ALLOCATIONS
+	if (g_scopeDepth++ > 0)
+	{
+		return;
+	}
+
+	g_scopeName = name;
+	g_scopeAllocations = 0;
+	g_scopeBytes = 0;
+	g_bTracking = true;
+#else
+	(void)name;
+#endif
+}
+
+/***********************************************************
+ *  EndScope()
+ *
+ *  This method stops counting, and reports the scope when
+ *  it allocated.  The tracking is off before the report is
+ *  written, so the output itself is not counted.
+ ***********************************************************/
+void AllocationTracker::EndScope()
+{
+#ifdef TRACK_FRAME_ALLOCATIONS
+	if ((g_scopeDepth == 0) || (--g_scopeDepth > 0))
+	{
+		return;
+	}
+
+	g_bTracking = false;
+	uint64_t allocations = g_scopeAllocations;
+	if (allocations == 0)
+	{
+		return;
+	}
+
+	g_totalAllocations += allocations;
+	uint64_t scopeNumber = g_allocatingScopes++;
+	if ((scopeNumber < REPORT_FIRST) || ((scopeNumber % REPORT_INTERVAL) == 0))
+	{
+		std::cout << "WARNING: " << allocations << " heap allocations ("
+			<< g_scopeBytes << " bytes) during "
+			<< g_scopeName << ", " << g_totalAllocations << " in all frames so far" << std::endl;
+	}
+#endif
+}
+
+/***********************************************************
+ *  RecordAllocation()
+ *
+ *  This method counts one allocation when the calling
+ *  thread has a scope open.
+ ***********************************************************/
+void AllocationTracker::RecordAllocation(size_t size)
+{
+	if (g_bTracking)
+	{
+		g_scopeAllocations++;
+		g_scopeBytes += size;
+	}
+}
+
+/***********************************************************
+ *  GetTotalAllocations()
+ *
+ *  This method returns the allocations counted so far.
+ ***********************************************************/
+uint64_t AllocationTracker::GetTotalAllocations()
+{
+	return(g_totalAllocations);
+}
+
+#ifdef TRACK_FRAME_ALLOCATIONS
+
+// the replaced global allocation functions; the aligned forms are left
+// to the library, nothing in the render loop uses over-aligned types
+void* operator new(size_t size)
+{
+	AllocationTracker::RecordAllocation(size);
+	void* pMemory = malloc((size > 0) ? size : 1);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t size)
+{
+	return(operator new(size));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	AllocationTracker::RecordAllocation(size);
+	return(malloc((size > 0) ? size : 1));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return(operator new(size, std::nothrow));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+#endif
@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.h
+// ============
+// report heap allocations made while a frame is rendered
+//
+// Builds with TRACK_FRAME_ALLOCATIONS defined (the Debug configuration)
+// replace the global operator new and delete with versions that count
+// the allocations made between BeginScope() and EndScope() by the thread
+// that opened the scope, so the loads and the workers running beside the
+// render loop are not counted.  A scope that allocated prints a warning
+// when it ends.  In other builds the scope calls do nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class AllocationTracker
+{
+public:
+	// start counting for the named part of the frame; scopes may nest,
+	// in which case the outermost one is counted and reported
+	static void BeginScope(const char* name);
+	// stop counting and report the allocations of the scope
+	static void EndScope();
+
+	// called by the replaced operator new
+	static void RecordAllocation(size_t size);
+
+	// the allocations of scopes that have ended, since startup
+	static uint64_t GetTotalAllocations();
+};
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpipeline.cpp
+// ============
+// asset loads written as coroutines that move between the loading threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPipeline.h"
+
+#include "stb_image.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method queues a task for the GL thread.
+ ***********************************************************/
+void GLThreadQueue::Submit(Task task)
+{
+	// notified under the lock: the GL thread may run the task, finish
+	// the load and destroy the queue as soon as the lock is released
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_tasks.push_back(std::move(task));
+	m_taskAvailable.notify_one();
+}
+
+/***********************************************************
+ *  RunPending()
+ *
+ *  This method runs the tasks queued so far on the calling
+ *  thread.  Tasks queued by the tasks it runs wait for the
+ *  next call.
+ ***********************************************************/
+int GLThreadQueue::RunPending(int timeoutMs)
+{
+	std::deque<Task> tasks;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_tasks.empty() && (timeoutMs > 0))
+		{
+			m_taskAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+				[this]() { return !m_tasks.empty(); });
+		}
+		tasks.swap(m_tasks);
+	}
+
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		tasks[i]();
+	}
+	return((int)tasks.size());
+}
+
+/***********************************************************
+ *  AssetPipeline()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetPipeline::AssetPipeline(WorkerPool& workers)
+	: m_ioThread(1), m_workers(workers)
+{
+	// the flag is shared by every thread; the images are flipped for
+	// OpenGL, as LoadGLTexture() does
+	stbi_set_flip_vertically_on_load(true);
+}
+
+/***********************************************************
+ *  ~AssetPipeline()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AssetPipeline::~AssetPipeline()
+{
+	m_ioThread.WaitIdle();
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method reads a whole file into memory.
+ ***********************************************************/
+bool AssetPipeline::ReadFile(const char* filename, std::vector<unsigned char>& contents)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open " << filename << std::endl;
+		return(false);
+	}
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	contents.resize((size_t)size);
+	if ((size > 0) && !file.read((char*)&contents[0], size))
+	{
+		std::cout << "Could not read " << filename << std::endl;
+		contents.clear();
+		return(false);
+	}
+	return(size > 0);
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method decodes the contents of an image file.
+ ***********************************************************/
+bool AssetPipeline::DecodeImage(const std::vector<unsigned char>& contents, DECODED_IMAGE& image)
+{
+	image.pixels = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.channels = 0;
+	if (contents.empty())
+	{
+		return(false);
+	}
+
+	image.pixels = stbi_load_from_memory(
+		&contents[0],
+		(int)contents.size(),
+		&image.width,
+		&image.height,
+		&image.channels,
+		0);
+	return(NULL != image.pixels);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method frees decoded pixels.
+ ***********************************************************/
+void AssetPipeline::FreeImage(DECODED_IMAGE& image)
+{
+	if (NULL != image.pixels)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+}
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpipeline.h
+// ============
+// asset loads written as coroutines that move between the loading threads
+//
+// A load is a coroutine returning an AssetTask.  It reads its file after
+// co_await ToIOThread(), decodes after co_await ToWorkers() and creates its
+// OpenGL objects after co_await ToGLThread(), so the steps read in order
+// while the file reads, the decoding and the uploads of different assets
+// overlap.  Tasks start as soon as they are created; awaiting one joins it,
+// so a coroutine that needs several assets starts them all and then awaits
+// them in turn.  An awaiting coroutine continues on the thread that
+// finished the awaited task.
+//
+// The GL thread runs its share of the work in Wait(), which returns the
+// result of a task once it is done.  A task must be awaited or waited for
+// before it is destroyed.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class AssetTask
+{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	// resumes the awaiting coroutine, if one is waiting, when the body
+	// of the task has finished
+	struct FINAL_AWAITER
+	{
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(Handle handle) noexcept
+		{
+			void* awaiting = handle.promise().continuation.exchange(promise_type::Completed());
+			if (awaiting != nullptr)
+			{
+				return std::coroutine_handle<>::from_address(awaiting);
+			}
+			return std::noop_coroutine();
+		}
+		void await_resume() const noexcept {}
+	};
+
+	struct promise_type
+	{
+		T value{};
+		// the awaiting coroutine, or Completed() once the task is done
+		std::atomic<void*> continuation{ nullptr };
+
+		static void* Completed()
+		{
+			static char marker;
+			return &marker;
+		}
+
+		AssetTask get_return_object() { return AssetTask(Handle::from_promise(*this)); }
+		std::suspend_never initial_suspend() const noexcept { return {}; }
+		FINAL_AWAITER final_suspend() const noexcept { return {}; }
+		void return_value(T result) { value = std::move(result); }
+		// the loads report failures through their results
+		void unhandled_exception() const { std::terminate(); }
+	};
+
+	AssetTask() : m_handle(nullptr) {}
+	AssetTask(AssetTask&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+	AssetTask& operator=(AssetTask&& other) noexcept
+	{
+		std::swap(m_handle, other.m_handle);
+		return(*this);
+	}
+	AssetTask(const AssetTask&) = delete;
+	AssetTask& operator=(const AssetTask&) = delete;
+	~AssetTask()
+	{
+		if (m_handle)
+		{
+			m_handle.destroy();
+		}
+	}
+
+	bool IsReady() const { return m_handle && (m_handle.promise().continuation.load() == promise_type::Completed()); }
+	// the result; only valid once the task is ready
+	const T& GetResult() const { return m_handle.promise().value; }
+
+	// awaiting a task suspends until it is done and returns its result
+	bool await_ready() const noexcept { return IsReady(); }
+	bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		// fails when the task finished in the meantime, which resumes
+		// the awaiting coroutine at once
+		void* expected = nullptr;
+		return(m_handle.promise().continuation.compare_exchange_strong(expected, awaiting.address()));
+	}
+	T await_resume() const { return m_handle.promise().value; }
+
+private:
+	explicit AssetTask(Handle handle) : m_handle(handle) {}
+
+	Handle m_handle;
+};
+
+// a queue of work for the thread that owns the GL context
+class GLThreadQueue
+{
+public:
+	typedef std::function<void()> Task;
+
+	// add a task; safe to call from any thread
+	void Submit(Task task);
+	// run the queued tasks, waiting up to timeoutMs for the first one;
+	// returns the number of tasks run
+	int RunPending(int timeoutMs);
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::deque<Task> m_tasks;
+};
+
+// continues the awaiting coroutine as a task of an executor
+template <typename EXECUTOR>
+class ExecutorSwitch
+{
+public:
+	explicit ExecutorSwitch(EXECUTOR& executor) : m_executor(executor) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> awaiting) { m_executor.Submit([awaiting]() { awaiting.resume(); }); }
+	void await_resume() const noexcept {}
+
+private:
+	EXECUTOR& m_executor;
+};
+
+class AssetPipeline
+{
+public:
+	// pixels decoded from an image file, freed with FreeImage()
+	struct DECODED_IMAGE
+	{
+		unsigned char* pixels;
+		int width;
+		int height;
+		int channels;
+	};
+
+	// constructor - decoding runs on the passed in workers
+	AssetPipeline(WorkerPool& workers);
+	// destructor
+	~AssetPipeline();
+
+	// the executors a load moves between
+	ExecutorSwitch<WorkerPool> ToIOThread() { return ExecutorSwitch<WorkerPool>(m_ioThread); }
+	ExecutorSwitch<WorkerPool> ToWorkers() { return ExecutorSwitch<WorkerPool>(m_workers); }
+	ExecutorSwitch<GLThreadQueue> ToGLThread() { return ExecutorSwitch<GLThreadQueue>(m_glQueue); }
+
+	// run the GL thread's part of the loads until the task is done and
+	// return its result; call on the GL thread only
+	template <typename T>
+	T Wait(AssetTask<T>& task)
+	{
+		while (!task.IsReady())
+		{
+			m_glQueue.RunPending(WAIT_TIMEOUT_MS);
+		}
+		return(task.GetResult());
+	}
+
+	// the steps of an image load, for the IO thread and the workers
+	static bool ReadFile(const char* filename, std::vector<unsigned char>& contents);
+	static bool DecodeImage(const std::vector<unsigned char>& contents, DECODED_IMAGE& image);
+	static void FreeImage(DECODED_IMAGE& image);
+
+private:
+	static const int WAIT_TIMEOUT_MS = 5;
+
+	// file reads are serialized on their own thread, so a slow disk
+	// does not hold up the decoding
+	WorkerPool m_ioThread;
+	WorkerPool& m_workers;
+	GLThreadQueue m_glQueue;
+};
@@ -0,0 +1,598 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render still images of the scene offline from a job list
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+#include "FrameArena.h"
+#include "ImageEncoder.h"
+
+#include "GLFW/glfw3.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// readbacks that may be in flight before the render thread waits
+	const int READBACK_DEPTH = 4;
+
+	// parse "x,y,z" into a vector
+	bool ParseVec3(const std::string& text, glm::vec3& value)
+	{
+		return(sscanf(text.c_str(), "%f,%f,%f", &value.x, &value.y, &value.z) == 3);
+	}
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchRenderer::BatchRenderer(SceneManager* pSceneManager, ShaderManager* pShaderManager, int threadCount)
+	: m_encoderPool(threadCount),
+	  m_readback(READBACK_DEPTH)
+{
+	m_pSceneManager = pSceneManager;
+	m_pShaderManager = pShaderManager;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_framebufferWidth = 0;
+	m_framebufferHeight = 0;
+	m_imagesWritten = 0;
+	m_imagesFailed = 0;
+	m_encodeMicroseconds = 0;
+	m_encoderStallSeconds = 0.0;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	m_encoderPool.WaitIdle();
+	m_readback.Destroy();
+	DestroyFramebuffer();
+	m_pSceneManager = NULL;
+	m_pShaderManager = NULL;
+}
+
+/***********************************************************
+ *  LoadJobFile()
+ *
+ *  This method reads the job list.  Each non-empty line that
+ *  does not start with '#' is one image, described by
+ *  key=value tokens.  Lines starting with "set" change the
+ *  defaults for the jobs that follow.
+ ***********************************************************/
+bool BatchRenderer::LoadJobFile(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open batch job file:" << filename << std::endl;
+		return(false);
+	}
+
+	BATCH_JOB defaults;
+	defaults.width = 1280;
+	defaults.height = 720;
+	defaults.eye = glm::vec3(0.0f, 10.0f, 36.0f);
+	defaults.target = glm::vec3(0.0f, 5.0f, -4.0f);
+	defaults.up = glm::vec3(0.0f, 1.0f, 0.0f);
+	defaults.fieldOfView = 80.0f;
+	defaults.orthographicHeight = 0.0f;
+	defaults.jpegQuality = 90;
+	defaults.gridColumns = 1;
+	defaults.gridRows = 1;
+	defaults.cubeFaceSize = 0;
+
+	std::string line;
+	int lineNumber = 0;
+	bool bSuccess = true;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t first = line.find_first_not_of(" \t\r");
+		if ((first == std::string::npos) || (line[first] == '#'))
+		{
+			continue;
+		}
+
+		if (line.compare(first, 4, "set ") == 0)
+		{
+			// the tokens update the defaults in place
+			bSuccess = ParseJobLine(line.substr(first + 4), defaults, lineNumber) && bSuccess;
+			continue;
+		}
+
+		BATCH_JOB job = defaults;
+		if (ParseJobLine(line.substr(first), job, lineNumber) == false)
+		{
+			bSuccess = false;
+			continue;
+		}
+		if (job.outputFile.empty())
+		{
+			std::cout << "Batch job on line " << lineNumber << " has no out= file" << std::endl;
+			bSuccess = false;
+			continue;
+		}
+		if (ImageEncoder::IsSupportedExtension(job.outputFile) == false)
+		{
+			std::cout << "Batch job on line " << lineNumber << " must write a .png, .jpg or .jpeg file" << std::endl;
+			bSuccess = false;
+			continue;
+		}
+		m_jobs.push_back(job);
+	}
+
+	// create the output folders up front so the encoders only write files
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		std::filesystem::path folder = std::filesystem::path(m_jobs[i].outputFile).parent_path();
+		if (!folder.empty())
+		{
+			std::error_code error;
+			std::filesystem::create_directories(folder, error);
+		}
+	}
+
+	std::cout << "INFO: Loaded " << m_jobs.size() << " batch jobs from " << filename << std::endl;
+	return(bSuccess && (m_jobs.size() > 0));
+}
+
+/***********************************************************
+ *  ParseJobLine()
+ *
+ *  This method applies the key=value tokens of one line.
+ ***********************************************************/
+bool BatchRenderer::ParseJobLine(const std::string& line, BATCH_JOB& job, int lineNumber)
+{
+	std::istringstream tokens(line);
+	std::string token;
+
+	while (tokens >> token)
+	{
+		size_t equals = token.find('=');
+		if (equals == std::string::npos)
+		{
+			std::cout << "Batch job line " << lineNumber << ": expected key=value, got " << token << std::endl;
+			return(false);
+		}
+
+		std::string key = token.substr(0, equals);
+		std::string value = token.substr(equals + 1);
+		bool bValid = true;
+
+		if (key == "out")
+		{
+			job.outputFile = value;
+		}
+		else if (key == "size")
+		{
+			bValid = (sscanf(value.c_str(), "%dx%d", &job.width, &job.height) == 2) &&
+				(job.width > 0) && (job.height > 0);
+		}
+		else if (key == "eye")
+		{
+			bValid = ParseVec3(value, job.eye);
+		}
+		else if (key == "target")
+		{
+			bValid = ParseVec3(value, job.target);
+		}
+		else if (key == "up")
+		{
+			bValid = ParseVec3(value, job.up);
+		}
+		else if (key == "fov")
+		{
+			job.fieldOfView = (float)atof(value.c_str());
+			job.orthographicHeight = 0.0f;
+		}
+		else if (key == "ortho")
+		{
+			job.orthographicHeight = (float)atof(value.c_str());
+		}
+		else if (key == "quality")
+		{
+			job.jpegQuality = atoi(value.c_str());
+		}
+		else if (key == "grid")
+		{
+			bValid = (sscanf(value.c_str(), "%dx%d", &job.gridColumns, &job.gridRows) == 2) &&
+				(job.gridColumns > 0) && (job.gridRows > 0) &&
+				(job.gridColumns * job.gridRows <= LayeredRenderer::MAX_VIEWS);
+		}
+		else if (key == "cubemap")
+		{
+			job.cubeFaceSize = atoi(value.c_str());
+			bValid = (job.cubeFaceSize >= 0);
+		}
+		else if (key == "material")
+		{
+			// material=<tag>:<r>,<g>,<b>[,<shininess>]
+			size_t colon = value.find(':');
+			MATERIAL_OVERRIDE material;
+			material.shininess = 0.0f;
+			bValid = (colon != std::string::npos) &&
+				(sscanf(value.c_str() + colon + 1, "%f,%f,%f,%f",
+					&material.diffuseColor.r, &material.diffuseColor.g,
+					&material.diffuseColor.b, &material.shininess) >= 3);
+			if (bValid)
+			{
+				material.tag = value.substr(0, colon);
+				job.materials.push_back(material);
+			}
+		}
+		else if (key == "texture")
+		{
+			// texture=<tag>:<image file>
+			size_t colon = value.find(':');
+			bValid = (colon != std::string::npos) && (colon + 1 < value.size());
+			if (bValid)
+			{
+				TEXTURE_OVERRIDE texture;
+				texture.tag = value.substr(0, colon);
+				texture.filename = value.substr(colon + 1);
+				job.textures.push_back(texture);
+			}
+		}
+		else
+		{
+			std::cout << "Batch job line " << lineNumber << ": unknown key " << key << std::endl;
+			return(false);
+		}
+
+		if (bValid == false)
+		{
+			std::cout << "Batch job line " << lineNumber << ": bad value for " << key << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  EnsureFramebuffer()
+ *
+ *  This method makes sure the offscreen framebuffer matches
+ *  the resolution of the job about to be rendered.
+ ***********************************************************/
+bool BatchRenderer::EnsureFramebuffer(int width, int height)
+{
+	if ((0 != m_framebuffer) && (width == m_framebufferWidth) && (height == m_framebufferHeight))
+	{
+		return(true);
+	}
+
+	// readbacks already queued keep their own copy in the pixel
+	// buffers, so the old attachments can be released right away
+	DestroyFramebuffer();
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create a " << width << "x" << height << " batch framebuffer" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		DestroyFramebuffer();
+		return(false);
+	}
+
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyFramebuffer()
+ *
+ *  This method frees the offscreen framebuffer.
+ ***********************************************************/
+void BatchRenderer::DestroyFramebuffer()
+{
+	if (0 != m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (0 != m_colorBuffer)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (0 != m_depthBuffer)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	m_framebufferWidth = 0;
+	m_framebufferHeight = 0;
+}
+
+/***********************************************************
+ *  RenderJob()
+ *
+ *  This method renders one job into the offscreen target and
+ *  queues its readback.  It only blocks when every readback
+ *  buffer is still waiting on the GPU.
+ ***********************************************************/
+void BatchRenderer::RenderJob(const BATCH_JOB& job, size_t jobIndex)
+{
+	// cube maps are written as a strip of six square faces
+	int width = job.width;
+	int height = job.height;
+	if (job.cubeFaceSize > 0)
+	{
+		width = job.cubeFaceSize * 6;
+		height = job.cubeFaceSize;
+	}
+
+	if (EnsureFramebuffer(width, height) == false)
+	{
+		m_imagesFailed++;
+		return;
+	}
+
+	// every still is a frame of its own for the temporary memory
+	FrameArena::BeginFrame();
+
+	// apply this job's material and texture variants
+	m_pSceneManager->ClearOverrides();
+	for (size_t i = 0; i < job.materials.size(); i++)
+	{
+		m_pSceneManager->OverrideMaterial(job.materials[i].tag, job.materials[i].diffuseColor, job.materials[i].shininess);
+	}
+	for (size_t i = 0; i < job.textures.size(); i++)
+	{
+		m_pSceneManager->OverrideTexture(job.textures[i].tag, job.textures[i].filename.c_str());
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	std::vector<LayeredRenderer::LAYERED_VIEW> views;
+	BuildJobViews(job, width, height, views);
+
+	// every still gets a freshly rendered monitor screen
+	const LayeredRenderer::LAYERED_VIEW& mainView = views[0];
+	m_pSceneManager->UpdateRenderTargets(mainView.view, mainView.projection, mainView.position, mainView.width, mainView.height, true);
+
+	m_pSceneManager->BuildDrawList();
+	if ((views.size() == 1) || (m_pSceneManager->SubmitDrawListLayered(views) == false))
+	{
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			glViewport(views[i].x, views[i].y, views[i].width, views[i].height);
+			m_viewUniforms.Set(m_pShaderManager->m_programID, views[i].view, views[i].projection, views[i].position);
+			m_pSceneManager->SubmitDrawList(views[i].projection * views[i].view);
+		}
+		glViewport(0, 0, width, height);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	m_readback.QueueReadback(
+		0, 0, width, height,
+		GL_RGBA, GL_UNSIGNED_BYTE,
+		jobIndex, jobIndex,
+		true,
+		[this](const FrameReadback::READBACK_FRAME& frame) { QueueEncode(frame); });
+
+	// get the commands to the GPU now rather than at the next wait
+	glFlush();
+}
+
+/***********************************************************
+ *  BuildJobViews()
+ *
+ *  This method is used for laying out the views of a job in
+ *  its image.  Cube map faces use the GL face order and
+ *  orientation; grid cells orbit the eye around the target
+ *  in equal steps, the first cell in the top left corner.
+ ***********************************************************/
+void BatchRenderer::BuildJobViews(const BATCH_JOB& job, int width, int height, std::vector<LayeredRenderer::LAYERED_VIEW>& views) const
+{
+	views.clear();
+
+	if (job.cubeFaceSize > 0)
+	{
+		// +X, -X, +Y, -Y, +Z, -Z
+		const glm::vec3 directions[6] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+		const glm::vec3 ups[6] = {
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+
+		for (int i = 0; i < 6; i++)
+		{
+			LayeredRenderer::LAYERED_VIEW face;
+			face.view = glm::lookAt(job.eye, job.eye + directions[i], ups[i]);
+			face.projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+			face.position = job.eye;
+			face.x = i * job.cubeFaceSize;
+			face.y = 0;
+			face.width = job.cubeFaceSize;
+			face.height = job.cubeFaceSize;
+			views.push_back(face);
+		}
+		return;
+	}
+
+	int cellCount = job.gridColumns * job.gridRows;
+	int cellWidth = width / job.gridColumns;
+	int cellHeight = height / job.gridRows;
+	float aspect = (float)cellWidth / (float)cellHeight;
+
+	glm::mat4 projection;
+	if (job.orthographicHeight > 0.0f)
+	{
+		float halfHeight = job.orthographicHeight * 0.5f;
+		projection = glm::ortho(-halfHeight * aspect, halfHeight * aspect, -halfHeight, halfHeight, 0.1f, 100.0f);
+	}
+	else
+	{
+		projection = glm::perspective(glm::radians(job.fieldOfView), aspect, 0.1f, 100.0f);
+	}
+
+	for (int i = 0; i < cellCount; i++)
+	{
+		float angle = 360.0f * (float)i / (float)cellCount;
+		glm::vec3 offset = glm::vec3(glm::rotate(glm::radians(angle), job.up) * glm::vec4(job.eye - job.target, 0.0f));
+
+		LayeredRenderer::LAYERED_VIEW cell;
+		cell.position = job.target + offset;
+		cell.view = glm::lookAt(cell.position, job.target, job.up);
+		cell.projection = projection;
+		// framebuffer rows start at the bottom of the image
+		cell.x = (i % job.gridColumns) * cellWidth;
+		cell.y = (job.gridRows - 1 - (i / job.gridColumns)) * cellHeight;
+		cell.width = cellWidth;
+		cell.height = cellHeight;
+		views.push_back(cell);
+	}
+}
+
+/***********************************************************
+ *  QueueEncode()
+ *
+ *  This method copies a finished readback out of its pixel
+ *  buffer and hands it to the encoder pool.
+ ***********************************************************/
+void BatchRenderer::QueueEncode(const FrameReadback::READBACK_FRAME& frame)
+{
+	// keep at most two images per encoder queued, waiting here is the
+	// only back pressure the encoders put on the render thread
+	double stallStart = glfwGetTime();
+	m_encoderPool.WaitForCapacity(m_encoderPool.GetThreadCount() * 2);
+	m_encoderStallSeconds += glfwGetTime() - stallStart;
+
+	const BATCH_JOB& job = m_jobs[(size_t)frame.userValue];
+
+	std::shared_ptr<std::vector<unsigned char> > pixels =
+		std::make_shared<std::vector<unsigned char> >(frame.pixels, frame.pixels + ((size_t)frame.stride * frame.height));
+
+	ImageEncoder::IMAGE_VIEW image;
+	image.pixels = NULL;
+	image.width = frame.width;
+	image.height = frame.height;
+	image.channels = 4;
+	image.stride = frame.stride;
+	// cube map strips keep the GL row order, so every face can be
+	// uploaded to its cube map face as it is stored in the file
+	image.bFlipVertically = (job.cubeFaceSize == 0);
+
+	std::string outputFile = job.outputFile;
+	int quality = job.jpegQuality;
+
+	m_encoderPool.Submit([this, pixels, image, outputFile, quality]() mutable
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		image.pixels = pixels->data();
+		if (ImageEncoder::WriteImageFile(outputFile, image, quality))
+		{
+			m_imagesWritten++;
+		}
+		else
+		{
+			std::cout << "Could not write batch image:" << outputFile << std::endl;
+			m_imagesFailed++;
+		}
+
+		m_encodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	});
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method renders the whole job list and reports the
+ *  throughput and where the pipeline had to wait.
+ ***********************************************************/
+bool BatchRenderer::Run()
+{
+	if (m_jobs.empty())
+	{
+		return(false);
+	}
+
+	std::cout << "INFO: Rendering " << m_jobs.size() << " images with "
+		<< m_encoderPool.GetThreadCount() << " encoder threads" << std::endl;
+
+	double startTime = glfwGetTime();
+	double submitSeconds = 0.0;
+
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		double jobStart = glfwGetTime();
+		RenderJob(m_jobs[i], i);
+		submitSeconds += glfwGetTime() - jobStart;
+	}
+
+	// drain the readbacks still in flight and the encoder queue
+	m_readback.Flush([this](const FrameReadback::READBACK_FRAME& frame) { QueueEncode(frame); });
+	double renderDoneTime = glfwGetTime();
+	m_encoderPool.WaitIdle();
+	double endTime = glfwGetTime();
+
+	m_pSceneManager->ClearOverrides();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	double totalSeconds = endTime - startTime;
+	int written = m_imagesWritten;
+	int failed = m_imagesFailed;
+	double readbackStall = m_readback.GetStallSeconds();
+
+	std::cout << "INFO: Batch finished, " << written << " images written, " << failed << " failed" << std::endl;
+	std::cout << "INFO:   total time          " << totalSeconds << " s" << std::endl;
+	if (totalSeconds > 0.0)
+	{
+		std::cout << "INFO:   throughput          " << (written / totalSeconds) << " images/s" << std::endl;
+	}
+	std::cout << "INFO:   render thread busy  " << submitSeconds << " s" << std::endl;
+	std::cout << "INFO:   readback stall      " << readbackStall << " s" << std::endl;
+	std::cout << "INFO:   encoder stall       " << m_encoderStallSeconds << " s" << std::endl;
+	std::cout << "INFO:   encoder tail        " << (endTime - renderDoneTime) << " s" << std::endl;
+	if (written > 0)
+	{
+		std::cout << "INFO:   average encode      " << ((double)m_encodeMicroseconds / written / 1000.0) << " ms/image" << std::endl;
+	}
+
+	return(failed == 0);
+}
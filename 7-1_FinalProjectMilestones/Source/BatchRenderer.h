@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render still images of the scene offline from a job list
+//
+// Every job renders the scene into an offscreen framebuffer, queues an
+// asynchronous readback and moves on to the next job straight away.  When
+// a readback completes, its pixels are handed to a pool of worker threads
+// that encode the PNG or JPEG file, so the GPU, the readback and the
+// encoding of different images all overlap.
+//
+// A job may also ask for a grid of thumbnails or the six faces of a cube
+// map in one image.  Those views are drawn with a single layered pass when
+// the context supports it, and one pass per view otherwise.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "FrameReadback.h"
+#include "WorkerPool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+class BatchRenderer
+{
+public:
+	struct MATERIAL_OVERRIDE
+	{
+		std::string tag;
+		glm::vec3 diffuseColor;
+		float shininess;          // 0 keeps the defined shininess
+	};
+
+	struct TEXTURE_OVERRIDE
+	{
+		std::string tag;
+		std::string filename;
+	};
+
+	struct BATCH_JOB
+	{
+		std::string outputFile;
+		int width;
+		int height;
+		glm::vec3 eye;
+		glm::vec3 target;
+		glm::vec3 up;
+		float fieldOfView;        // degrees, perspective projection
+		float orthographicHeight; // > 0 selects an orthographic projection
+		int jpegQuality;
+		// a contact sheet of views orbiting the target, or 1x1
+		int gridColumns;
+		int gridRows;
+		// > 0 renders the six cube map faces from the eye into a strip
+		int cubeFaceSize;
+		std::vector<MATERIAL_OVERRIDE> materials;
+		std::vector<TEXTURE_OVERRIDE> textures;
+	};
+
+	// constructor - threadCount of 0 sizes the encoder pool automatically
+	BatchRenderer(SceneManager* pSceneManager, ShaderManager* pShaderManager, int threadCount);
+	// destructor
+	~BatchRenderer();
+
+	// read the job list; see batch/desk_stills.txt for the format
+	bool LoadJobFile(const char* filename);
+	// render every job and print the throughput report
+	bool Run();
+
+	size_t GetJobCount() const { return m_jobs.size(); }
+
+private:
+	SceneManager* m_pSceneManager;
+	ShaderManager* m_pShaderManager;
+	// the camera uniforms of the shader manager's program
+	ViewUniforms m_viewUniforms;
+	WorkerPool m_encoderPool;
+	FrameReadback m_readback;
+	std::vector<BATCH_JOB> m_jobs;
+
+	// offscreen target, recreated when the job resolution changes
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_framebufferWidth;
+	int m_framebufferHeight;
+
+	// statistics shared with the encoder threads
+	std::atomic<int> m_imagesWritten;
+	std::atomic<int> m_imagesFailed;
+	std::atomic<long long> m_encodeMicroseconds;
+	// time the render thread spent waiting for a free encoder
+	double m_encoderStallSeconds;
+
+	bool ParseJobLine(const std::string& line, BATCH_JOB& defaults, int lineNumber);
+	bool EnsureFramebuffer(int width, int height);
+	void DestroyFramebuffer();
+	void RenderJob(const BATCH_JOB& job, size_t jobIndex);
+	// the cameras and viewports of a job's image
+	void BuildJobViews(const BATCH_JOB& job, int width, int height, std::vector<LayeredRenderer::LAYERED_VIEW>& views) const;
+	// called on the render thread with a mapped readback buffer
+	void QueueEncode(const FrameReadback::READBACK_FRAME& frame);
+};
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumes.cpp
+// ============
+// world space bounding boxes and view frustum visibility tests
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumes.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************
+ *  TransformUnitBox()
+ *
+ *  This method returns the world bounds of the basic box
+ *  mesh after it has been scaled, rotated and translated.
+ ***********************************************************/
+BoundingVolumes::BOX BoundingVolumes::TransformUnitBox(const glm::mat4& model)
+{
+	BOX unitBox;
+	unitBox.minimum = glm::vec3(-0.5f, -0.5f, -0.5f);
+	unitBox.maximum = glm::vec3(0.5f, 0.5f, 0.5f);
+	return(TransformBox(unitBox, model));
+}
+
+/***********************************************************
+ *  TransformBox()
+ *
+ *  This method returns the axis aligned bounds of a box
+ *  placed by a model matrix.  The center is transformed and
+ *  the half extents are projected onto the world axes.
+ ***********************************************************/
+BoundingVolumes::BOX BoundingVolumes::TransformBox(const BOX& box, const glm::mat4& model)
+{
+	glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+	glm::vec3 extent = (box.maximum - box.minimum) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent(0.0f);
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			worldExtent[row] += std::fabs(model[column][row]) * extent[column];
+		}
+	}
+
+	BOX result;
+	result.minimum = worldCenter - worldExtent;
+	result.maximum = worldCenter + worldExtent;
+	return(result);
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This method builds the clip planes from the rows of the
+ *  combined matrix (Gribb and Hartmann).  The planes are
+ *  normalized so distances are in world units.
+ ***********************************************************/
+BoundingVolumes::FRUSTUM BoundingVolumes::ExtractFrustum(const glm::mat4& viewProjection)
+{
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	FRUSTUM frustum;
+	frustum.planes[0] = rows[3] + rows[0];   // left
+	frustum.planes[1] = rows[3] - rows[0];   // right
+	frustum.planes[2] = rows[3] + rows[1];   // bottom
+	frustum.planes[3] = rows[3] - rows[1];   // top
+	frustum.planes[4] = rows[3] + rows[2];   // near
+	frustum.planes[5] = rows[3] - rows[2];   // far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(frustum.planes[i]));
+		if (length > 0.0f)
+		{
+			frustum.planes[i] = frustum.planes[i] / length;
+		}
+	}
+
+	return(frustum);
+}
+
+/***********************************************************
+ *  IsBoxVisible()
+ *
+ *  This method tests the box corner furthest along each
+ *  plane normal.  It can report a box near a frustum corner
+ *  as visible, which only costs an unneeded draw.
+ ***********************************************************/
+bool BoundingVolumes::IsBoxVisible(const FRUSTUM& frustum, const BOX& box)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		glm::vec3 corner(
+			(plane.x >= 0.0f) ? box.maximum.x : box.minimum.x,
+			(plane.y >= 0.0f) ? box.maximum.y : box.minimum.y,
+			(plane.z >= 0.0f) ? box.maximum.z : box.minimum.z);
+
+		if ((glm::dot(glm::vec3(plane), corner) + plane.w) < 0.0f)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DistanceToBox()
+ *
+ *  This method returns how far a point is from a box, which
+ *  is 0 for a point inside it.
+ ***********************************************************/
+float BoundingVolumes::DistanceToBox(const BOX& box, const glm::vec3& point)
+{
+	glm::vec3 outside = glm::max(glm::max(box.minimum - point, point - box.maximum), glm::vec3(0.0f));
+	return(glm::length(outside));
+}
+
+/***********************************************************
+ *  ProjectedSize()
+ *
+ *  This method projects the eight box corners to the screen
+ *  and measures the rectangle around them in pixels.
+ ***********************************************************/
+float BoundingVolumes::ProjectedSize(const BOX& box, const glm::mat4& viewProjection, int viewportWidth, int viewportHeight)
+{
+	float minX = 1.0f;
+	float maxX = -1.0f;
+	float minY = 1.0f;
+	float maxY = -1.0f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner(
+			(i & 1) ? box.maximum.x : box.minimum.x,
+			(i & 2) ? box.maximum.y : box.minimum.y,
+			(i & 4) ? box.maximum.z : box.minimum.z,
+			1.0f);
+		glm::vec4 clip = viewProjection * corner;
+
+		// a corner behind the eye has no meaningful screen position
+		if (clip.w <= 0.0001f)
+		{
+			return((float)std::max(viewportWidth, viewportHeight));
+		}
+
+		float x = clip.x / clip.w;
+		float y = clip.y / clip.w;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+	}
+
+	// clamp to the viewport, since only the visible part matters
+	minX = std::max(minX, -1.0f);
+	maxX = std::min(maxX, 1.0f);
+	minY = std::max(minY, -1.0f);
+	maxY = std::min(maxY, 1.0f);
+
+	float width = std::max(0.0f, maxX - minX) * 0.5f * viewportWidth;
+	float height = std::max(0.0f, maxY - minY) * 0.5f * viewportHeight;
+	return(std::max(width, height));
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumes.h
+// ============
+// world space bounding boxes and view frustum visibility tests
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+class BoundingVolumes
+{
+public:
+	// axis aligned box in world space
+	struct BOX
+	{
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+	};
+
+	// the six clip planes of a view, normals pointing inward
+	struct FRUSTUM
+	{
+		glm::vec4 planes[6];
+	};
+
+	// bounds of the unit box mesh (-0.5 to 0.5) placed by a model matrix
+	static BOX TransformUnitBox(const glm::mat4& model);
+	// bounds of a box after it has been placed by a model matrix
+	static BOX TransformBox(const BOX& box, const glm::mat4& model);
+
+	// extract the clip planes from a combined projection * view matrix
+	static FRUSTUM ExtractFrustum(const glm::mat4& viewProjection);
+	// false only when the box is entirely outside one of the planes
+	static bool IsBoxVisible(const FRUSTUM& frustum, const BOX& box);
+
+	// distance from a point to the nearest point of a box, 0 inside it
+	static float DistanceToBox(const BOX& box, const glm::vec3& point);
+
+	// larger of the width and height, in pixels, of the screen rectangle
+	// covered by the box; a box crossing the near plane covers the viewport
+	static float ProjectedSize(const BOX& box, const glm::mat4& viewProjection, int viewportWidth, int viewportHeight);
+};
@@ -0,0 +1,436 @@
+///////////////////////////////////////////////////////////////////////////////
+// capturemanager.cpp
+// ============
+// screenshots and continuous video capture of the display window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CaptureManager.h"
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// readbacks in flight; at 60 Hz the pixels are mapped ~50 ms later
+	const int CAPTURE_READBACK_DEPTH = 3;
+	// frames waiting for the video writer before new ones are dropped
+	const int MAX_QUEUED_VIDEO_FRAMES = 8;
+
+	unsigned char ClampToByte(float value)
+	{
+		return((unsigned char)std::max(0.0f, std::min(255.0f, value + 0.5f)));
+	}
+}
+
+/***********************************************************
+ *  CaptureManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CaptureManager::CaptureManager(const char* captureFolder, int videoFrameRate)
+	: m_readback(CAPTURE_READBACK_DEPTH),
+	  m_videoWriter(1),
+	  m_screenshotWriter(1)
+{
+	m_captureFolder = captureFolder;
+	m_videoFrameRate = videoFrameRate;
+	m_bScreenshotRequested = false;
+	m_bRecording = false;
+	m_bStopPending = false;
+	m_pendingVideoReadbacks = 0;
+	m_videoFormat = VIDEO_Y4M;
+	m_pVideoFile = NULL;
+	m_videoWidth = 0;
+	m_videoHeight = 0;
+	m_frameCounter = 0;
+	m_videoFramesWritten = 0;
+	m_videoFramesDropped = 0;
+}
+
+/***********************************************************
+ *  ~CaptureManager()
+ *
+ *  The destructor for the class.  Pending readbacks are
+ *  delivered so the last frames of a recording are kept.
+ ***********************************************************/
+CaptureManager::~CaptureManager()
+{
+	m_bScreenshotRequested = false;
+	if (m_bRecording)
+	{
+		StopRecording();
+	}
+	m_readback.Flush([this](const FrameReadback::READBACK_FRAME& frame) { HandleReadback(frame); });
+	m_readback.Destroy();
+
+	m_videoWriter.WaitIdle();
+	m_screenshotWriter.WaitIdle();
+
+	if (NULL != m_pVideoFile)
+	{
+		fclose(m_pVideoFile);
+		m_pVideoFile = NULL;
+	}
+}
+
+/***********************************************************
+ *  RequestScreenshot()
+ *
+ *  This method marks the next rendered frame for capture.
+ ***********************************************************/
+void CaptureManager::RequestScreenshot()
+{
+	m_bScreenshotRequested = true;
+}
+
+/***********************************************************
+ *  ToggleRecording()
+ *
+ *  This method starts a recording, which opens its file with
+ *  the size of the next captured frame, or stops the one in
+ *  progress.
+ ***********************************************************/
+void CaptureManager::ToggleRecording(VIDEO_FORMAT format)
+{
+	if (m_bRecording)
+	{
+		StopRecording();
+	}
+	else if (m_bStopPending == false)
+	{
+		m_bRecording = true;
+		m_videoFormat = format;
+		m_videoWidth = 0;
+		m_videoHeight = 0;
+		m_videoFramesDropped = 0;
+	}
+}
+
+/***********************************************************
+ *  MakeFilename()
+ *
+ *  This method builds a time stamped file name inside the
+ *  capture folder, creating the folder if needed.
+ ***********************************************************/
+std::string CaptureManager::MakeFilename(const char* prefix, const char* extension) const
+{
+	std::error_code error;
+	std::filesystem::create_directories(m_captureFolder, error);
+
+	char timestamp[32];
+	time_t now = time(NULL);
+	strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", localtime(&now));
+
+	return(m_captureFolder + "/" + prefix + "_" + timestamp + "_" + std::to_string(m_frameCounter) + extension);
+}
+
+/***********************************************************
+ *  AcquireBuffer()
+ *
+ *  This method returns a recycled frame buffer if one is
+ *  free, so continuous capture does not allocate per frame.
+ ***********************************************************/
+CaptureManager::PixelBuffer CaptureManager::AcquireBuffer(size_t size)
+{
+	PixelBuffer buffer;
+	{
+		std::lock_guard<std::mutex> lock(m_bufferMutex);
+		if (!m_freeBuffers.empty())
+		{
+			buffer = m_freeBuffers.back();
+			m_freeBuffers.pop_back();
+		}
+	}
+
+	if (!buffer)
+	{
+		buffer = std::make_shared<std::vector<unsigned char> >();
+	}
+	buffer->resize(size);
+	return(buffer);
+}
+
+/***********************************************************
+ *  ReleaseBuffer()
+ *
+ *  This method returns a frame buffer to the free list.
+ ***********************************************************/
+void CaptureManager::ReleaseBuffer(PixelBuffer buffer)
+{
+	std::lock_guard<std::mutex> lock(m_bufferMutex);
+	if (m_freeBuffers.size() < (size_t)MAX_QUEUED_VIDEO_FRAMES)
+	{
+		m_freeBuffers.push_back(buffer);
+	}
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method queues a readback of the back buffer when a
+ *  screenshot or a recording needs this frame, and hands
+ *  earlier readbacks that have completed to the writers.
+ ***********************************************************/
+void CaptureManager::CaptureFrame(int width, int height)
+{
+	FrameReadback::ReadbackHandler handler =
+		[this](const FrameReadback::READBACK_FRAME& frame) { HandleReadback(frame); };
+
+	m_frameCounter++;
+
+	uint64_t kinds = 0;
+	if (m_bScreenshotRequested)
+	{
+		kinds |= CAPTURE_SCREENSHOT;
+	}
+	if (m_bRecording)
+	{
+		if (0 == m_videoWidth)
+		{
+			StartRecording(m_videoFormat, width, height);
+		}
+
+		// a resized window or a writer that cannot keep up loses the frame
+		// rather than slowing down the render loop
+		if ((width == m_videoWidth) && (height == m_videoHeight) &&
+			(m_videoWriter.GetOutstandingCount() < MAX_QUEUED_VIDEO_FRAMES))
+		{
+			kinds |= CAPTURE_VIDEO;
+		}
+		else
+		{
+			m_videoFramesDropped++;
+		}
+	}
+
+	if (0 != kinds)
+	{
+		glReadBuffer(GL_BACK);
+		if (m_readback.QueueReadback(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_frameCounter, kinds, false, handler))
+		{
+			if (kinds & CAPTURE_SCREENSHOT)
+			{
+				m_bScreenshotRequested = false;
+			}
+			if (kinds & CAPTURE_VIDEO)
+			{
+				m_pendingVideoReadbacks++;
+			}
+		}
+		else if (kinds & CAPTURE_VIDEO)
+		{
+			m_videoFramesDropped++;
+		}
+	}
+	else
+	{
+		m_readback.ProcessCompleted(handler);
+	}
+
+	// close a stopped recording once its last frames have arrived
+	if (m_bStopPending && (0 == m_pendingVideoReadbacks))
+	{
+		m_bStopPending = false;
+		m_videoWriter.Submit([this]()
+		{
+			if (NULL != m_pVideoFile)
+			{
+				fclose(m_pVideoFile);
+				m_pVideoFile = NULL;
+			}
+			std::cout << "INFO: Finished recording " << m_videoFilename << ", "
+				<< m_videoFramesWritten << " frames" << std::endl;
+		});
+	}
+}
+
+/***********************************************************
+ *  HandleReadback()
+ *
+ *  This method copies a completed readback out of its pixel
+ *  buffer and passes the copy to the background writers.
+ *  Each writer gets a copy of its own and releases it, so a
+ *  frame that is both a screenshot and a video frame is not
+ *  recycled while the other writer still reads it.
+ ***********************************************************/
+void CaptureManager::HandleReadback(const FrameReadback::READBACK_FRAME& frame)
+{
+	size_t size = (size_t)frame.stride * frame.height;
+	int width = frame.width;
+	int height = frame.height;
+	int stride = frame.stride;
+
+	if (frame.userValue & CAPTURE_VIDEO)
+	{
+		m_pendingVideoReadbacks--;
+		PixelBuffer pixels = AcquireBuffer(size);
+		memcpy(pixels->data(), frame.pixels, size);
+		VIDEO_FORMAT format = m_videoFormat;
+		m_videoWriter.Submit([this, pixels, format, width, height, stride]()
+		{
+			WriteVideoFrame(pixels, format, width, height, stride);
+		});
+	}
+
+	if (frame.userValue & CAPTURE_SCREENSHOT)
+	{
+		PixelBuffer pixels = AcquireBuffer(size);
+		memcpy(pixels->data(), frame.pixels, size);
+		std::string filename = MakeFilename("screenshot", ".png");
+		m_screenshotWriter.Submit([this, pixels, width, height, stride, filename]()
+		{
+			ImageEncoder::IMAGE_VIEW image;
+			image.pixels = pixels->data();
+			image.width = width;
+			image.height = height;
+			image.channels = 4;
+			image.stride = stride;
+			image.bFlipVertically = true;
+
+			if (ImageEncoder::WriteImageFile(filename, image, 95))
+			{
+				std::cout << "INFO: Saved screenshot " << filename << std::endl;
+			}
+			else
+			{
+				std::cout << "Could not save screenshot " << filename << std::endl;
+			}
+			ReleaseBuffer(pixels);
+		});
+	}
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method fixes the video size and asks the writer
+ *  thread to open the file.  Y4M needs even dimensions, so
+ *  an odd last row or column is cropped.
+ ***********************************************************/
+void CaptureManager::StartRecording(VIDEO_FORMAT format, int width, int height)
+{
+	m_videoWidth = width;
+	m_videoHeight = height;
+
+	char sizeText[32];
+	snprintf(sizeText, sizeof(sizeText), "_%dx%d", width, height);
+	std::string baseName = MakeFilename("recording", "");
+	m_videoFilename = baseName + ((format == VIDEO_Y4M) ? ".y4m" : (std::string(sizeText) + ".rgba"));
+
+	std::string filename = m_videoFilename;
+	int frameRate = m_videoFrameRate;
+	m_videoWriter.Submit([this, format, width, height, filename, frameRate]()
+	{
+		// the count is only touched by this thread, after the frames of
+		// the previous recording
+		m_videoFramesWritten = 0;
+		m_pVideoFile = fopen(filename.c_str(), "wb");
+		if (NULL == m_pVideoFile)
+		{
+			std::cout << "Could not create video file " << filename << std::endl;
+			return;
+		}
+		if (format == VIDEO_Y4M)
+		{
+			// C420jpeg: BT.601 with centered chroma samples, in full range
+			fprintf(m_pVideoFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width & ~1, height & ~1, frameRate);
+		}
+		std::cout << "INFO: Recording to " << filename << std::endl;
+	});
+}
+
+/***********************************************************
+ *  StopRecording()
+ *
+ *  This method stops queuing video frames; the file is
+ *  closed when the frames still in flight have been written.
+ ***********************************************************/
+void CaptureManager::StopRecording()
+{
+	m_bRecording = false;
+	m_bStopPending = (0 != m_videoWidth);
+	if (m_videoFramesDropped > 0)
+	{
+		std::cout << "INFO: Recording dropped " << m_videoFramesDropped << " frames" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  WriteVideoFrame()
+ *
+ *  This method runs on the video writer thread.  It converts
+ *  a bottom-up RGBA frame into the file's layout and appends
+ *  it to the open video file.
+ ***********************************************************/
+void CaptureManager::WriteVideoFrame(PixelBuffer pixels, VIDEO_FORMAT format, int width, int height, int stride)
+{
+	if (NULL == m_pVideoFile)
+	{
+		ReleaseBuffer(pixels);
+		return;
+	}
+
+	const unsigned char* source = pixels->data();
+
+	if (format == VIDEO_RAW)
+	{
+		for (int y = height - 1; y >= 0; y--)
+		{
+			fwrite(source + ((size_t)stride * y), 1, (size_t)width * 4, m_pVideoFile);
+		}
+	}
+	else
+	{
+		int evenWidth = width & ~1;
+		int evenHeight = height & ~1;
+		size_t lumaSize = (size_t)evenWidth * evenHeight;
+		size_t chromaSize = lumaSize / 4;
+		m_yuvFrame.resize(lumaSize + (chromaSize * 2));
+
+		unsigned char* planeY = m_yuvFrame.data();
+		unsigned char* planeU = planeY + lumaSize;
+		unsigned char* planeV = planeU + chromaSize;
+
+		// walk 2x2 blocks; output rows run top to bottom
+		for (int y = 0; y < evenHeight; y += 2)
+		{
+			const unsigned char* row0 = source + ((size_t)stride * (height - 1 - y));
+			const unsigned char* row1 = source + ((size_t)stride * (height - 2 - y));
+			for (int x = 0; x < evenWidth; x += 2)
+			{
+				float sumR = 0.0f;
+				float sumG = 0.0f;
+				float sumB = 0.0f;
+				for (int i = 0; i < 4; i++)
+				{
+					const unsigned char* pixel = ((i < 2) ? row0 : row1) + ((x + (i & 1)) * 4);
+					float r = pixel[0];
+					float g = pixel[1];
+					float b = pixel[2];
+					planeY[((size_t)(y + (i >> 1)) * evenWidth) + x + (i & 1)] =
+						ClampToByte((0.299f * r) + (0.587f * g) + (0.114f * b));
+					sumR += r;
+					sumG += g;
+					sumB += b;
+				}
+				sumR *= 0.25f;
+				sumG *= 0.25f;
+				sumB *= 0.25f;
+				size_t chromaIndex = ((size_t)(y / 2) * (evenWidth / 2)) + (x / 2);
+				planeU[chromaIndex] = ClampToByte(128.0f - (0.168736f * sumR) - (0.331264f * sumG) + (0.5f * sumB));
+				planeV[chromaIndex] = ClampToByte(128.0f + (0.5f * sumR) - (0.418688f * sumG) - (0.081312f * sumB));
+			}
+		}
+
+		fputs("FRAME\n", m_pVideoFile);
+		fwrite(m_yuvFrame.data(), 1, m_yuvFrame.size(), m_pVideoFile);
+	}
+
+	m_videoFramesWritten++;
+	ReleaseBuffer(pixels);
+}
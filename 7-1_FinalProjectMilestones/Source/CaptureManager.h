@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// capturemanager.h
+// ============
+// screenshots and continuous video capture of the display window
+//
+// Frames are read back through the fenced pixel buffer ring, so a capture
+// completes a few frames after it was requested and the render loop never
+// waits for the GPU.  File writing and the RGB to YUV conversion of video
+// frames happen on background threads.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameReadback.h"
+#include "WorkerPool.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CaptureManager
+{
+public:
+	enum VIDEO_FORMAT
+	{
+		VIDEO_Y4M,     // YUV 4:2:0, plays in ffplay/mpv/VLC
+		VIDEO_RAW      // packed RGBA frames, top row first
+	};
+
+	// constructor - captureFolder is created on first use
+	CaptureManager(const char* captureFolder, int videoFrameRate);
+	// destructor - finishes writing any capture in progress
+	~CaptureManager();
+
+	// save the next rendered frame as a PNG file
+	void RequestScreenshot();
+	// start or stop continuous capture into a video file
+	void ToggleRecording(VIDEO_FORMAT format);
+	bool IsRecording() const { return m_bRecording; }
+
+	// called once per frame after the scene has been rendered, with the
+	// back buffer still bound for reading
+	void CaptureFrame(int width, int height);
+
+private:
+	typedef std::shared_ptr<std::vector<unsigned char> > PixelBuffer;
+
+	// the readback request kinds, stored in the readback user value
+	enum CAPTURE_KIND
+	{
+		CAPTURE_SCREENSHOT = 1,
+		CAPTURE_VIDEO = 2
+	};
+
+	std::string m_captureFolder;
+	int m_videoFrameRate;
+	FrameReadback m_readback;
+	// video frames must be written in order, so one thread each
+	WorkerPool m_videoWriter;
+	WorkerPool m_screenshotWriter;
+
+	bool m_bScreenshotRequested;
+	bool m_bRecording;
+	// recording was stopped but some of its frames are still in flight
+	bool m_bStopPending;
+	int m_pendingVideoReadbacks;
+	VIDEO_FORMAT m_videoFormat;
+	// the open video file, touched only by the video writer thread
+	FILE* m_pVideoFile;
+	std::string m_videoFilename;
+	int m_videoWidth;
+	int m_videoHeight;
+	uint64_t m_frameCounter;
+	// reset and counted on the video writer thread
+	uint64_t m_videoFramesWritten;
+	uint64_t m_videoFramesDropped;
+
+	// recycled frame copies so steady recording does not allocate
+	std::mutex m_bufferMutex;
+	std::vector<PixelBuffer> m_freeBuffers;
+	// YUV conversion scratch, used only by the video writer thread
+	std::vector<unsigned char> m_yuvFrame;
+
+	PixelBuffer AcquireBuffer(size_t size);
+	void ReleaseBuffer(PixelBuffer buffer);
+	std::string MakeFilename(const char* prefix, const char* extension) const;
+	// runs on the render thread with a mapped readback buffer
+	void HandleReadback(const FrameReadback::READBACK_FRAME& frame);
+	void StartRecording(VIDEO_FORMAT format, int width, int height);
+	void StopRecording();
+	// runs on the video writer thread
+	void WriteVideoFrame(PixelBuffer pixels, VIDEO_FORMAT format, int width, int height, int stride);
+};
@@ -0,0 +1,513 @@
+///////////////////////////////////////////////////////////////////////////////
+// collisionworld.cpp
+// ============
+// swept sphere collision against the static scene geometry
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CollisionWorld.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+// declaration of the global variables and defines
+namespace
+{
+	// colliders per leaf of the hierarchy
+	const int BVH_LEAF_SIZE = 4;
+	// slides per move; more only helps in tight corners
+	const int MAX_SLIDE_ITERATIONS = 4;
+	// distance kept between the sphere and the surfaces it touches
+	const float CONTACT_SKIN = 0.005f;
+	// motions shorter than this are finished
+	const float MIN_MOTION = 0.0001f;
+
+	bool BoxesOverlap(const BoundingVolumes::BOX& a, const BoundingVolumes::BOX& b)
+	{
+		return((a.minimum.x <= b.maximum.x) && (a.maximum.x >= b.minimum.x) &&
+			(a.minimum.y <= b.maximum.y) && (a.maximum.y >= b.minimum.y) &&
+			(a.minimum.z <= b.maximum.z) && (a.maximum.z >= b.minimum.z));
+	}
+
+	glm::vec3 BoxCenter(const BoundingVolumes::BOX& box)
+	{
+		return((box.minimum + box.maximum) * 0.5f);
+	}
+
+	// the smallest root of a*x^2 + b*x + c in [0, maxRoot]
+	bool LowestRoot(float a, float b, float c, float maxRoot, float& root)
+	{
+		float determinant = b * b - 4.0f * a * c;
+		if ((determinant < 0.0f) || (fabsf(a) < FLT_EPSILON))
+		{
+			return(false);
+		}
+
+		float squareRoot = sqrtf(determinant);
+		float r1 = (-b - squareRoot) / (2.0f * a);
+		float r2 = (-b + squareRoot) / (2.0f * a);
+		if (r1 > r2)
+		{
+			std::swap(r1, r2);
+		}
+
+		if ((r1 > 0.0f) && (r1 < maxRoot))
+		{
+			root = r1;
+			return(true);
+		}
+		if ((r2 > 0.0f) && (r2 < maxRoot))
+		{
+			root = r2;
+			return(true);
+		}
+		return(false);
+	}
+
+	// true when a point in the triangle's plane lies inside its edges
+	bool IsPointInTriangle(glm::vec3 point, glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 normal)
+	{
+		return((glm::dot(glm::cross(b - a, point - a), normal) >= 0.0f) &&
+			(glm::dot(glm::cross(c - b, point - b), normal) >= 0.0f) &&
+			(glm::dot(glm::cross(a - c, point - c), normal) >= 0.0f));
+	}
+}
+
+/***********************************************************
+ *  CollisionWorld()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CollisionWorld::CollisionWorld()
+{
+	ResetStats();
+}
+
+/***********************************************************
+ *  ~CollisionWorld()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CollisionWorld::~CollisionWorld()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method adds a collider made of the triangles of a
+ *  mesh placed in the world.  Degenerate triangles, such as
+ *  those of a mesh scaled flat, are left out.
+ ***********************************************************/
+void CollisionWorld::AddMesh(
+	const float* positions,
+	int vertexCount,
+	int stride,
+	const uint32_t* indices,
+	int indexCount,
+	const glm::mat4& model)
+{
+	COLLIDER collider;
+	collider.firstTriangle = (int)m_triangles.size();
+	collider.triangleCount = 0;
+	collider.bounds.minimum = glm::vec3(FLT_MAX);
+	collider.bounds.maximum = glm::vec3(-FLT_MAX);
+
+	for (int i = 0; i + 2 < indexCount; i += 3)
+	{
+		glm::vec3 corners[3];
+		bool bValid = true;
+		for (int j = 0; j < 3; j++)
+		{
+			int vertex = (int)indices[i + j];
+			if (vertex >= vertexCount)
+			{
+				bValid = false;
+				break;
+			}
+			const float* position = positions + (size_t)vertex * stride;
+			corners[j] = glm::vec3(model * glm::vec4(position[0], position[1], position[2], 1.0f));
+		}
+
+		glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		float length = glm::length(normal);
+		if (!bValid || (length < FLT_EPSILON))
+		{
+			continue;
+		}
+
+		TRIANGLE triangle;
+		triangle.a = corners[0];
+		triangle.b = corners[1];
+		triangle.c = corners[2];
+		triangle.normal = normal / length;
+		m_triangles.push_back(triangle);
+		collider.triangleCount++;
+
+		for (int j = 0; j < 3; j++)
+		{
+			collider.bounds.minimum = glm::min(collider.bounds.minimum, corners[j]);
+			collider.bounds.maximum = glm::max(collider.bounds.maximum, corners[j]);
+		}
+	}
+
+	if (collider.triangleCount > 0)
+	{
+		m_colliders.push_back(collider);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes every collider and the hierarchy.
+ ***********************************************************/
+void CollisionWorld::Clear()
+{
+	m_triangles.clear();
+	m_colliders.clear();
+	m_colliderOrder.clear();
+	m_nodes.clear();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method builds the bounding volume hierarchy over the
+ *  collider boxes, splitting at the median along the longest
+ *  axis of the box centers.
+ ***********************************************************/
+void CollisionWorld::Build()
+{
+	m_nodes.clear();
+	m_colliderOrder.resize(m_colliders.size());
+	for (size_t i = 0; i < m_colliders.size(); i++)
+	{
+		m_colliderOrder[i] = (int)i;
+	}
+
+	if (!m_colliders.empty())
+	{
+		m_nodes.reserve(m_colliders.size() * 2);
+		BuildNode(0, (int)m_colliders.size());
+		// a median split hierarchy needs far fewer, so the queries
+		// do not allocate
+		m_traversal.reserve(64);
+	}
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method builds the node of a run of colliders and
+ *  returns its index.
+ ***********************************************************/
+int CollisionWorld::BuildNode(int first, int count)
+{
+	int nodeIndex = (int)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+
+	BoundingVolumes::BOX bounds;
+	BoundingVolumes::BOX centerBounds;
+	bounds.minimum = centerBounds.minimum = glm::vec3(FLT_MAX);
+	bounds.maximum = centerBounds.maximum = glm::vec3(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		const BoundingVolumes::BOX& box = m_colliders[m_colliderOrder[i]].bounds;
+		bounds.minimum = glm::min(bounds.minimum, box.minimum);
+		bounds.maximum = glm::max(bounds.maximum, box.maximum);
+		glm::vec3 center = BoxCenter(box);
+		centerBounds.minimum = glm::min(centerBounds.minimum, center);
+		centerBounds.maximum = glm::max(centerBounds.maximum, center);
+	}
+
+	m_nodes[nodeIndex].bounds = bounds;
+	m_nodes[nodeIndex].secondChild = -1;
+	m_nodes[nodeIndex].firstCollider = first;
+	m_nodes[nodeIndex].colliderCount = count;
+
+	if (count <= BVH_LEAF_SIZE)
+	{
+		return(nodeIndex);
+	}
+
+	glm::vec3 extent = centerBounds.maximum - centerBounds.minimum;
+	int axis = 0;
+	if (extent.y > extent[axis])
+	{
+		axis = 1;
+	}
+	if (extent.z > extent[axis])
+	{
+		axis = 2;
+	}
+
+	int half = count / 2;
+	std::nth_element(
+		m_colliderOrder.begin() + first,
+		m_colliderOrder.begin() + first + half,
+		m_colliderOrder.begin() + first + count,
+		[this, axis](int a, int b)
+		{
+			return(BoxCenter(m_colliders[a].bounds)[axis] < BoxCenter(m_colliders[b].bounds)[axis]);
+		});
+
+	m_nodes[nodeIndex].colliderCount = 0;
+	BuildNode(first, half);
+	int secondChild = BuildNode(first + half, count - half);
+	m_nodes[nodeIndex].secondChild = secondChild;
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  CollectCandidates()
+ *
+ *  This method walks the hierarchy and gathers the colliders
+ *  whose boxes overlap the passed in box.
+ ***********************************************************/
+void CollisionWorld::CollectCandidates(const BoundingVolumes::BOX& bounds)
+{
+	m_candidates.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	m_traversal.clear();
+	m_traversal.push_back(0);
+
+	while (!m_traversal.empty())
+	{
+		int index = m_traversal.back();
+		m_traversal.pop_back();
+		const BVH_NODE& node = m_nodes[index];
+		m_stats.nodesVisited++;
+		if (!BoxesOverlap(node.bounds, bounds))
+		{
+			continue;
+		}
+
+		if (node.colliderCount > 0)
+		{
+			for (int i = node.firstCollider; i < node.firstCollider + node.colliderCount; i++)
+			{
+				if (BoxesOverlap(m_colliders[m_colliderOrder[i]].bounds, bounds))
+				{
+					m_candidates.push_back(m_colliderOrder[i]);
+				}
+			}
+		}
+		else
+		{
+			m_traversal.push_back(node.secondChild);
+			m_traversal.push_back(index + 1);
+		}
+	}
+
+	m_stats.collidersTested += (uint32_t)m_candidates.size();
+}
+
+/***********************************************************
+ *  MoveSphere()
+ *
+ *  This method moves a sphere until its first contact, then
+ *  slides the rest of the motion along the plane tangent to
+ *  the contact point, a few times at most.
+ ***********************************************************/
+glm::vec3 CollisionWorld::MoveSphere(glm::vec3 start, glm::vec3 end, float radius)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	m_stats.queries++;
+
+	glm::vec3 position = start;
+	glm::vec3 motion = end - start;
+
+	for (int iteration = 0; iteration < MAX_SLIDE_ITERATIONS; iteration++)
+	{
+		float distance = glm::length(motion);
+		if (distance < MIN_MOTION)
+		{
+			break;
+		}
+
+		SWEEP_HIT hit;
+		SweepSphere(position, motion, radius, hit);
+		if (!hit.bHit)
+		{
+			position += motion;
+			break;
+		}
+		m_stats.contacts++;
+
+		// stop just short of the contact
+		glm::vec3 direction = motion / distance;
+		float travel = distance * hit.time;
+		glm::vec3 destination = position + motion;
+		if (travel >= CONTACT_SKIN)
+		{
+			position += direction * (travel - CONTACT_SKIN);
+			hit.point -= direction * CONTACT_SKIN;
+		}
+
+		// slide along the plane through the contact point
+		glm::vec3 slideNormal = position - hit.point;
+		float slideLength = glm::length(slideNormal);
+		if (slideLength < FLT_EPSILON)
+		{
+			break;
+		}
+		slideNormal /= slideLength;
+		glm::vec3 slideDestination = destination - glm::dot(destination - hit.point, slideNormal) * slideNormal;
+		motion = slideDestination - hit.point;
+	}
+
+	m_stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return(position);
+}
+
+/***********************************************************
+ *  SweepSphere()
+ *
+ *  This method finds the earliest contact of a moving sphere
+ *  with the triangles of the colliders its path overlaps.
+ ***********************************************************/
+void CollisionWorld::SweepSphere(glm::vec3 start, glm::vec3 motion, float radius, SWEEP_HIT& hit)
+{
+	hit.bHit = false;
+	hit.time = 1.0f;
+
+	BoundingVolumes::BOX sweptBounds;
+	sweptBounds.minimum = glm::min(start, start + motion) - glm::vec3(radius);
+	sweptBounds.maximum = glm::max(start, start + motion) + glm::vec3(radius);
+	CollectCandidates(sweptBounds);
+
+	for (size_t i = 0; i < m_candidates.size(); i++)
+	{
+		const COLLIDER& collider = m_colliders[m_candidates[i]];
+		for (int j = collider.firstTriangle; j < collider.firstTriangle + collider.triangleCount; j++)
+		{
+			SweepSphereTriangle(m_triangles[j], start, motion, radius, hit);
+		}
+		m_stats.trianglesTested += (uint32_t)collider.triangleCount;
+	}
+}
+
+/***********************************************************
+ *  SweepSphereTriangle()
+ *
+ *  This method tests a moving sphere against one triangle,
+ *  first against its face and, when the sphere touches the
+ *  plane outside the triangle, against its corners and its
+ *  edges.  Triangles are two sided.  A closer earlier hit is
+ *  kept; spheres moving away from a plane never hit it.
+ ***********************************************************/
+void CollisionWorld::SweepSphereTriangle(const TRIANGLE& triangle, glm::vec3 start, glm::vec3 motion, float radius, SWEEP_HIT& hit)
+{
+	glm::vec3 normal = triangle.normal;
+	float signedDistance = glm::dot(normal, start - triangle.a);
+	if (signedDistance < 0.0f)
+	{
+		normal = -normal;
+		signedDistance = -signedDistance;
+	}
+
+	float normalDotMotion = glm::dot(normal, motion);
+	if (normalDotMotion >= 0.0f)
+	{
+		return;
+	}
+
+	// the interval in which the sphere overlaps the plane
+	float t0 = (signedDistance - radius) / -normalDotMotion;
+	float t1 = (signedDistance + radius) / -normalDotMotion;
+	if ((t0 > hit.time) || (t1 < 0.0f))
+	{
+		return;
+	}
+	t0 = std::max(t0, 0.0f);
+
+	// the sphere first touches the plane at this point; inside the
+	// triangle that is the contact
+	glm::vec3 planePoint = start - normal * radius + motion * t0;
+	if (IsPointInTriangle(planePoint, triangle.a, triangle.b, triangle.c, triangle.normal))
+	{
+		hit.bHit = true;
+		hit.time = t0;
+		hit.point = planePoint;
+		return;
+	}
+
+	float motionSquared = glm::dot(motion, motion);
+	float radiusSquared = radius * radius;
+	float bestTime = hit.time;
+	bool bFound = false;
+	glm::vec3 bestPoint;
+	float root = 0.0f;
+
+	// corners
+	const glm::vec3 corners[3] = { triangle.a, triangle.b, triangle.c };
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec3 toStart = start - corners[i];
+		float b = 2.0f * glm::dot(motion, toStart);
+		float c = glm::dot(toStart, toStart) - radiusSquared;
+		if (LowestRoot(motionSquared, b, c, bestTime, root))
+		{
+			bestTime = root;
+			bestPoint = corners[i];
+			bFound = true;
+		}
+	}
+
+	// edges
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec3 edgeStart = corners[i];
+		glm::vec3 edge = corners[(i + 1) % 3] - edgeStart;
+		glm::vec3 toEdge = edgeStart - start;
+		float edgeSquared = glm::dot(edge, edge);
+		float edgeDotMotion = glm::dot(edge, motion);
+		float edgeDotToEdge = glm::dot(edge, toEdge);
+
+		float a = edgeSquared * -motionSquared + edgeDotMotion * edgeDotMotion;
+		float b = edgeSquared * (2.0f * glm::dot(motion, toEdge)) - 2.0f * edgeDotMotion * edgeDotToEdge;
+		float c = edgeSquared * (radiusSquared - glm::dot(toEdge, toEdge)) + edgeDotToEdge * edgeDotToEdge;
+		if (LowestRoot(a, b, c, bestTime, root))
+		{
+			// only a contact between the two corners counts
+			float along = (edgeDotMotion * root - edgeDotToEdge) / edgeSquared;
+			if ((along >= 0.0f) && (along <= 1.0f))
+			{
+				bestTime = root;
+				bestPoint = edgeStart + edge * along;
+				bFound = true;
+			}
+		}
+	}
+
+	if (bFound)
+	{
+		hit.bHit = true;
+		hit.time = bestTime;
+		hit.point = bestPoint;
+	}
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method clears the query counters, usually once per
+ *  frame or report interval.
+ ***********************************************************/
+void CollisionWorld::ResetStats()
+{
+	m_stats.queries = 0;
+	m_stats.nodesVisited = 0;
+	m_stats.collidersTested = 0;
+	m_stats.trianglesTested = 0;
+	m_stats.contacts = 0;
+	m_stats.seconds = 0.0;
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// collisionworld.h
+// ============
+// swept sphere collision against the static scene geometry
+//
+// Every collider is a triangle mesh in world space with its bounding box.
+// The boxes are kept in a bounding volume hierarchy, so a query only tests
+// the triangles of the colliders its swept volume overlaps, which keeps the
+// cost nearly flat as the number of objects grows.  A moving sphere stops
+// at the first contact and slides along the touched surface with the rest
+// of its motion.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class CollisionWorld
+{
+public:
+	// work done by the queries since the last ResetStats()
+	struct COLLISION_STATS
+	{
+		uint32_t queries;
+		uint32_t nodesVisited;
+		uint32_t collidersTested;
+		uint32_t trianglesTested;
+		uint32_t contacts;
+		double seconds;
+	};
+
+	// constructor
+	CollisionWorld();
+	// destructor
+	~CollisionWorld();
+
+	// add a collider from triangle list geometry; positions holds
+	// stride floats per vertex starting with x, y, z, and the model
+	// matrix places it in the world
+	void AddMesh(
+		const float* positions,
+		int vertexCount,
+		int stride,
+		const uint32_t* indices,
+		int indexCount,
+		const glm::mat4& model);
+	// remove every collider
+	void Clear();
+	// build the hierarchy after the colliders have been added; a
+	// world whose colliders change is cleared and built again
+	void Build();
+
+	// move a sphere of the passed in radius from start toward end,
+	// sliding along what it touches; returns where it ends up
+	glm::vec3 MoveSphere(glm::vec3 start, glm::vec3 end, float radius);
+
+	size_t GetColliderCount() const { return m_colliders.size(); }
+	size_t GetTriangleCount() const { return m_triangles.size(); }
+	const COLLISION_STATS& GetStats() const { return m_stats; }
+	void ResetStats();
+
+private:
+	struct TRIANGLE
+	{
+		glm::vec3 a;
+		glm::vec3 b;
+		glm::vec3 c;
+		glm::vec3 normal;
+	};
+
+	struct COLLIDER
+	{
+		BoundingVolumes::BOX bounds;
+		int firstTriangle;
+		int triangleCount;
+	};
+
+	// leaves reference a run of m_colliderOrder, inner nodes their two
+	// children; the first child of an inner node directly follows it
+	struct BVH_NODE
+	{
+		BoundingVolumes::BOX bounds;
+		int secondChild;
+		int firstCollider;
+		int colliderCount;     // 0 for inner nodes
+	};
+
+	// the earliest contact of a sweep
+	struct SWEEP_HIT
+	{
+		bool bHit;
+		float time;            // fraction of the motion, 0 to 1
+		glm::vec3 point;
+	};
+
+	std::vector<TRIANGLE> m_triangles;
+	std::vector<COLLIDER> m_colliders;
+	std::vector<int> m_colliderOrder;
+	std::vector<BVH_NODE> m_nodes;
+	// colliders overlapping the current query, reused between queries
+	std::vector<int> m_candidates;
+	// nodes left to visit by the current query, reused as well; a
+	// vector rather than a fixed array, so no depth is too deep
+	std::vector<int> m_traversal;
+	COLLISION_STATS m_stats;
+
+	int BuildNode(int first, int count);
+	void CollectCandidates(const BoundingVolumes::BOX& bounds);
+	void SweepSphere(glm::vec3 start, glm::vec3 motion, float radius, SWEEP_HIT& hit);
+	static void SweepSphereTriangle(const TRIANGLE& triangle, glm::vec3 start, glm::vec3 motion, float radius, SWEEP_HIT& hit);
+};
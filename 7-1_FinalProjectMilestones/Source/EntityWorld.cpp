@@ -0,0 +1,708 @@
+///////////////////////////////////////////////////////////////////////////////
+// entityworld.cpp
+// ============
+// archetype based storage of the scene objects and their components
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EntityWorld.h"
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <latch>
+
+// declaration of the global variables and defines
+namespace
+{
+	// bytes of component data per chunk
+	const size_t CHUNK_BYTES = 16 * 1024;
+	// every component array starts on its own cache line
+	const size_t ARRAY_ALIGNMENT = 64;
+	// chunks handed to one worker task; enough to hide the task overhead
+	const int MIN_CHUNKS_PER_TASK = 4;
+
+	// one task of a parallel iteration; the task captures only its
+	// address, which std::function stores without a heap allocation
+	struct CHUNK_BATCH
+	{
+		const EntityWorld::CHUNK_VIEW* views;
+		int first;
+		int last;
+		const EntityWorld::ChunkFunction* pFunction;
+	};
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return((value + alignment - 1) & ~(alignment - 1));
+	}
+}
+
+/***********************************************************
+ *  EntityWorld()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EntityWorld::EntityWorld()
+{
+	m_aliveCount = 0;
+	m_structureVersion = 0;
+	m_bIterating = false;
+}
+
+/***********************************************************
+ *  ~EntityWorld()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+EntityWorld::~EntityWorld()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  ComponentSize()
+ *
+ *  This method returns the size in bytes of one component
+ *  of the passed in type.
+ ***********************************************************/
+size_t EntityWorld::ComponentSize(COMPONENT_TYPE type)
+{
+	switch (type)
+	{
+	case COMPONENT_TRANSFORM:
+		return(sizeof(TRANSFORM_COMPONENT));
+	case COMPONENT_MESH:
+		return(sizeof(MESH_COMPONENT));
+	case COMPONENT_MATERIAL:
+		return(sizeof(MATERIAL_COMPONENT));
+	case COMPONENT_BOUNDS:
+		return(sizeof(BOUNDS_COMPONENT));
+	case COMPONENT_LIGHT:
+		return(sizeof(LIGHT_COMPONENT));
+	case COMPONENT_STATIC:
+		// a tag has no array
+		return(0);
+	case COMPONENT_IMPOSTOR:
+		return(sizeof(IMPOSTOR_COMPONENT));
+	default:
+		return(0);
+	}
+}
+
+/***********************************************************
+ *  FindArchetype()
+ *
+ *  This method returns the index of the archetype with the
+ *  passed in components, creating it when it does not exist.
+ *  The chunk capacity is chosen so that the entity handles
+ *  and every component array fit in CHUNK_BYTES.
+ ***********************************************************/
+int EntityWorld::FindArchetype(COMPONENT_MASK mask)
+{
+	for (size_t i = 0; i < m_archetypes.size(); i++)
+	{
+		if (m_archetypes[i].mask == mask)
+		{
+			return((int)i);
+		}
+	}
+
+	size_t bytesPerEntity = sizeof(ENTITY);
+	size_t arrayCount = 1;
+	for (int type = 0; type < COMPONENT_COUNT; type++)
+	{
+		if (mask & MaskOf((COMPONENT_TYPE)type))
+		{
+			bytesPerEntity += ComponentSize((COMPONENT_TYPE)type);
+			arrayCount++;
+		}
+	}
+
+	ARCHETYPE archetype;
+	archetype.mask = mask;
+	archetype.capacity = (int)((CHUNK_BYTES - arrayCount * ARRAY_ALIGNMENT) / bytesPerEntity);
+	archetype.capacity = std::max(archetype.capacity, 1);
+	archetype.entityCount = 0;
+	m_archetypes.push_back(std::move(archetype));
+
+	return((int)m_archetypes.size() - 1);
+}
+
+/***********************************************************
+ *  CreateChunk()
+ *
+ *  This method allocates a chunk for the passed in archetype
+ *  and lays out its arrays, each on its own cache line.
+ ***********************************************************/
+EntityWorld::CHUNK* EntityWorld::CreateChunk(const ARCHETYPE& archetype) const
+{
+	size_t offsets[COMPONENT_COUNT + 1];
+	size_t offset = 0;
+
+	offsets[COMPONENT_COUNT] = offset;
+	offset = AlignUp(offset + sizeof(ENTITY) * archetype.capacity, ARRAY_ALIGNMENT);
+	for (int type = 0; type < COMPONENT_COUNT; type++)
+	{
+		offsets[type] = offset;
+		if (archetype.mask & MaskOf((COMPONENT_TYPE)type))
+		{
+			offset = AlignUp(offset + ComponentSize((COMPONENT_TYPE)type) * archetype.capacity, ARRAY_ALIGNMENT);
+		}
+	}
+
+	CHUNK* pChunk = new CHUNK;
+	pChunk->memory.reset(new unsigned char[offset + ARRAY_ALIGNMENT]);
+	unsigned char* base = (unsigned char*)AlignUp((size_t)pChunk->memory.get(), ARRAY_ALIGNMENT);
+
+	pChunk->entities = (ENTITY*)(base + offsets[COMPONENT_COUNT]);
+	for (int type = 0; type < COMPONENT_COUNT; type++)
+	{
+		pChunk->components[type] = NULL;
+		if (archetype.mask & MaskOf((COMPONENT_TYPE)type))
+		{
+			pChunk->components[type] = base + offsets[type];
+		}
+	}
+	pChunk->count = 0;
+
+	return(pChunk);
+}
+
+/***********************************************************
+ *  AppendRow()
+ *
+ *  This method places an entity in the next free row of an
+ *  archetype, starting a chunk when the last one is full,
+ *  and zero fills its components.
+ ***********************************************************/
+void EntityWorld::AppendRow(int archetypeIndex, uint32_t entityIndex)
+{
+	ARCHETYPE& archetype = m_archetypes[archetypeIndex];
+	if (archetype.chunks.empty() || (archetype.chunks.back()->count == archetype.capacity))
+	{
+		archetype.chunks.emplace_back(CreateChunk(archetype));
+	}
+
+	CHUNK* pChunk = archetype.chunks.back().get();
+	int row = pChunk->count++;
+	archetype.entityCount++;
+	m_structureVersion++;
+
+	ENTITY_RECORD& record = m_records[entityIndex];
+	record.archetype = archetypeIndex;
+	record.chunk = (int)archetype.chunks.size() - 1;
+	record.row = row;
+
+	pChunk->entities[row].index = entityIndex;
+	pChunk->entities[row].generation = record.generation;
+	for (int type = 0; type < COMPONENT_COUNT; type++)
+	{
+		if (pChunk->components[type] != NULL)
+		{
+			size_t size = ComponentSize((COMPONENT_TYPE)type);
+			memset((unsigned char*)pChunk->components[type] + size * row, 0, size);
+		}
+	}
+}
+
+/***********************************************************
+ *  RemoveRow()
+ *
+ *  This method removes a row from an archetype by moving the
+ *  archetype's last entity into it, so the chunks stay
+ *  densely packed, and frees the last chunk when it empties.
+ ***********************************************************/
+void EntityWorld::RemoveRow(int archetypeIndex, int chunkIndex, int row)
+{
+	ARCHETYPE& archetype = m_archetypes[archetypeIndex];
+	CHUNK* pChunk = archetype.chunks[chunkIndex].get();
+	CHUNK* pLast = archetype.chunks.back().get();
+	int lastRow = pLast->count - 1;
+
+	if ((pChunk != pLast) || (row != lastRow))
+	{
+		ENTITY moved = pLast->entities[lastRow];
+		pChunk->entities[row] = moved;
+		for (int type = 0; type < COMPONENT_COUNT; type++)
+		{
+			if (pChunk->components[type] != NULL)
+			{
+				size_t size = ComponentSize((COMPONENT_TYPE)type);
+				memcpy(
+					(unsigned char*)pChunk->components[type] + size * row,
+					(unsigned char*)pLast->components[type] + size * lastRow,
+					size);
+			}
+		}
+		m_records[moved.index].chunk = chunkIndex;
+		m_records[moved.index].row = row;
+	}
+
+	pLast->count--;
+	archetype.entityCount--;
+	m_structureVersion++;
+	if (pLast->count == 0)
+	{
+		archetype.chunks.pop_back();
+	}
+}
+
+/***********************************************************
+ *  CheckStructuralChange()
+ *
+ *  This method returns false, with a message, when entities
+ *  would move while systems iterate over the chunks.
+ ***********************************************************/
+bool EntityWorld::CheckStructuralChange() const
+{
+	if (m_bIterating)
+	{
+		std::cout << "Could not change the entities while systems iterate; queue the change instead" << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  CreateEntity()
+ *
+ *  This method creates an entity with the passed in zero
+ *  filled components and returns its handle.
+ ***********************************************************/
+EntityWorld::ENTITY EntityWorld::CreateEntity(COMPONENT_MASK mask)
+{
+	ENTITY entity = { 0, 0 };
+	if (!CheckStructuralChange())
+	{
+		return(entity);
+	}
+
+	if (!m_freeIndices.empty())
+	{
+		entity.index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	}
+	else
+	{
+		entity.index = (uint32_t)m_records.size();
+		ENTITY_RECORD record;
+		record.generation = 1;
+		record.bAlive = false;
+		record.archetype = -1;
+		record.chunk = -1;
+		record.row = -1;
+		m_records.push_back(record);
+	}
+
+	ENTITY_RECORD& record = m_records[entity.index];
+	record.bAlive = true;
+	entity.generation = record.generation;
+	AppendRow(FindArchetype(mask), entity.index);
+	m_aliveCount++;
+
+	return(entity);
+}
+
+/***********************************************************
+ *  DestroyEntity()
+ *
+ *  This method destroys an entity; its handle and any copies
+ *  of it go stale.
+ ***********************************************************/
+void EntityWorld::DestroyEntity(ENTITY entity)
+{
+	if (!IsAlive(entity) || !CheckStructuralChange())
+	{
+		return;
+	}
+
+	ENTITY_RECORD& record = m_records[entity.index];
+	RemoveRow(record.archetype, record.chunk, record.row);
+	record.bAlive = false;
+	record.generation++;
+	record.archetype = -1;
+	m_freeIndices.push_back(entity.index);
+	m_aliveCount--;
+}
+
+/***********************************************************
+ *  MoveToArchetype()
+ *
+ *  This method moves an entity to the archetype with the
+ *  passed in components, keeping the values of those it
+ *  already had.
+ ***********************************************************/
+void EntityWorld::MoveToArchetype(ENTITY entity, COMPONENT_MASK mask)
+{
+	ENTITY_RECORD& record = m_records[entity.index];
+	if (m_archetypes[record.archetype].mask == mask)
+	{
+		return;
+	}
+
+	int oldArchetype = record.archetype;
+	int oldChunk = record.chunk;
+	int oldRow = record.row;
+
+	// the source chunk stays allocated until its row is removed below
+	AppendRow(FindArchetype(mask), entity.index);
+	CHUNK* pSource = m_archetypes[oldArchetype].chunks[oldChunk].get();
+	CHUNK* pTarget = m_archetypes[record.archetype].chunks[record.chunk].get();
+	for (int type = 0; type < COMPONENT_COUNT; type++)
+	{
+		if ((pSource->components[type] != NULL) && (pTarget->components[type] != NULL))
+		{
+			size_t size = ComponentSize((COMPONENT_TYPE)type);
+			memcpy(
+				(unsigned char*)pTarget->components[type] + size * record.row,
+				(unsigned char*)pSource->components[type] + size * oldRow,
+				size);
+		}
+	}
+
+	RemoveRow(oldArchetype, oldChunk, oldRow);
+}
+
+/***********************************************************
+ *  AddComponents()
+ *
+ *  This method adds zero filled components to an entity.
+ ***********************************************************/
+void EntityWorld::AddComponents(ENTITY entity, COMPONENT_MASK mask)
+{
+	if (!IsAlive(entity) || !CheckStructuralChange())
+	{
+		return;
+	}
+	MoveToArchetype(entity, GetMask(entity) | mask);
+}
+
+/***********************************************************
+ *  RemoveComponents()
+ *
+ *  This method removes components from an entity.
+ ***********************************************************/
+void EntityWorld::RemoveComponents(ENTITY entity, COMPONENT_MASK mask)
+{
+	if (!IsAlive(entity) || !CheckStructuralChange())
+	{
+		return;
+	}
+	MoveToArchetype(entity, GetMask(entity) & ~mask);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method destroys every entity.  The archetypes are
+ *  kept, without their chunks.
+ ***********************************************************/
+void EntityWorld::Clear()
+{
+	for (size_t i = 0; i < m_archetypes.size(); i++)
+	{
+		m_archetypes[i].chunks.clear();
+		m_archetypes[i].entityCount = 0;
+	}
+
+	m_freeIndices.clear();
+	for (uint32_t i = 0; i < (uint32_t)m_records.size(); i++)
+	{
+		if (m_records[i].bAlive)
+		{
+			m_records[i].bAlive = false;
+			m_records[i].generation++;
+			m_records[i].archetype = -1;
+		}
+		m_freeIndices.push_back(i);
+	}
+	m_aliveCount = 0;
+	m_structureVersion++;
+
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.clear();
+}
+
+/***********************************************************
+ *  IsAlive()
+ *
+ *  This method returns true when the handle still refers to
+ *  an existing entity.
+ ***********************************************************/
+bool EntityWorld::IsAlive(ENTITY entity) const
+{
+	return((entity.index < m_records.size()) &&
+		m_records[entity.index].bAlive &&
+		(m_records[entity.index].generation == entity.generation));
+}
+
+/***********************************************************
+ *  GetMask()
+ *
+ *  This method returns the components of an entity, or none
+ *  for a stale handle.
+ ***********************************************************/
+EntityWorld::COMPONENT_MASK EntityWorld::GetMask(ENTITY entity) const
+{
+	if (!IsAlive(entity))
+	{
+		return(0);
+	}
+	return(m_archetypes[m_records[entity.index].archetype].mask);
+}
+
+/***********************************************************
+ *  GetComponentData()
+ *
+ *  This method returns the address of a component of an
+ *  entity, or NULL when the entity does not have it.  The
+ *  address is valid until the next structural change.
+ ***********************************************************/
+void* EntityWorld::GetComponentData(ENTITY entity, COMPONENT_TYPE type)
+{
+	if (!IsAlive(entity))
+	{
+		return(NULL);
+	}
+
+	const ENTITY_RECORD& record = m_records[entity.index];
+	CHUNK* pChunk = m_archetypes[record.archetype].chunks[record.chunk].get();
+	if (pChunk->components[type] == NULL)
+	{
+		return(NULL);
+	}
+	return((unsigned char*)pChunk->components[type] + ComponentSize(type) * record.row);
+}
+
+/***********************************************************
+ *  QueueCreateEntity()
+ *
+ *  This method records the creation of an entity for the
+ *  next PlaybackCommands().
+ ***********************************************************/
+void EntityWorld::QueueCreateEntity(COMPONENT_MASK mask, EntityInitializer initializer)
+{
+	COMMAND command;
+	command.type = COMMAND_CREATE;
+	command.entity.index = 0;
+	command.entity.generation = 0;
+	command.mask = mask;
+	command.initializer = std::move(initializer);
+
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.push_back(std::move(command));
+}
+
+/***********************************************************
+ *  QueueDestroyEntity()
+ *
+ *  This method records the destruction of an entity for the
+ *  next PlaybackCommands().
+ ***********************************************************/
+void EntityWorld::QueueDestroyEntity(ENTITY entity)
+{
+	COMMAND command;
+	command.type = COMMAND_DESTROY;
+	command.entity = entity;
+	command.mask = 0;
+
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.push_back(std::move(command));
+}
+
+/***********************************************************
+ *  QueueAddComponents()
+ *
+ *  This method records adding components to an entity for
+ *  the next PlaybackCommands().
+ ***********************************************************/
+void EntityWorld::QueueAddComponents(ENTITY entity, COMPONENT_MASK mask)
+{
+	COMMAND command;
+	command.type = COMMAND_ADD_COMPONENTS;
+	command.entity = entity;
+	command.mask = mask;
+
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.push_back(std::move(command));
+}
+
+/***********************************************************
+ *  QueueRemoveComponents()
+ *
+ *  This method records removing components from an entity
+ *  for the next PlaybackCommands().
+ ***********************************************************/
+void EntityWorld::QueueRemoveComponents(ENTITY entity, COMPONENT_MASK mask)
+{
+	COMMAND command;
+	command.type = COMMAND_REMOVE_COMPONENTS;
+	command.entity = entity;
+	command.mask = mask;
+
+	std::lock_guard<std::mutex> lock(m_commandMutex);
+	m_commands.push_back(std::move(command));
+}
+
+/***********************************************************
+ *  PlaybackCommands()
+ *
+ *  This method applies the queued structural changes.  It is
+ *  called at the frame boundary, when no system iterates.
+ *  Commands queued by the initializers are applied as well.
+ ***********************************************************/
+void EntityWorld::PlaybackCommands()
+{
+	std::vector<COMMAND> commands;
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_commandMutex);
+			if (m_commands.empty())
+			{
+				break;
+			}
+			commands.swap(m_commands);
+		}
+
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			COMMAND& command = commands[i];
+			switch (command.type)
+			{
+			case COMMAND_CREATE:
+			{
+				ENTITY entity = CreateEntity(command.mask);
+				if (command.initializer)
+				{
+					command.initializer(*this, entity);
+				}
+				break;
+			}
+			case COMMAND_DESTROY:
+				DestroyEntity(command.entity);
+				break;
+			case COMMAND_ADD_COMPONENTS:
+				AddComponents(command.entity, command.mask);
+				break;
+			case COMMAND_REMOVE_COMPONENTS:
+				RemoveComponents(command.entity, command.mask);
+				break;
+			}
+		}
+		commands.clear();
+	}
+}
+
+/***********************************************************
+ *  ForEachChunk()
+ *
+ *  This method calls the passed in function for every chunk
+ *  holding at least the required components.
+ ***********************************************************/
+void EntityWorld::ForEachChunk(COMPONENT_MASK required, const ChunkFunction& function, COMPONENT_MASK excluded)
+{
+	bool bWasIterating = m_bIterating;
+	m_bIterating = true;
+
+	for (size_t i = 0; i < m_archetypes.size(); i++)
+	{
+		const ARCHETYPE& archetype = m_archetypes[i];
+		if (((archetype.mask & required) != required) || ((archetype.mask & excluded) != 0))
+		{
+			continue;
+		}
+
+		for (size_t j = 0; j < archetype.chunks.size(); j++)
+		{
+			const CHUNK* pChunk = archetype.chunks[j].get();
+			CHUNK_VIEW view;
+			view.count = pChunk->count;
+			view.entities = pChunk->entities;
+			memcpy(view.components, pChunk->components, sizeof(view.components));
+			function(view);
+		}
+	}
+
+	m_bIterating = bWasIterating;
+}
+
+/***********************************************************
+ *  ParallelForEachChunk()
+ *
+ *  This method spreads the matching chunks over the worker
+ *  threads in contiguous batches, so each thread streams
+ *  through its own part of memory, and waits for those
+ *  batches only; other tasks of the shared pool, such as
+ *  asset decoding, may still be running when it returns.
+ *  The function must only touch the chunk it is passed.  The
+ *  chunk list and the batches live in the frame arena.
+ ***********************************************************/
+void EntityWorld::ParallelForEachChunk(WorkerPool& pool, COMPONENT_MASK required, const ChunkFunction& function, COMPONENT_MASK excluded)
+{
+	int chunkCount = 0;
+	for (size_t i = 0; i < m_archetypes.size(); i++)
+	{
+		if (((m_archetypes[i].mask & required) == required) && ((m_archetypes[i].mask & excluded) == 0))
+		{
+			chunkCount += (int)m_archetypes[i].chunks.size();
+		}
+	}
+
+	// a few batches per thread evens out chunks of different cost
+	int threadCount = std::max(pool.GetThreadCount(), 1);
+	int batchSize = std::max(MIN_CHUNKS_PER_TASK, (chunkCount + threadCount * 4 - 1) / (threadCount * 4));
+	if ((chunkCount <= batchSize) || (pool.GetThreadCount() == 0))
+	{
+		ForEachChunk(required, function, excluded);
+		return;
+	}
+
+	FrameArena& arena = FrameArena::GetThreadArena();
+	CHUNK_VIEW* views = arena.AllocateArray<CHUNK_VIEW>(chunkCount);
+	int viewCount = 0;
+	for (size_t i = 0; i < m_archetypes.size(); i++)
+	{
+		const ARCHETYPE& archetype = m_archetypes[i];
+		if (((archetype.mask & required) != required) || ((archetype.mask & excluded) != 0))
+		{
+			continue;
+		}
+
+		for (size_t j = 0; j < archetype.chunks.size(); j++)
+		{
+			const CHUNK* pChunk = archetype.chunks[j].get();
+			CHUNK_VIEW& view = views[viewCount++];
+			view.count = pChunk->count;
+			view.entities = pChunk->entities;
+			memcpy(view.components, pChunk->components, sizeof(view.components));
+		}
+	}
+
+	bool bWasIterating = m_bIterating;
+	m_bIterating = true;
+
+	int batchCount = (chunkCount + batchSize - 1) / batchSize;
+	CHUNK_BATCH* batches = arena.AllocateArray<CHUNK_BATCH>(batchCount);
+	std::latch batchesDone(batchCount);
+	for (int i = 0; i < batchCount; i++)
+	{
+		CHUNK_BATCH* pBatch = &batches[i];
+		pBatch->views = views;
+		pBatch->first = i * batchSize;
+		pBatch->last = std::min(pBatch->first + batchSize, chunkCount);
+		pBatch->pFunction = &function;
+		pool.Submit([pBatch, &batchesDone]()
+			{
+				for (int j = pBatch->first; j < pBatch->last; j++)
+				{
+					(*pBatch->pFunction)(pBatch->views[j]);
+				}
+				batchesDone.count_down();
+			});
+	}
+	batchesDone.wait();
+
+	m_bIterating = bWasIterating;
+}
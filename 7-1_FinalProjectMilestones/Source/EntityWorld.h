@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// entityworld.h
+// ============
+// archetype based storage of the scene objects and their components
+//
+// Entities with the same set of components share an archetype.  An
+// archetype stores its entities in fixed size chunks, and inside a chunk
+// every component type has its own contiguous array, so a system that
+// reads only transforms streams through transforms and nothing else.
+// Removing an entity moves the archetype's last entity into its place,
+// which keeps every chunk but the last one full.
+//
+// Structural changes (creating and destroying entities, adding and
+// removing components) move entities between chunks, so they must not
+// happen while systems iterate.  Systems record them in the command buffer
+// instead, and PlaybackCommands() applies them at the frame boundary.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "WorkerPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class EntityWorld
+{
+public:
+	// the component types; each has one bit in a COMPONENT_MASK
+	enum COMPONENT_TYPE
+	{
+		COMPONENT_TRANSFORM,
+		COMPONENT_MESH,
+		COMPONENT_MATERIAL,
+		COMPONENT_BOUNDS,
+		COMPONENT_LIGHT,
+		COMPONENT_STATIC,
+		COMPONENT_IMPOSTOR,
+		COMPONENT_COUNT
+	};
+
+	typedef uint32_t COMPONENT_MASK;
+
+	static COMPONENT_MASK MaskOf(COMPONENT_TYPE type) { return (COMPONENT_MASK)1 << type; }
+
+	// placement in the world; model is derived from the other values
+	// by the transform system
+	struct TRANSFORM_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_TRANSFORM;
+		glm::vec3 scale;
+		glm::vec3 rotationDegrees;  // applied X, then Y, then Z
+		glm::vec3 position;
+		glm::mat4 model;
+	};
+
+	struct MESH_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_MESH;
+		int mesh;
+	};
+
+	// everything the shader needs to draw the mesh
+	struct MATERIAL_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_MATERIAL;
+		int materialIndex;        // -1 for none
+		int textureSlot;          // -1 draws with the solid color
+		bool bVideoTexture;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		uint32_t pickID;
+	};
+
+	// mesh bounds and their world space box, updated with the model
+	struct BOUNDS_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_BOUNDS;
+		BoundingVolumes::BOX local;
+		BoundingVolumes::BOX world;
+	};
+
+	enum LIGHT_TYPE
+	{
+		LIGHT_DIRECTIONAL,
+		LIGHT_POINT
+	};
+
+	// a light source, placed by the entity's transform
+	struct LIGHT_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_LIGHT;
+		int type;
+		glm::vec3 direction;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+	};
+
+	// a tag without data for entities whose transform never changes;
+	// their model matrix and bounds are set once when they are created
+	struct STATIC_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_STATIC;
+	};
+
+	// a part of an assembly that an impostor replaces in the distance;
+	// instance is the impostor's handle in the ImpostorRenderer
+	struct IMPOSTOR_COMPONENT
+	{
+		static const COMPONENT_TYPE TYPE = COMPONENT_IMPOSTOR;
+		int instance;
+	};
+
+	// a handle that goes stale when its entity is destroyed
+	struct ENTITY
+	{
+		uint32_t index;
+		uint32_t generation;
+	};
+
+	// the arrays of one chunk, for the systems
+	class CHUNK_VIEW
+	{
+	public:
+		int count;
+		const ENTITY* entities;
+
+		// the component array of the chunk, NULL when the archetype
+		// has no such component
+		template <typename T>
+		T* Get() const { return (T*)components[T::TYPE]; }
+
+	private:
+		friend class EntityWorld;
+		void* components[COMPONENT_COUNT];
+	};
+
+	typedef std::function<void(const CHUNK_VIEW& chunk)> ChunkFunction;
+	typedef std::function<void(EntityWorld& world, ENTITY entity)> EntityInitializer;
+
+	// constructor
+	EntityWorld();
+	// destructor
+	~EntityWorld();
+
+	// immediate structural changes, not allowed while systems iterate;
+	// new components are zero filled
+	ENTITY CreateEntity(COMPONENT_MASK mask);
+	void DestroyEntity(ENTITY entity);
+	void AddComponents(ENTITY entity, COMPONENT_MASK mask);
+	void RemoveComponents(ENTITY entity, COMPONENT_MASK mask);
+	// remove every entity
+	void Clear();
+
+	bool IsAlive(ENTITY entity) const;
+	COMPONENT_MASK GetMask(ENTITY entity) const;
+	template <typename T>
+	T* GetComponent(ENTITY entity) { return (T*)GetComponentData(entity, T::TYPE); }
+
+	// deferred structural changes, safe to call from any thread; the
+	// initializer of a created entity runs during the playback
+	void QueueCreateEntity(COMPONENT_MASK mask, EntityInitializer initializer);
+	void QueueDestroyEntity(ENTITY entity);
+	void QueueAddComponents(ENTITY entity, COMPONENT_MASK mask);
+	void QueueRemoveComponents(ENTITY entity, COMPONENT_MASK mask);
+	// apply the queued changes in the order they were recorded
+	void PlaybackCommands();
+
+	// call the function for every chunk whose archetype has all the
+	// required components and none of the excluded ones, in creation
+	// order of the archetypes
+	void ForEachChunk(COMPONENT_MASK required, const ChunkFunction& function, COMPONENT_MASK excluded = 0);
+	// the same on the worker threads, one batch of chunks per task;
+	// returns when every chunk has been processed
+	void ParallelForEachChunk(WorkerPool& pool, COMPONENT_MASK required, const ChunkFunction& function, COMPONENT_MASK excluded = 0);
+
+	size_t GetEntityCount() const { return m_aliveCount; }
+	// changes whenever an entity is added, removed or moved between
+	// rows, so a copy of the chunks can tell when it went stale
+	uint64_t GetStructureVersion() const { return m_structureVersion; }
+	size_t GetArchetypeCount() const { return m_archetypes.size(); }
+
+private:
+	struct CHUNK
+	{
+		std::unique_ptr<unsigned char[]> memory;
+		ENTITY* entities;
+		void* components[COMPONENT_COUNT];
+		int count;
+	};
+
+	struct ARCHETYPE
+	{
+		COMPONENT_MASK mask;
+		int capacity;             // entities per chunk
+		std::vector<std::unique_ptr<CHUNK> > chunks;
+		size_t entityCount;
+	};
+
+	// where an entity lives, indexed by ENTITY::index
+	struct ENTITY_RECORD
+	{
+		uint32_t generation;
+		bool bAlive;
+		int archetype;
+		int chunk;
+		int row;
+	};
+
+	enum COMMAND_TYPE
+	{
+		COMMAND_CREATE,
+		COMMAND_DESTROY,
+		COMMAND_ADD_COMPONENTS,
+		COMMAND_REMOVE_COMPONENTS
+	};
+
+	struct COMMAND
+	{
+		COMMAND_TYPE type;
+		ENTITY entity;
+		COMPONENT_MASK mask;
+		EntityInitializer initializer;
+	};
+
+	std::vector<ARCHETYPE> m_archetypes;
+	std::vector<ENTITY_RECORD> m_records;
+	std::vector<uint32_t> m_freeIndices;
+	size_t m_aliveCount;
+	uint64_t m_structureVersion;
+	// true while systems run over the chunks
+	bool m_bIterating;
+
+	std::mutex m_commandMutex;
+	std::vector<COMMAND> m_commands;
+
+	static size_t ComponentSize(COMPONENT_TYPE type);
+	int FindArchetype(COMPONENT_MASK mask);
+	CHUNK* CreateChunk(const ARCHETYPE& archetype) const;
+	// reserve the next row of an archetype for an entity
+	void AppendRow(int archetypeIndex, uint32_t entityIndex);
+	// fill a row's hole with the archetype's last entity
+	void RemoveRow(int archetypeIndex, int chunkIndex, int row);
+	void MoveToArchetype(ENTITY entity, COMPONENT_MASK mask);
+	void* GetComponentData(ENTITY entity, COMPONENT_TYPE type);
+	bool CheckStructuralChange() const;
+};
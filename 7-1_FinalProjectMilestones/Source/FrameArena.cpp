@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// linear allocator for memory that only lives until the next frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	// starting size of the arena of every thread
+	const size_t THREAD_ARENA_CAPACITY = 256 * 1024;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return((value + alignment - 1) & ~(alignment - 1));
+	}
+}
+
+std::atomic<uint64_t> FrameArena::s_frame(0);
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t capacity)
+{
+	m_capacity = capacity;
+	m_pBuffer = new unsigned char[m_capacity];
+	m_used = 0;
+	m_peak = 0;
+	m_frame = s_frame.load(std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	Reset();
+	delete[] m_pBuffer;
+	m_pBuffer = NULL;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method returns memory of the passed in size and
+ *  power of two alignment.  It moves the offset forward, or
+ *  takes a heap block when the buffer is full.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	size_t base = (size_t)m_pBuffer;
+	size_t offset = AlignUp(base + m_used, alignment) - base;
+	if (offset + size <= m_capacity)
+	{
+		m_used = offset + size;
+		m_peak = (m_used > m_peak) ? m_used : m_peak;
+		return(m_pBuffer + offset);
+	}
+
+	// counted as used so the buffer grows to fit the whole frame
+	m_used += size + alignment;
+	m_peak = (m_used > m_peak) ? m_used : m_peak;
+	unsigned char* pBlock = new unsigned char[size + alignment];
+	m_overflowBlocks.push_back(pBlock);
+	return((void*)AlignUp((size_t)pBlock, alignment));
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method releases the allocations of the frame.  When
+ *  the frame overflowed, the buffer is replaced by one large
+ *  enough for the peak.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	if (!m_overflowBlocks.empty())
+	{
+		for (size_t i = 0; i < m_overflowBlocks.size(); i++)
+		{
+			delete[] m_overflowBlocks[i];
+		}
+		m_overflowBlocks.clear();
+
+		delete[] m_pBuffer;
+		m_capacity = AlignUp(m_peak + m_peak / 2, 4096);
+		m_pBuffer = new unsigned char[m_capacity];
+	}
+
+	m_used = 0;
+	m_frame = s_frame.load(std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  GetThreadArena()
+ *
+ *  This method returns the arena of the calling thread,
+ *  created on its first use and reset when a new frame has
+ *  begun since it was last used.
+ ***********************************************************/
+FrameArena& FrameArena::GetThreadArena()
+{
+	thread_local FrameArena arena(THREAD_ARENA_CAPACITY);
+	if (arena.m_frame != s_frame.load(std::memory_order_relaxed))
+	{
+		arena.Reset();
+	}
+	return(arena);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method ends the lifetime of every allocation of the
+ *  previous frame, in all thread arenas.
+ ***********************************************************/
+void FrameArena::BeginFrame()
+{
+	s_frame.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// linear allocator for memory that only lives until the next frame
+//
+// Allocation bumps an offset into one buffer and nothing is freed
+// individually; the whole arena is reset at the start of the next frame.
+// Every thread has its own arena, so the worker threads allocate without
+// locks.  When a frame needs more than the buffer holds, the rest comes
+// from the heap and the buffer grows to the peak at the next reset, so
+// after the first few frames the arena never touches the heap.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t capacity);
+	// destructor
+	~FrameArena();
+
+	// uninitialized memory valid until the arena is reset
+	void* Allocate(size_t size, size_t alignment = 16);
+	template <typename T>
+	T* AllocateArray(size_t count) { return (T*)Allocate(sizeof(T) * count, alignof(T)); }
+
+	// release everything allocated since the last reset
+	void Reset();
+
+	size_t GetUsed() const { return m_used; }
+	size_t GetCapacity() const { return m_capacity; }
+	size_t GetPeak() const { return m_peak; }
+
+	// the arena of the calling thread, reset on its first use in every
+	// frame; only objects of the current frame may be kept in it
+	static FrameArena& GetThreadArena();
+	// start a new frame for every thread arena; called by the thread
+	// that owns the render loop
+	static void BeginFrame();
+
+private:
+	unsigned char* m_pBuffer;
+	size_t m_capacity;
+	size_t m_used;
+	size_t m_peak;
+	// heap blocks of the allocations that did not fit this frame
+	std::vector<unsigned char*> m_overflowBlocks;
+	// the frame the arena was last reset for
+	uint64_t m_frame;
+
+	static std::atomic<uint64_t> s_frame;
+};
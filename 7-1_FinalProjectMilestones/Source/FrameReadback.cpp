@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// framereadback.cpp
+// ============
+// asynchronous framebuffer readback through a ring of pixel buffer objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameReadback.h"
+
+#include "GLFW/glfw3.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  FrameReadback()
+ *
+ *  The constructor for the class.  The pixel buffers are
+ *  created lazily by the first readback that needs them.
+ ***********************************************************/
+FrameReadback::FrameReadback(int ringSize)
+{
+	if (ringSize < 1)
+	{
+		ringSize = 1;
+	}
+
+	m_slots.resize(ringSize);
+	for (int i = 0; i < ringSize; i++)
+	{
+		m_slots[i].pbo = 0;
+		m_slots[i].capacity = 0;
+		m_slots[i].fence = NULL;
+	}
+	m_head = 0;
+	m_pendingCount = 0;
+	m_droppedCount = 0;
+	m_stallSeconds = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameReadback()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameReadback::~FrameReadback()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the pixel buffers and any fences that
+ *  are still waiting.  Pending frames are discarded.
+ ***********************************************************/
+void FrameReadback::Destroy()
+{
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (NULL != m_slots[i].fence)
+		{
+			glDeleteSync(m_slots[i].fence);
+			m_slots[i].fence = NULL;
+		}
+		if (0 != m_slots[i].pbo)
+		{
+			glDeleteBuffers(1, &m_slots[i].pbo);
+			m_slots[i].pbo = 0;
+		}
+		m_slots[i].capacity = 0;
+	}
+	m_head = 0;
+	m_pendingCount = 0;
+}
+
+/***********************************************************
+ *  BytesPerPixel()
+ *
+ *  This method returns the packed pixel size for the
+ *  format/type pairs used by the readback consumers.
+ ***********************************************************/
+int FrameReadback::BytesPerPixel(GLenum format, GLenum type)
+{
+	int components = 4;
+	switch (format)
+	{
+	case GL_RED:
+	case GL_RED_INTEGER:
+	case GL_DEPTH_COMPONENT:
+		components = 1;
+		break;
+	case GL_RG:
+	case GL_RG_INTEGER:
+		components = 2;
+		break;
+	case GL_RGB:
+	case GL_BGR:
+		components = 3;
+		break;
+	default:
+		components = 4;
+		break;
+	}
+
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:
+		return(components);
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:
+		return(components * 2);
+	default:
+		return(components * 4);
+	}
+}
+
+/***********************************************************
+ *  QueueReadback()
+ *
+ *  This method copies a region of the bound read framebuffer
+ *  into the next free pixel buffer and fences the copy.
+ ***********************************************************/
+bool FrameReadback::QueueReadback(
+	int x, int y, int width, int height,
+	GLenum format, GLenum type,
+	uint64_t frameNumber,
+	uint64_t userValue,
+	bool bWaitWhenFull,
+	const ReadbackHandler& handler)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	// deliver anything that has already finished to free up slots
+	ProcessCompleted(handler);
+
+	if (m_pendingCount == (int)m_slots.size())
+	{
+		if (bWaitWhenFull == false)
+		{
+			m_droppedCount++;
+			return(false);
+		}
+
+		// the ring is full, so the oldest readback has to be waited on
+		double stallStart = glfwGetTime();
+		glClientWaitSync(m_slots[m_head].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		m_stallSeconds += glfwGetTime() - stallStart;
+		DeliverOldest(handler);
+	}
+
+	int slotIndex = (m_head + m_pendingCount) % (int)m_slots.size();
+	READBACK_SLOT& slot = m_slots[slotIndex];
+
+	// rows are packed tightly apart from the GL_PACK_ALIGNMENT of 4
+	int stride = ((width * BytesPerPixel(format, type)) + 3) & ~3;
+	GLsizeiptr requiredSize = (GLsizeiptr)stride * height;
+
+	if (0 == slot.pbo)
+	{
+		glGenBuffers(1, &slot.pbo);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	if (slot.capacity < requiredSize)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, requiredSize, NULL, GL_STREAM_READ);
+		slot.capacity = requiredSize;
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	// with a pack buffer bound the last argument is an offset, so this
+	// call only schedules the copy and returns straight away
+	glReadPixels(x, y, width, height, format, type, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	slot.frame.pixels = NULL;
+	slot.frame.width = width;
+	slot.frame.height = height;
+	slot.frame.stride = stride;
+	slot.frame.format = format;
+	slot.frame.type = type;
+	slot.frame.frameNumber = frameNumber;
+	slot.frame.queueTime = glfwGetTime();
+	slot.frame.userValue = userValue;
+
+	m_pendingCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ProcessCompleted()
+ *
+ *  This method polls the fences of the pending readbacks
+ *  without blocking and delivers the finished ones in order.
+ ***********************************************************/
+int FrameReadback::ProcessCompleted(const ReadbackHandler& handler)
+{
+	int delivered = 0;
+
+	while (m_pendingCount > 0)
+	{
+		GLenum waitResult = glClientWaitSync(m_slots[m_head].fence, 0, 0);
+		if ((waitResult != GL_ALREADY_SIGNALED) &&
+			(waitResult != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+
+		DeliverOldest(handler);
+		delivered++;
+	}
+
+	return(delivered);
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method waits for every pending readback to finish.
+ *  It is meant for shutdown and for the end of a batch.
+ ***********************************************************/
+void FrameReadback::Flush(const ReadbackHandler& handler)
+{
+	while (m_pendingCount > 0)
+	{
+		double stallStart = glfwGetTime();
+		glClientWaitSync(m_slots[m_head].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		m_stallSeconds += glfwGetTime() - stallStart;
+		DeliverOldest(handler);
+	}
+}
+
+/***********************************************************
+ *  DeliverOldest()
+ *
+ *  This method maps the oldest pixel buffer, whose fence is
+ *  known to have signaled, and passes it to the handler.
+ ***********************************************************/
+void FrameReadback::DeliverOldest(const ReadbackHandler& handler)
+{
+	READBACK_SLOT& slot = m_slots[m_head];
+
+	glDeleteSync(slot.fence);
+	slot.fence = NULL;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	void* pMapped = glMapBufferRange(
+		GL_PIXEL_PACK_BUFFER,
+		0,
+		(GLsizeiptr)slot.frame.stride * slot.frame.height,
+		GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		slot.frame.pixels = (const unsigned char*)pMapped;
+		if (handler)
+		{
+			handler(slot.frame);
+		}
+		slot.frame.pixels = NULL;
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		std::cout << "FrameReadback: could not map pixel buffer for frame " << slot.frame.frameNumber << std::endl;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_head = (m_head + 1) % (int)m_slots.size();
+	m_pendingCount--;
+}
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// framereadback.h
+// ============
+// asynchronous framebuffer readback through a ring of pixel buffer objects
+//
+// glReadPixels into a bound GL_PIXEL_PACK_BUFFER returns immediately, and a
+// fence placed after it tells us when the copy has really finished.  The
+// pixels are only mapped once the fence has signaled, usually two or three
+// frames later, so the render loop never waits on the GPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class FrameReadback
+{
+public:
+	// a finished readback, valid only for the duration of the handler call
+	struct READBACK_FRAME
+	{
+		const unsigned char* pixels;
+		int width;
+		int height;
+		int stride;              // bytes per row, rows are bottom-to-top
+		GLenum format;
+		GLenum type;
+		uint64_t frameNumber;    // caller supplied frame counter
+		double queueTime;        // seconds, when the readback was issued
+		uint64_t userValue;      // caller supplied tag, e.g. a job index
+	};
+
+	typedef std::function<void(const READBACK_FRAME&)> ReadbackHandler;
+
+	// constructor - ringSize is the number of frames that may be in flight
+	FrameReadback(int ringSize = 3);
+	// destructor
+	~FrameReadback();
+
+	// issue a readback of the currently bound read framebuffer; when every
+	// ring slot is still pending, either drop the request or wait for the
+	// oldest one (the time spent waiting is added to the stall counter)
+	bool QueueReadback(
+		int x, int y, int width, int height,
+		GLenum format, GLenum type,
+		uint64_t frameNumber,
+		uint64_t userValue,
+		bool bWaitWhenFull,
+		const ReadbackHandler& handler);
+
+	// hand every readback whose fence has signaled to the handler, oldest
+	// first; returns the number of frames delivered
+	int ProcessCompleted(const ReadbackHandler& handler);
+
+	// block until all pending readbacks are delivered
+	void Flush(const ReadbackHandler& handler);
+
+	// release every GL object owned by the ring
+	void Destroy();
+
+	int GetPendingCount() const { return m_pendingCount; }
+	uint64_t GetDroppedCount() const { return m_droppedCount; }
+	double GetStallSeconds() const { return m_stallSeconds; }
+
+private:
+	struct READBACK_SLOT
+	{
+		GLuint pbo;
+		GLsizeiptr capacity;
+		GLsync fence;
+		READBACK_FRAME frame;
+	};
+
+	std::vector<READBACK_SLOT> m_slots;
+	// index of the oldest pending slot and number of pending slots
+	int m_head;
+	int m_pendingCount;
+	uint64_t m_droppedCount;
+	double m_stallSeconds;
+
+	// bytes per pixel for the supported format/type pairs
+	static int BytesPerPixel(GLenum format, GLenum type);
+	// map the oldest slot, call the handler and recycle the slot
+	void DeliverOldest(const ReadbackHandler& handler);
+};
@@ -0,0 +1,479 @@
+///////////////////////////////////////////////////////////////////////////////
+// geometryarena.cpp
+// ============
+// share one vertex buffer, index buffer and vertex array between meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <iostream>
+
+/***********************************************************
+ *  GeometryArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GeometryArena::GeometryArena()
+{
+	for (int i = 0; i < MAX_ATTRIBUTES; i++)
+	{
+		m_attributeSizes[i] = 0;
+	}
+	m_attributeCount = 0;
+	m_vertexFloats = 0;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_vertexCapacity = 0;
+	m_indexCapacity = 0;
+	m_generation = 0;
+}
+
+/***********************************************************
+ *  ~GeometryArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GeometryArena::~GeometryArena()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method creates the empty buffers and the vertex
+ *  array of the vertex format.
+ ***********************************************************/
+bool GeometryArena::Create(const int* attributeSizes, int attributeCount, int vertexCapacity, int indexCapacity)
+{
+	Destroy();
+	if ((NULL == attributeSizes) || (attributeCount <= 0) || (attributeCount > MAX_ATTRIBUTES))
+	{
+		return(false);
+	}
+
+	m_attributeCount = attributeCount;
+	m_vertexFloats = 0;
+	for (int i = 0; i < attributeCount; i++)
+	{
+		m_attributeSizes[i] = attributeSizes[i];
+		m_vertexFloats += attributeSizes[i];
+	}
+
+	m_vertexCapacity = std::max(vertexCapacity, 1);
+	m_indexCapacity = std::max(indexCapacity, 1);
+	glGenVertexArrays(1, &m_vertexArray);
+	m_vertexBuffer = CreateBuffer(m_vertexCapacity * m_vertexFloats * (int)sizeof(float));
+	m_indexBuffer = CreateBuffer(m_indexCapacity * (int)sizeof(GLuint));
+	if ((m_vertexArray == 0) || (m_vertexBuffer == 0) || (m_indexBuffer == 0))
+	{
+		std::cout << "Could not create the buffers of the geometry arena" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	m_freeVertices.push_back(FREE_BLOCK{ 0, m_vertexCapacity });
+	m_freeIndices.push_back(FREE_BLOCK{ 0, m_indexCapacity });
+	SetupVertexArray();
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the GL objects and forgets every
+ *  allocation.
+ ***********************************************************/
+void GeometryArena::Destroy()
+{
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (m_vertexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (m_indexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	m_vertexCapacity = 0;
+	m_indexCapacity = 0;
+	m_freeVertices.clear();
+	m_freeIndices.clear();
+	m_allocations.clear();
+	m_unusedAllocations.clear();
+	m_generation++;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method finds room for a mesh, growing the buffers
+ *  to at least twice their size when there is none, and
+ *  uploads its vertices and indices.
+ ***********************************************************/
+GeometryArena::ALLOCATION GeometryArena::Allocate(const float* vertices, int vertexCount, const GLuint* indices, int indexCount)
+{
+	if ((m_vertexArray == 0) || (NULL == vertices) || (NULL == indices) || (vertexCount <= 0) || (indexCount <= 0))
+	{
+		return(INVALID_ALLOCATION);
+	}
+
+	int firstVertex = TakeBlock(m_freeVertices, vertexCount);
+	if (firstVertex < 0)
+	{
+		if (Grow(std::max(m_vertexCapacity * 2, m_vertexCapacity + vertexCount), m_indexCapacity) == false)
+		{
+			return(INVALID_ALLOCATION);
+		}
+		firstVertex = TakeBlock(m_freeVertices, vertexCount);
+	}
+	int firstIndex = TakeBlock(m_freeIndices, indexCount);
+	if (firstIndex < 0)
+	{
+		if (Grow(m_vertexCapacity, std::max(m_indexCapacity * 2, m_indexCapacity + indexCount)) == false)
+		{
+			ReturnBlock(m_freeVertices, firstVertex, vertexCount);
+			return(INVALID_ALLOCATION);
+		}
+		firstIndex = TakeBlock(m_freeIndices, indexCount);
+	}
+
+	GLsizeiptr stride = (GLsizeiptr)(m_vertexFloats * sizeof(float));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, stride * firstVertex, stride * vertexCount, vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(sizeof(GLuint) * firstIndex), (GLsizeiptr)(sizeof(GLuint) * indexCount), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	ALLOCATION allocation = (ALLOCATION)m_allocations.size();
+	if (!m_unusedAllocations.empty())
+	{
+		allocation = m_unusedAllocations.back();
+		m_unusedAllocations.pop_back();
+	}
+	else
+	{
+		m_allocations.push_back(ALLOCATION_INFO());
+	}
+
+	ALLOCATION_INFO& info = m_allocations[allocation];
+	info.range.baseVertex = (GLint)firstVertex;
+	info.range.firstIndex = (GLuint)firstIndex;
+	info.range.vertexCount = (GLsizei)vertexCount;
+	info.range.indexCount = (GLsizei)indexCount;
+	info.bLive = true;
+	return(allocation);
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method returns the ranges of a mesh.  The data is
+ *  left in place until the space is allocated again, and
+ *  the handle no longer draws.
+ ***********************************************************/
+void GeometryArena::Free(ALLOCATION allocation)
+{
+	if (!IsLive(allocation))
+	{
+		return;
+	}
+
+	ALLOCATION_INFO& info = m_allocations[allocation];
+	ReturnBlock(m_freeVertices, info.range.baseVertex, info.range.vertexCount);
+	ReturnBlock(m_freeIndices, (int)info.range.firstIndex, info.range.indexCount);
+	info.bLive = false;
+	m_unusedAllocations.push_back(allocation);
+	m_generation++;
+}
+
+/***********************************************************
+ *  Defragment()
+ *
+ *  This method copies the live ranges, in the order they
+ *  are in, to the start of new buffers of the same size.
+ *  Nothing is done when the free space is already one
+ *  block at the end of each buffer.
+ ***********************************************************/
+void GeometryArena::Defragment()
+{
+	bool bPacked =
+		(m_freeVertices.size() <= 1) && (m_freeIndices.size() <= 1) &&
+		(m_freeVertices.empty() || (m_freeVertices[0].start + m_freeVertices[0].size == m_vertexCapacity)) &&
+		(m_freeIndices.empty() || (m_freeIndices[0].start + m_freeIndices[0].size == m_indexCapacity));
+	if ((m_vertexArray == 0) || bPacked)
+	{
+		return;
+	}
+
+	std::vector<ALLOCATION> live;
+	for (size_t i = 0; i < m_allocations.size(); i++)
+	{
+		if (m_allocations[i].bLive)
+		{
+			live.push_back((ALLOCATION)i);
+		}
+	}
+
+	int stride = m_vertexFloats * (int)sizeof(float);
+	GLuint vertexBuffer = CreateBuffer(m_vertexCapacity * stride);
+	GLuint indexBuffer = CreateBuffer(m_indexCapacity * (int)sizeof(GLuint));
+	if ((vertexBuffer == 0) || (indexBuffer == 0))
+	{
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+		return;
+	}
+
+	// the vertices and the indices of a mesh are not in the same order
+	// in their buffers, so each buffer is packed on its own
+	int vertexEnd = 0;
+	std::sort(live.begin(), live.end(), [this](ALLOCATION a, ALLOCATION b)
+		{ return m_allocations[a].range.baseVertex < m_allocations[b].range.baseVertex; });
+	glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		RANGE& range = m_allocations[live[i]].range;
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			(GLintptr)range.baseVertex * stride, (GLintptr)vertexEnd * stride, (GLsizeiptr)range.vertexCount * stride);
+		range.baseVertex = (GLint)vertexEnd;
+		vertexEnd += range.vertexCount;
+	}
+
+	int indexEnd = 0;
+	std::sort(live.begin(), live.end(), [this](ALLOCATION a, ALLOCATION b)
+		{ return m_allocations[a].range.firstIndex < m_allocations[b].range.firstIndex; });
+	glBindBuffer(GL_COPY_READ_BUFFER, m_indexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		RANGE& range = m_allocations[live[i]].range;
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			(GLintptr)(range.firstIndex * sizeof(GLuint)), (GLintptr)(indexEnd * sizeof(GLuint)),
+			(GLsizeiptr)(range.indexCount * sizeof(GLuint)));
+		range.firstIndex = (GLuint)indexEnd;
+		indexEnd += range.indexCount;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &m_vertexBuffer);
+	glDeleteBuffers(1, &m_indexBuffer);
+	m_vertexBuffer = vertexBuffer;
+	m_indexBuffer = indexBuffer;
+
+	m_freeVertices.clear();
+	m_freeIndices.clear();
+	ReturnBlock(m_freeVertices, vertexEnd, m_vertexCapacity - vertexEnd);
+	ReturnBlock(m_freeIndices, indexEnd, m_indexCapacity - indexEnd);
+
+	SetupVertexArray();
+	m_generation++;
+}
+
+/***********************************************************
+ *  IsLive()
+ *
+ *  This method returns true while an allocation holds a
+ *  mesh, from Allocate() until Free().
+ ***********************************************************/
+bool GeometryArena::IsLive(ALLOCATION allocation) const
+{
+	return((allocation >= 0) && (allocation < (ALLOCATION)m_allocations.size()) && m_allocations[allocation].bLive);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method binds the vertex array of the arena.
+ ***********************************************************/
+void GeometryArena::Bind() const
+{
+	glBindVertexArray(m_vertexArray);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method draws one mesh from its ranges.
+ ***********************************************************/
+void GeometryArena::Draw(ALLOCATION allocation, int instanceCount) const
+{
+	if (!IsLive(allocation) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	const RANGE& range = m_allocations[allocation].range;
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * range.firstIndex), instanceCount, range.baseVertex);
+}
+
+/***********************************************************
+ *  TakeBlock()
+ *
+ *  This method takes a run from the first free block that
+ *  is large enough.
+ ***********************************************************/
+int GeometryArena::TakeBlock(std::vector<FREE_BLOCK>& freeList, int size)
+{
+	for (size_t i = 0; i < freeList.size(); i++)
+	{
+		FREE_BLOCK& block = freeList[i];
+		if (block.size >= size)
+		{
+			int start = block.start;
+			block.start += size;
+			block.size -= size;
+			if (block.size == 0)
+			{
+				freeList.erase(freeList.begin() + i);
+			}
+			return(start);
+		}
+	}
+	return(-1);
+}
+
+/***********************************************************
+ *  ReturnBlock()
+ *
+ *  This method puts a run back in order, joining it with
+ *  the free blocks right before and after it.
+ ***********************************************************/
+void GeometryArena::ReturnBlock(std::vector<FREE_BLOCK>& freeList, int start, int size)
+{
+	if (size <= 0)
+	{
+		return;
+	}
+
+	size_t next = 0;
+	while ((next < freeList.size()) && (freeList[next].start < start))
+	{
+		next++;
+	}
+
+	bool bJoinPrevious = (next > 0) && (freeList[next - 1].start + freeList[next - 1].size == start);
+	bool bJoinNext = (next < freeList.size()) && (start + size == freeList[next].start);
+	if (bJoinPrevious && bJoinNext)
+	{
+		freeList[next - 1].size += size + freeList[next].size;
+		freeList.erase(freeList.begin() + next);
+	}
+	else if (bJoinPrevious)
+	{
+		freeList[next - 1].size += size;
+	}
+	else if (bJoinNext)
+	{
+		freeList[next].start = start;
+		freeList[next].size += size;
+	}
+	else
+	{
+		freeList.insert(freeList.begin() + next, FREE_BLOCK{ start, size });
+	}
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method creates an empty buffer of the passed in
+ *  size, without touching the vertex array bindings.
+ ***********************************************************/
+GLuint GeometryArena::CreateBuffer(int bytes) const
+{
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	if (buffer != 0)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	return(buffer);
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method copies a buffer that needs more room into a
+ *  larger one.  The ranges keep their offsets, and the new
+ *  space becomes free.
+ ***********************************************************/
+bool GeometryArena::Grow(int vertexCapacity, int indexCapacity)
+{
+	int stride = m_vertexFloats * (int)sizeof(float);
+	GLuint* buffers[2] = { &m_vertexBuffer, &m_indexBuffer };
+	int* capacities[2] = { &m_vertexCapacity, &m_indexCapacity };
+	int newCapacities[2] = { vertexCapacity, indexCapacity };
+	int elementSizes[2] = { stride, (int)sizeof(GLuint) };
+	std::vector<FREE_BLOCK>* freeLists[2] = { &m_freeVertices, &m_freeIndices };
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (newCapacities[i] <= *capacities[i])
+		{
+			continue;
+		}
+
+		GLuint buffer = CreateBuffer(newCapacities[i] * elementSizes[i]);
+		if (buffer == 0)
+		{
+			std::cout << "Could not grow the geometry arena" << std::endl;
+			return(false);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, *buffers[i]);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)(*capacities[i]) * elementSizes[i]);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, buffers[i]);
+		*buffers[i] = buffer;
+
+		ReturnBlock(*freeLists[i], *capacities[i], newCapacities[i] - *capacities[i]);
+		*capacities[i] = newCapacities[i];
+	}
+
+	SetupVertexArray();
+	return(true);
+}
+
+/***********************************************************
+ *  SetupVertexArray()
+ *
+ *  This method points the attributes and the element
+ *  buffer of the vertex array at the current buffers.  The
+ *  previous vertex array binding is restored.
+ ***********************************************************/
+void GeometryArena::SetupVertexArray()
+{
+	GLint previousArray = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousArray);
+
+	GLsizei stride = (GLsizei)(m_vertexFloats * sizeof(float));
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	int offset = 0;
+	for (int i = 0; i < m_attributeCount; i++)
+	{
+		glEnableVertexAttribArray((GLuint)i);
+		glVertexAttribPointer((GLuint)i, m_attributeSizes[i], GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * offset));
+		offset += m_attributeSizes[i];
+	}
+	// the element buffer binding stays with the vertex array
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+	glBindVertexArray((GLuint)previousArray);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
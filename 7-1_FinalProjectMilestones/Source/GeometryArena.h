@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// geometryarena.h
+// ============
+// share one vertex buffer, index buffer and vertex array between meshes
+//
+// An arena holds the meshes of one vertex format.  Each mesh is a range of
+// vertices and a range of indices sub-allocated from two large buffers by
+// first fit from sorted free lists, whose neighbouring blocks are joined
+// again when a range is freed.  The indices of a mesh count from its own
+// first vertex and are drawn with its base vertex, so the ranges can move.
+// The buffers grow by copying when a mesh does not fit, which keeps the
+// ranges where they are, and Defragment() packs the live ranges to the
+// start; it bumps the generation, which tells holders of cached offsets,
+// such as indirect draw tables, to read the ranges again.  Free() bumps it
+// too, since Allocate() hands the freed handle out again for other ranges.
+// Every mesh of the arena is drawn through the same vertex array.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+class GeometryArena
+{
+public:
+	// where a mesh is in the buffers
+	struct RANGE
+	{
+		GLint baseVertex;
+		GLuint firstIndex;
+		GLsizei vertexCount;
+		GLsizei indexCount;
+	};
+
+	// a mesh of the arena; its range can move
+	typedef int ALLOCATION;
+	static const ALLOCATION INVALID_ALLOCATION = -1;
+
+	// float attributes per vertex at most, at locations 0 and up
+	static const int MAX_ATTRIBUTES = 4;
+
+	// constructor
+	GeometryArena();
+	// destructor
+	~GeometryArena();
+
+	// create the buffers and the vertex array for interleaved float
+	// vertices with the passed in component counts per attribute
+	bool Create(const int* attributeSizes, int attributeCount, int vertexCapacity, int indexCapacity);
+	// free the buffers, the vertex array and every allocation
+	void Destroy();
+
+	// copy a mesh into the arena, growing the buffers when it does not
+	// fit; the indices count from the mesh's first vertex
+	ALLOCATION Allocate(const float* vertices, int vertexCount, const GLuint* indices, int indexCount);
+	// return the ranges of a mesh to the free lists
+	void Free(ALLOCATION allocation);
+	// move the live ranges to the start of the buffers, so the free
+	// space is one block at the end of each
+	void Defragment();
+
+	// the range of a freed allocation is stale
+	const RANGE& GetRange(ALLOCATION allocation) const { return m_allocations[allocation].range; }
+	bool IsLive(ALLOCATION allocation) const;
+	// changes whenever ranges move or are freed
+	uint32_t GetGeneration() const { return m_generation; }
+	GLuint GetVertexArray() const { return m_vertexArray; }
+	int GetFreeBlockCount() const { return (int)(m_freeVertices.size() + m_freeIndices.size()); }
+
+	// bind the vertex array shared by every mesh
+	void Bind() const;
+	// draw a mesh instanceCount times, nothing for a freed one; the
+	// vertex array must be bound
+	void Draw(ALLOCATION allocation, int instanceCount) const;
+
+private:
+	// a run of unused vertices or indices
+	struct FREE_BLOCK
+	{
+		int start;
+		int size;
+	};
+
+	struct ALLOCATION_INFO
+	{
+		RANGE range;
+		bool bLive;
+	};
+
+	int m_attributeSizes[MAX_ATTRIBUTES];
+	int m_attributeCount;
+	int m_vertexFloats;
+
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	int m_vertexCapacity;
+	int m_indexCapacity;
+	// sorted by start, never touching each other
+	std::vector<FREE_BLOCK> m_freeVertices;
+	std::vector<FREE_BLOCK> m_freeIndices;
+	std::vector<ALLOCATION_INFO> m_allocations;
+	std::vector<ALLOCATION> m_unusedAllocations;
+	uint32_t m_generation;
+
+	// first fit from a free list; -1 when no block is large enough
+	static int TakeBlock(std::vector<FREE_BLOCK>& freeList, int size);
+	// put a run back, joined with the blocks next to it
+	static void ReturnBlock(std::vector<FREE_BLOCK>& freeList, int start, int size);
+	// create an empty buffer of the passed in size
+	GLuint CreateBuffer(int bytes) const;
+	// replace the buffers by larger copies of them
+	bool Grow(int vertexCapacity, int indexCapacity);
+	// point the vertex array at the current buffers
+	void SetupVertexArray();
+};
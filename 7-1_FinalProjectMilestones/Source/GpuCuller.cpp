@@ -0,0 +1,591 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// cull the draw list and choose its levels of detail on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "BoundingVolumes.h"
+#include "ShaderCompiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// objects tested by one work group, local_size_x of the shader
+	const int CULL_GROUP_SIZE = 64;
+	// objects and impostor fades reserved when the buffers are first
+	// created
+	const int INITIAL_OBJECTS = 1024;
+	const int INITIAL_FADES = 256;
+
+	// storage buffer binding points; the culling shader declares the
+	// first four, the draw records take the next one and the fades of
+	// the impostors, read by both programs, the last
+	const GLuint OBJECT_BINDING = 0;
+	const GLuint LOD_BINDING = 1;
+	const GLuint COMMAND_BINDING = 2;
+	const GLuint COUNT_BINDING = 3;
+	const GLuint RECORD_BINDING = 4;
+	const GLuint FADE_BINDING = 5;
+	// the instanced attribute holding the object of a draw
+	const GLuint OBJECT_INDEX_LOCATION = 3;
+
+	// the draw program reads storage buffers in its fragment stage,
+	// which the scene's 330 shader cannot
+	const char* g_DrawShaderVersion = "#version 430 core\n";
+
+	// the command layout of glMultiDrawElementsIndirect
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// the group of the commands of an object's texture slot, as in the
+	// culling shader; untextured objects are drawn with the first one
+	int GetBatch(int textureSlot)
+	{
+		return(std::min(std::max(textureSlot, 0), GpuCuller::MAX_SCENE_TEXTURES - 1));
+	}
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+{
+	m_bAvailable = false;
+	m_bDrawCount = false;
+	m_cullProgram = 0;
+	m_drawProgram = 0;
+	m_pMeshes = NULL;
+	m_lodBuffer = 0;
+	m_lodGeneration = 0;
+	m_objectBuffer = 0;
+	m_recordBuffer = 0;
+	m_objectIndexBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_objectCapacity = 0;
+	m_objectCount = 0;
+	m_fadeBuffer = 0;
+	m_fadeCapacity = 0;
+	m_lodBias = 1.0f;
+	for (int i = 0; i < MAX_SCENE_TEXTURES; i++)
+	{
+		m_batchStarts[i] = 0;
+		m_batchSizes[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+	DestroyObjectBuffers();
+	if (m_fadeBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_fadeBuffer);
+		m_fadeBuffer = 0;
+	}
+	if (m_lodBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lodBuffer);
+		m_lodBuffer = 0;
+	}
+	m_pMeshes = NULL;
+
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+		m_cullProgram = 0;
+	}
+	if (m_drawProgram != 0)
+	{
+		glDeleteProgram(m_drawProgram);
+		m_drawProgram = 0;
+	}
+	m_bAvailable = false;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method compiles and links the culling and drawing
+ *  programs, resolves their uniforms and creates the table
+ *  of the mesh ranges and the object buffers.
+ ***********************************************************/
+bool GpuCuller::Initialize(const MeshLibrary* pMeshes, const char* computeShaderFile, const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	if (NULL == pMeshes)
+	{
+		return(false);
+	}
+	m_pMeshes = pMeshes;
+
+	// compute shaders, storage buffers and indirect draws are all core
+	// in 4.3; the count from a buffer needs 4.6 or the extension
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "INFO: Compute shaders are not supported, the draw list is culled on the CPU" << std::endl;
+		return(false);
+	}
+	m_bDrawCount = (GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters) ? true : false;
+
+	GLuint computeShader = ShaderCompiler::CompileShader(GL_COMPUTE_SHADER, computeShaderFile, "");
+	if (computeShader != 0)
+	{
+		m_cullProgram = ShaderCompiler::LinkProgram(&computeShader, 1, "culling");
+		glDeleteShader(computeShader);
+	}
+
+	GLuint drawShaders[2] = {
+		ShaderCompiler::CompileShader(GL_VERTEX_SHADER, vertexShaderFile, ""),
+		ShaderCompiler::CompileShader(GL_FRAGMENT_SHADER, fragmentShaderFile, "#define INDIRECT_DRAWS\n", g_DrawShaderVersion) };
+	if ((drawShaders[0] != 0) && (drawShaders[1] != 0))
+	{
+		m_drawProgram = ShaderCompiler::LinkProgram(drawShaders, 2, "indirect draw");
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		if (drawShaders[i] != 0)
+		{
+			glDeleteShader(drawShaders[i]);
+		}
+	}
+
+	if ((m_cullProgram == 0) || (m_drawProgram == 0))
+	{
+		return(false);
+	}
+
+	// every uniform is needed: a culling program that ignored one would
+	// draw the wrong objects, so the CPU culling is used instead
+	bool bResolved = true;
+	bResolved = m_cullUniforms.objectCount.Resolve(m_cullProgram, "objectCount", true) && bResolved;
+	bResolved = m_cullUniforms.frustumPlanes.Resolve(m_cullProgram, "frustumPlanes", true) && bResolved;
+	bResolved = m_cullUniforms.viewPosition.Resolve(m_cullProgram, "viewPosition", true) && bResolved;
+	bResolved = m_cullUniforms.bOrthographic.Resolve(m_cullProgram, "bOrthographic", true) && bResolved;
+	bResolved = m_cullUniforms.projectionScale.Resolve(m_cullProgram, "projectionScale", true) && bResolved;
+	bResolved = m_cullUniforms.lodBias.Resolve(m_cullProgram, "lodBias", true) && bResolved;
+	bResolved = m_cullUniforms.batchStarts.Resolve(m_cullProgram, "batchStarts", true) && bResolved;
+
+	bResolved = m_drawUniforms.view.Resolve(m_drawProgram, "view", true) && bResolved;
+	bResolved = m_drawUniforms.projection.Resolve(m_drawProgram, "projection", true) && bResolved;
+	bResolved = m_drawUniforms.viewPosition.Resolve(m_drawProgram, "viewPosition", true) && bResolved;
+	bResolved = m_drawUniforms.bUseLighting.Resolve(m_drawProgram, "bUseLighting", true) && bResolved;
+	bResolved = m_drawUniforms.objectTexture.Resolve(m_drawProgram, "objectTexture", true) && bResolved;
+	if (bResolved == false)
+	{
+		std::cout << "Could not resolve the uniforms of the GPU culling, the draw list is culled on the CPU" << std::endl;
+		return(false);
+	}
+
+	// the scene's fragment shader keeps to GLSL 330 syntax, which has
+	// no binding qualifier, so the storage block is connected here
+	GLuint recordBlock = glGetProgramResourceIndex(m_drawProgram, GL_SHADER_STORAGE_BLOCK, "DrawRecords");
+	if (recordBlock == GL_INVALID_INDEX)
+	{
+		std::cout << "Could not find the storage block of the indirect draw program" << std::endl;
+		return(false);
+	}
+	glShaderStorageBlockBinding(m_drawProgram, recordBlock, RECORD_BINDING);
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_drawProgram);
+	m_drawUniforms.bUseLighting.Set(true);
+	glUseProgram((GLuint)previousProgram);
+
+	if ((CreateLodTable() == false) || (CreateObjectBuffers(INITIAL_OBJECTS) == false) ||
+		(CreateFadeBuffer(INITIAL_FADES) == false))
+	{
+		return(false);
+	}
+
+	m_bAvailable = true;
+	return(true);
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method replaces the objects to cull and draw, and
+ *  reserves a range of the commands for the objects of each
+ *  texture slot.  The buffers grow when the objects do not
+ *  fit.
+ ***********************************************************/
+void GpuCuller::SetObjects(const std::vector<DRAW_UNIFORMS>& records, const std::vector<CULL_OBJECT>& objects)
+{
+	if (!m_bAvailable)
+	{
+		return;
+	}
+
+	int count = (int)std::min(records.size(), objects.size());
+	if (count > m_objectCapacity)
+	{
+		if (CreateObjectBuffers(std::max(count, m_objectCapacity * 2)) == false)
+		{
+			m_objectCount = 0;
+			return;
+		}
+	}
+
+	m_objectCount = count;
+	for (int i = 0; i < MAX_SCENE_TEXTURES; i++)
+	{
+		m_batchSizes[i] = 0;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		m_batchSizes[GetBatch(objects[i].textureSlot)]++;
+	}
+	int start = 0;
+	for (int i = 0; i < MAX_SCENE_TEXTURES; i++)
+	{
+		m_batchStarts[i] = start;
+		start += m_batchSizes[i];
+	}
+	if (count == 0)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(CULL_OBJECT), objects.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_recordBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(DRAW_UNIFORMS), records.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateObjects()
+ *
+ *  This method writes over a range of the objects, such as
+ *  those that moved since they were set.  The ranges of the
+ *  commands stay as they are, so the objects must keep their
+ *  texture slots.
+ ***********************************************************/
+void GpuCuller::UpdateObjects(int first, int count, const DRAW_UNIFORMS* records, const CULL_OBJECT* objects)
+{
+	if (!m_bAvailable || (first < 0) || (count <= 0) || (first + count > m_objectCount))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(CULL_OBJECT), count * sizeof(CULL_OBJECT), objects);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_recordBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(DRAW_UNIFORMS), count * sizeof(DRAW_UNIFORMS), records);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetImpostorFades()
+ *
+ *  This method replaces the fades of the impostor instances
+ *  that the objects refer to.  The buffer grows when they
+ *  do not fit.
+ ***********************************************************/
+void GpuCuller::SetImpostorFades(const float* fades, int count)
+{
+	if (!m_bAvailable || (count <= 0))
+	{
+		return;
+	}
+
+	if ((count > m_fadeCapacity) && (CreateFadeBuffer(std::max(count, m_fadeCapacity * 2)) == false))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_fadeBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(float), fades);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method culls the objects against the view with the
+ *  compute shader and draws the commands it appends, one
+ *  multi-draw for each texture slot with objects.  The
+ *  previous program and vertex array are restored.
+ ***********************************************************/
+void GpuCuller::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (!m_bAvailable || (m_objectCount == 0))
+	{
+		return;
+	}
+
+	GLint previousProgram = 0;
+	GLint previousArray = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousArray);
+
+	// start with no commands; without the count from the buffer every
+	// command past the last appended one must be an empty draw
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	if (!m_bDrawCount)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	UpdateLodTable();
+
+	glm::vec3 eyePosition = glm::vec3(glm::inverse(view)[3]);
+	bool bOrthographic = (projection[3][3] == 1.0f);
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(projection * view);
+
+	glUseProgram(m_cullProgram);
+	m_cullUniforms.objectCount.Set(m_objectCount);
+	m_cullUniforms.frustumPlanes.Set(frustum.planes);
+	m_cullUniforms.viewPosition.Set(eyePosition);
+	m_cullUniforms.bOrthographic.Set(bOrthographic);
+	m_cullUniforms.projectionScale.Set(projection[1][1]);
+	m_cullUniforms.lodBias.Set(m_lodBias);
+	m_cullUniforms.batchStarts.Set(m_batchStarts);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LOD_BINDING, m_lodBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, m_countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FADE_BINDING, m_fadeBuffer);
+	glDispatchCompute((GLuint)((m_objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+	// the commands and their count are read by the draw
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	glUseProgram(m_drawProgram);
+	m_drawUniforms.view.Set(view);
+	m_drawUniforms.projection.Set(projection);
+	m_drawUniforms.viewPosition.Set(eyePosition);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RECORD_BINDING, m_recordBuffer);
+
+	// the texture of a group is the same for all of its draws, so the
+	// sampler is dynamically uniform
+	m_pMeshes->Bind();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	if (m_bDrawCount)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_countBuffer);
+	}
+	for (int i = 0; i < MAX_SCENE_TEXTURES; i++)
+	{
+		if (m_batchSizes[i] == 0)
+		{
+			continue;
+		}
+
+		m_drawUniforms.objectTexture.Set(SAMPLER_UNIT{ i });
+		const void* commands = (const void*)(m_batchStarts[i] * sizeof(DRAW_COMMAND));
+		if (m_bDrawCount)
+		{
+			glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, commands, (GLintptr)(i * sizeof(GLuint)), m_batchSizes[i], 0);
+		}
+		else
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, m_batchSizes[i], 0);
+		}
+	}
+	if (m_bDrawCount)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindVertexArray((GLuint)previousArray);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  CreateLodTable()
+ *
+ *  This method creates the buffer of the table of where
+ *  each level of detail of each mesh starts, for the
+ *  culling shader, and fills it.
+ ***********************************************************/
+bool GpuCuller::CreateLodTable()
+{
+	glGenBuffers(1, &m_lodBuffer);
+	if (m_lodBuffer == 0)
+	{
+		std::cout << "Could not create the level of detail table of the culled meshes" << std::endl;
+		return(false);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lodBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(MESH_LOD) * MeshLibrary::MESH_COUNT * MeshLibrary::MAX_LODS, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_lodGeneration = m_pMeshes->GetArena().GetGeneration() - 1;
+	UpdateLodTable();
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateLodTable()
+ *
+ *  This method writes the ranges of the levels of detail
+ *  into the table again when the arena has moved them
+ *  since it was last written.  Levels a mesh does not have
+ *  are left empty.
+ ***********************************************************/
+void GpuCuller::UpdateLodTable()
+{
+	uint32_t generation = m_pMeshes->GetArena().GetGeneration();
+	if (generation == m_lodGeneration)
+	{
+		return;
+	}
+
+	MESH_LOD lods[MeshLibrary::MESH_COUNT * MeshLibrary::MAX_LODS] = {};
+	for (int mesh = 0; mesh < MeshLibrary::MESH_COUNT; mesh++)
+	{
+		int lodCount = MeshLibrary::GetLodCount((MeshLibrary::MESH_ID)mesh);
+		for (int lod = 0; lod < lodCount; lod++)
+		{
+			const GeometryArena::RANGE& range = m_pMeshes->GetRange((MeshLibrary::MESH_ID)mesh, lod);
+			MESH_LOD& entry = lods[mesh * MeshLibrary::MAX_LODS + lod];
+			entry.indexCount = (GLuint)range.indexCount;
+			entry.firstIndex = range.firstIndex;
+			entry.baseVertex = range.baseVertex;
+			entry.minimumSize = MeshLibrary::GetLodMinimumSize((MeshLibrary::MESH_ID)mesh, lod);
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lodBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(lods), lods);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	m_lodGeneration = generation;
+}
+
+/***********************************************************
+ *  CreateObjectBuffers()
+ *
+ *  This method creates the buffers of the objects for the
+ *  passed in number of them, replacing the previous ones.
+ *  The object index attribute counts up from 0, so the base
+ *  instance of a command is the object it draws.
+ ***********************************************************/
+bool GpuCuller::CreateObjectBuffers(int capacity)
+{
+	DestroyObjectBuffers();
+
+	GLuint buffers[5] = {};
+	glGenBuffers(5, buffers);
+	m_objectBuffer = buffers[0];
+	m_recordBuffer = buffers[1];
+	m_objectIndexBuffer = buffers[2];
+	m_commandBuffer = buffers[3];
+	m_countBuffer = buffers[4];
+	if ((m_objectBuffer == 0) || (m_recordBuffer == 0) || (m_objectIndexBuffer == 0) ||
+		(m_commandBuffer == 0) || (m_countBuffer == 0))
+	{
+		std::cout << "Could not create the object buffers of the GPU culling" << std::endl;
+		DestroyObjectBuffers();
+		return(false);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(CULL_OBJECT), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_recordBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DRAW_UNIFORMS), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DRAW_COMMAND), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_SCENE_TEXTURES * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::vector<GLint> objectIndices(capacity);
+	for (int i = 0; i < capacity; i++)
+	{
+		objectIndices[i] = i;
+	}
+	// the attribute is added to the vertex array of the meshes, whose
+	// own attributes stop below its location
+	GLint previousArray = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousArray);
+	m_pMeshes->Bind();
+	glBindBuffer(GL_ARRAY_BUFFER, m_objectIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLint), objectIndices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(OBJECT_INDEX_LOCATION);
+	glVertexAttribIPointer(OBJECT_INDEX_LOCATION, 1, GL_INT, sizeof(GLint), (void*)0);
+	glVertexAttribDivisor(OBJECT_INDEX_LOCATION, 1);
+	glBindVertexArray((GLuint)previousArray);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_objectCapacity = capacity;
+	return(true);
+}
+
+/***********************************************************
+ *  CreateFadeBuffer()
+ *
+ *  This method creates the buffer of the impostor fades for
+ *  the passed in number of instances, replacing the previous
+ *  one.  The fades start at 0, which hides nothing.
+ ***********************************************************/
+bool GpuCuller::CreateFadeBuffer(int capacity)
+{
+	if (m_fadeBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_fadeBuffer);
+		m_fadeBuffer = 0;
+		m_fadeCapacity = 0;
+	}
+
+	glGenBuffers(1, &m_fadeBuffer);
+	if (m_fadeBuffer == 0)
+	{
+		std::cout << "Could not create the impostor fade buffer of the GPU culling" << std::endl;
+		return(false);
+	}
+
+	std::vector<float> fades(capacity, 0.0f);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_fadeBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(float), fades.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_fadeCapacity = capacity;
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyObjectBuffers()
+ *
+ *  This method frees the buffers of the objects.
+ ***********************************************************/
+void GpuCuller::DestroyObjectBuffers()
+{
+	GLuint buffers[5] = { m_objectBuffer, m_recordBuffer, m_objectIndexBuffer, m_commandBuffer, m_countBuffer };
+	for (int i = 0; i < 5; i++)
+	{
+		if (buffers[i] != 0)
+		{
+			glDeleteBuffers(1, &buffers[i]);
+		}
+	}
+	m_objectBuffer = 0;
+	m_recordBuffer = 0;
+	m_objectIndexBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_objectCapacity = 0;
+}
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull the draw list and choose its levels of detail on the GPU
+//
+// The objects stay in storage buffers: their bounds and mesh for the
+// culling, and their DRAW_UNIFORMS records for the drawing.  They are all
+// replaced when the scene changes, and a range of them when only those
+// objects moved.  An object an impostor can take over refers to the fade
+// of the impostor's instance, and is left out once the fade reaches 1;
+// the fades go up every frame.  For every view a compute shader tests each object against the
+// frustum, picks the level of detail of its mesh from its size on the
+// screen and appends a draw command for it with an atomic counter.  The
+// commands are grouped by the texture slot of their object: each slot has
+// its own range of the command buffer, sized when the objects are set, and
+// its own counter.  Every group is drawn by one
+// glMultiDrawElementsIndirectCount() reading its counter, or, without
+// ARB_indirect_parameters, by a glMultiDrawElementsIndirect() over its range
+// of a command buffer cleared to empty draws.  A sampler indexed per draw of
+// a multi-draw is not dynamically uniform, which GLSL leaves undefined, so
+// each group samples the one unit set for it instead.  Every level of every
+// mesh is a range of the scene's MeshLibrary arena, so the whole list is
+// drawn through its one vertex array; the table of the ranges is uploaded
+// again whenever the arena moves them.
+//
+// The main thread only uploads what changed and issues the dispatch and the
+// draws, whatever the number of objects and views.  The program uses the
+// scene's fragment shader compiled with INDIRECT_DRAWS defined, which reads
+// the record of the draw's object.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshLibrary.h"
+#include "ShaderUniforms.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class GpuCuller
+{
+public:
+	// the texture slots of the scene, each bound to the unit of the
+	// same number and drawn as one group; MAX_SCENE_TEXTURES in the
+	// culling shader
+	static const int MAX_SCENE_TEXTURES = 16;
+
+	// std430 layout of the CullObject struct of the shaders
+	struct CULL_OBJECT
+	{
+		glm::vec4 minimum;
+		glm::vec4 maximum;
+		GLint mesh;
+		GLint textureSlot;          // -1 draws with the solid color
+		GLint impostor;             // instance whose fade hides it, or -1
+		GLint padding;
+	};
+
+	// constructor
+	GpuCuller();
+	// destructor
+	~GpuCuller();
+
+	// build the culling and drawing programs for the meshes of the
+	// library, which must outlive the culler; fails without compute
+	// shaders, in which case callers cull on the CPU
+	bool Initialize(const MeshLibrary* pMeshes, const char* computeShaderFile, const char* vertexShaderFile, const char* fragmentShaderFile);
+	bool IsAvailable() const { return m_bAvailable; }
+	// the drawing program, for the light uniforms of the scene
+	GLuint GetProgram() const { return m_drawProgram; }
+
+	// replace the objects with one record and one cull object each
+	void SetObjects(const std::vector<DRAW_UNIFORMS>& records, const std::vector<CULL_OBJECT>& objects);
+	// write over a range of the objects set last; their texture slots
+	// must be those of the objects they replace
+	void UpdateObjects(int first, int count, const DRAW_UNIFORMS* records, const CULL_OBJECT* objects);
+	// the fade of every impostor instance the objects refer to
+	void SetImpostorFades(const float* fades, int count);
+	int GetObjectCount() const { return m_objectCount; }
+	// scale the screen sizes at which the levels of detail change; above
+	// 1 the coarser levels are drawn from nearer
+	void SetLodBias(float lodBias) { m_lodBias = lodBias; }
+
+	// cull the objects against a view and draw the visible ones; the
+	// view's viewport must be set and the scene textures bound
+	void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+private:
+	// std430 layout of the MeshLod struct of the culling shader
+	struct MESH_LOD
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLfloat minimumSize;
+	};
+
+	// the uniforms of the culling program
+	struct CULL_UNIFORMS
+	{
+		Uniform<int> objectCount;
+		UniformArray<glm::vec4, 6> frustumPlanes;
+		Uniform<glm::vec3> viewPosition;
+		Uniform<bool> bOrthographic;
+		Uniform<float> projectionScale;
+		Uniform<float> lodBias;
+		UniformArray<int, MAX_SCENE_TEXTURES> batchStarts;
+	};
+
+	// the uniforms of the drawing program set by this class
+	struct DRAW_PROGRAM_UNIFORMS
+	{
+		Uniform<glm::mat4> view;
+		Uniform<glm::mat4> projection;
+		Uniform<glm::vec3> viewPosition;
+		Uniform<bool> bUseLighting;
+		Uniform<SAMPLER_UNIT> objectTexture;
+	};
+
+	bool m_bAvailable;
+	// the count of the draws comes from the GPU
+	bool m_bDrawCount;
+	GLuint m_cullProgram;
+	GLuint m_drawProgram;
+	CULL_UNIFORMS m_cullUniforms;
+	DRAW_PROGRAM_UNIFORMS m_drawUniforms;
+
+	// the meshes, and where each of their levels of detail starts as
+	// of the arena generation the table was written for
+	const MeshLibrary* m_pMeshes;
+	GLuint m_lodBuffer;
+	uint32_t m_lodGeneration;
+	// the objects, their records, the object number of each instance
+	// attribute, the compacted commands and their count per texture
+	GLuint m_objectBuffer;
+	GLuint m_recordBuffer;
+	GLuint m_objectIndexBuffer;
+	GLuint m_commandBuffer;
+	GLuint m_countBuffer;
+	int m_objectCapacity;
+	int m_objectCount;
+	// the fades of the impostor instances
+	GLuint m_fadeBuffer;
+	int m_fadeCapacity;
+	float m_lodBias;
+	// the first command and the number of objects of each texture slot;
+	// untextured objects are drawn with the first slot
+	int m_batchStarts[MAX_SCENE_TEXTURES];
+	int m_batchSizes[MAX_SCENE_TEXTURES];
+
+	bool CreateLodTable();
+	void UpdateLodTable();
+	bool CreateObjectBuffers(int capacity);
+	bool CreateFadeBuffer(int capacity);
+	void DestroyObjectBuffers();
+};
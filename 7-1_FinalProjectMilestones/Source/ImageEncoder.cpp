@@ -0,0 +1,850 @@
+///////////////////////////////////////////////////////////////////////////////
+// imageencoder.cpp
+// ============
+// encode captured frames to PNG and baseline JPEG files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// declaration of the global variables and defines
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////
+	// shared helpers
+	/////////////////////////////////////////////////////////////////////////
+
+	// return a pointer to a row in top-to-bottom order
+	const unsigned char* GetRow(const ImageEncoder::IMAGE_VIEW& image, int y)
+	{
+		if (image.bFlipVertically)
+		{
+			y = image.height - 1 - y;
+		}
+		return(image.pixels + ((size_t)image.stride * y));
+	}
+
+	void AppendBigEndian32(std::vector<unsigned char>& output, uint32_t value)
+	{
+		output.push_back((unsigned char)(value >> 24));
+		output.push_back((unsigned char)(value >> 16));
+		output.push_back((unsigned char)(value >> 8));
+		output.push_back((unsigned char)value);
+	}
+
+	void AppendBigEndian16(std::vector<unsigned char>& output, uint32_t value)
+	{
+		output.push_back((unsigned char)(value >> 8));
+		output.push_back((unsigned char)value);
+	}
+
+	/////////////////////////////////////////////////////////////////////////
+	// PNG / deflate
+	/////////////////////////////////////////////////////////////////////////
+
+	const int DEFLATE_WINDOW_SIZE = 32768;
+	const int DEFLATE_HASH_BITS = 15;
+	const int DEFLATE_MAX_CHAIN = 32;
+	const int DEFLATE_MIN_MATCH = 3;
+	const int DEFLATE_MAX_MATCH = 258;
+
+	const unsigned short LENGTH_BASE[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LENGTH_EXTRA[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DISTANCE_BASE[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DISTANCE_EXTRA[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// least-significant-bit first writer used by deflate
+	struct DEFLATE_BIT_WRITER
+	{
+		std::vector<unsigned char>* pOutput;
+		uint32_t bitBuffer;
+		int bitCount;
+
+		void WriteBits(uint32_t value, int count)
+		{
+			bitBuffer |= value << bitCount;
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				pOutput->push_back((unsigned char)bitBuffer);
+				bitBuffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		// Huffman codes are defined most-significant bit first
+		void WriteCode(uint32_t code, int length)
+		{
+			uint32_t reversed = 0;
+			for (int i = 0; i < length; i++)
+			{
+				reversed = (reversed << 1) | ((code >> i) & 1);
+			}
+			WriteBits(reversed, length);
+		}
+
+		void Flush()
+		{
+			if (bitCount > 0)
+			{
+				pOutput->push_back((unsigned char)bitBuffer);
+			}
+			bitBuffer = 0;
+			bitCount = 0;
+		}
+	};
+
+	// write a literal/length symbol with the fixed Huffman code
+	void WriteFixedLiteral(DEFLATE_BIT_WRITER& writer, int symbol)
+	{
+		if (symbol < 144)
+		{
+			writer.WriteCode(0x30 + symbol, 8);
+		}
+		else if (symbol < 256)
+		{
+			writer.WriteCode(0x190 + (symbol - 144), 9);
+		}
+		else if (symbol < 280)
+		{
+			writer.WriteCode(symbol - 256, 7);
+		}
+		else
+		{
+			writer.WriteCode(0xC0 + (symbol - 280), 8);
+		}
+	}
+
+	void WriteMatch(DEFLATE_BIT_WRITER& writer, int length, int distance)
+	{
+		int lengthCode = 28;
+		while (LENGTH_BASE[lengthCode] > length)
+		{
+			lengthCode--;
+		}
+		WriteFixedLiteral(writer, 257 + lengthCode);
+		writer.WriteBits(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+		int distanceCode = 29;
+		while (DISTANCE_BASE[distanceCode] > distance)
+		{
+			distanceCode--;
+		}
+		writer.WriteCode(distanceCode, 5);
+		writer.WriteBits(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+	}
+
+	uint32_t Hash3(const unsigned char* data)
+	{
+		uint32_t value = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+		return((value * 2654435761u) >> (32 - DEFLATE_HASH_BITS));
+	}
+
+	uint32_t Adler32(const unsigned char* data, size_t size)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0)
+		{
+			// 5552 is the largest block that cannot overflow before the modulo
+			size_t block = std::min(size, (size_t)5552);
+			for (size_t i = 0; i < block; i++)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data += block;
+			size -= block;
+		}
+		return((b << 16) | a);
+	}
+
+	// zlib stream holding one fixed-Huffman deflate block
+	void ZlibCompress(const std::vector<unsigned char>& input, std::vector<unsigned char>& output)
+	{
+		output.push_back(0x78);
+		output.push_back(0x01);
+
+		DEFLATE_BIT_WRITER writer;
+		writer.pOutput = &output;
+		writer.bitBuffer = 0;
+		writer.bitCount = 0;
+
+		// BFINAL = 1, BTYPE = 01 (fixed Huffman codes)
+		writer.WriteBits(1, 1);
+		writer.WriteBits(1, 2);
+
+		const unsigned char* data = input.data();
+		int size = (int)input.size();
+		std::vector<int> head(1 << DEFLATE_HASH_BITS, -1);
+		std::vector<int> previous(DEFLATE_WINDOW_SIZE, -1);
+
+		int position = 0;
+		while (position < size)
+		{
+			int bestLength = 0;
+			int bestDistance = 0;
+
+			if (position + DEFLATE_MIN_MATCH <= size)
+			{
+				uint32_t hash = Hash3(data + position);
+				int candidate = head[hash];
+				int chain = DEFLATE_MAX_CHAIN;
+				int maxLength = std::min(DEFLATE_MAX_MATCH, size - position);
+
+				while ((candidate >= 0) && (position - candidate <= DEFLATE_WINDOW_SIZE) && (chain-- > 0))
+				{
+					int length = 0;
+					while ((length < maxLength) && (data[candidate + length] == data[position + length]))
+					{
+						length++;
+					}
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = position - candidate;
+						if (length == maxLength)
+						{
+							break;
+						}
+					}
+					candidate = previous[candidate & (DEFLATE_WINDOW_SIZE - 1)];
+				}
+
+				previous[position & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+				head[hash] = position;
+			}
+
+			if (bestLength >= DEFLATE_MIN_MATCH)
+			{
+				WriteMatch(writer, bestLength, bestDistance);
+				// keep the hash chains current for the bytes inside the match
+				for (int i = 1; i < bestLength; i++)
+				{
+					int inner = position + i;
+					if (inner + DEFLATE_MIN_MATCH <= size)
+					{
+						uint32_t hash = Hash3(data + inner);
+						previous[inner & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+						head[hash] = inner;
+					}
+				}
+				position += bestLength;
+			}
+			else
+			{
+				WriteFixedLiteral(writer, data[position]);
+				position++;
+			}
+		}
+
+		// end of block
+		WriteFixedLiteral(writer, 256);
+		writer.Flush();
+
+		AppendBigEndian32(output, Adler32(input.data(), input.size()));
+	}
+
+	// table for the reflected CRC-32 polynomial used by PNG
+	struct CRC_TABLE
+	{
+		uint32_t entries[256];
+
+		CRC_TABLE()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				entries[n] = c;
+			}
+		}
+	};
+
+	uint32_t Crc32(const unsigned char* data, size_t size)
+	{
+		// function local statics are initialized once, even when several
+		// worker threads encode at the same time
+		static const CRC_TABLE table;
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(~crc);
+	}
+
+	void AppendPngChunk(std::vector<unsigned char>& output, const char* type, const std::vector<unsigned char>& data)
+	{
+		AppendBigEndian32(output, (uint32_t)data.size());
+		size_t typeStart = output.size();
+		output.insert(output.end(), type, type + 4);
+		output.insert(output.end(), data.begin(), data.end());
+		AppendBigEndian32(output, Crc32(output.data() + typeStart, output.size() - typeStart));
+	}
+
+	int PaethPredictor(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+		if ((pa <= pb) && (pa <= pc))
+		{
+			return(a);
+		}
+		if (pb <= pc)
+		{
+			return(b);
+		}
+		return(c);
+	}
+
+	/////////////////////////////////////////////////////////////////////////
+	// JPEG
+	/////////////////////////////////////////////////////////////////////////
+
+	const unsigned char ZIGZAG[64] = {
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+	// standard quantization tables from Annex K, in natural order
+	const unsigned char LUMINANCE_QUANT[64] = {
+		16, 11, 10, 16, 24, 40, 51, 61,
+		12, 12, 14, 19, 26, 58, 60, 55,
+		14, 13, 16, 24, 40, 57, 69, 56,
+		14, 17, 22, 29, 51, 87, 80, 62,
+		18, 22, 37, 56, 68, 109, 103, 77,
+		24, 35, 55, 64, 81, 104, 113, 92,
+		49, 64, 78, 87, 103, 121, 120, 101,
+		72, 92, 95, 98, 112, 100, 103, 99 };
+	const unsigned char CHROMINANCE_QUANT[64] = {
+		17, 18, 24, 47, 99, 99, 99, 99,
+		18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99,
+		47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99 };
+
+	// standard Huffman tables from Annex K: code counts per length 1..16
+	// followed by the symbol values
+	const unsigned char DC_LUMINANCE_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+	const unsigned char DC_LUMINANCE_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	const unsigned char DC_CHROMINANCE_BITS[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+	const unsigned char DC_CHROMINANCE_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	const unsigned char AC_LUMINANCE_BITS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+	const unsigned char AC_LUMINANCE_VALUES[162] = {
+		0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+		0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+		0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+		0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+		0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+		0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+		0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+		0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+		0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+		0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+		0xf9, 0xfa };
+	const unsigned char AC_CHROMINANCE_BITS[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+	const unsigned char AC_CHROMINANCE_VALUES[162] = {
+		0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+		0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+		0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+		0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+		0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+		0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+		0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+		0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+		0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+		0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+		0xf9, 0xfa };
+
+	struct HUFFMAN_TABLE
+	{
+		unsigned short codes[256];
+		unsigned char lengths[256];
+	};
+
+	// build the canonical codes for a bits/values table pair
+	void BuildHuffmanTable(const unsigned char* bits, const unsigned char* values, HUFFMAN_TABLE& table)
+	{
+		memset(&table, 0, sizeof(table));
+		int code = 0;
+		int index = 0;
+		for (int length = 1; length <= 16; length++)
+		{
+			for (int i = 0; i < bits[length - 1]; i++)
+			{
+				table.codes[values[index]] = (unsigned short)code;
+				table.lengths[values[index]] = (unsigned char)length;
+				code++;
+				index++;
+			}
+			code <<= 1;
+		}
+	}
+
+	// most-significant-bit first writer with 0xFF byte stuffing
+	struct JPEG_BIT_WRITER
+	{
+		std::vector<unsigned char>* pOutput;
+		uint32_t bitBuffer;
+		int bitCount;
+
+		void WriteBits(uint32_t value, int count)
+		{
+			bitBuffer = (bitBuffer << count) | (value & ((1u << count) - 1));
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				unsigned char byte = (unsigned char)(bitBuffer >> (bitCount - 8));
+				pOutput->push_back(byte);
+				if (byte == 0xFF)
+				{
+					pOutput->push_back(0x00);
+				}
+				bitCount -= 8;
+			}
+		}
+
+		// pad the final byte with one bits as the standard requires
+		void Flush()
+		{
+			if (bitCount > 0)
+			{
+				WriteBits(0x7F, 8 - bitCount);
+			}
+		}
+	};
+
+	// number of bits needed for the magnitude of a coefficient
+	int MagnitudeCategory(int value)
+	{
+		value = abs(value);
+		int category = 0;
+		while (value > 0)
+		{
+			category++;
+			value >>= 1;
+		}
+		return(category);
+	}
+
+	void WriteCoefficient(JPEG_BIT_WRITER& writer, int value, int category)
+	{
+		// negative values are stored as the one's complement
+		if (value < 0)
+		{
+			value += (1 << category) - 1;
+		}
+		writer.WriteBits((uint32_t)value, category);
+	}
+
+	// forward DCT, quantization and entropy coding of one 8x8 block
+	int EncodeBlock(
+		JPEG_BIT_WRITER& writer,
+		const float* block,
+		const float* dctTable,
+		const float* quantReciprocal,
+		int previousDC,
+		const HUFFMAN_TABLE& dcTable,
+		const HUFFMAN_TABLE& acTable)
+	{
+		float rows[64];
+		float coefficients[64];
+
+		// separable 2D DCT: rows first, then columns
+		for (int y = 0; y < 8; y++)
+		{
+			for (int u = 0; u < 8; u++)
+			{
+				float sum = 0.0f;
+				for (int x = 0; x < 8; x++)
+				{
+					sum += block[(y * 8) + x] * dctTable[(u * 8) + x];
+				}
+				rows[(y * 8) + u] = sum;
+			}
+		}
+		for (int u = 0; u < 8; u++)
+		{
+			for (int v = 0; v < 8; v++)
+			{
+				float sum = 0.0f;
+				for (int y = 0; y < 8; y++)
+				{
+					sum += rows[(y * 8) + u] * dctTable[(v * 8) + y];
+				}
+				coefficients[(v * 8) + u] = sum;
+			}
+		}
+
+		int quantized[64];
+		for (int i = 0; i < 64; i++)
+		{
+			int natural = ZIGZAG[i];
+			quantized[i] = (int)lroundf(coefficients[natural] * quantReciprocal[natural]);
+		}
+
+		// DC coefficient is coded as the difference to the previous block
+		int difference = quantized[0] - previousDC;
+		int category = MagnitudeCategory(difference);
+		writer.WriteBits(dcTable.codes[category], dcTable.lengths[category]);
+		WriteCoefficient(writer, difference, category);
+
+		// AC coefficients as (zero run, size) symbols
+		int lastNonZero = 63;
+		while ((lastNonZero > 0) && (quantized[lastNonZero] == 0))
+		{
+			lastNonZero--;
+		}
+
+		int run = 0;
+		for (int i = 1; i <= lastNonZero; i++)
+		{
+			if (quantized[i] == 0)
+			{
+				run++;
+				continue;
+			}
+			while (run > 15)
+			{
+				// ZRL, sixteen zeros
+				writer.WriteBits(acTable.codes[0xF0], acTable.lengths[0xF0]);
+				run -= 16;
+			}
+			category = MagnitudeCategory(quantized[i]);
+			int symbol = (run << 4) | category;
+			writer.WriteBits(acTable.codes[symbol], acTable.lengths[symbol]);
+			WriteCoefficient(writer, quantized[i], category);
+			run = 0;
+		}
+		if (lastNonZero < 63)
+		{
+			// EOB, the rest of the block is zero
+			writer.WriteBits(acTable.codes[0x00], acTable.lengths[0x00]);
+		}
+
+		return(quantized[0]);
+	}
+
+	void AppendHuffmanSegment(std::vector<unsigned char>& output, int tableClassAndId,
+		const unsigned char* bits, const unsigned char* values, int valueCount)
+	{
+		output.push_back(tableClassAndId);
+		output.insert(output.end(), bits, bits + 16);
+		output.insert(output.end(), values, values + valueCount);
+	}
+}
+
+/***********************************************************
+ *  EncodePNG()
+ *
+ *  This method encodes an 8-bit RGB or RGBA image as PNG.
+ *  Each row gets the filter with the smallest sum of
+ *  absolute residuals before deflate compression.
+ ***********************************************************/
+bool ImageEncoder::EncodePNG(const IMAGE_VIEW& image, std::vector<unsigned char>& output)
+{
+	if ((NULL == image.pixels) || (image.width <= 0) || (image.height <= 0) ||
+		((image.channels != 3) && (image.channels != 4)))
+	{
+		return(false);
+	}
+
+	int channels = image.channels;
+	size_t rowBytes = (size_t)image.width * channels;
+
+	// filtered scanlines, each prefixed with its filter type byte
+	std::vector<unsigned char> filtered;
+	filtered.reserve((rowBytes + 1) * image.height);
+
+	std::vector<unsigned char> zeroRow(rowBytes, 0);
+	std::vector<unsigned char> candidate(rowBytes);
+	std::vector<unsigned char> best(rowBytes);
+
+	for (int y = 0; y < image.height; y++)
+	{
+		const unsigned char* row = GetRow(image, y);
+		const unsigned char* above = (y > 0) ? GetRow(image, y - 1) : zeroRow.data();
+
+		int bestFilter = 0;
+		long bestScore = -1;
+		for (int filter = 0; filter < 5; filter++)
+		{
+			long score = 0;
+			for (size_t i = 0; i < rowBytes; i++)
+			{
+				int left = (i >= (size_t)channels) ? row[i - channels] : 0;
+				int up = above[i];
+				int upLeft = (i >= (size_t)channels) ? above[i - channels] : 0;
+				int predicted = 0;
+				switch (filter)
+				{
+				case 1: predicted = left; break;
+				case 2: predicted = up; break;
+				case 3: predicted = (left + up) / 2; break;
+				case 4: predicted = PaethPredictor(left, up, upLeft); break;
+				default: predicted = 0; break;
+				}
+				unsigned char residual = (unsigned char)(row[i] - predicted);
+				candidate[i] = residual;
+				score += (residual < 128) ? residual : (256 - residual);
+			}
+			if ((bestScore < 0) || (score < bestScore))
+			{
+				bestScore = score;
+				bestFilter = filter;
+				best.swap(candidate);
+			}
+		}
+
+		filtered.push_back((unsigned char)bestFilter);
+		filtered.insert(filtered.end(), best.begin(), best.end());
+	}
+
+	output.clear();
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	output.insert(output.end(), signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	AppendBigEndian32(header, (uint32_t)image.width);
+	AppendBigEndian32(header, (uint32_t)image.height);
+	header.push_back(8);                              // bit depth
+	header.push_back((channels == 4) ? 6 : 2);        // RGBA or RGB
+	header.push_back(0);                              // deflate
+	header.push_back(0);                              // adaptive filtering
+	header.push_back(0);                              // no interlace
+	AppendPngChunk(output, "IHDR", header);
+
+	std::vector<unsigned char> compressed;
+	compressed.reserve(filtered.size() / 2);
+	ZlibCompress(filtered, compressed);
+	AppendPngChunk(output, "IDAT", compressed);
+
+	AppendPngChunk(output, "IEND", std::vector<unsigned char>());
+
+	return(true);
+}
+
+/***********************************************************
+ *  EncodeJPEG()
+ *
+ *  This method encodes an 8-bit RGB or RGBA image as a
+ *  baseline JFIF file using the standard Annex K tables.
+ ***********************************************************/
+bool ImageEncoder::EncodeJPEG(const IMAGE_VIEW& image, int quality, std::vector<unsigned char>& output)
+{
+	if ((NULL == image.pixels) || (image.width <= 0) || (image.height <= 0) ||
+		(image.width > 65535) || (image.height > 65535) ||
+		((image.channels != 3) && (image.channels != 4)))
+	{
+		return(false);
+	}
+
+	quality = std::max(1, std::min(100, quality));
+	int scale = (quality < 50) ? (5000 / quality) : (200 - (quality * 2));
+
+	unsigned char quantTables[2][64];
+	float quantReciprocal[2][64];
+	for (int i = 0; i < 64; i++)
+	{
+		int luminance = ((LUMINANCE_QUANT[i] * scale) + 50) / 100;
+		int chrominance = ((CHROMINANCE_QUANT[i] * scale) + 50) / 100;
+		quantTables[0][i] = (unsigned char)std::max(1, std::min(255, luminance));
+		quantTables[1][i] = (unsigned char)std::max(1, std::min(255, chrominance));
+		quantReciprocal[0][i] = 1.0f / quantTables[0][i];
+		quantReciprocal[1][i] = 1.0f / quantTables[1][i];
+	}
+
+	// orthonormal DCT basis, dctTable[u * 8 + x]
+	float dctTable[64];
+	for (int u = 0; u < 8; u++)
+	{
+		float c = (u == 0) ? sqrtf(0.125f) : 0.5f;
+		for (int x = 0; x < 8; x++)
+		{
+			dctTable[(u * 8) + x] = c * cosf((float)(((2 * x) + 1) * u) * 3.14159265f / 16.0f);
+		}
+	}
+
+	HUFFMAN_TABLE dcLuminance;
+	HUFFMAN_TABLE acLuminance;
+	HUFFMAN_TABLE dcChrominance;
+	HUFFMAN_TABLE acChrominance;
+	BuildHuffmanTable(DC_LUMINANCE_BITS, DC_LUMINANCE_VALUES, dcLuminance);
+	BuildHuffmanTable(AC_LUMINANCE_BITS, AC_LUMINANCE_VALUES, acLuminance);
+	BuildHuffmanTable(DC_CHROMINANCE_BITS, DC_CHROMINANCE_VALUES, dcChrominance);
+	BuildHuffmanTable(AC_CHROMINANCE_BITS, AC_CHROMINANCE_VALUES, acChrominance);
+
+	output.clear();
+	output.reserve((size_t)image.width * image.height / 4);
+
+	// SOI and JFIF APP0
+	const unsigned char header[20] = {
+		0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+		0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00 };
+	output.insert(output.end(), header, header + 20);
+
+	// DQT, both tables stored in zigzag order
+	output.push_back(0xFF);
+	output.push_back(0xDB);
+	AppendBigEndian16(output, 2 + (2 * 65));
+	for (int table = 0; table < 2; table++)
+	{
+		output.push_back((unsigned char)table);
+		for (int i = 0; i < 64; i++)
+		{
+			output.push_back(quantTables[table][ZIGZAG[i]]);
+		}
+	}
+
+	// SOF0, three components without subsampling
+	output.push_back(0xFF);
+	output.push_back(0xC0);
+	AppendBigEndian16(output, 17);
+	output.push_back(8);
+	AppendBigEndian16(output, (uint32_t)image.height);
+	AppendBigEndian16(output, (uint32_t)image.width);
+	output.push_back(3);
+	const unsigned char components[9] = { 1, 0x11, 0, 2, 0x11, 1, 3, 0x11, 1 };
+	output.insert(output.end(), components, components + 9);
+
+	// DHT, all four tables in one segment
+	output.push_back(0xFF);
+	output.push_back(0xC4);
+	AppendBigEndian16(output, 2 + (4 * 17) + 12 + 162 + 12 + 162);
+	AppendHuffmanSegment(output, 0x00, DC_LUMINANCE_BITS, DC_LUMINANCE_VALUES, 12);
+	AppendHuffmanSegment(output, 0x10, AC_LUMINANCE_BITS, AC_LUMINANCE_VALUES, 162);
+	AppendHuffmanSegment(output, 0x01, DC_CHROMINANCE_BITS, DC_CHROMINANCE_VALUES, 12);
+	AppendHuffmanSegment(output, 0x11, AC_CHROMINANCE_BITS, AC_CHROMINANCE_VALUES, 162);
+
+	// SOS
+	const unsigned char scanHeader[14] = {
+		0xFF, 0xDA, 0x00, 0x0C, 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+	output.insert(output.end(), scanHeader, scanHeader + 14);
+
+	JPEG_BIT_WRITER writer;
+	writer.pOutput = &output;
+	writer.bitBuffer = 0;
+	writer.bitCount = 0;
+
+	int previousDC[3] = { 0, 0, 0 };
+	float blocks[3][64];
+
+	for (int blockY = 0; blockY < image.height; blockY += 8)
+	{
+		for (int blockX = 0; blockX < image.width; blockX += 8)
+		{
+			for (int y = 0; y < 8; y++)
+			{
+				// edge blocks repeat the last row and column
+				const unsigned char* row = GetRow(image, std::min(blockY + y, image.height - 1));
+				for (int x = 0; x < 8; x++)
+				{
+					const unsigned char* pixel = row + ((size_t)std::min(blockX + x, image.width - 1) * image.channels);
+					float r = pixel[0];
+					float g = pixel[1];
+					float b = pixel[2];
+					int index = (y * 8) + x;
+					blocks[0][index] = (0.299f * r) + (0.587f * g) + (0.114f * b) - 128.0f;
+					blocks[1][index] = (-0.168736f * r) - (0.331264f * g) + (0.5f * b);
+					blocks[2][index] = (0.5f * r) - (0.418688f * g) - (0.081312f * b);
+				}
+			}
+
+			previousDC[0] = EncodeBlock(writer, blocks[0], dctTable, quantReciprocal[0], previousDC[0], dcLuminance, acLuminance);
+			previousDC[1] = EncodeBlock(writer, blocks[1], dctTable, quantReciprocal[1], previousDC[1], dcChrominance, acChrominance);
+			previousDC[2] = EncodeBlock(writer, blocks[2], dctTable, quantReciprocal[1], previousDC[2], dcChrominance, acChrominance);
+		}
+	}
+
+	writer.Flush();
+
+	// EOI
+	output.push_back(0xFF);
+	output.push_back(0xD9);
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsSupportedExtension()
+ *
+ *  This method checks the extension of an output filename.
+ ***********************************************************/
+bool ImageEncoder::IsSupportedExtension(const std::string& filename)
+{
+	size_t dot = filename.find_last_of('.');
+	if (dot == std::string::npos)
+	{
+		return(false);
+	}
+
+	std::string extension = filename.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return((extension == "png") || (extension == "jpg") || (extension == "jpeg"));
+}
+
+/***********************************************************
+ *  WriteImageFile()
+ *
+ *  This method encodes the image in the format named by the
+ *  file extension and writes it to disk.
+ ***********************************************************/
+bool ImageEncoder::WriteImageFile(const std::string& filename, const IMAGE_VIEW& image, int jpegQuality)
+{
+	size_t dot = filename.find_last_of('.');
+	std::string extension = (dot == std::string::npos) ? "" : filename.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	std::vector<unsigned char> encoded;
+	bool bEncoded = false;
+	if (extension == "png")
+	{
+		bEncoded = EncodePNG(image, encoded);
+	}
+	else if ((extension == "jpg") || (extension == "jpeg"))
+	{
+		bEncoded = EncodeJPEG(image, jpegQuality, encoded);
+	}
+
+	if (bEncoded == false)
+	{
+		return(false);
+	}
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		return(false);
+	}
+	size_t written = fwrite(encoded.data(), 1, encoded.size(), pFile);
+	fclose(pFile);
+
+	return(written == encoded.size());
+}
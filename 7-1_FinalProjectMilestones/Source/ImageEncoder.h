@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// imageencoder.h
+// ============
+// encode captured frames to PNG and baseline JPEG files
+//
+// Both encoders are self contained so they can run on worker threads with
+// no library state.  Input rows may be stored bottom-to-top, as OpenGL
+// returns them, in which case bFlipVertically writes them top-to-bottom.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class ImageEncoder
+{
+public:
+	// description of a block of 8-bit pixels in memory
+	struct IMAGE_VIEW
+	{
+		const unsigned char* pixels;
+		int width;
+		int height;
+		int channels;          // 3 (RGB) or 4 (RGBA)
+		int stride;            // bytes from one row to the next
+		bool bFlipVertically;  // true when rows are stored bottom-to-top
+	};
+
+	// PNG with adaptive row filters and fixed-Huffman deflate compression
+	static bool EncodePNG(const IMAGE_VIEW& image, std::vector<unsigned char>& output);
+
+	// baseline JPEG with 4:4:4 sampling, quality 1..100; alpha is dropped
+	static bool EncodeJPEG(const IMAGE_VIEW& image, int quality, std::vector<unsigned char>& output);
+
+	// pick the encoder from the file extension (.png, .jpg, .jpeg) and
+	// write the result to disk
+	static bool WriteImageFile(const std::string& filename, const IMAGE_VIEW& image, int jpegQuality);
+
+	// true if the file extension is one that WriteImageFile supports
+	static bool IsSupportedExtension(const std::string& filename);
+};
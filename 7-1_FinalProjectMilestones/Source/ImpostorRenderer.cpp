@@ -0,0 +1,589 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorrenderer.cpp
+// ============
+// draw distant multi-part assemblies as one textured quad each
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorRenderer.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the parts fade into the impostor between these distances from
+	// the camera to the center of an assembly
+	const float IMPOSTOR_NEAR = 55.0f;
+	const float IMPOSTOR_FAR = 65.0f;
+	const float PI = 3.14159265f;
+	// the atlases are read on these units while the impostors are
+	// drawn; the scene's textures on them are restored afterwards
+	const int COLOR_ATLAS_UNIT = 13;
+	const int NORMAL_ATLAS_UNIT = 14;
+	const int DEPTH_ATLAS_UNIT = 15;
+	// the smallest mipmap is a few pixels per frame, so the frames do
+	// not bleed into each other
+	const int ATLAS_MAX_LEVEL = 4;
+	// instances reserved when the instance buffer is created
+	const int INITIAL_INSTANCES = 64;
+}
+
+/***********************************************************
+ *  ImpostorRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorRenderer::ImpostorRenderer()
+{
+	m_bInitialized = false;
+	m_pMeshes = NULL;
+	m_quadArray = 0;
+	m_quadBuffer = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+}
+
+/***********************************************************
+ *  ~ImpostorRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorRenderer::~ImpostorRenderer()
+{
+	for (size_t i = 0; i < m_atlases.size(); i++)
+	{
+		glDeleteTextures(1, &m_atlases[i].colorTexture);
+		glDeleteTextures(1, &m_atlases[i].normalTexture);
+		glDeleteTextures(1, &m_atlases[i].depthTexture);
+	}
+	m_atlases.clear();
+
+	if (m_quadArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_quadArray);
+		m_quadArray = 0;
+	}
+	if (m_quadBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_quadBuffer);
+		m_quadBuffer = 0;
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	m_pMeshes = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method loads the bake program, which draws the parts
+ *  with the scene's DrawUniforms block, and the impostor
+ *  program, and creates the quad.
+ ***********************************************************/
+bool ImpostorRenderer::Initialize(
+	const MeshLibrary* pMeshes,
+	const char* bakeVertexShaderFile,
+	const char* bakeFragmentShaderFile,
+	const char* vertexShaderFile,
+	const char* fragmentShaderFile)
+{
+	if (NULL == pMeshes)
+	{
+		return(false);
+	}
+	m_pMeshes = pMeshes;
+
+	if ((m_bakeShader.LoadShaders(bakeVertexShaderFile, bakeFragmentShaderFile) == 0) ||
+		(m_shader.LoadShaders(vertexShaderFile, fragmentShaderFile) == 0))
+	{
+		std::cout << "Could not load the impostor shaders" << std::endl;
+		return(false);
+	}
+	if (DrawUniformBuffer::BindProgram(m_bakeShader.m_programID) == false)
+	{
+		return(false);
+	}
+
+	GLuint bakeProgram = m_bakeShader.m_programID;
+	m_bakeUniforms.view.Resolve(bakeProgram, "view");
+	m_bakeUniforms.projection.Resolve(bakeProgram, "projection");
+	m_bakeUniforms.objectTexture.Resolve(bakeProgram, "objectTexture");
+
+	GLuint program = m_shader.m_programID;
+	m_uniforms.viewProjection.Resolve(program, "viewProjection");
+	m_uniforms.viewPosition.Resolve(program, "viewPosition");
+	m_uniforms.viewDirection.Resolve(program, "viewDirection");
+	m_uniforms.bOrthographic.Resolve(program, "bOrthographic");
+	m_uniforms.radius.Resolve(program, "radius");
+	m_uniforms.colorAtlas.Resolve(program, "colorAtlas");
+	m_uniforms.normalAtlas.Resolve(program, "normalAtlas");
+	m_uniforms.depthAtlas.Resolve(program, "depthAtlas");
+
+	if (CreateQuad() == false)
+	{
+		std::cout << "Could not create the impostor quad" << std::endl;
+		return(false);
+	}
+
+	m_bInitialized = true;
+	return(true);
+}
+
+/***********************************************************
+ *  CreateQuad()
+ *
+ *  This method creates the vertex array of the impostor
+ *  quad: the corners at location 0 and the center and fade
+ *  of each instance at location 3.
+ ***********************************************************/
+bool ImpostorRenderer::CreateQuad()
+{
+	const float corners[] = {
+		-1.0f, -1.0f,
+		1.0f, -1.0f,
+		1.0f, 1.0f,
+		-1.0f, 1.0f };
+
+	glGenVertexArrays(1, &m_quadArray);
+	glGenBuffers(1, &m_quadBuffer);
+	glGenBuffers(1, &m_instanceBuffer);
+	if ((m_quadArray == 0) || (m_quadBuffer == 0) || (m_instanceBuffer == 0))
+	{
+		return(false);
+	}
+
+	glBindVertexArray(m_quadArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_quadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
+
+	m_instanceCapacity = INITIAL_INSTANCES;
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_drawInstances.reserve(m_instanceCapacity);
+	return(true);
+}
+
+/***********************************************************
+ *  CreateAtlasTexture()
+ *
+ *  This method creates the storage of one atlas.
+ ***********************************************************/
+GLuint ImpostorRenderer::CreateAtlasTexture(GLint internalFormat, GLenum format, GLenum type, bool bMipmaps)
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat,
+		YAW_FRAMES * FRAME_PIXELS, ELEVATION_FRAMES * FRAME_PIXELS, 0, format, type, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, bMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, bMipmaps ? GL_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, bMipmaps ? ATLAS_MAX_LEVEL : 0);
+	return(texture);
+}
+
+/***********************************************************
+ *  GetFrameDirection()
+ *
+ *  This method returns the unit direction from an assembly
+ *  to the bake camera of a frame.  The yaw frames go around
+ *  the vertical axis, the elevation frames from the horizon
+ *  up in equal steps; the highest stays below the vertical,
+ *  where the bake camera's up direction would not be valid.
+ ***********************************************************/
+glm::vec3 ImpostorRenderer::GetFrameDirection(int yawFrame, int elevationFrame)
+{
+	float yaw = 2.0f * PI * (float)yawFrame / (float)YAW_FRAMES;
+	float elevation = 0.5f * PI * (float)elevationFrame / (float)ELEVATION_FRAMES;
+	return(glm::vec3(
+		sinf(yaw) * cosf(elevation),
+		sinf(elevation),
+		cosf(yaw) * cosf(elevation)));
+}
+
+/***********************************************************
+ *  BakeAtlas()
+ *
+ *  This method renders every frame of an assembly through an
+ *  orthographic camera that fits its bounding sphere.  The
+ *  depth of such a camera is linear, so the depth atlas
+ *  gives the distance in front of the sphere's center
+ *  directly.
+ ***********************************************************/
+int ImpostorRenderer::BakeAtlas(const char* name, const std::vector<BAKE_PART>& parts)
+{
+	if (!m_bInitialized || parts.empty())
+	{
+		return(-1);
+	}
+
+	BoundingVolumes::BOX bounds = parts[0].bounds;
+	for (size_t i = 1; i < parts.size(); i++)
+	{
+		bounds.minimum = glm::min(bounds.minimum, parts[i].bounds.minimum);
+		bounds.maximum = glm::max(bounds.maximum, parts[i].bounds.maximum);
+	}
+
+	ATLAS atlas;
+	atlas.name = name;
+	atlas.center = (bounds.minimum + bounds.maximum) * 0.5f;
+	atlas.radius = glm::length(bounds.maximum - bounds.minimum) * 0.5f;
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	atlas.colorTexture = CreateAtlasTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, true);
+	atlas.normalTexture = CreateAtlasTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, true);
+	atlas.depthTexture = CreateAtlasTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, false);
+
+	GLint previousFramebuffer = 0;
+	GLint previousProgram = 0;
+	GLint previousArray = 0;
+	GLint previousViewport[4];
+	GLfloat previousClearColor[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousArray);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+	// the bake may run before the render loop has enabled the depth test
+	GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas.colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas.normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas.depthTexture, 0);
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	if (status == GL_FRAMEBUFFER_COMPLETE)
+	{
+		// empty texels have no coverage and the farthest depth
+		glViewport(0, 0, YAW_FRAMES * FRAME_PIXELS, ELEVATION_FRAMES * FRAME_PIXELS);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+
+		m_bakeShader.use();
+		DrawUniformBuffer records;
+		records.Create();
+		records.Begin();
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			records.Append(parts[i].uniforms);
+		}
+		records.Upload();
+
+		// the camera sits on the sphere's diameter, so its depth range
+		// is the sphere and the center is at depth one half
+		glm::mat4 projection = glm::ortho(
+			-atlas.radius, atlas.radius,
+			-atlas.radius, atlas.radius,
+			atlas.radius, atlas.radius * 3.0f);
+		m_bakeUniforms.projection.Set(projection);
+
+		m_pMeshes->Bind();
+		for (int elevationFrame = 0; elevationFrame < ELEVATION_FRAMES; elevationFrame++)
+		{
+			for (int yawFrame = 0; yawFrame < YAW_FRAMES; yawFrame++)
+			{
+				glViewport(yawFrame * FRAME_PIXELS, elevationFrame * FRAME_PIXELS, FRAME_PIXELS, FRAME_PIXELS);
+				glm::vec3 eye = atlas.center + GetFrameDirection(yawFrame, elevationFrame) * (atlas.radius * 2.0f);
+				m_bakeUniforms.view.Set(glm::lookAt(eye, atlas.center, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+				for (size_t i = 0; i < parts.size(); i++)
+				{
+					records.Bind((int)i);
+					if (parts[i].textureSlot >= 0)
+					{
+						m_bakeUniforms.objectTexture.Set(SAMPLER_UNIT{ parts[i].textureSlot });
+					}
+					m_pMeshes->Draw(parts[i].mesh, 1);
+				}
+			}
+		}
+		records.Destroy();
+
+		glBindTexture(GL_TEXTURE_2D, atlas.colorTexture);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, atlas.normalTexture);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+	glUseProgram(previousProgram);
+	glBindVertexArray((GLuint)previousArray);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+	if (!bDepthTest)
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Impostor framebuffer is incomplete, status 0x" << std::hex << status << std::dec << std::endl;
+		glDeleteTextures(1, &atlas.colorTexture);
+		glDeleteTextures(1, &atlas.normalTexture);
+		glDeleteTextures(1, &atlas.depthTexture);
+		return(-1);
+	}
+
+	m_atlases.push_back(atlas);
+	std::cout << "INFO: Baked the " << name << " impostor from " << parts.size() << " parts into "
+		<< YAW_FRAMES * ELEVATION_FRAMES << " frames" << std::endl;
+	return((int)m_atlases.size() - 1);
+}
+
+/***********************************************************
+ *  FindAtlas()
+ *
+ *  This method finds a baked atlas by the name of its
+ *  assembly.
+ ***********************************************************/
+int ImpostorRenderer::FindAtlas(const char* name) const
+{
+	for (size_t i = 0; i < m_atlases.size(); i++)
+	{
+		if (m_atlases[i].name == name)
+		{
+			return((int)i);
+		}
+	}
+	return(-1);
+}
+
+/***********************************************************
+ *  AddInstance()
+ *
+ *  This method places a copy of an assembly.  The handles of
+ *  removed instances are reused.
+ ***********************************************************/
+int ImpostorRenderer::AddInstance(int atlas, const glm::vec3& position)
+{
+	if ((atlas < 0) || (atlas >= (int)m_atlases.size()))
+	{
+		return(-1);
+	}
+
+	INSTANCE instance;
+	instance.atlas = atlas;
+	instance.position = position;
+	instance.bAlive = true;
+	instance.bResident = false;
+	instance.fade = 1.0f;
+
+	if (!m_freeInstances.empty())
+	{
+		int handle = m_freeInstances.back();
+		m_freeInstances.pop_back();
+		m_instances[handle] = instance;
+		return(handle);
+	}
+	m_instances.push_back(instance);
+	return((int)m_instances.size() - 1);
+}
+
+/***********************************************************
+ *  RemoveInstance()
+ *
+ *  This method removes a placed copy of an assembly.
+ ***********************************************************/
+void ImpostorRenderer::RemoveInstance(int instance)
+{
+	if ((instance < 0) || (instance >= (int)m_instances.size()) || !m_instances[instance].bAlive)
+	{
+		return;
+	}
+	m_instances[instance].bAlive = false;
+	m_freeInstances.push_back(instance);
+}
+
+/***********************************************************
+ *  SetPartsResident()
+ *
+ *  This method records whether the parts of an instance can
+ *  be drawn instead of its impostor.
+ ***********************************************************/
+void ImpostorRenderer::SetPartsResident(int instance, bool bResident)
+{
+	if ((instance >= 0) && (instance < (int)m_instances.size()))
+	{
+		m_instances[instance].bResident = bResident;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method computes the fade of every instance from its
+ *  distance to the camera.
+ ***********************************************************/
+void ImpostorRenderer::Update(const glm::vec3& cameraPosition)
+{
+	m_fades.resize(m_instances.size());
+	for (size_t i = 0; i < m_instances.size(); i++)
+	{
+		INSTANCE& instance = m_instances[i];
+		if (!instance.bAlive)
+		{
+			m_fades[i] = 1.0f;
+			continue;
+		}
+		if (!instance.bResident)
+		{
+			instance.fade = 1.0f;
+			m_fades[i] = instance.fade;
+			continue;
+		}
+
+		float distance = glm::length(instance.position + m_atlases[instance.atlas].center - cameraPosition);
+		instance.fade = glm::clamp((distance - IMPOSTOR_NEAR) / (IMPOSTOR_FAR - IMPOSTOR_NEAR), 0.0f, 1.0f);
+		m_fades[i] = instance.fade;
+	}
+}
+
+/***********************************************************
+ *  GetFade()
+ *
+ *  This method returns how far an instance has faded into
+ *  its impostor.
+ ***********************************************************/
+float ImpostorRenderer::GetFade(int instance) const
+{
+	if ((instance < 0) || (instance >= (int)m_instances.size()))
+	{
+		return(0.0f);
+	}
+	return(m_instances[instance].fade);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method draws the visible impostors of each atlas in
+ *  one instanced call.  The orthographic views look along
+ *  their own direction instead of from a point.
+ ***********************************************************/
+void ImpostorRenderer::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (!m_bInitialized || m_atlases.empty())
+	{
+		return;
+	}
+
+	glm::mat4 viewProjection = projection * view;
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(viewProjection);
+	glm::mat4 inverseView = glm::inverse(view);
+	bool bOrthographic = (projection[3][3] == 1.0f);
+
+	GLint previousProgram = 0;
+	GLint previousActiveTexture = 0;
+	GLint previousTextures[3];
+	const int units[3] = { COLOR_ATLAS_UNIT, NORMAL_ATLAS_UNIT, DEPTH_ATLAS_UNIT };
+	bool bStateSaved = false;
+
+	for (size_t atlasIndex = 0; atlasIndex < m_atlases.size(); atlasIndex++)
+	{
+		const ATLAS& atlas = m_atlases[atlasIndex];
+
+		m_drawInstances.clear();
+		for (size_t i = 0; i < m_instances.size(); i++)
+		{
+			const INSTANCE& instance = m_instances[i];
+			if (!instance.bAlive || (instance.atlas != (int)atlasIndex) || (instance.fade <= 0.0f))
+			{
+				continue;
+			}
+
+			glm::vec3 center = instance.position + atlas.center;
+			BoundingVolumes::BOX sphereBox;
+			sphereBox.minimum = center - glm::vec3(atlas.radius);
+			sphereBox.maximum = center + glm::vec3(atlas.radius);
+			if (BoundingVolumes::IsBoxVisible(frustum, sphereBox))
+			{
+				m_drawInstances.push_back(glm::vec4(center, instance.fade));
+			}
+		}
+		if (m_drawInstances.empty())
+		{
+			continue;
+		}
+
+		if (!bStateSaved)
+		{
+			glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+			glGetIntegerv(GL_ACTIVE_TEXTURE, &previousActiveTexture);
+			for (int i = 0; i < 3; i++)
+			{
+				glActiveTexture(GL_TEXTURE0 + units[i]);
+				glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTextures[i]);
+			}
+
+			m_shader.use();
+			m_uniforms.viewProjection.Set(viewProjection);
+			m_uniforms.viewPosition.Set(glm::vec3(inverseView[3]));
+			m_uniforms.viewDirection.Set(glm::normalize(glm::vec3(inverseView[2])));
+			m_uniforms.bOrthographic.Set(bOrthographic);
+			m_uniforms.colorAtlas.Set(SAMPLER_UNIT{ COLOR_ATLAS_UNIT });
+			m_uniforms.normalAtlas.Set(SAMPLER_UNIT{ NORMAL_ATLAS_UNIT });
+			m_uniforms.depthAtlas.Set(SAMPLER_UNIT{ DEPTH_ATLAS_UNIT });
+			bStateSaved = true;
+		}
+
+		m_uniforms.radius.Set(atlas.radius);
+		glActiveTexture(GL_TEXTURE0 + COLOR_ATLAS_UNIT);
+		glBindTexture(GL_TEXTURE_2D, atlas.colorTexture);
+		glActiveTexture(GL_TEXTURE0 + NORMAL_ATLAS_UNIT);
+		glBindTexture(GL_TEXTURE_2D, atlas.normalTexture);
+		glActiveTexture(GL_TEXTURE0 + DEPTH_ATLAS_UNIT);
+		glBindTexture(GL_TEXTURE_2D, atlas.depthTexture);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+		if (m_drawInstances.size() > m_instanceCapacity)
+		{
+			m_instanceCapacity = m_drawInstances.size();
+		}
+		// orphaned like the draw uniforms, so the upload does not wait
+		// for the previous view's draw
+		glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_drawInstances.size() * sizeof(glm::vec4), &m_drawInstances[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindVertexArray(m_quadArray);
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, (GLsizei)m_drawInstances.size());
+		glBindVertexArray(0);
+	}
+
+	if (bStateSaved)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + units[i]);
+			glBindTexture(GL_TEXTURE_2D, previousTextures[i]);
+		}
+		glActiveTexture(previousActiveTexture);
+		glUseProgram(previousProgram);
+	}
+}
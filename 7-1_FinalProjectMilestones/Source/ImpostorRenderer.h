@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorrenderer.h
+// ============
+// draw distant multi-part assemblies as one textured quad each
+//
+// An assembly, such as a workstation made of a desk, a monitor and a
+// keyboard of small boxes, is rendered once at load time from
+// YAW_FRAMES directions around it at each of ELEVATION_FRAMES heights.  The
+// frames go into three atlases: the unlit color with its coverage, the
+// normal with the strength of the specular highlight, and the depth of
+// the orthographic bake.  A placed copy of an assembly is an instance; the
+// instances are drawn as camera facing quads that blend the two baked
+// frames nearest to the view direction, light the baked normals with the
+// scene lights and write the baked depth, so they intersect the other
+// geometry correctly.
+//
+// Between IMPOSTOR_NEAR and IMPOSTOR_FAR the parts and the impostor are
+// cross-faded with complementary dither patterns; beyond it only the
+// impostor is drawn.  An instance whose parts are not created yet, or are
+// being removed, always shows the impostor.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "MeshLibrary.h"
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class ImpostorRenderer
+{
+public:
+	// the frames of an atlas; each frame is FRAME_PIXELS square
+	static const int YAW_FRAMES = 16;
+	static const int ELEVATION_FRAMES = 4;
+	static const int FRAME_PIXELS = 128;
+
+	// one basic shape of an assembly as the scene draws it, placed in
+	// the space of the assembly
+	struct BAKE_PART
+	{
+		MeshLibrary::MESH_ID mesh;
+		int textureSlot;            // -1 draws with the solid color
+		DRAW_UNIFORMS uniforms;
+		BoundingVolumes::BOX bounds;
+	};
+
+	// constructor
+	ImpostorRenderer();
+	// destructor
+	~ImpostorRenderer();
+
+	// load the bake and the impostor programs and create the quad; the
+	// parts are baked with the meshes of the library, which must
+	// outlive the renderer
+	bool Initialize(
+		const MeshLibrary* pMeshes,
+		const char* bakeVertexShaderFile,
+		const char* bakeFragmentShaderFile,
+		const char* vertexShaderFile,
+		const char* fragmentShaderFile);
+	// the impostor program, for the light uniforms of the scene
+	GLuint GetProgram() const { return m_shader.m_programID; }
+
+	// render the frames of an assembly into new atlases; the textures
+	// of the parts must be bound to their slots.  Returns the atlas
+	// index, or -1 when it could not be baked
+	int BakeAtlas(const char* name, const std::vector<BAKE_PART>& parts);
+	int FindAtlas(const char* name) const;
+	int GetAtlasCount() const { return (int)m_atlases.size(); }
+
+	// place a copy of an assembly with its origin at position; returns
+	// the instance handle, or -1 for an atlas that does not exist
+	int AddInstance(int atlas, const glm::vec3& position);
+	void RemoveInstance(int instance);
+	// whether the parts of an instance exist and may be drawn
+	void SetPartsResident(int instance, bool bResident);
+
+	// compute the fade of every instance for the camera
+	void Update(const glm::vec3& cameraPosition);
+	// 0 draws the parts alone, 1 the impostor alone
+	float GetFade(int instance) const;
+	// the fades of all instances by number, as of the last Update()
+	const std::vector<float>& GetFades() const { return m_fades; }
+
+	// draw the impostors that are fading in or faded in and inside the
+	// view; the view's viewport must be set
+	void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+private:
+	struct ATLAS
+	{
+		std::string name;
+		GLuint colorTexture;
+		GLuint normalTexture;
+		GLuint depthTexture;
+		// the bounding sphere of the assembly in its own space
+		glm::vec3 center;
+		float radius;
+	};
+
+	struct INSTANCE
+	{
+		int atlas;
+		glm::vec3 position;
+		bool bAlive;
+		bool bResident;
+		float fade;
+	};
+
+	// the uniforms of the impostor program
+	struct IMPOSTOR_UNIFORMS
+	{
+		Uniform<glm::mat4> viewProjection;
+		Uniform<glm::vec3> viewPosition;
+		Uniform<glm::vec3> viewDirection;
+		Uniform<bool> bOrthographic;
+		Uniform<float> radius;
+		Uniform<SAMPLER_UNIT> colorAtlas;
+		Uniform<SAMPLER_UNIT> normalAtlas;
+		Uniform<SAMPLER_UNIT> depthAtlas;
+	};
+
+	// the uniforms of the bake program outside its DrawUniforms block
+	struct BAKE_UNIFORMS
+	{
+		Uniform<glm::mat4> view;
+		Uniform<glm::mat4> projection;
+		Uniform<SAMPLER_UNIT> objectTexture;
+	};
+
+	bool m_bInitialized;
+	ShaderManager m_bakeShader;
+	ShaderManager m_shader;
+	BAKE_UNIFORMS m_bakeUniforms;
+	IMPOSTOR_UNIFORMS m_uniforms;
+	// the parts are baked with the instanced meshes
+	const MeshLibrary* m_pMeshes;
+	// the corners of the quad and the per-instance centers and fades
+	GLuint m_quadArray;
+	GLuint m_quadBuffer;
+	GLuint m_instanceBuffer;
+	size_t m_instanceCapacity;
+
+	std::vector<ATLAS> m_atlases;
+	std::vector<INSTANCE> m_instances;
+	std::vector<int> m_freeInstances;
+	// the fade of every instance, removed ones at 1
+	std::vector<float> m_fades;
+	// the instances of one atlas drawn by Draw(), reused every frame
+	std::vector<glm::vec4> m_drawInstances;
+
+	// the direction from the center of an assembly to the camera of a
+	// baked frame
+	static glm::vec3 GetFrameDirection(int yawFrame, int elevationFrame);
+	static GLuint CreateAtlasTexture(GLint internalFormat, GLenum format, GLenum type, bool bMipmaps);
+	bool CreateQuad();
+};
@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputqueue.cpp
+// ============
+// queue the keyboard and mouse events of a window with their times
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputQueue.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  InputQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputQueue::InputQueue()
+{
+	m_head = 0;
+	m_count = 0;
+	m_droppedCount = 0;
+	m_bFirstMotion = true;
+	m_lastX = 0.0;
+	m_lastY = 0.0;
+	m_bRawMotion = false;
+}
+
+/***********************************************************
+ *  Attach()
+ *
+ *  This method installs the input callbacks of a window.
+ ***********************************************************/
+void InputQueue::Attach(GLFWwindow* window)
+{
+	glfwSetWindowUserPointer(window, this);
+	glfwSetKeyCallback(window, &InputQueue::Key_Callback);
+	glfwSetMouseButtonCallback(window, &InputQueue::Mouse_Button_Callback);
+	glfwSetCursorPosCallback(window, &InputQueue::Mouse_Position_Callback);
+	glfwSetScrollCallback(window, &InputQueue::Mouse_Scroll_Wheel_Callback);
+
+	// raw motion only applies while the cursor is disabled, which is
+	// how the camera is steered
+	if (glfwRawMouseMotionSupported())
+	{
+		glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+		m_bRawMotion = true;
+	}
+	std::cout << "INFO: Input events are queued with their times, mouse motion "
+		<< (m_bRawMotion ? "raw" : "accelerated by the desktop") << std::endl;
+}
+
+/***********************************************************
+ *  Pop()
+ *
+ *  This method takes the oldest event out of the queue.
+ ***********************************************************/
+bool InputQueue::Pop(INPUT_EVENT& event)
+{
+	if (m_count == 0)
+	{
+		return(false);
+	}
+
+	event = m_events[m_head];
+	m_head = (m_head + 1) % MAX_EVENTS;
+	m_count--;
+	return(true);
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  This method adds an event with the current time.  When
+ *  the queue is full, motion is added to the newest motion
+ *  event, and other events are dropped.
+ ***********************************************************/
+void InputQueue::Push(EVENT_TYPE type, int code, int action, double x, double y)
+{
+	double time = glfwGetTime();
+	if (m_count == MAX_EVENTS)
+	{
+		INPUT_EVENT& newest = m_events[(m_head + m_count - 1) % MAX_EVENTS];
+		if ((type == EVENT_MOUSE_MOVE) && (newest.type == EVENT_MOUSE_MOVE))
+		{
+			newest.time = time;
+			newest.x += x;
+			newest.y += y;
+		}
+		else
+		{
+			m_droppedCount++;
+		}
+		return;
+	}
+
+	INPUT_EVENT& event = m_events[(m_head + m_count) % MAX_EVENTS];
+	event.type = type;
+	event.time = time;
+	event.code = code;
+	event.action = action;
+	event.x = x;
+	event.y = y;
+	m_count++;
+}
+
+/***********************************************************
+ *  Key_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a key is pressed, repeated or released.
+ ***********************************************************/
+void InputQueue::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	InputQueue* pQueue = static_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+	if ((NULL != pQueue) && (key != GLFW_KEY_UNKNOWN))
+	{
+		pQueue->Push(EVENT_KEY, key, action, 0.0, 0.0);
+	}
+}
+
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a mouse button is pressed or released.
+ ***********************************************************/
+void InputQueue::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	InputQueue* pQueue = static_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+	if (NULL != pQueue)
+	{
+		pQueue->Push(EVENT_MOUSE_BUTTON, button, action, 0.0, 0.0);
+	}
+}
+
+/***********************************************************
+ *  Mouse_Position_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the mouse is moved within the active GLFW display window.
+ ***********************************************************/
+void InputQueue::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
+{
+	InputQueue* pQueue = static_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+	if (NULL == pQueue)
+	{
+		return;
+	}
+
+	// the first position only sets where the motion starts from
+	if (pQueue->m_bFirstMotion)
+	{
+		pQueue->m_lastX = xMousePos;
+		pQueue->m_lastY = yMousePos;
+		pQueue->m_bFirstMotion = false;
+	}
+
+	// reversed since y-coordinates go from bottom to top
+	double xOffset = xMousePos - pQueue->m_lastX;
+	double yOffset = pQueue->m_lastY - yMousePos;
+	pQueue->m_lastX = xMousePos;
+	pQueue->m_lastY = yMousePos;
+
+	pQueue->Push(EVENT_MOUSE_MOVE, 0, 0, xOffset, yOffset);
+}
+
+/***********************************************************
+ *  Mouse_Scroll_Wheel_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the mouse wheel is scrolled.
+ ***********************************************************/
+void InputQueue::Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double xOffset, double yOffset)
+{
+	InputQueue* pQueue = static_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+	if (NULL != pQueue)
+	{
+		pQueue->Push(EVENT_SCROLL, 0, 0, xOffset, yOffset);
+	}
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputqueue.h
+// ============
+// queue the keyboard and mouse events of a window with their times
+//
+// The GLFW callbacks of the window push every key, mouse button, mouse
+// motion and scroll event into a fixed ring, stamped with glfwGetTime()
+// when it is delivered; GLFW passes no time of its own.  The view manager
+// drains the ring once per frame and applies the events in order at their
+// times, so a key held for part of a frame moves the camera for that part
+// only, and a tap between two frames is not lost.  Mouse motion is read
+// raw, without the acceleration of the desktop, where it is supported.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+class InputQueue
+{
+public:
+	enum EVENT_TYPE
+	{
+		EVENT_KEY,
+		EVENT_MOUSE_BUTTON,
+		EVENT_MOUSE_MOVE,
+		EVENT_SCROLL
+	};
+
+	struct INPUT_EVENT
+	{
+		EVENT_TYPE type;
+		// glfwGetTime() when the event was delivered
+		double time;
+		// the key or mouse button, and GLFW_PRESS, GLFW_RELEASE or
+		// GLFW_REPEAT
+		int code;
+		int action;
+		// the motion since the previous mouse event, y up, or the
+		// scroll offsets
+		double x;
+		double y;
+	};
+
+	// events held between two frames before new ones are dropped
+	static const int MAX_EVENTS = 512;
+
+	// constructor
+	InputQueue();
+
+	// install the callbacks of the window and turn on raw mouse motion
+	// when it is supported; the window's user pointer is this queue
+	void Attach(GLFWwindow* window);
+
+	// take the oldest event; false when the queue is empty
+	bool Pop(INPUT_EVENT& event);
+	// events lost because the queue was full
+	int GetDroppedCount() const { return m_droppedCount; }
+	bool IsRawMotion() const { return m_bRawMotion; }
+
+private:
+	INPUT_EVENT m_events[MAX_EVENTS];
+	int m_head;
+	int m_count;
+	int m_droppedCount;
+	// the cursor position of the previous motion event
+	bool m_bFirstMotion;
+	double m_lastX;
+	double m_lastY;
+	bool m_bRawMotion;
+
+	void Push(EVENT_TYPE type, int code, int action, double x, double y);
+
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
+	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
+	static void Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double xOffset, double yOffset);
+};
@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////////////
+// layeredrenderer.cpp
+// ============
+// draw one stream of draw calls into several views in a single pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LayeredRenderer.h"
+#include "ShaderCompiler.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_ViewBlockName = "LayeredViews";
+	// uniform buffer binding point of the view block
+	const GLuint VIEW_BLOCK_BINDING = 0;
+
+	// std140 layout of the view block
+	struct VIEW_BLOCK
+	{
+		glm::mat4 viewProjection[LayeredRenderer::MAX_VIEWS];
+		glm::vec4 viewPositions[LayeredRenderer::MAX_VIEWS];
+	};
+}
+
+/***********************************************************
+ *  LayeredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LayeredRenderer::LayeredRenderer()
+{
+	m_bAvailable = false;
+	m_bVertexShaderLayer = false;
+	m_program = 0;
+	m_viewBuffer = 0;
+	m_viewCount = 0;
+	m_previousProgram = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_previousViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~LayeredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LayeredRenderer::~LayeredRenderer()
+{
+	if (m_viewBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_viewBuffer);
+		m_viewBuffer = 0;
+	}
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+	// the program belongs to this class, not the shader manager
+	m_shaderManager.m_programID = 0;
+	m_bAvailable = false;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method compiles and links the layered program,
+ *  choosing the vertex shader or the geometry shader to
+ *  route the views, and creates the view buffer and the
+ *  instanced meshes.
+ ***********************************************************/
+bool LayeredRenderer::Initialize(const char* vertexShaderFile, const char* geometryShaderFile, const char* fragmentShaderFile)
+{
+	// several viewports need viewport arrays; layers alone would not,
+	// but the batch views are laid out as viewports
+	if (!(GLEW_VERSION_4_1 || GLEW_ARB_viewport_array))
+	{
+		std::cout << "INFO: Viewport arrays are not supported, views are rendered one pass each" << std::endl;
+		return(false);
+	}
+
+	m_bVertexShaderLayer = GLEW_ARB_shader_viewport_layer_array ? true : false;
+	std::string vertexDefines = m_bVertexShaderLayer ? "#define LAYER_FROM_VERTEX_SHADER\n" : "";
+
+	GLuint vertexShader = ShaderCompiler::CompileShader(GL_VERTEX_SHADER, vertexShaderFile, vertexDefines);
+	GLuint geometryShader = 0;
+	if (!m_bVertexShaderLayer)
+	{
+		geometryShader = ShaderCompiler::CompileShader(GL_GEOMETRY_SHADER, geometryShaderFile, "");
+	}
+	GLuint fragmentShader = ShaderCompiler::CompileShader(GL_FRAGMENT_SHADER, fragmentShaderFile, "#define LAYERED_VIEWS\n");
+
+	bool bCompiled = (vertexShader != 0) && (fragmentShader != 0) &&
+		(m_bVertexShaderLayer || (geometryShader != 0));
+
+	if (bCompiled)
+	{
+		GLuint shaders[3] = { vertexShader, fragmentShader, geometryShader };
+		m_program = ShaderCompiler::LinkProgram(shaders, (geometryShader != 0) ? 3 : 2, "layered");
+	}
+
+	if (vertexShader != 0)
+	{
+		glDeleteShader(vertexShader);
+	}
+	if (geometryShader != 0)
+	{
+		glDeleteShader(geometryShader);
+	}
+	if (fragmentShader != 0)
+	{
+		glDeleteShader(fragmentShader);
+	}
+
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	GLuint blockIndex = glGetUniformBlockIndex(m_program, g_ViewBlockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		std::cout << "The layered shader program has no " << g_ViewBlockName << " block" << std::endl;
+		glDeleteProgram(m_program);
+		m_program = 0;
+		return(false);
+	}
+	glUniformBlockBinding(m_program, blockIndex, VIEW_BLOCK_BINDING);
+
+	glGenBuffers(1, &m_viewBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_viewBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(VIEW_BLOCK), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_shaderManager.m_programID = m_program;
+	m_bAvailable = true;
+
+	std::cout << "INFO: Layered rendering of up to " << MAX_VIEWS << " views per pass, views routed by the "
+		<< (m_bVertexShaderLayer ? "vertex" : "geometry") << " shader" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method uploads the matrices and eye positions of
+ *  the views and sets one viewport per view.  The caller
+ *  sets the remaining uniforms through GetShaderManager().
+ ***********************************************************/
+bool LayeredRenderer::Begin(const std::vector<LAYERED_VIEW>& views)
+{
+	if (!m_bAvailable || views.empty() || ((int)views.size() > MAX_VIEWS))
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &m_previousProgram);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+	VIEW_BLOCK block;
+	for (size_t i = 0; i < views.size(); i++)
+	{
+		block.viewProjection[i] = views[i].projection * views[i].view;
+		block.viewPositions[i] = glm::vec4(views[i].position, 1.0f);
+	}
+	m_viewCount = (int)views.size();
+
+	// only the views in use are uploaded; the instances never index
+	// past them
+	glBindBuffer(GL_UNIFORM_BUFFER, m_viewBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4) * m_viewCount, block.viewProjection);
+	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(block.viewProjection), sizeof(glm::vec4) * m_viewCount, block.viewPositions);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, VIEW_BLOCK_BINDING, m_viewBuffer);
+
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		glViewportIndexedf(i,
+			(float)views[i].x, (float)views[i].y,
+			(float)views[i].width, (float)views[i].height);
+	}
+
+	glUseProgram(m_program);
+	return(true);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method restores the program and viewport that were
+ *  current before Begin().
+ ***********************************************************/
+void LayeredRenderer::End()
+{
+	if (m_viewCount == 0)
+	{
+		return;
+	}
+
+	// glViewport resets every viewport of the array
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+	glUseProgram((GLuint)m_previousProgram);
+	m_viewCount = 0;
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// layeredrenderer.h
+// ============
+// draw one stream of draw calls into several views in a single pass
+//
+// Every draw is instanced once per view.  The instance index selects the
+// view's matrices from a uniform block and is written to gl_ViewportIndex
+// and gl_Layer, so each copy lands in its own viewport of a viewport array
+// or its own layer of a layered framebuffer.  The vertex shader writes the
+// indices itself where ARB_shader_viewport_layer_array is supported;
+// otherwise a pass-through geometry shader does it.
+//
+// The program uses the scene's fragment shader compiled with LAYERED_VIEWS
+// defined, which takes the eye position of each view from the same block.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class LayeredRenderer
+{
+public:
+	// matches MAX_LAYERED_VIEWS in the shaders and the minimum
+	// GL_MAX_VIEWPORTS every implementation supports
+	static const int MAX_VIEWS = 16;
+
+	struct LAYERED_VIEW
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 position;
+		// viewport, in pixels of the bound framebuffer or of each layer
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	// constructor
+	LayeredRenderer();
+	// destructor
+	~LayeredRenderer();
+
+	// build the program; fails when the context has no
+	// viewport arrays, in which case callers draw one view at a time
+	bool Initialize(const char* vertexShaderFile, const char* geometryShaderFile, const char* fragmentShaderFile);
+	bool IsAvailable() const { return m_bAvailable; }
+
+	// the program wrapped for the uniform setters of the scene code
+	ShaderManager* GetShaderManager() { return &m_shaderManager; }
+
+	// make the program current, upload the views and set their
+	// viewports; draws with GetViewCount() instances until End()
+	bool Begin(const std::vector<LAYERED_VIEW>& views);
+	// restore the previous program and viewport
+	void End();
+	int GetViewCount() const { return m_viewCount; }
+
+private:
+	bool m_bAvailable;
+	bool m_bVertexShaderLayer;
+	GLuint m_program;
+	ShaderManager m_shaderManager;
+	GLuint m_viewBuffer;
+	int m_viewCount;
+	// state restored by End()
+	GLint m_previousProgram;
+	GLint m_previousViewport[4];
+};
@@ -0,0 +1,436 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightcostview.cpp
+// ============
+// show how many lights and texture fetches every pixel costs as a heatmap
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightCostView.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the characters of the glyphs of the resolve shader, in its order
+	const char* GLYPH_CHARACTERS = "0123456789.ACEFGHILMSTVX";
+	// readbacks in flight, and how often the counts are read
+	const int COST_READBACK_DEPTH = 3;
+	const double READBACK_INTERVAL = 0.25;
+	// how often the counts are written to the console
+	const double REPORT_INTERVAL = 5.0;
+	// the ramp reaches at least this cost, and grows in steps of
+	// COST_SCALE_STEP to fit the maximum
+	const float MIN_COST_SCALE = 8.0f;
+	const float COST_SCALE_STEP = 4.0f;
+
+	const char* const MODE_NAMES[LightCostView::COST_MODE_COUNT] = { "off", "light evaluations", "texture fetches" };
+	const char* const MODE_LABELS[LightCostView::COST_MODE_COUNT] = { "", "LIGHTS", "FETCHES" };
+
+	double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+}
+
+/***********************************************************
+ *  LightCostView()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightCostView::LightCostView(const char* vertexShaderFile, const char* fragmentShaderFile)
+	: m_readback(COST_READBACK_DEPTH)
+{
+	m_vertexShaderFile = vertexShaderFile;
+	m_fragmentShaderFile = fragmentShaderFile;
+	m_mode = COST_OFF;
+	m_bInitialized = false;
+	m_bFailed = false;
+	m_framebuffer = 0;
+	m_costTexture = 0;
+	m_depthBuffer = 0;
+	m_emptyArray = 0;
+	m_width = 0;
+	m_height = 0;
+	m_readbackTime = std::chrono::steady_clock::now();
+	m_reportTime = m_readbackTime;
+	m_bHaveStats = false;
+	m_previousFramebuffer = 0;
+	m_bPreviousBlend = GL_FALSE;
+	m_previousBlendSource = GL_ONE;
+	m_previousBlendDestination = GL_ZERO;
+	for (int i = 0; i < 4; i++)
+	{
+		m_previousClearColor[i] = 0.0f;
+	}
+}
+
+/***********************************************************
+ *  ~LightCostView()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightCostView::~LightCostView()
+{
+	m_readback.Destroy();
+	DestroyTarget();
+	if (m_emptyArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyArray);
+		m_emptyArray = 0;
+	}
+	if (m_shader.m_programID != 0)
+	{
+		glDeleteProgram(m_shader.m_programID);
+		m_shader.m_programID = 0;
+	}
+}
+
+/***********************************************************
+ *  CycleMode()
+ *
+ *  This method switches to the next mode of the view.
+ ***********************************************************/
+void LightCostView::CycleMode()
+{
+	m_mode = (COST_MODE)((m_mode + 1) % COST_MODE_COUNT);
+	std::cout << "INFO: Light cost view " << MODE_NAMES[m_mode] << std::endl;
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method binds the cost target and clears it, and
+ *  makes every fragment add its counts to its pixel.  The
+ *  depth test stays as it is, so hidden fragments that are
+ *  drawn before what hides them are counted, as they cost.
+ ***********************************************************/
+bool LightCostView::Begin(int width, int height)
+{
+	if ((m_mode == COST_OFF) || m_bFailed)
+	{
+		return(false);
+	}
+	if ((m_bInitialized == false) && (Initialize() == false))
+	{
+		std::cout << "WARNING: the light cost view is not available" << std::endl;
+		m_bFailed = true;
+		m_mode = COST_OFF;
+		return(false);
+	}
+	if (((width != m_width) || (height != m_height)) && (CreateTarget(width, height) == false))
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	m_bPreviousBlend = glIsEnabled(GL_BLEND);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &m_previousBlendSource);
+	glGetIntegerv(GL_BLEND_DST_RGB, &m_previousBlendDestination);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, m_previousClearColor);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	return(true);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method reads the counts back now and then, restores
+ *  the previous framebuffer and draws the heatmap of the
+ *  counts over the whole of it, with the legend.
+ ***********************************************************/
+void LightCostView::End()
+{
+	FrameReadback::ReadbackHandler handler = [this](const FrameReadback::READBACK_FRAME& frame) { HandleReadback(frame); };
+	if (SecondsSince(m_readbackTime) >= READBACK_INTERVAL)
+	{
+		// the cost target is still bound for reading
+		m_readback.QueueReadback(0, 0, m_width, m_height, GL_RGB, GL_FLOAT, 0, 0, false, handler);
+		m_readbackTime = std::chrono::steady_clock::now();
+	}
+	m_readback.ProcessCompleted(handler);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_previousFramebuffer);
+	glClearColor(m_previousClearColor[0], m_previousClearColor[1], m_previousClearColor[2], m_previousClearColor[3]);
+
+	GLint previousProgram = 0;
+	GLint previousArray = 0;
+	GLint previousActiveTexture = 0;
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousArray);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &previousActiveTexture);
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+
+	int glyphs[2 * MAX_LEGEND_GLYPHS];
+	BuildLegend(glyphs);
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glViewport(0, 0, m_width, m_height);
+	m_shader.use();
+	m_uniforms.costTexture.Set(SAMPLER_UNIT{ 0 });
+	m_uniforms.costChannel.Set((m_mode == COST_FETCHES) ? 1 : 0);
+	m_uniforms.costScale.Set(GetCostScale());
+	if (m_uniforms.legendGlyphs >= 0)
+	{
+		glUniform1iv(m_uniforms.legendGlyphs, 2 * MAX_LEGEND_GLYPHS, glyphs);
+	}
+	glBindTexture(GL_TEXTURE_2D, m_costTexture);
+	glBindVertexArray(m_emptyArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray((GLuint)previousArray);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+	glActiveTexture((GLenum)previousActiveTexture);
+	glUseProgram((GLuint)previousProgram);
+	if (bDepthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	glBlendFunc((GLenum)m_previousBlendSource, (GLenum)m_previousBlendDestination);
+	if (m_bPreviousBlend)
+	{
+		glEnable(GL_BLEND);
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method loads the resolve program and looks up its
+ *  uniforms, and creates the empty vertex array.
+ ***********************************************************/
+bool LightCostView::Initialize()
+{
+	if (m_shader.LoadShaders(m_vertexShaderFile.c_str(), m_fragmentShaderFile.c_str()) == 0)
+	{
+		std::cout << "Could not load the light cost shaders" << std::endl;
+		return(false);
+	}
+
+	GLuint program = m_shader.m_programID;
+	m_uniforms.costTexture.Resolve(program, "costTexture");
+	m_uniforms.costChannel.Resolve(program, "costChannel");
+	m_uniforms.costScale.Resolve(program, "costScale");
+	m_uniforms.legendGlyphs = ShaderUniforms::FindUniform(program, "legendGlyphs[0]", GL_INT);
+
+	glGenVertexArrays(1, &m_emptyArray);
+	if (m_emptyArray == 0)
+	{
+		return(false);
+	}
+
+	m_bInitialized = true;
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method creates the floating point target the counts
+ *  are added up in, with its own depth buffer, replacing the
+ *  previous one.
+ ***********************************************************/
+bool LightCostView::CreateTarget(int width, int height)
+{
+	DestroyTarget();
+
+	GLint previousTexture = 0;
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	// half floats count exactly up to 2048 per pixel, and blend on
+	// every desktop implementation
+	glGenTextures(1, &m_costTexture);
+	glBindTexture(GL_TEXTURE_2D, m_costTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_costTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	if (bComplete == false)
+	{
+		std::cout << "Could not create the light cost target" << std::endl;
+		DestroyTarget();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method frees the cost target.
+ ***********************************************************/
+void LightCostView::DestroyTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_costTexture != 0)
+	{
+		glDeleteTextures(1, &m_costTexture);
+		m_costTexture = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  HandleReadback()
+ *
+ *  This method sums the counts of the pixels that at least
+ *  one fragment reached, and writes them to the console
+ *  every few seconds.
+ ***********************************************************/
+void LightCostView::HandleReadback(const FrameReadback::READBACK_FRAME& frame)
+{
+	COST_STATS stats;
+	double lights = 0.0;
+	double fetches = 0.0;
+	double fragments = 0.0;
+	for (int y = 0; y < frame.height; y++)
+	{
+		const float* pixel = reinterpret_cast<const float*>(frame.pixels + (size_t)y * frame.stride);
+		for (int x = 0; x < frame.width; x++, pixel += 3)
+		{
+			if (pixel[2] <= 0.0f)
+			{
+				continue;
+			}
+			stats.coveredPixels++;
+			lights += pixel[0];
+			fetches += pixel[1];
+			fragments += pixel[2];
+			stats.maximumLights = std::max(stats.maximumLights, pixel[0]);
+			stats.maximumFetches = std::max(stats.maximumFetches, pixel[1]);
+		}
+	}
+	if (stats.coveredPixels > 0)
+	{
+		stats.averageLights = (float)(lights / stats.coveredPixels);
+		stats.averageFetches = (float)(fetches / stats.coveredPixels);
+		stats.averageFragments = (float)(fragments / stats.coveredPixels);
+	}
+	m_stats = stats;
+	m_bHaveStats = true;
+
+	if (SecondsSince(m_reportTime) >= REPORT_INTERVAL)
+	{
+		std::cout << "INFO: Light cost over " << stats.coveredPixels << " covered pixels: "
+			<< stats.averageLights << " light evaluations per pixel (max " << stats.maximumLights << "), "
+			<< stats.averageFetches << " texture fetches (max " << stats.maximumFetches << "), "
+			<< stats.averageFragments << " fragments shaded" << std::endl;
+		m_reportTime = std::chrono::steady_clock::now();
+	}
+}
+
+/***********************************************************
+ *  GetCostScale()
+ *
+ *  This method returns the cost at the hot end of the ramp:
+ *  the maximum of the shown counts rounded up to a step,
+ *  and never below MIN_COST_SCALE.
+ ***********************************************************/
+float LightCostView::GetCostScale() const
+{
+	float maximum = (m_mode == COST_FETCHES) ? m_stats.maximumFetches : m_stats.maximumLights;
+	return(std::max(MIN_COST_SCALE, std::ceil(maximum / COST_SCALE_STEP) * COST_SCALE_STEP));
+}
+
+/***********************************************************
+ *  BuildLegend()
+ *
+ *  This method writes the glyphs of the legend: the shown
+ *  counts with their average and maximum above the ramp,
+ *  and the costs at its start, middle and end below it.
+ *  Both rows are written in place, with no allocation.
+ ***********************************************************/
+void LightCostView::BuildLegend(int* glyphs) const
+{
+	char text[MAX_LEGEND_GLYPHS + 1] = {};
+	float average = (m_mode == COST_FETCHES) ? m_stats.averageFetches : m_stats.averageLights;
+	float maximum = (m_mode == COST_FETCHES) ? m_stats.maximumFetches : m_stats.maximumLights;
+	if (m_bHaveStats)
+	{
+		snprintf(text, sizeof(text), "%s AVG %.1f MAX %.0f", MODE_LABELS[m_mode], average, maximum);
+	}
+	else
+	{
+		snprintf(text, sizeof(text), "%s", MODE_LABELS[m_mode]);
+	}
+	EncodeText(text, glyphs);
+
+	float scale = GetCostScale();
+	char ticks[MAX_LEGEND_GLYPHS + 1];
+	char middle[16] = {};
+	char end[16] = {};
+	snprintf(middle, sizeof(middle), "%g", scale * 0.5f);
+	snprintf(end, sizeof(end), "%g", scale);
+	memset(ticks, ' ', MAX_LEGEND_GLYPHS);
+	ticks[MAX_LEGEND_GLYPHS] = '\0';
+	ticks[0] = '0';
+	memcpy(ticks + (MAX_LEGEND_GLYPHS - strlen(middle)) / 2, middle, strlen(middle));
+	memcpy(ticks + MAX_LEGEND_GLYPHS - strlen(end), end, strlen(end));
+	EncodeText(ticks, glyphs + MAX_LEGEND_GLYPHS);
+}
+
+/***********************************************************
+ *  EncodeText()
+ *
+ *  This method turns a row of text into the glyph indices
+ *  of the resolve shader; characters it has no glyph for,
+ *  and the rest of the row after the end of the text, are
+ *  left empty.
+ ***********************************************************/
+void LightCostView::EncodeText(const char* text, int* glyphs)
+{
+	bool bEnded = false;
+	for (int i = 0; i < MAX_LEGEND_GLYPHS; i++)
+	{
+		glyphs[i] = -1;
+		bEnded = bEnded || (text[i] == '\0');
+		if (!bEnded)
+		{
+			const char* found = strchr(GLYPH_CHARACTERS, text[i]);
+			if (NULL != found)
+			{
+				glyphs[i] = (int)(found - GLYPH_CHARACTERS);
+			}
+		}
+	}
+}
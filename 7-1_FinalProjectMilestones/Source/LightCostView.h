@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightcostview.h
+// ============
+// show how many lights and texture fetches every pixel costs as a heatmap
+//
+// While the view is on, the scene is drawn with the scene's fragment shader
+// compiled with LIGHT_COST defined.  Every light function and texture
+// sample of that shader counts itself, so the count follows the lighting
+// wherever it is evaluated, and each fragment outputs its counts instead of
+// its color.  They are added up per pixel with additive blending into a
+// floating point target, so overdraw costs what it really costs.  A full
+// screen pass then colors each pixel by its light evaluations or its
+// texture fetches, and draws a legend with the color ramp and the average
+// and maximum over the covered pixels, which are read back a few times a
+// second without waiting for the GPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameReadback.h"
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+
+#include <chrono>
+#include <string>
+
+class LightCostView
+{
+public:
+	enum COST_MODE
+	{
+		COST_OFF,
+		COST_LIGHTS,       // light evaluations per pixel
+		COST_FETCHES,      // texture fetches per pixel
+		COST_MODE_COUNT
+	};
+
+	// glyphs in one row of the legend; MAX_LEGEND_GLYPHS in the shader
+	static const int MAX_LEGEND_GLYPHS = 24;
+
+	// constructor - the programs are only loaded on first use
+	LightCostView(const char* vertexShaderFile, const char* fragmentShaderFile);
+	// destructor
+	~LightCostView();
+
+	// switch from off to the light evaluations to the texture fetches
+	// and back to off
+	void CycleMode();
+	COST_MODE GetMode() const { return m_mode; }
+
+	// bind the cost target, sized to the framebuffer the views are drawn
+	// into, and set up the blending that adds the counts up; returns
+	// false when the view is off or not available, and the scene is then
+	// drawn normally
+	bool Begin(int width, int height);
+	// restore the framebuffer bound before Begin() and draw the heatmap
+	// and the legend over it
+	void End();
+
+private:
+	// the counts of the covered pixels of the last readback
+	struct COST_STATS
+	{
+		int coveredPixels = 0;
+		float averageLights = 0.0f;
+		float maximumLights = 0.0f;
+		float averageFetches = 0.0f;
+		float maximumFetches = 0.0f;
+		float averageFragments = 0.0f;
+	};
+
+	struct RESOLVE_UNIFORMS
+	{
+		Uniform<SAMPLER_UNIT> costTexture;
+		Uniform<int> costChannel;
+		Uniform<float> costScale;
+		GLint legendGlyphs = -1;
+	};
+
+	std::string m_vertexShaderFile;
+	std::string m_fragmentShaderFile;
+	COST_MODE m_mode;
+	bool m_bInitialized;
+	bool m_bFailed;
+	ShaderManager m_shader;
+	RESOLVE_UNIFORMS m_uniforms;
+	// the summed counts, their depth buffer, and the vertex array of the
+	// full screen triangle, which has no attributes
+	GLuint m_framebuffer;
+	GLuint m_costTexture;
+	GLuint m_depthBuffer;
+	GLuint m_emptyArray;
+	int m_width;
+	int m_height;
+
+	FrameReadback m_readback;
+	std::chrono::steady_clock::time_point m_readbackTime;
+	std::chrono::steady_clock::time_point m_reportTime;
+	COST_STATS m_stats;
+	bool m_bHaveStats;
+
+	// state replaced between Begin() and End()
+	GLint m_previousFramebuffer;
+	GLboolean m_bPreviousBlend;
+	GLint m_previousBlendSource;
+	GLint m_previousBlendDestination;
+	GLfloat m_previousClearColor[4];
+
+	bool Initialize();
+	bool CreateTarget(int width, int height);
+	void DestroyTarget();
+	void HandleReadback(const FrameReadback::READBACK_FRAME& frame);
+	// the hot end of the ramp for the shown counts
+	float GetCostScale() const;
+	// the glyphs of the two legend rows
+	void BuildLegend(int* glyphs) const;
+	static void EncodeText(const char* text, int* glyphs);
+};
@@ -9,6 +9,8 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <cstdint>          // uint64_t
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -22,6 +24,19 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "SharedFrameRing.h"
+#include "BatchRenderer.h"
+#include "ObjectPicker.h"
+#include "QualityTuner.h"
+#include "TelemetryPublisher.h"
+#include "SceneSystems.h"
+#include "AllocationTracker.h"
+#include "PerfCounters.h"
+#include "StartupTimeline.h"
+#include "FrameArena.h"
+#include "GeometryArena.h"
+
+#include <chrono>
 
 // Namespace for declaring global variables
 namespace
@@ -38,12 +53,67 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// optional shared memory output of every rendered frame
+	SharedFrameRing* g_FrameOutput = nullptr;
+
+	// command line settings for the shared memory frame output
+	const char* g_SharedOutputName = nullptr;
+	int g_SharedOutputSlots = 4;
+
+	// command line settings for the offline batch renderer
+	const char* g_BatchJobFile = nullptr;
+	int g_BatchThreads = 0;
+
+	// optional Y4M video played on the monitor screen
+	const char* g_MonitorVideoFile = nullptr;
+	// finds the object under a click a frame or two later
+	ObjectPicker* g_ObjectPicker = nullptr;
+	// the scene geometry the camera collides with
+	CollisionWorld* g_CollisionWorld = nullptr;
+	// entities updated by --ecs-benchmark instead of opening the window
+	int g_EcsBenchmarkCount = 0;
+	// --arena-self-check exercises the geometry arena in a hidden window
+	bool g_bArenaSelfCheck = false;
+
+	// a world streamed around the camera, and the world written by
+	// --write-office-floor instead of opening the window
+	const char* g_StreamWorldFile = nullptr;
+	size_t g_StreamBudgetKB = 2048;
+	const char* g_OfficeFloorFile = nullptr;
+	const int OFFICE_FLOOR_COLUMNS = 10;
+	const int OFFICE_FLOOR_ROWS = 10;
+
+	// --cpu-culling keeps the culling of the main views on the CPU
+	bool g_bGpuCulling = true;
+
+	// the quality tier follows the frame time unless --quality fixes it
+	QualityTuner* g_QualityTuner = nullptr;
+	QualityTuner::QUALITY_TIER g_QualityTier = QualityTuner::TIER_HIGH;
+	bool g_bAutoQuality = true;
+	float g_TargetFrameMs = 16.7f;
+
+	// optional stream of the statistics of every frame to monitoring
+	TelemetryPublisher* g_Telemetry = nullptr;
+	const char* g_TelemetrySocket = nullptr;
+
+	// --perf-counters samples the hardware counters around the phases
+	// of the frame
+	bool g_bPerfCounters = false;
+
+	// the scene's loads start on the loading threads before the window
+	// unless --serial-startup makes them all on the main thread once the
+	// context exists, to compare the time to the first frame
+	bool g_bSerialStartup = false;
+	const char* g_StartupTraceFile = nullptr;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void ParseCommandLine(int argc, char* argv[]);
+void RunEcsBenchmark(int entityCount);
+bool RunArenaSelfCheck();
 
 
 /***********************************************************
@@ -54,41 +124,192 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the main thread adds the first span of the startup timeline
+	double start = StartupTimeline::Now();
+	ParseCommandLine(argc, argv);
+	StartupTimeline::AddSpan("parse command line", start);
+
+	// the benchmark needs no window or OpenGL context
+	if (g_EcsBenchmarkCount > 0)
+	{
+		RunEcsBenchmark(g_EcsBenchmarkCount);
+		return(EXIT_SUCCESS);
+	}
+	if (g_bArenaSelfCheck)
+	{
+		return(RunArenaSelfCheck() ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	if (NULL != g_OfficeFloorFile)
+	{
+		bool bWritten = SceneManager::WriteOfficeFloor(g_OfficeFloorFile, OFFICE_FLOOR_COLUMNS, OFFICE_FLOOR_ROWS);
+		return(bWritten ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// try to create a new shader manager object
+	g_ShaderManager = new ShaderManager();
+
+	// try to create a new scene manager object; its textures are read
+	// and decoded and its meshes built on the loading threads while
+	// the window and the context are created below, unless the whole
+	// scene is loaded serially by PrepareScene()
+	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetMonitorVideo(g_MonitorVideoFile);
+	g_SceneManager->SetGpuCulling(g_bGpuCulling);
+	g_SceneManager->SetSerialLoading(g_bSerialStartup);
+	g_SceneManager->StartLoading();
+
 	// if GLFW fails initialization, then terminate the application
+	start = StartupTimeline::Now();
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
+	StartupTimeline::AddSpan("initialize GLFW", start);
 
-	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
+	// batch rendering draws offscreen, so the window stays hidden
+	if (NULL != g_BatchJobFile)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create the main display window
+	start = StartupTimeline::Now();
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	StartupTimeline::AddSpan("create window", start);
 
 	// if GLEW fails initialization, then terminate the application
+	start = StartupTimeline::Now();
 	if (InitializeGLEW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
+	StartupTimeline::AddSpan("initialize GLEW", start);
 
 	// load the shader code from the external GLSL files
+	start = StartupTimeline::Now();
 	g_ShaderManager->LoadShaders(
 		"shaders/vertexShader.glsl",
 		"shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
+	StartupTimeline::AddSpan("load shaders", start);
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	// prepare the 3D scene, uploading what the loading threads have
+	// decoded and built as it becomes ready
+	start = StartupTimeline::Now();
 	g_SceneManager->PrepareScene();
+	StartupTimeline::AddSpan("prepare scene", start);
+
+	// in batch mode render the job list instead of the interactive loop
+	if (NULL != g_BatchJobFile)
+	{
+		bool bBatchSucceeded = false;
+		{
+			BatchRenderer batchRenderer(g_SceneManager, g_ShaderManager, g_BatchThreads);
+			if (batchRenderer.LoadJobFile(g_BatchJobFile))
+			{
+				bBatchSucceeded = batchRenderer.Run();
+			}
+		}
+
+		delete g_SceneManager;
+		g_SceneManager = NULL;
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+
+		exit(bBatchSucceeded ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// when requested, publish every rendered frame to shared memory
+	if (NULL != g_SharedOutputName)
+	{
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+
+		g_FrameOutput = new SharedFrameRing();
+		if (g_FrameOutput->CreateProducer(g_SharedOutputName, g_SharedOutputSlots, framebufferWidth, framebufferHeight) == false)
+		{
+			delete g_FrameOutput;
+			g_FrameOutput = NULL;
+		}
+	}
+
+	// the camera stops at the scene geometry instead of flying through
+	start = StartupTimeline::Now();
+	g_CollisionWorld = new CollisionWorld();
+	g_SceneManager->BuildCollisionWorld(*g_CollisionWorld);
+	StartupTimeline::AddSpan("build collision world", start);
+	g_ViewManager->SetCollisionWorld(g_CollisionWorld);
+
+	// the chunks of a large world load and unload as the camera moves
+	if (NULL != g_StreamWorldFile)
+	{
+		g_SceneManager->StartWorldStreaming(g_StreamWorldFile, g_StreamBudgetKB * 1024);
+	}
+
+	// clicking selects objects through a small ID render pass
+	g_ObjectPicker = new ObjectPicker();
+	if (g_ObjectPicker->Initialize("shaders/pickVertexShader.glsl", "shaders/pickFragmentShader.glsl") == false)
+	{
+		delete g_ObjectPicker;
+		g_ObjectPicker = NULL;
+	}
+
+	// when requested, stream the statistics of every frame over a
+	// local socket; a background thread formats and sends them
+	if (NULL != g_TelemetrySocket)
+	{
+		g_Telemetry = new TelemetryPublisher();
+		if (g_Telemetry->Start(g_TelemetrySocket) == false)
+		{
+			delete g_Telemetry;
+			g_Telemetry = NULL;
+		}
+	}
+
+	// the tuner starts at the best tier and steps down while the frames
+	// take longer than the target; it also times the frames for the
+	// telemetry
+	g_QualityTuner = new QualityTuner();
+	g_QualityTuner->Initialize(g_QualityTier, g_TargetFrameMs, g_bAutoQuality, NULL != g_Telemetry);
+
+	// the counters are read on this thread, which renders every frame
+	if (g_bPerfCounters)
+	{
+		PerfCounters::Initialize();
+	}
+
+	// counter of rendered frames, used to tag captured frames
+	uint64_t frameNumber = 0;
+	start = StartupTimeline::Now();
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// the temporary memory of the previous frame is reused
+		FrameArena::BeginFrame();
+		PerfCounters::BeginScope("Frame");
+
+		// a new tier is applied before the frame is drawn
+		if (g_QualityTuner->ConsumeTierChange())
+		{
+			const QualityTuner::QUALITY_SETTINGS& settings = g_QualityTuner->GetSettings();
+			g_SceneManager->SetQualitySettings(settings);
+			g_ViewManager->SetRenderScale(settings.renderScale);
+		}
+		g_QualityTuner->BeginFrame();
+
+		// convert from 3D object space to 2D view; this also binds the
+		// framebuffer the views are rendered into
+		g_ViewManager->PrepareSceneView();
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -96,21 +317,176 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+
+		// refresh the live textures that are due before the scene uses them;
+		// this renders too, so it allocates nothing either
+		AllocationTracker::BeginScope("UpdateRenderTargets");
+		PerfCounters::BeginScope("UpdateRenderTargets");
+		g_SceneManager->UpdateRenderTargets(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(),
+			g_ViewManager->GetViewPosition(),
+			g_ViewManager->GetView(0).width,
+			g_ViewManager->GetView(0).height);
+		PerfCounters::EndScope();
+		AllocationTracker::EndScope();
+
+		// a few streamed entities are created or removed per frame
+		g_SceneManager->UpdateWorldStreaming(g_ViewManager->GetViewPosition(), g_ViewManager->GetCameraVelocity());
+		// and the camera collides with the chunks that are loaded
+		if (NULL != g_CollisionWorld)
+		{
+			g_SceneManager->UpdateCollisionWorld(*g_CollisionWorld);
+		}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// traverse the 3D scene once, then cull and draw it in every view;
+		// in the steady state this performs no heap allocations
+		AllocationTracker::BeginScope("RenderScene");
+		PerfCounters::BeginScope("BuildDrawList");
+		g_SceneManager->BuildDrawList();
+		PerfCounters::EndScope();
+		// the camera follows the input that arrived during the work above
+		g_ViewManager->LatchViews();
+		// while the light cost view is on, the views count the lighting
+		// work of every pixel instead, and are shown as its heatmap; the
+		// impostors are left out, their shader does not count
+		LightCostView* pLightCostView = g_ViewManager->GetLightCostView();
+		bool bLightCostView = (NULL != pLightCostView) &&
+			(pLightCostView->GetMode() != LightCostView::COST_OFF) &&
+			g_SceneManager->SetLightCostView(true) &&
+			pLightCostView->Begin(g_ViewManager->GetSceneWidth(), g_ViewManager->GetSceneHeight());
+		g_SceneManager->SetLightCostView(bLightCostView);
+		PerfCounters::BeginScope("SubmitDrawList");
+		for (int i = 0; i < g_ViewManager->GetViewCount(); i++)
+		{
+			const ViewManager::VIEW_INFO& view = g_ViewManager->GetView(i);
+			g_ViewManager->ApplyView(i);
+			g_SceneManager->SubmitDrawList(view.view, view.projection);
+			if (!bLightCostView)
+			{
+				g_SceneManager->SubmitImpostors(view.view, view.projection);
+			}
+		}
+		if (bLightCostView)
+		{
+			pLightCostView->End();
+		}
+		PerfCounters::EndScope();
+		AllocationTracker::EndScope();
 
+		// render the IDs under a new click, and report the picks whose
+		// readback has finished since the last frame
+		if (NULL != g_ObjectPicker)
+		{
+			int pickView = 0;
+			int pickX = 0;
+			int pickY = 0;
+			if (g_ViewManager->ConsumePickRequest(pickView, pickX, pickY))
+			{
+				const ViewManager::VIEW_INFO& view = g_ViewManager->GetView(pickView);
+				g_ObjectPicker->Pick(
+					pickX, pickY, view.view, view.projection,
+					view.x, view.y, view.width, view.height,
+					[](const glm::mat4& viewProjection, ShaderManager* pPickShader)
+					{
+						g_SceneManager->SubmitPickDrawList(viewProjection, pPickShader);
+					});
+			}
+			if (g_ObjectPicker->Update())
+			{
+				uint32_t pickID = g_ObjectPicker->GetLastPick();
+				SceneManager::SCENE_OBJECT object = SceneManager::GetPickObject(pickID);
+				std::cout << "INFO: Selected " << SceneManager::GetObjectName(object);
+				if (object != SceneManager::OBJECT_NONE)
+				{
+					std::cout << " part " << SceneManager::GetPickPart(pickID);
+				}
+				std::cout << std::endl;
+			}
+		}
+
+		// capture screenshots and video frames of the finished scene
+		g_ViewManager->FinishSceneView();
+
+		// queue the asynchronous readback of this frame for the
+		// shared memory output, it never waits for the GPU
+		if (NULL != g_FrameOutput)
+		{
+			g_FrameOutput->CaptureFrame(framebufferWidth, framebufferHeight, frameNumber);
+		}
+		frameNumber++;
+
+		// the wait for the display is not part of the frame's cost
+		g_QualityTuner->EndFrame();
+
+		// the work of the frame goes to the counters' report and to the
+		// telemetry thread
+		PerfCounters::EndScope();
+		SceneManager::FRAME_COUNTERS counters = g_SceneManager->TakeFrameCounters();
+		PerfCounters::EndFrame(counters.drawCalls);
+		if (NULL != g_Telemetry)
+		{
+			TelemetryPublisher::FRAME_STATS stats = {};
+			stats.frameNumber = frameNumber - 1;
+			stats.cpuMilliseconds = -1.0;
+			stats.gpuMilliseconds = -1.0;
+			g_QualityTuner->GetLastFrameTimes(stats.cpuMilliseconds, stats.gpuMilliseconds);
+			stats.drawCalls = counters.drawCalls;
+			stats.triangles = counters.triangles;
+			stats.drawItems = counters.drawItems;
+			stats.cpuVisibleItems = counters.cpuVisibleItems;
+			stats.cpuCulledItems = counters.cpuCulledItems;
+			stats.gpuCulledObjects = counters.gpuCulledObjects;
+			stats.frameArenaBytes = FrameArena::GetThreadArena().GetUsed();
+			stats.streamedBytes = g_SceneManager->GetStreamedMemory();
+			g_Telemetry->Publish(stats);
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
+		g_ViewManager->FramePresented();
+
+		// the startup ends with the first presented frame
+		if (frameNumber == 1)
+		{
+			StartupTimeline::AddSpan("first frame", start);
+			StartupTimeline::Finish(g_StartupTraceFile);
+		}
 
 		// query the latest GLFW events
 		glfwPollEvents();
 	}
 
+	PerfCounters::Shutdown();
+
 	// clear the allocated manager objects from memory
+	if (NULL != g_Telemetry)
+	{
+		g_Telemetry->Stop();
+		delete g_Telemetry;
+		g_Telemetry = NULL;
+	}
+	if (NULL != g_QualityTuner)
+	{
+		delete g_QualityTuner;
+		g_QualityTuner = NULL;
+	}
+	if (NULL != g_ObjectPicker)
+	{
+		delete g_ObjectPicker;
+		g_ObjectPicker = NULL;
+	}
+	if (NULL != g_FrameOutput)
+	{
+		g_FrameOutput->FlushPendingFrames();
+		std::cout << "INFO: Shared frame output published " << g_FrameOutput->GetPublishedCount()
+			<< " frames, dropped " << g_FrameOutput->GetReadback().GetDroppedCount() << std::endl;
+		delete g_FrameOutput;
+		g_FrameOutput = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -121,6 +497,11 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_CollisionWorld)
+	{
+		delete g_CollisionWorld;
+		g_CollisionWorld = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
@@ -183,4 +564,270 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function reads the optional command line switches:
+ *    --shm-output <name>   publish frames to shared memory
+ *    --shm-slots <count>   number of frames in the ring
+ *    --batch <job file>    render the job list offscreen
+ *    --threads <count>     image encoder threads for --batch
+ *    --monitor-video <file> loop a 4:2:0 Y4M video on the monitor
+ *    --ecs-benchmark <count> time the transform system and exit
+ *    --arena-self-check    check the geometry arena's allocation,
+ *                          freeing and defragmenting, and exit
+ *    --write-office-floor <index file> write a 100 workstation
+ *                          world as chunk files and exit
+ *    --stream-world <index file> stream a chunked world around
+ *                          the camera
+ *    --stream-budget <KB>  memory of the streamed chunks
+ *    --cpu-culling         cull the main views on the CPU
+ *    --quality <tier>      low, medium or high, kept fixed
+ *    --target-frame-ms <ms> frame time the quality tier is
+ *                          tuned to, 16.7 by default
+ *    --telemetry <socket path> stream the statistics of every
+ *                          frame over a Unix domain socket
+ *    --perf-counters       report the hardware counters of the
+ *                          frame phases (Linux)
+ *    --serial-startup      read, decode and upload the scene on
+ *                          the main thread once the context
+ *                          exists, with no loading threads
+ *    --startup-trace <file> write the startup timeline as a
+ *                          chrome://tracing trace
+ ***********************************************************/
+void ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--shm-output") == 0) && (i + 1 < argc))
+		{
+			g_SharedOutputName = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--shm-slots") == 0) && (i + 1 < argc))
+		{
+			g_SharedOutputSlots = atoi(argv[++i]);
+			if (g_SharedOutputSlots < 2)
+			{
+				g_SharedOutputSlots = 2;
+			}
+		}
+		else if ((strcmp(argv[i], "--batch") == 0) && (i + 1 < argc))
+		{
+			g_BatchJobFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc))
+		{
+			g_BatchThreads = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--monitor-video") == 0) && (i + 1 < argc))
+		{
+			g_MonitorVideoFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--ecs-benchmark") == 0) && (i + 1 < argc))
+		{
+			g_EcsBenchmarkCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--arena-self-check") == 0)
+		{
+			g_bArenaSelfCheck = true;
+		}
+		else if ((strcmp(argv[i], "--write-office-floor") == 0) && (i + 1 < argc))
+		{
+			g_OfficeFloorFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--stream-world") == 0) && (i + 1 < argc))
+		{
+			g_StreamWorldFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--stream-budget") == 0) && (i + 1 < argc))
+		{
+			int budget = atoi(argv[++i]);
+			g_StreamBudgetKB = (budget > 0) ? (size_t)budget : g_StreamBudgetKB;
+		}
+		else if (strcmp(argv[i], "--cpu-culling") == 0)
+		{
+			g_bGpuCulling = false;
+		}
+		else if ((strcmp(argv[i], "--quality") == 0) && (i + 1 < argc))
+		{
+			if (QualityTuner::FindTier(argv[++i], g_QualityTier))
+			{
+				g_bAutoQuality = false;
+			}
+			else
+			{
+				std::cout << "WARNING: unknown quality tier " << argv[i] << ", tuning it automatically" << std::endl;
+			}
+		}
+		else if ((strcmp(argv[i], "--target-frame-ms") == 0) && (i + 1 < argc))
+		{
+			float target = (float)atof(argv[++i]);
+			g_TargetFrameMs = (target > 0.0f) ? target : g_TargetFrameMs;
+		}
+		else if ((strcmp(argv[i], "--telemetry") == 0) && (i + 1 < argc))
+		{
+			g_TelemetrySocket = argv[++i];
+		}
+		else if (strcmp(argv[i], "--perf-counters") == 0)
+		{
+			g_bPerfCounters = true;
+		}
+		else if (strcmp(argv[i], "--serial-startup") == 0)
+		{
+			g_bSerialStartup = true;
+		}
+		else if ((strcmp(argv[i], "--startup-trace") == 0) && (i + 1 < argc))
+		{
+			g_StartupTraceFile = argv[++i];
+		}
+		else
+		{
+			std::cout << "WARNING: ignoring unknown argument " << argv[i] << std::endl;
+		}
+	}
+}
+
+/***********************************************************
+ *	RunEcsBenchmark()
+ *
+ *  This function times the transform system over the passed
+ *  in number of entities, on one thread and on the worker
+ *  threads.  Each entity reads and writes its whole transform,
+ *  so the rate is reported as bytes moved per second; the
+ *  parallel rate should approach the memory bandwidth.
+ ***********************************************************/
+void RunEcsBenchmark(int entityCount)
+{
+	const int PASSES = 10;
+
+	EntityWorld world;
+	EntityWorld::COMPONENT_MASK mask = EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM);
+	for (int i = 0; i < entityCount; i++)
+	{
+		EntityWorld::ENTITY entity = world.CreateEntity(mask);
+		EntityWorld::TRANSFORM_COMPONENT* pTransform = world.GetComponent<EntityWorld::TRANSFORM_COMPONENT>(entity);
+		pTransform->scale = glm::vec3(1.0f, 1.0f, 1.0f);
+		pTransform->rotationDegrees = glm::vec3((float)(i % 360), (float)(i % 180), 0.0f);
+		pTransform->position = glm::vec3((float)(i % 1000), 0.0f, (float)(i / 1000));
+	}
+
+	WorkerPool pool;
+	double bytesPerPass = (double)entityCount * sizeof(EntityWorld::TRANSFORM_COMPONENT) * 2.0;
+	for (int parallel = 0; parallel < 2; parallel++)
+	{
+		WorkerPool* pPool = (parallel != 0) ? &pool : NULL;
+		// the first pass warms the caches and page tables
+		SceneSystems::UpdateTransforms(world, pPool);
+
+		double bestSeconds = 0.0;
+		for (int pass = 0; pass < PASSES; pass++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			SceneSystems::UpdateTransforms(world, pPool);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if ((pass == 0) || (seconds < bestSeconds))
+			{
+				bestSeconds = seconds;
+			}
+		}
+
+		std::cout << "INFO: " << entityCount << " transforms on "
+			<< ((pPool != NULL) ? pool.GetThreadCount() : 1) << " thread(s): "
+			<< (bestSeconds * 1000.0) << " ms, "
+			<< (bestSeconds * 1.0e9 / entityCount) << " ns per entity, "
+			<< (bytesPerPass / bestSeconds / 1.0e9) << " GB/s" << std::endl;
+	}
+}
+
+/***********************************************************
+ *	RunArenaSelfCheck()
+ *
+ *  This function allocates, frees, allocates again and
+ *  defragments meshes in a small geometry arena, checking
+ *  their offsets and the arena generation at every step.
+ *  The arena needs a context, so a hidden window is made.
+ ***********************************************************/
+bool RunArenaSelfCheck()
+{
+	if (InitializeGLFW() == false)
+	{
+		return(false);
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* pWindow = glfwCreateWindow(64, 64, WINDOW_TITLE, NULL, NULL);
+	if (NULL == pWindow)
+	{
+		std::cout << "Could not create the window of the arena self-check" << std::endl;
+		glfwTerminate();
+		return(false);
+	}
+	glfwMakeContextCurrent(pWindow);
+	if (InitializeGLEW() == false)
+	{
+		glfwTerminate();
+		return(false);
+	}
+
+	int failures = 0;
+	auto check = [&failures](bool bPassed, const char* what)
+		{
+			if (!bPassed)
+			{
+				std::cout << "WARNING: geometry arena self-check failed: " << what << std::endl;
+				failures++;
+			}
+		};
+
+	{
+		// three meshes of four vertices and six indices fill the arena
+		// but for one mesh's room
+		const int attributeSizes[3] = { 3, 3, 2 };
+		const float vertices[4 * 8] = {};
+		const GLuint indices[6] = { 0, 1, 2, 0, 2, 3 };
+		GeometryArena arena;
+		check(arena.Create(attributeSizes, 3, 16, 24), "create");
+
+		GeometryArena::ALLOCATION a = arena.Allocate(vertices, 4, indices, 6);
+		GeometryArena::ALLOCATION b = arena.Allocate(vertices, 4, indices, 6);
+		GeometryArena::ALLOCATION c = arena.Allocate(vertices, 4, indices, 6);
+		check(arena.IsLive(a) && arena.IsLive(b) && arena.IsLive(c), "allocate");
+		check((arena.GetRange(b).baseVertex == 4) && (arena.GetRange(b).firstIndex == 6), "offsets of the second mesh");
+		check((arena.GetRange(c).baseVertex == 8) && (arena.GetRange(c).firstIndex == 12), "offsets of the third mesh");
+
+		// freeing the middle mesh leaves a hole before the free end
+		uint32_t generation = arena.GetGeneration();
+		arena.Free(b);
+		check(!arena.IsLive(b), "the freed mesh is not live");
+		check(arena.GetGeneration() != generation, "freeing changes the generation");
+		check(arena.GetFreeBlockCount() == 4, "a hole and the end of each buffer are free");
+
+		// a smaller mesh takes the hole and the freed handle
+		GeometryArena::ALLOCATION d = arena.Allocate(vertices, 3, indices, 6);
+		check(d == b, "the freed handle is reused");
+		check((arena.GetRange(d).baseVertex == 4) && (arena.GetRange(d).firstIndex == 6), "the hole is filled first");
+
+		// packing moves the meshes after the first one down
+		arena.Free(a);
+		generation = arena.GetGeneration();
+		arena.Defragment();
+		check(arena.GetGeneration() != generation, "defragmenting changes the generation");
+		check((arena.GetRange(d).baseVertex == 0) && (arena.GetRange(d).firstIndex == 0), "offsets of the first mesh after packing");
+		check((arena.GetRange(c).baseVertex == 3) && (arena.GetRange(c).firstIndex == 6), "offsets of the second mesh after packing");
+		check(arena.GetFreeBlockCount() == 2, "the free space is one block at the end of each buffer");
+
+		// packed buffers are left alone
+		generation = arena.GetGeneration();
+		arena.Defragment();
+		check(arena.GetGeneration() == generation, "packed buffers do not move");
+		check(glGetError() == GL_NO_ERROR, "no OpenGL errors");
+	}
+
+	glfwTerminate();
+	if (failures == 0)
+	{
+		std::cout << "INFO: geometry arena self-check passed" << std::endl;
+	}
+	return(failures == 0);
+}
@@ -0,0 +1,396 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.cpp
+// ============
+// indexed versions of the basic scene meshes that can be drawn instanced
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const int VERTEX_FLOATS = MeshLibrary::VERTEX_FLOATS;
+	// sides around the cylinder at each level of detail
+	const int CYLINDER_LOD_SLICES[MeshLibrary::MAX_LODS] = { 36, 12, 6 };
+	// the fraction of the viewport height from which each level of
+	// detail is drawn; the coarsest level is drawn at any size
+	const float LOD_MINIMUM_SIZES[MeshLibrary::MAX_LODS] = { 0.05f, 0.015f, 0.0f };
+	const float PI = 3.14159265f;
+
+	void AddVertex(std::vector<float>& vertices, float x, float y, float z, float nx, float ny, float nz, float u, float v)
+	{
+		float vertex[VERTEX_FLOATS] = { x, y, z, nx, ny, nz, u, v };
+		vertices.insert(vertices.end(), vertex, vertex + VERTEX_FLOATS);
+	}
+
+	// two triangles of the quad whose four vertices start at first
+	void AddQuad(std::vector<GLuint>& indices, GLuint first)
+	{
+		GLuint quad[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+		indices.insert(indices.end(), quad, quad + 6);
+	}
+}
+
+/***********************************************************
+ *  MeshLibrary()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshLibrary::MeshLibrary()
+{
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < MAX_LODS; lod++)
+		{
+			m_allocations[i][lod] = GeometryArena::INVALID_ALLOCATION;
+		}
+	}
+	m_bLoaded = false;
+	m_cylinderSlices = CYLINDER_LOD_SLICES[0];
+	m_bGenerated = false;
+}
+
+/***********************************************************
+ *  ~MeshLibrary()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshLibrary::~MeshLibrary()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Generate()
+ *
+ *  This method builds every level of detail of every mesh
+ *  on the CPU, without any OpenGL calls.
+ ***********************************************************/
+void MeshLibrary::Generate()
+{
+	if (m_bGenerated || m_bLoaded)
+	{
+		return;
+	}
+
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < GetLodCount((MESH_ID)i); lod++)
+		{
+			BuildGeometry((MESH_ID)i, m_vertices[i][lod], m_indices[i][lod], lod, (lod == 0) ? m_cylinderSlices : 0);
+		}
+	}
+	m_bGenerated = true;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method copies every level of detail of every mesh
+ *  into an arena sized to hold them all, and frees the
+ *  built geometry.
+ ***********************************************************/
+bool MeshLibrary::Load()
+{
+	if (m_bLoaded)
+	{
+		return(true);
+	}
+
+	Generate();
+	int vertexCount = 0;
+	int indexCount = 0;
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < GetLodCount((MESH_ID)i); lod++)
+		{
+			vertexCount += (int)(m_vertices[i][lod].size() / VERTEX_FLOATS);
+			indexCount += (int)m_indices[i][lod].size();
+		}
+	}
+
+	// position, normal and texture coordinate
+	const int attributeSizes[3] = { 3, 3, 2 };
+	if (m_arena.Create(attributeSizes, 3, vertexCount, indexCount) == false)
+	{
+		return(false);
+	}
+
+	bool bSuccess = true;
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < GetLodCount((MESH_ID)i); lod++)
+		{
+			m_allocations[i][lod] = m_arena.Allocate(
+				m_vertices[i][lod].data(), (int)(m_vertices[i][lod].size() / VERTEX_FLOATS),
+				m_indices[i][lod].data(), (int)m_indices[i][lod].size());
+			bSuccess &= (m_allocations[i][lod] != GeometryArena::INVALID_ALLOCATION);
+			std::vector<float>().swap(m_vertices[i][lod]);
+			std::vector<GLuint>().swap(m_indices[i][lod]);
+		}
+	}
+	m_bGenerated = false;
+
+	m_bLoaded = true;
+	if (bSuccess == false)
+	{
+		Destroy();
+	}
+
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  BuildGeometry()
+ *
+ *  This method builds the vertices and triangle indices of a
+ *  mesh with the same extents as ShapeMeshes: a unit box
+ *  centered on the origin, a 2x2 plane facing up and a
+ *  cylinder of radius 1 standing from y = 0 to y = 1.  A
+ *  coarser level of detail of the cylinder has fewer sides.
+ ***********************************************************/
+void MeshLibrary::BuildGeometry(MESH_ID mesh, std::vector<float>& vertices, std::vector<GLuint>& indices, int lod, int cylinderSlices)
+{
+	vertices.clear();
+	indices.clear();
+
+	switch (mesh)
+	{
+	case MESH_BOX:
+	{
+		// four vertices per face so every face has its own normal
+		const float faceNormals[6][3] = {
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+			{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } };
+		for (int face = 0; face < 6; face++)
+		{
+			float nx = faceNormals[face][0];
+			float ny = faceNormals[face][1];
+			float nz = faceNormals[face][2];
+			// two axes spanning the face, chosen so the winding faces out
+			float ux = ny + nz, uy = 0.0f, uz = -nx;
+			if (ny != 0.0f)
+			{
+				ux = 1.0f;
+				uz = 0.0f;
+			}
+			float vx = ny * uz - nz * uy, vy = nz * ux - nx * uz, vz = nx * uy - ny * ux;
+
+			GLuint first = (GLuint)(vertices.size() / VERTEX_FLOATS);
+			const float corners[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+			for (int corner = 0; corner < 4; corner++)
+			{
+				float s = corners[corner][0];
+				float t = corners[corner][1];
+				AddVertex(vertices,
+					nx * 0.5f + ux * s + vx * t,
+					ny * 0.5f + uy * s + vy * t,
+					nz * 0.5f + uz * s + vz * t,
+					nx, ny, nz,
+					s + 0.5f, t + 0.5f);
+			}
+			AddQuad(indices, first);
+		}
+		break;
+	}
+
+	case MESH_PLANE:
+		AddVertex(vertices, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+		AddVertex(vertices, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f);
+		AddVertex(vertices, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f);
+		AddVertex(vertices, -1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+		AddQuad(indices, 0);
+		break;
+
+	case MESH_CYLINDER:
+	{
+		int slices = (cylinderSlices > 0) ? cylinderSlices : CYLINDER_LOD_SLICES[std::clamp(lod, 0, MAX_LODS - 1)];
+		// the side repeats its first column so the texture wraps
+		for (int i = 0; i <= slices; i++)
+		{
+			float angle = 2.0f * PI * (float)i / (float)slices;
+			float x = cosf(angle);
+			float z = -sinf(angle);
+			float u = (float)i / (float)slices;
+			AddVertex(vertices, x, 0.0f, z, x, 0.0f, z, u, 0.0f);
+			AddVertex(vertices, x, 1.0f, z, x, 0.0f, z, u, 1.0f);
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint bottom = (GLuint)(i * 2);
+			GLuint side[6] = { bottom, bottom + 2, bottom + 3, bottom, bottom + 3, bottom + 1 };
+			indices.insert(indices.end(), side, side + 6);
+		}
+		// caps as fans around their centers
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float y = (float)cap;
+			float ny = (cap == 0) ? -1.0f : 1.0f;
+			GLuint center = (GLuint)(vertices.size() / VERTEX_FLOATS);
+			AddVertex(vertices, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+			for (int i = 0; i <= slices; i++)
+			{
+				float angle = 2.0f * PI * (float)i / (float)slices;
+				float x = cosf(angle);
+				float z = -sinf(angle);
+				AddVertex(vertices, x, y, z, 0.0f, ny, 0.0f, 0.5f + x * 0.5f, 0.5f - z * 0.5f);
+			}
+			for (int i = 0; i < slices; i++)
+			{
+				GLuint first = center + 1 + (GLuint)i;
+				if (cap == 0)
+				{
+					GLuint fan[3] = { center, first + 1, first };
+					indices.insert(indices.end(), fan, fan + 3);
+				}
+				else
+				{
+					GLuint fan[3] = { center, first, first + 1 };
+					indices.insert(indices.end(), fan, fan + 3);
+				}
+			}
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetLodCount()
+ *
+ *  This method returns how many levels of detail
+ *  BuildGeometry() can make of a mesh.
+ ***********************************************************/
+int MeshLibrary::GetLodCount(MESH_ID mesh)
+{
+	return((mesh == MESH_CYLINDER) ? MAX_LODS : 1);
+}
+
+/***********************************************************
+ *  GetLodMinimumSize()
+ *
+ *  This method returns the screen size from which a level
+ *  of a mesh is drawn.
+ ***********************************************************/
+float MeshLibrary::GetLodMinimumSize(MESH_ID mesh, int lod)
+{
+	if ((lod < 0) || (lod >= GetLodCount(mesh) - 1))
+	{
+		return(0.0f);
+	}
+	return(LOD_MINIMUM_SIZES[lod]);
+}
+
+/***********************************************************
+ *  SelectLod()
+ *
+ *  This method returns the level of a mesh for a screen
+ *  size: the next level is taken while the object is
+ *  smaller than the scaled minimum size of the current one.
+ ***********************************************************/
+int MeshLibrary::SelectLod(MESH_ID mesh, float screenSize, float lodBias)
+{
+	int lodCount = GetLodCount(mesh);
+	int lod = 0;
+	while ((lod + 1 < lodCount) && (screenSize < GetLodMinimumSize(mesh, lod) * lodBias))
+	{
+		lod++;
+	}
+	return(lod);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the arena and forgets the ranges.
+ ***********************************************************/
+void MeshLibrary::Destroy()
+{
+	m_arena.Destroy();
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < MAX_LODS; lod++)
+		{
+			m_allocations[i][lod] = GeometryArena::INVALID_ALLOCATION;
+		}
+	}
+	m_bLoaded = false;
+}
+
+/***********************************************************
+ *  SetCylinderSlices()
+ *
+ *  This method rebuilds the finest level of the cylinder
+ *  with another number of sides.  The new level is placed
+ *  before the old one is freed, so a failure keeps the old
+ *  one, and the arena is defragmented right after, so the
+ *  changes do not leave holes that only smaller meshes fit.
+ *  The ranges move, which the arena generation tells.
+ ***********************************************************/
+bool MeshLibrary::SetCylinderSlices(int slices)
+{
+	slices = std::clamp(slices, CYLINDER_LOD_SLICES[1], CYLINDER_LOD_SLICES[0]);
+	if (!m_bLoaded)
+	{
+		return(false);
+	}
+	if (slices == m_cylinderSlices)
+	{
+		return(true);
+	}
+
+	std::vector<float> vertices;
+	std::vector<GLuint> indices;
+	BuildGeometry(MESH_CYLINDER, vertices, indices, 0, slices);
+	GeometryArena::ALLOCATION allocation = m_arena.Allocate(
+		vertices.data(), (int)(vertices.size() / VERTEX_FLOATS), indices.data(), (int)indices.size());
+	if (allocation == GeometryArena::INVALID_ALLOCATION)
+	{
+		std::cout << "Could not rebuild the cylinder with " << slices << " sides" << std::endl;
+		return(false);
+	}
+
+	m_arena.Free(m_allocations[MESH_CYLINDER][0]);
+	m_allocations[MESH_CYLINDER][0] = allocation;
+	m_cylinderSlices = slices;
+	m_arena.Defragment();
+	return(true);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method draws every instance of a level of a mesh
+ *  with one call.  A level the mesh does not have draws its
+ *  coarsest one.
+ ***********************************************************/
+void MeshLibrary::Draw(MESH_ID mesh, int instanceCount, int lod) const
+{
+	if ((mesh < 0) || (mesh >= MESH_COUNT) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	lod = std::clamp(lod, 0, GetLodCount(mesh) - 1);
+	m_arena.Draw(m_allocations[mesh][lod], instanceCount);
+}
+
+/***********************************************************
+ *  GetRange()
+ *
+ *  This method returns where a level of a mesh is in the
+ *  buffers of the arena.  The library must be loaded.
+ ***********************************************************/
+const GeometryArena::RANGE& MeshLibrary::GetRange(MESH_ID mesh, int lod) const
+{
+	lod = std::clamp(lod, 0, GetLodCount(mesh) - 1);
+	return(m_arena.GetRange(m_allocations[mesh][lod]));
+}
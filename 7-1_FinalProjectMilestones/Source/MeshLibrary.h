@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.h
+// ============
+// indexed versions of the basic scene meshes that can be drawn instanced
+//
+// The meshes match the ones of ShapeMeshes in size and vertex layout
+// (position, normal and texture coordinate at locations 0, 1 and 2), so the
+// same model matrices place them identically.  Every level of detail of
+// every mesh is a range of one GeometryArena, so the whole library is drawn
+// through a single vertex array: Bind() it once, and Draw() repeats a mesh
+// for a number of instances in a single call without binding anything.
+// Locations above 2 are free for instanced attributes of the callers.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GeometryArena.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+class MeshLibrary
+{
+public:
+	enum MESH_ID
+	{
+		MESH_BOX,
+		MESH_PLANE,
+		MESH_CYLINDER,
+		MESH_COUNT
+	};
+
+	// floats per vertex: position, normal, texture coordinate
+	static const int VERTEX_FLOATS = 8;
+	// levels of detail a mesh can have; level 0 is the one Load()
+	// creates and every further level has fewer triangles
+	static const int MAX_LODS = 3;
+
+	// constructor
+	MeshLibrary();
+	// destructor
+	~MeshLibrary();
+
+	// build the geometry of every level of detail of every mesh; needs
+	// no context, so it can run on another thread before Load()
+	void Generate();
+	// place every level of detail of every mesh in the arena, building
+	// them first unless Generate() already has
+	bool Load();
+	// free the GL objects
+	void Destroy();
+	// replace the finest level of the cylinder by one with the passed
+	// in number of sides, clamped between those of the next level and
+	// the full tessellation, and pack the arena again; the library
+	// must be loaded
+	bool SetCylinderSlices(int slices);
+
+	// bind the vertex array shared by every mesh
+	void Bind() const { m_arena.Bind(); }
+	// draw a level of a mesh instanceCount times; gl_InstanceID tells
+	// them apart.  The vertex array must be bound
+	void Draw(MESH_ID mesh, int instanceCount, int lod = 0) const;
+
+	// where a level of a mesh is in the shared buffers, for indirect
+	// draws; the ranges move when the generation of the arena changes
+	const GeometryArena::RANGE& GetRange(MESH_ID mesh, int lod = 0) const;
+	const GeometryArena& GetArena() const { return m_arena; }
+
+	// the interleaved vertices and triangle list of a mesh, for code
+	// that needs the geometry on the CPU; a cylinder has the sides of
+	// its level unless cylinderSlices sets them
+	static void BuildGeometry(MESH_ID mesh, std::vector<float>& vertices, std::vector<GLuint>& indices, int lod = 0, int cylinderSlices = 0);
+	// the number of levels of detail of a mesh, at least 1; only the
+	// cylinder has coarser levels, the flat shapes cannot lose triangles
+	static int GetLodCount(MESH_ID mesh);
+	// the smallest fraction of the viewport height a level of a mesh is
+	// drawn at, 0 for its coarsest level
+	static float GetLodMinimumSize(MESH_ID mesh, int lod);
+	// the level of a mesh to draw for an object covering screenSize of
+	// the viewport height; above 1 the bias draws the coarser levels from
+	// nearer.  The culling shader chooses the same way
+	static int SelectLod(MESH_ID mesh, float screenSize, float lodBias);
+
+private:
+	GeometryArena m_arena;
+	// the range of each level of each mesh; levels a mesh does not
+	// have are INVALID_ALLOCATION
+	GeometryArena::ALLOCATION m_allocations[MESH_COUNT][MAX_LODS];
+	bool m_bLoaded;
+	// the sides of the finest level of the cylinder
+	int m_cylinderSlices;
+	// the geometry built by Generate(), freed once it is in the arena
+	std::vector<float> m_vertices[MESH_COUNT][MAX_LODS];
+	std::vector<GLuint> m_indices[MESH_COUNT][MAX_LODS];
+	bool m_bGenerated;
+};
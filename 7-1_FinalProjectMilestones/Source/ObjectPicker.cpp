@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// objectpicker.cpp
+// ============
+// find the object under a pixel without stalling the render loop
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ObjectPicker.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// picks that may wait for their readback at the same time
+	const int PICK_READBACK_DEPTH = 3;
+}
+
+/***********************************************************
+ *  ObjectPicker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ObjectPicker::ObjectPicker()
+	: m_readback(PICK_READBACK_DEPTH)
+{
+	m_framebuffer = 0;
+	m_idBuffer = 0;
+	m_depthBuffer = 0;
+	m_pickCount = 0;
+	m_lastPick = NO_OBJECT;
+	m_bNewPick = false;
+	m_bAvailable = false;
+}
+
+/***********************************************************
+ *  ~ObjectPicker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ObjectPicker::~ObjectPicker()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method loads the ID shaders and creates the one
+ *  pixel framebuffer with an integer color attachment.
+ ***********************************************************/
+bool ObjectPicker::Initialize(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	if (m_shaderManager.LoadShaders(vertexShaderFile, fragmentShaderFile) == 0)
+	{
+		std::cout << "Could not load the object picking shaders" << std::endl;
+		return(false);
+	}
+	m_uniforms.view.Resolve(m_shaderManager.m_programID, "view", true);
+	m_uniforms.projection.Resolve(m_shaderManager.m_programID, "projection", true);
+	m_uniforms.pickInstanceStride.Resolve(m_shaderManager.m_programID, "pickInstanceStride");
+
+	glGenRenderbuffers(1, &m_idBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_idBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, 1, 1);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1, 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_idBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create the object picking framebuffer" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	m_bAvailable = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the framebuffer, the readback ring and
+ *  the ID program.
+ ***********************************************************/
+void ObjectPicker::Destroy()
+{
+	m_readback.Destroy();
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_idBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_idBuffer);
+		m_idBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	if (m_shaderManager.m_programID != 0)
+	{
+		glDeleteProgram(m_shaderManager.m_programID);
+		m_shaderManager.m_programID = 0;
+	}
+	m_bAvailable = false;
+}
+
+/***********************************************************
+ *  Pick()
+ *
+ *  This method renders the object IDs under one pixel.  The
+ *  projection is scaled and shifted so the picked pixel of
+ *  the viewport fills the whole one pixel target, which
+ *  samples exactly where the main view sampled it.  The
+ *  framebuffer, viewport and program are restored.
+ ***********************************************************/
+bool ObjectPicker::Pick(
+	int x, int y,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportX, int viewportY,
+	int viewportWidth, int viewportHeight,
+	const DrawCallback& draw)
+{
+	if (!m_bAvailable || (viewportWidth <= 0) || (viewportHeight <= 0) ||
+		(x < viewportX) || (y < viewportY) ||
+		(x >= viewportX + viewportWidth) || (y >= viewportY + viewportHeight))
+	{
+		return(false);
+	}
+
+	// the pixel center in normalized device coordinates
+	float centerX = 2.0f * ((float)(x - viewportX) + 0.5f) / (float)viewportWidth - 1.0f;
+	float centerY = 2.0f * ((float)(y - viewportY) + 0.5f) / (float)viewportHeight - 1.0f;
+	glm::mat4 pickMatrix =
+		glm::scale(glm::vec3((float)viewportWidth, (float)viewportHeight, 1.0f)) *
+		glm::translate(glm::vec3(-centerX, -centerY, 0.0f));
+	glm::mat4 pickProjection = pickMatrix * projection;
+
+	GLint previousDrawFramebuffer = 0;
+	GLint previousReadFramebuffer = 0;
+	GLint previousProgram = 0;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDrawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, 1, 1);
+	const GLuint clearID[4] = { NO_OBJECT, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, clearID);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	m_shaderManager.use();
+	m_uniforms.view.Set(view);
+	m_uniforms.projection.Set(pickProjection);
+	m_uniforms.pickInstanceStride.Set(0);
+	draw(pickProjection * view, &m_shaderManager);
+
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	bool bQueued = m_readback.QueueReadback(
+		0, 0, 1, 1,
+		GL_RED_INTEGER, GL_UNSIGNED_INT,
+		m_pickCount, m_pickCount,
+		false,
+		[this](const FrameReadback::READBACK_FRAME& frame) { StorePick(frame); });
+	m_pickCount++;
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)previousDrawFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)previousReadFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glUseProgram((GLuint)previousProgram);
+
+	return(bQueued);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method delivers the picks whose readback finished
+ *  without waiting for the ones still in flight.
+ ***********************************************************/
+bool ObjectPicker::Update()
+{
+	if (!m_bAvailable || (m_readback.GetPendingCount() == 0))
+	{
+		return(false);
+	}
+
+	m_bNewPick = false;
+	m_readback.ProcessCompleted([this](const FrameReadback::READBACK_FRAME& frame) { StorePick(frame); });
+
+	return(m_bNewPick);
+}
+
+/***********************************************************
+ *  StorePick()
+ *
+ *  This method keeps the ID of a finished readback.
+ ***********************************************************/
+void ObjectPicker::StorePick(const FrameReadback::READBACK_FRAME& frame)
+{
+	memcpy(&m_lastPick, frame.pixels, sizeof(m_lastPick));
+	m_bNewPick = true;
+}
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// objectpicker.h
+// ============
+// find the object under a pixel without stalling the render loop
+//
+// A pick renders object IDs into a one pixel R32UI target through a
+// projection narrowed to the picked pixel, so frustum culling leaves only
+// the few draws that can cover it.  The ID is read back through a pixel
+// buffer and fence and delivered by Update() a frame or two later.
+// Instanced draws may give every instance its own ID by setting the
+// pickInstanceStride uniform.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameReadback.h"
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+
+class ObjectPicker
+{
+public:
+	// draws the pickable objects with the passed in shader, setting its
+	// model and pickID uniforms; culls against viewProjection
+	typedef std::function<void(const glm::mat4& viewProjection, ShaderManager* pShader)> DrawCallback;
+
+	// the value read where no object was drawn
+	static const uint32_t NO_OBJECT = 0;
+
+	// constructor
+	ObjectPicker();
+	// destructor
+	~ObjectPicker();
+
+	// load the ID shaders and create the ID target
+	bool Initialize(const char* vertexShaderFile, const char* fragmentShaderFile);
+
+	// render the IDs at pixel (x, y) of the framebuffer, seen through
+	// the passed in view and its viewport, and queue the readback
+	bool Pick(
+		int x, int y,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportX, int viewportY,
+		int viewportWidth, int viewportHeight,
+		const DrawCallback& draw);
+
+	// deliver finished picks; returns true when a new result arrived
+	bool Update();
+
+	// the object handle of the newest finished pick
+	uint32_t GetLastPick() const { return m_lastPick; }
+	int GetPendingCount() const { return m_readback.GetPendingCount(); }
+
+private:
+	ShaderManager m_shaderManager;
+	// resolved when the ID shaders are loaded
+	struct PICK_UNIFORMS
+	{
+		Uniform<glm::mat4> view;
+		Uniform<glm::mat4> projection;
+		Uniform<int> pickInstanceStride;
+	};
+	PICK_UNIFORMS m_uniforms;
+	GLuint m_framebuffer;
+	GLuint m_idBuffer;
+	GLuint m_depthBuffer;
+	FrameReadback m_readback;
+	uint64_t m_pickCount;
+	uint32_t m_lastPick;
+	bool m_bNewPick;
+	bool m_bAvailable;
+
+	void Destroy();
+	// called with the mapped pixel of a finished pick
+	void StorePick(const FrameReadback::READBACK_FRAME& frame);
+};
@@ -0,0 +1,374 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.cpp
+// ============
+// sample the hardware performance counters around parts of the frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerfCounters.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	enum COUNTER
+	{
+		COUNTER_CYCLES,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_CACHE_MISSES,
+		COUNTER_BRANCH_MISSES,
+		COUNTER_COUNT
+	};
+
+	const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+		"cycles", "instructions", "cache misses", "branch misses" };
+
+	// named scopes and the depth they may nest to
+	const int MAX_SCOPES = 16;
+	const int MAX_DEPTH = 8;
+	// the scopes are reported this often
+	const double REPORT_SECONDS = 5.0;
+
+	// the counts of a reading, scaled up when the counters had to share
+	// the hardware with other groups
+	struct READING
+	{
+		uint64_t values[COUNTER_COUNT];
+	};
+
+	struct SCOPE_TOTALS
+	{
+		const char* name;
+		uint64_t calls;
+		uint64_t values[COUNTER_COUNT];
+	};
+
+	struct OPEN_SCOPE
+	{
+		int scope;
+		READING start;
+	};
+
+	bool g_bAvailable = false;
+	// the descriptor of each counter, -1 for those not opened; the
+	// first is the leader of the group
+	int g_counterFiles[COUNTER_COUNT] = { -1, -1, -1, -1 };
+	// the position of each opened counter in a group reading
+	int g_readIndex[COUNTER_COUNT] = { -1, -1, -1, -1 };
+	int g_openedCount = 0;
+
+	// the scopes are opened and closed by the render loop thread
+	SCOPE_TOTALS g_scopes[MAX_SCOPES];
+	int g_scopeCount = 0;
+	OPEN_SCOPE g_openScopes[MAX_DEPTH];
+	int g_depth = 0;
+	uint64_t g_frames = 0;
+	uint64_t g_draws = 0;
+	std::chrono::steady_clock::time_point g_reportTime;
+
+	// the totals of a name, added on first use; -1 when the table is full
+	int FindScope(const char* name)
+	{
+		for (int i = 0; i < g_scopeCount; i++)
+		{
+			if ((g_scopes[i].name == name) || (strcmp(g_scopes[i].name, name) == 0))
+			{
+				return(i);
+			}
+		}
+		if (g_scopeCount == MAX_SCOPES)
+		{
+			return(-1);
+		}
+
+		SCOPE_TOTALS& scope = g_scopes[g_scopeCount];
+		memset(&scope, 0, sizeof(scope));
+		scope.name = name;
+		return(g_scopeCount++);
+	}
+
+	// read every counter of the group with one call
+	bool ReadCounters(READING& reading)
+	{
+#ifdef __linux__
+		// the layout of PERF_FORMAT_GROUP with the enabled and running
+		// times
+		uint64_t buffer[3 + COUNTER_COUNT];
+		ssize_t bytes = read(g_counterFiles[COUNTER_CYCLES], buffer, sizeof(buffer));
+		if (bytes < (ssize_t)((3 + g_openedCount) * sizeof(uint64_t)))
+		{
+			return(false);
+		}
+
+		uint64_t timeEnabled = buffer[1];
+		uint64_t timeRunning = buffer[2];
+		for (int i = 0; i < COUNTER_COUNT; i++)
+		{
+			uint64_t value = (g_readIndex[i] >= 0) ? buffer[3 + g_readIndex[i]] : 0;
+			if ((timeRunning > 0) && (timeRunning < timeEnabled))
+			{
+				value = (uint64_t)((double)value * (double)timeEnabled / (double)timeRunning);
+			}
+			reading.values[i] = value;
+		}
+		return(true);
+#else
+		(void)reading;
+		return(false);
+#endif
+	}
+
+#ifdef __linux__
+	// open one counter of the user space of the calling thread
+	int OpenCounter(uint64_t config, int groupFile)
+	{
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = config;
+		attributes.disabled = (groupFile == -1) ? 1 : 0;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return((int)syscall(__NR_perf_event_open, &attributes, 0, -1, groupFile, 0));
+	}
+#endif
+
+	void Report()
+	{
+		if ((g_frames == 0) || (g_scopeCount == 0))
+		{
+			return;
+		}
+
+		double frames = (double)g_frames;
+		double draws = (double)((g_draws > 0) ? g_draws : 1);
+		std::cout << "INFO: Performance counters over " << g_frames << " frames, "
+			<< std::fixed << std::setprecision(1) << (double)g_draws / frames << " draws per frame" << std::endl;
+		for (int i = 0; i < g_scopeCount; i++)
+		{
+			const SCOPE_TOTALS& scope = g_scopes[i];
+			if (scope.calls == 0)
+			{
+				continue;
+			}
+
+			std::cout << "  " << scope.name << ": " << std::setprecision(3)
+				<< (double)scope.values[COUNTER_CYCLES] / frames / 1000000.0 << " Mcycles per frame";
+			if ((g_readIndex[COUNTER_INSTRUCTIONS] >= 0) && (scope.values[COUNTER_CYCLES] > 0))
+			{
+				std::cout << ", IPC " << std::setprecision(2)
+					<< (double)scope.values[COUNTER_INSTRUCTIONS] / (double)scope.values[COUNTER_CYCLES];
+			}
+			for (int j = COUNTER_CACHE_MISSES; j < COUNTER_COUNT; j++)
+			{
+				if (g_readIndex[j] >= 0)
+				{
+					std::cout << ", " << std::setprecision(1) << (double)scope.values[j] / draws
+						<< " " << COUNTER_NAMES[j] << " per draw";
+				}
+			}
+			std::cout << std::endl;
+		}
+		std::cout << std::defaultfloat << std::setprecision(6);
+
+		for (int i = 0; i < g_scopeCount; i++)
+		{
+			g_scopes[i].calls = 0;
+			memset(g_scopes[i].values, 0, sizeof(g_scopes[i].values));
+		}
+		g_frames = 0;
+		g_draws = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method opens the counter group for the calling
+ *  thread.  The cycles lead the group and are required; the
+ *  other counters are added when the machine has them.
+ ***********************************************************/
+bool PerfCounters::Initialize()
+{
+	if (g_bAvailable)
+	{
+		return(true);
+	}
+
+#ifdef __linux__
+	const uint64_t configs[COUNTER_COUNT] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES };
+
+	g_counterFiles[COUNTER_CYCLES] = OpenCounter(configs[COUNTER_CYCLES], -1);
+	if (g_counterFiles[COUNTER_CYCLES] < 0)
+	{
+		int error = errno;
+		std::cout << "INFO: Hardware performance counters are not available ("
+			<< strerror(error) << ((error == EACCES) || (error == EPERM) ? ", see /proc/sys/kernel/perf_event_paranoid" : "")
+			<< "), the render loop is not sampled" << std::endl;
+		return(false);
+	}
+	g_readIndex[COUNTER_CYCLES] = 0;
+	g_openedCount = 1;
+
+	for (int i = COUNTER_CYCLES + 1; i < COUNTER_COUNT; i++)
+	{
+		g_counterFiles[i] = OpenCounter(configs[i], g_counterFiles[COUNTER_CYCLES]);
+		if (g_counterFiles[i] < 0)
+		{
+			std::cout << "INFO: The " << COUNTER_NAMES[i] << " counter is not available, left out" << std::endl;
+			continue;
+		}
+		g_readIndex[i] = g_openedCount++;
+	}
+
+	ioctl(g_counterFiles[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(g_counterFiles[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	g_bAvailable = true;
+	g_reportTime = std::chrono::steady_clock::now();
+	std::cout << "INFO: Sampling " << g_openedCount << " hardware performance counters around the frame phases" << std::endl;
+	return(true);
+#else
+	std::cout << "INFO: Hardware performance counters need Linux perf_event_open, the render loop is not sampled" << std::endl;
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method closes the counters.
+ ***********************************************************/
+void PerfCounters::Shutdown()
+{
+#ifdef __linux__
+	// the members of the group are closed before their leader
+	for (int i = COUNTER_COUNT - 1; i >= 0; i--)
+	{
+		if (g_counterFiles[i] >= 0)
+		{
+			close(g_counterFiles[i]);
+			g_counterFiles[i] = -1;
+		}
+		g_readIndex[i] = -1;
+	}
+#endif
+	g_openedCount = 0;
+	g_depth = 0;
+	g_bAvailable = false;
+}
+
+/***********************************************************
+ *  IsAvailable()
+ *
+ *  This method returns whether the counters are open.
+ ***********************************************************/
+bool PerfCounters::IsAvailable()
+{
+	return(g_bAvailable);
+}
+
+/***********************************************************
+ *  BeginScope()
+ *
+ *  This method reads the counters as a scope opens.
+ ***********************************************************/
+void PerfCounters::BeginScope(const char* name)
+{
+	if (!g_bAvailable)
+	{
+		return;
+	}
+
+	// scopes beyond the depth or the table are skipped, their
+	// EndScope() then closes nothing
+	int scope = (g_depth < MAX_DEPTH) ? FindScope(name) : -1;
+	if (g_depth < MAX_DEPTH)
+	{
+		g_openScopes[g_depth].scope = scope;
+		if ((scope >= 0) && !ReadCounters(g_openScopes[g_depth].start))
+		{
+			g_openScopes[g_depth].scope = -1;
+		}
+	}
+	g_depth++;
+}
+
+/***********************************************************
+ *  EndScope()
+ *
+ *  This method reads the counters as a scope closes and adds
+ *  the difference to its totals.
+ ***********************************************************/
+void PerfCounters::EndScope()
+{
+	if (!g_bAvailable || (g_depth == 0))
+	{
+		return;
+	}
+
+	g_depth--;
+	if (g_depth >= MAX_DEPTH)
+	{
+		return;
+	}
+
+	const OPEN_SCOPE& open = g_openScopes[g_depth];
+	READING end;
+	if ((open.scope < 0) || !ReadCounters(end))
+	{
+		return;
+	}
+
+	SCOPE_TOTALS& scope = g_scopes[open.scope];
+	scope.calls++;
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		// a scaled estimate can go back slightly
+		if (end.values[i] > open.start.values[i])
+		{
+			scope.values[i] += end.values[i] - open.start.values[i];
+		}
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method counts a frame and its draws, and reports
+ *  the scopes every REPORT_SECONDS.
+ ***********************************************************/
+void PerfCounters::EndFrame(int drawCalls)
+{
+	if (!g_bAvailable)
+	{
+		return;
+	}
+
+	g_frames++;
+	g_draws += (drawCalls > 0) ? (uint64_t)drawCalls : 0;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<double>(now - g_reportTime).count() >= REPORT_SECONDS)
+	{
+		Report();
+		g_reportTime = now;
+	}
+}
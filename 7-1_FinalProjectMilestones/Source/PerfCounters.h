@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.h
+// ============
+// sample the hardware performance counters around parts of the frame
+//
+// On Linux, Initialize() opens one group of counters with perf_event_open
+// for the render loop thread: cycles, instructions, cache misses and
+// branch misses, counted in user space only so the default paranoia
+// level allows it.  Every scope between BeginScope() and EndScope() reads
+// the group when it opens and closes, and adds the difference to the
+// totals of its name; scopes may nest and each one is counted.  Every few
+// seconds the scopes are reported with their cycles per frame, their
+// instructions per cycle, and their misses per draw of the frame.
+//
+// Counters the machine lacks are left out of the report.  Where none can
+// be opened, such as on other platforms, in most virtual machines, or
+// when perf_event_paranoid forbids it, the reason is logged once and the
+// scope calls do nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+class PerfCounters
+{
+public:
+	// open the counters for the calling thread, which must be the one
+	// that opens the scopes; false when they are not available
+	static bool Initialize();
+	// close the counters
+	static void Shutdown();
+
+	static bool IsAvailable();
+
+	// start counting for the named part of the frame; the name must
+	// stay valid, as string literals do
+	static void BeginScope(const char* name);
+	// stop counting and add the counts to the scope
+	static void EndScope();
+
+	// close a frame that made the passed in draw calls, and report the
+	// scopes when it is time
+	static void EndFrame(int drawCalls);
+};
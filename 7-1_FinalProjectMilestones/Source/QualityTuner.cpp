@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+// qualitytuner.cpp
+// ============
+// choose the quality tier that keeps the frames within a time budget
+///////////////////////////////////////////////////////////////////////////////
+
+#include "QualityTuner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// name, point lights, per-vertex lighting, level of detail bias,
+	// cylinder sides and render scale; the high tier is the full quality
+	// of the scene
+	const QualityTuner::QUALITY_SETTINGS TIER_SETTINGS[QualityTuner::TIER_COUNT] = {
+		{ "low", 1, true, 4.0f, 16, 0.5f },
+		{ "medium", 3, false, 2.0f, 24, 0.75f },
+		{ "high", 5, false, 1.0f, 36, 1.0f } };
+
+	// the benchmark at startup checks the cost more often
+	const double BENCHMARK_SECONDS = 3.0;
+	const double BENCHMARK_WINDOW_SECONDS = 0.5;
+	const double TUNING_WINDOW_SECONDS = 2.0;
+	// frames ignored at startup and after a change
+	const int WARMUP_FRAMES = 10;
+	// a tier steps up only below this fraction of the target, so the
+	// next tier has room before it is over
+	const double STEP_UP_HEADROOM = 0.7;
+	// a tier given up is not tried again for this long
+	const double STEP_UP_COOLDOWN_SECONDS = 30.0;
+}
+
+/***********************************************************
+ *  QualityTuner()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+QualityTuner::QualityTuner()
+{
+	m_tier = TIER_HIGH;
+	m_bAutoTune = false;
+	m_bTimeFrames = false;
+	m_bTierChanged = false;
+	m_bBenchmarkReported = false;
+	m_targetMilliseconds = 16.7f;
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		m_beginQueries[i] = 0;
+		m_endQueries[i] = 0;
+		m_cpuMilliseconds[i] = 0.0;
+		m_bQueryPending[i] = false;
+	}
+	m_queryFrame = 0;
+	m_lastCpuMilliseconds = 0.0;
+	m_lastGpuMilliseconds = 0.0;
+	m_bHaveLastFrame = false;
+	m_windowCpu = 0.0;
+	m_windowGpu = 0.0;
+	m_windowCost = 0.0;
+	m_windowFrames = 0;
+	m_warmupFrames = WARMUP_FRAMES;
+	m_blockedTier = -1;
+}
+
+/***********************************************************
+ *  ~QualityTuner()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+QualityTuner::~QualityTuner()
+{
+	if (m_beginQueries[0] != 0)
+	{
+		glDeleteQueries(QUERY_FRAMES, m_beginQueries);
+		glDeleteQueries(QUERY_FRAMES, m_endQueries);
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method sets the starting tier and the target, and
+ *  creates the timestamp queries when the frames are timed.
+ *  The starting tier counts as a change, so its settings
+ *  get applied.
+ ***********************************************************/
+void QualityTuner::Initialize(QUALITY_TIER tier, float targetFrameMilliseconds, bool bAutoTune, bool bTimeFrames)
+{
+	m_tier = tier;
+	m_targetMilliseconds = (targetFrameMilliseconds > 0.0f) ? targetFrameMilliseconds : m_targetMilliseconds;
+	m_bAutoTune = bAutoTune;
+	m_bTimeFrames = bAutoTune || bTimeFrames;
+	m_bTierChanged = true;
+
+	if ((m_beginQueries[0] == 0) && m_bTimeFrames)
+	{
+		glGenQueries(QUERY_FRAMES, m_beginQueries);
+		glGenQueries(QUERY_FRAMES, m_endQueries);
+	}
+
+	m_startTime = CLOCK::now();
+	ResetWindow();
+
+	std::cout << "INFO: Quality tier " << GetSettings().name;
+	if (m_bAutoTune)
+	{
+		std::cout << ", tuned to " << m_targetMilliseconds << " ms per frame";
+	}
+	std::cout << std::endl;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method starts timing a frame.
+ ***********************************************************/
+void QualityTuner::BeginFrame()
+{
+	if (!m_bTimeFrames)
+	{
+		return;
+	}
+
+	// the slot of this frame is reused, so its last result is read
+	// first if it has arrived; otherwise the old frame is dropped
+	int slot = m_queryFrame % QUERY_FRAMES;
+	if (m_bQueryPending[slot])
+	{
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(m_endQueries[slot], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable)
+		{
+			GLuint64 begin = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(m_beginQueries[slot], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(m_endQueries[slot], GL_QUERY_RESULT, &end);
+			m_lastCpuMilliseconds = m_cpuMilliseconds[slot];
+			m_lastGpuMilliseconds = (double)(end - begin) / 1000000.0;
+			m_bHaveLastFrame = true;
+			if (m_bAutoTune)
+			{
+				AddFrame(m_lastCpuMilliseconds, m_lastGpuMilliseconds);
+			}
+		}
+		m_bQueryPending[slot] = false;
+	}
+
+	glQueryCounter(m_beginQueries[slot], GL_TIMESTAMP);
+	m_frameStart = CLOCK::now();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method stops timing a frame.  Its GPU time is read
+ *  when the slot comes around again, QUERY_FRAMES frames
+ *  later, which is enough for it to have finished.
+ ***********************************************************/
+void QualityTuner::EndFrame()
+{
+	if (!m_bTimeFrames)
+	{
+		return;
+	}
+
+	int slot = m_queryFrame % QUERY_FRAMES;
+	glQueryCounter(m_endQueries[slot], GL_TIMESTAMP);
+	m_cpuMilliseconds[slot] = std::chrono::duration<double, std::milli>(CLOCK::now() - m_frameStart).count();
+	m_bQueryPending[slot] = true;
+	m_queryFrame++;
+}
+
+/***********************************************************
+ *  ConsumeTierChange()
+ *
+ *  This method reports a change of tier once.
+ ***********************************************************/
+bool QualityTuner::ConsumeTierChange()
+{
+	bool bChanged = m_bTierChanged;
+	m_bTierChanged = false;
+	return(bChanged);
+}
+
+/***********************************************************
+ *  GetLastFrameTimes()
+ *
+ *  This method returns the times of the latest frame whose
+ *  GPU time has been read.
+ ***********************************************************/
+bool QualityTuner::GetLastFrameTimes(double& cpuMilliseconds, double& gpuMilliseconds) const
+{
+	if (!m_bHaveLastFrame)
+	{
+		return(false);
+	}
+
+	cpuMilliseconds = m_lastCpuMilliseconds;
+	gpuMilliseconds = m_lastGpuMilliseconds;
+	return(true);
+}
+
+/***********************************************************
+ *  GetTierSettings()
+ *
+ *  This method returns the settings of a tier.
+ ***********************************************************/
+const QualityTuner::QUALITY_SETTINGS& QualityTuner::GetTierSettings(QUALITY_TIER tier)
+{
+	int index = std::clamp((int)tier, 0, TIER_COUNT - 1);
+	return(TIER_SETTINGS[index]);
+}
+
+/***********************************************************
+ *  FindTier()
+ *
+ *  This method looks up a tier by its name.
+ ***********************************************************/
+bool QualityTuner::FindTier(const char* name, QUALITY_TIER& tier)
+{
+	if (NULL == name)
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < TIER_COUNT; i++)
+	{
+		if (strcmp(name, TIER_SETTINGS[i].name) == 0)
+		{
+			tier = (QUALITY_TIER)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  AddFrame()
+ *
+ *  This method adds the times of a finished frame to the
+ *  window, and at the end of the window steps the tier down
+ *  when the average cost is over the target or up when it
+ *  is well under it.
+ ***********************************************************/
+void QualityTuner::AddFrame(double cpuMilliseconds, double gpuMilliseconds)
+{
+	if (m_warmupFrames > 0)
+	{
+		m_warmupFrames--;
+		m_windowStart = CLOCK::now();
+		return;
+	}
+
+	m_windowCpu += cpuMilliseconds;
+	m_windowGpu += gpuMilliseconds;
+	m_windowCost += std::max(cpuMilliseconds, gpuMilliseconds);
+	m_windowFrames++;
+
+	CLOCK::time_point now = CLOCK::now();
+	double runSeconds = std::chrono::duration<double>(now - m_startTime).count();
+	double windowSeconds = std::chrono::duration<double>(now - m_windowStart).count();
+	bool bBenchmark = (runSeconds < BENCHMARK_SECONDS);
+	if (windowSeconds < (bBenchmark ? BENCHMARK_WINDOW_SECONDS : TUNING_WINDOW_SECONDS))
+	{
+		return;
+	}
+
+	double frames = (double)m_windowFrames;
+	double cost = m_windowCost / frames;
+	double cpu = m_windowCpu / frames;
+	double gpu = m_windowGpu / frames;
+
+	if ((cost > m_targetMilliseconds) && (m_tier > TIER_LOW))
+	{
+		m_blockedTier = m_tier;
+		m_blockedUntil = now + std::chrono::duration_cast<CLOCK::duration>(std::chrono::duration<double>(STEP_UP_COOLDOWN_SECONDS));
+		ChangeTier((QUALITY_TIER)(m_tier - 1), windowSeconds, cost, cpu, gpu, m_windowFrames);
+		return;
+	}
+
+	int nextTier = m_tier + 1;
+	bool bBlocked = (nextTier == m_blockedTier) && (now < m_blockedUntil);
+	if ((cost < m_targetMilliseconds * STEP_UP_HEADROOM) && (nextTier < TIER_COUNT) && !bBlocked)
+	{
+		ChangeTier((QUALITY_TIER)nextTier, windowSeconds, cost, cpu, gpu, m_windowFrames);
+		return;
+	}
+
+	if (!bBenchmark && !m_bBenchmarkReported)
+	{
+		std::cout << "INFO: Quality benchmark settled on tier " << GetSettings().name << " at "
+			<< cost << " ms per frame (CPU " << cpu << " ms, GPU " << gpu << " ms), target "
+			<< m_targetMilliseconds << " ms" << std::endl;
+		m_bBenchmarkReported = true;
+	}
+	ResetWindow();
+}
+
+/***********************************************************
+ *  ChangeTier()
+ *
+ *  This method switches to another tier and logs the
+ *  measurement that caused it.
+ ***********************************************************/
+void QualityTuner::ChangeTier(QUALITY_TIER tier, double windowSeconds, double cost, double cpu, double gpu, int frames)
+{
+	std::cout << "INFO: Quality tier " << GetSettings().name << " -> " << GetTierSettings(tier).name
+		<< ": " << cost << " ms per frame (CPU " << cpu << " ms, GPU " << gpu << " ms) over "
+		<< frames << " frames in " << windowSeconds << " s, target " << m_targetMilliseconds << " ms" << std::endl;
+
+	m_tier = tier;
+	m_bTierChanged = true;
+	m_warmupFrames = WARMUP_FRAMES;
+	ResetWindow();
+}
+
+/***********************************************************
+ *  ResetWindow()
+ *
+ *  This method starts a new measurement window.
+ ***********************************************************/
+void QualityTuner::ResetWindow()
+{
+	m_windowStart = CLOCK::now();
+	m_windowCpu = 0.0;
+	m_windowGpu = 0.0;
+	m_windowCost = 0.0;
+	m_windowFrames = 0;
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// qualitytuner.h
+// ============
+// choose the quality tier that keeps the frames within a time budget
+//
+// A tier sets the number of point lights, whether the scene is lit per
+// vertex or per fragment, the level of detail bias of the GPU culling and
+// the scale of the resolution the views are rendered at.  The tuner times
+// every frame on the CPU and, with timestamp queries read a few frames
+// later, on the GPU; the cost of a frame is the larger of the two.  For
+// the first BENCHMARK_SECONDS the average cost is checked twice a second
+// so the tier settles quickly, then every few seconds.  A tier over the
+// target steps down; one well under it steps up, except back into a tier
+// that was just given up.  Every change is logged with the measurement
+// that caused it.  The frames can also be timed for others, such as the
+// telemetry, with the tier kept fixed.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+
+class QualityTuner
+{
+public:
+	enum QUALITY_TIER
+	{
+		TIER_LOW,
+		TIER_MEDIUM,
+		TIER_HIGH,
+		TIER_COUNT
+	};
+
+	struct QUALITY_SETTINGS
+	{
+		const char* name;
+		// point lights sent to the shaders, at most 5
+		int pointLights;
+		// light at the vertices and interpolate, instead of per pixel
+		bool bVertexLighting;
+		// scales the screen sizes at which the meshes get coarser
+		float lodBias;
+		// sides of the finest level of the cylinder
+		int cylinderSlices;
+		// fraction of the window resolution the views are rendered at
+		float renderScale;
+	};
+
+	// constructor
+	QualityTuner();
+	// destructor
+	~QualityTuner();
+
+	// start at a tier; with bAutoTune the tier follows the frame cost,
+	// otherwise it stays, and the frames are only timed when
+	// bTimeFrames asks for it.  Needs a current context for the queries
+	void Initialize(QUALITY_TIER tier, float targetFrameMilliseconds, bool bAutoTune, bool bTimeFrames = false);
+
+	// bracket the work of a frame, before the buffers are swapped, so
+	// the wait for the display is not counted
+	void BeginFrame();
+	void EndFrame();
+
+	// true once after the tier has changed, when its settings must be
+	// applied
+	bool ConsumeTierChange();
+	QUALITY_TIER GetTier() const { return m_tier; }
+	const QUALITY_SETTINGS& GetSettings() const { return GetTierSettings(m_tier); }
+
+	// the times of the latest frame whose GPU time has arrived, a few
+	// frames behind the current one; false until there is one
+	bool GetLastFrameTimes(double& cpuMilliseconds, double& gpuMilliseconds) const;
+
+	static const QUALITY_SETTINGS& GetTierSettings(QUALITY_TIER tier);
+	// the tier of a name such as "medium"; false for an unknown name
+	static bool FindTier(const char* name, QUALITY_TIER& tier);
+
+private:
+	// frames whose GPU timestamps may still be in flight
+	static const int QUERY_FRAMES = 4;
+
+	typedef std::chrono::steady_clock CLOCK;
+
+	QUALITY_TIER m_tier;
+	bool m_bAutoTune;
+	bool m_bTimeFrames;
+	bool m_bTierChanged;
+	bool m_bBenchmarkReported;
+	float m_targetMilliseconds;
+
+	// timestamps at the start and end of each frame in flight, and the
+	// CPU time of the frame they belong to
+	GLuint m_beginQueries[QUERY_FRAMES];
+	GLuint m_endQueries[QUERY_FRAMES];
+	double m_cpuMilliseconds[QUERY_FRAMES];
+	bool m_bQueryPending[QUERY_FRAMES];
+	int m_queryFrame;
+	CLOCK::time_point m_frameStart;
+	double m_lastCpuMilliseconds;
+	double m_lastGpuMilliseconds;
+	bool m_bHaveLastFrame;
+
+	// the measurements of the current window
+	CLOCK::time_point m_startTime;
+	CLOCK::time_point m_windowStart;
+	double m_windowCpu;
+	double m_windowGpu;
+	double m_windowCost;
+	int m_windowFrames;
+	// frames left out after a change, while new programs and targets
+	// are created
+	int m_warmupFrames;
+	// the tier given up last, which is not stepped back into before
+	// the time has passed
+	int m_blockedTier;
+	CLOCK::time_point m_blockedUntil;
+
+	// add the times of a finished frame and decide at the end of a window
+	void AddFrame(double cpuMilliseconds, double gpuMilliseconds);
+	void ChangeTier(QUALITY_TIER tier, double windowSeconds, double cost, double cpu, double gpu, int frames);
+	void ResetWindow();
+};
@@ -0,0 +1,358 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertargetmanager.cpp
+// ============
+// secondary views rendered into textures at their own refresh rates
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderTargetManager.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// weight of the newest measurement in the running GPU time estimate
+	const float GPU_TIME_SMOOTHING = 0.25f;
+}
+
+/***********************************************************
+ *  RenderTargetManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderTargetManager::RenderTargetManager(ShaderManager* pShaderManager, float frameBudgetMilliseconds)
+{
+	m_pShaderManager = pShaderManager;
+	m_frameBudgetMilliseconds = frameBudgetMilliseconds;
+	m_startTime = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  ~RenderTargetManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderTargetManager::~RenderTargetManager()
+{
+	for (size_t i = 0; i < m_targets.size(); i++)
+	{
+		glDeleteQueries(1, &m_targets[i].timerQuery);
+		glDeleteFramebuffers(1, &m_targets[i].framebuffer);
+		glDeleteRenderbuffers(1, &m_targets[i].depthBuffer);
+		glDeleteTextures(1, &m_targets[i].colorTexture);
+	}
+	m_targets.clear();
+	m_pShaderManager = NULL;
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method creates the framebuffer of a new target with
+ *  a mipmapped color texture, so the texture stays smooth
+ *  when its surface is far away.
+ ***********************************************************/
+int RenderTargetManager::CreateTarget(int width, int height, float updateRate, glm::vec4 clearColor, RenderCallback callback)
+{
+	RENDER_TARGET target;
+	target.width = width;
+	target.height = height;
+	target.clearColor = clearColor;
+	target.callback = callback;
+	target.updateInterval = (updateRate > 0.0f) ? (1.0 / updateRate) : 0.0;
+	target.lastUpdateTime = -1.0e9;
+	target.bHasContent = false;
+	target.bHasSurface = false;
+	target.minScreenPixels = 0.0f;
+	target.bTimerPending = false;
+	target.gpuMilliseconds = 0.0f;
+
+	GLint previousTexture = 0;
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenTextures(1, &target.colorTexture);
+	glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glGenRenderbuffers(1, &target.depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &target.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Render target framebuffer is incomplete, status 0x" << std::hex << status << std::dec << std::endl;
+		glDeleteFramebuffers(1, &target.framebuffer);
+		glDeleteRenderbuffers(1, &target.depthBuffer);
+		glDeleteTextures(1, &target.colorTexture);
+		return(-1);
+	}
+
+	glGenQueries(1, &target.timerQuery);
+
+	m_targets.push_back(target);
+	m_dueTargets.reserve(m_targets.size());
+	return((int)m_targets.size() - 1);
+}
+
+/***********************************************************
+ *  SetTargetSurface()
+ *
+ *  This method records where the target's texture appears
+ *  in the main scene so hidden targets can be skipped.
+ ***********************************************************/
+void RenderTargetManager::SetTargetSurface(int target, const BoundingVolumes::BOX& bounds, glm::vec3 facing, float minScreenPixels)
+{
+	if ((target < 0) || (target >= (int)m_targets.size()))
+	{
+		return;
+	}
+
+	m_targets[target].bHasSurface = true;
+	m_targets[target].surfaceBounds = bounds;
+	m_targets[target].surfaceFacing = facing;
+	m_targets[target].minScreenPixels = minScreenPixels;
+}
+
+/***********************************************************
+ *  GetTextureID()
+ *
+ *  This method returns the color texture of a target.
+ ***********************************************************/
+uint32_t RenderTargetManager::GetTextureID(int target) const
+{
+	if ((target < 0) || (target >= (int)m_targets.size()))
+	{
+		return(0);
+	}
+	return(m_targets[target].colorTexture);
+}
+
+/***********************************************************
+ *  HasContent()
+ *
+ *  This method tells whether the target has been rendered.
+ ***********************************************************/
+bool RenderTargetManager::HasContent(int target) const
+{
+	if ((target < 0) || (target >= (int)m_targets.size()))
+	{
+		return(false);
+	}
+	return(m_targets[target].bHasContent);
+}
+
+/***********************************************************
+ *  GetTime()
+ *
+ *  This method returns the seconds since construction.
+ ***********************************************************/
+double RenderTargetManager::GetTime() const
+{
+	return(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+/***********************************************************
+ *  CollectGPUTime()
+ *
+ *  This method folds a finished timer query into the GPU
+ *  time estimate of the target.
+ ***********************************************************/
+void RenderTargetManager::CollectGPUTime(RENDER_TARGET& target)
+{
+	if (target.bTimerPending == false)
+	{
+		return;
+	}
+
+	GLint bAvailable = 0;
+	glGetQueryObjectiv(target.timerQuery, GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+	if (bAvailable)
+	{
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(target.timerQuery, GL_QUERY_RESULT, &nanoseconds);
+		float milliseconds = (float)(nanoseconds / 1.0e6);
+		if (target.gpuMilliseconds <= 0.0f)
+		{
+			target.gpuMilliseconds = milliseconds;
+		}
+		else
+		{
+			target.gpuMilliseconds += (milliseconds - target.gpuMilliseconds) * GPU_TIME_SMOOTHING;
+		}
+		target.bTimerPending = false;
+	}
+}
+
+/***********************************************************
+ *  IsSurfaceVisible()
+ *
+ *  This method tests the surface of a target against the
+ *  main view: it must face the camera, be inside the view
+ *  frustum and cover enough pixels to be worth refreshing.
+ ***********************************************************/
+bool RenderTargetManager::IsSurfaceVisible(
+	const RENDER_TARGET& target,
+	const BoundingVolumes::FRUSTUM& frustum,
+	const glm::mat4& viewProjection,
+	glm::vec3 viewPosition,
+	int viewportWidth,
+	int viewportHeight) const
+{
+	if (target.bHasSurface == false)
+	{
+		return(true);
+	}
+
+	glm::vec3 center = (target.surfaceBounds.minimum + target.surfaceBounds.maximum) * 0.5f;
+	if (glm::dot(target.surfaceFacing, viewPosition - center) <= 0.0f)
+	{
+		return(false);
+	}
+
+	if (BoundingVolumes::IsBoxVisible(frustum, target.surfaceBounds) == false)
+	{
+		return(false);
+	}
+
+	float screenPixels = BoundingVolumes::ProjectedSize(target.surfaceBounds, viewProjection, viewportWidth, viewportHeight);
+	return(screenPixels >= target.minScreenPixels);
+}
+
+/***********************************************************
+ *  RenderTarget()
+ *
+ *  This method draws the content of one target into its
+ *  framebuffer and rebuilds the texture mipmaps.
+ ***********************************************************/
+void RenderTargetManager::RenderTarget(RENDER_TARGET& target, double time)
+{
+	// only one measurement per target is kept in flight
+	bool bTimed = (target.bTimerPending == false);
+	if (bTimed)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, target.timerQuery);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glViewport(0, 0, target.width, target.height);
+	glClearColor(target.clearColor.r, target.clearColor.g, target.clearColor.b, target.clearColor.a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	target.callback(time);
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+	if (bTimed)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		target.bTimerPending = true;
+	}
+
+	target.lastUpdateTime = time;
+	target.bHasContent = true;
+}
+
+/***********************************************************
+ *  UpdateTargets()
+ *
+ *  This method refreshes the targets that are due, most
+ *  overdue first, until the estimated GPU time of the frame
+ *  reaches the budget.  The most overdue visible target is
+ *  always refreshed so an expensive one cannot starve.
+ ***********************************************************/
+void RenderTargetManager::UpdateTargets(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3 viewPosition,
+	int viewportWidth,
+	int viewportHeight,
+	bool bForce)
+{
+	if (m_targets.empty())
+	{
+		return;
+	}
+
+	double now = GetTime();
+	glm::mat4 viewProjection = projection * view;
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(viewProjection);
+
+	// gather the visible targets that are due, with how late they are
+	m_dueTargets.clear();
+	for (size_t i = 0; i < m_targets.size(); i++)
+	{
+		RENDER_TARGET& target = m_targets[i];
+		CollectGPUTime(target);
+
+		double lateness = now - (target.lastUpdateTime + target.updateInterval);
+		if ((bForce == false) && (lateness < 0.0))
+		{
+			continue;
+		}
+		if (IsSurfaceVisible(target, frustum, viewProjection, viewPosition, viewportWidth, viewportHeight) == false)
+		{
+			continue;
+		}
+		m_dueTargets.push_back(std::make_pair(lateness, (int)i));
+	}
+
+	if (m_dueTargets.empty())
+	{
+		return;
+	}
+	std::sort(m_dueTargets.begin(), m_dueTargets.end(),
+		[](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4] = { 0, 0, 0, 0 };
+	GLfloat previousClearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+
+	float spentMilliseconds = 0.0f;
+	for (size_t i = 0; i < m_dueTargets.size(); i++)
+	{
+		RENDER_TARGET& target = m_targets[m_dueTargets[i].second];
+		if ((bForce == false) && (i > 0) &&
+			((spentMilliseconds + target.gpuMilliseconds) > m_frameBudgetMilliseconds))
+		{
+			// left for a later frame, where it will be further overdue
+			continue;
+		}
+
+		RenderTarget(target, now);
+		spentMilliseconds += target.gpuMilliseconds;
+	}
+
+	// restore the main view
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+	if (NULL != m_pShaderManager)
+	{
+		m_viewUniforms.Set(m_pShaderManager->m_programID, view, projection, viewPosition);
+	}
+}
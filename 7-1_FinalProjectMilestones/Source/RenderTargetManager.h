@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertargetmanager.h
+// ============
+// secondary views rendered into textures at their own refresh rates
+//
+// Each target owns a framebuffer whose color texture is sampled by the main
+// scene, for example on the monitor screen.  A target is refreshed only when
+// its update interval has passed, its display surface is inside the main
+// view and large enough on screen, and the frame's time budget allows it.
+// The GPU time of every update is measured with timer queries that are read
+// a frame or more later, so the budget never waits on the GPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+class RenderTargetManager
+{
+public:
+	// draws the content of a target; its framebuffer and viewport are
+	// bound and cleared, time is seconds since the manager was created
+	typedef std::function<void(double time)> RenderCallback;
+
+	// constructor - frameBudgetMilliseconds is the GPU time all targets
+	// together may use in one frame
+	RenderTargetManager(ShaderManager* pShaderManager, float frameBudgetMilliseconds);
+	// destructor
+	~RenderTargetManager();
+
+	// add a target refreshed updateRate times a second; returns its
+	// index, or -1 if the framebuffer could not be created
+	int CreateTarget(int width, int height, float updateRate, glm::vec4 clearColor, RenderCallback callback);
+	// the world space box the texture is displayed on and the direction
+	// its visible face points; targets without a surface always update
+	void SetTargetSurface(int target, const BoundingVolumes::BOX& bounds, glm::vec3 facing, float minScreenPixels);
+
+	uint32_t GetTextureID(int target) const;
+	// true once the target has been rendered at least once
+	bool HasContent(int target) const;
+
+	// refresh the due targets that are visible from the main view, then
+	// restore the main view's framebuffer, viewport and shader matrices;
+	// bForce ignores the update rates and the budget
+	void UpdateTargets(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3 viewPosition,
+		int viewportWidth,
+		int viewportHeight,
+		bool bForce);
+
+private:
+	struct RENDER_TARGET
+	{
+		GLuint framebuffer;
+		GLuint colorTexture;
+		GLuint depthBuffer;
+		int width;
+		int height;
+		glm::vec4 clearColor;
+		RenderCallback callback;
+		double updateInterval;
+		double lastUpdateTime;
+		bool bHasContent;
+
+		bool bHasSurface;
+		BoundingVolumes::BOX surfaceBounds;
+		glm::vec3 surfaceFacing;
+		float minScreenPixels;
+
+		// GPU time of the last measured update
+		GLuint timerQuery;
+		bool bTimerPending;
+		float gpuMilliseconds;
+	};
+
+	ShaderManager* m_pShaderManager;
+	// the camera uniforms of the shader manager's program
+	ViewUniforms m_viewUniforms;
+	float m_frameBudgetMilliseconds;
+	std::vector<RENDER_TARGET> m_targets;
+	// the visible targets that are due, with how late they are; kept
+	// between frames with room for every target
+	std::vector<std::pair<double, int> > m_dueTargets;
+	std::chrono::steady_clock::time_point m_startTime;
+
+	double GetTime() const;
+	// read a finished timer query without waiting for one in flight
+	void CollectGPUTime(RENDER_TARGET& target);
+	bool IsSurfaceVisible(
+		const RENDER_TARGET& target,
+		const BoundingVolumes::FRUSTUM& frustum,
+		const glm::mat4& viewProjection,
+		glm::vec3 viewPosition,
+		int viewportWidth,
+		int viewportHeight) const;
+	void RenderTarget(RENDER_TARGET& target, double time);
+};
@@ -8,6 +8,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "AllocationTracker.h"
+#include "PerfCounters.h"
+#include "StartupTimeline.h"
+#include "FrameArena.h"
+#include "SceneSystems.h"
+#include "SceneTables.h"
+#include "ShaderCompiler.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +23,168 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// the names of the lights in the scene shaders, the directional
+	// light first
+	const char* g_DirectionalLightName = "directionalLight";
+	const char* g_PointLightsName = "pointLights";
+
+	// a pick handle is the object in the high bits and the part in
+	// the low bits
+	const int PICK_PART_BITS = 16;
+
+	// placement of the monitor screen, shared by the scene table and
+	// the visibility test of its live texture
+	constexpr SceneTables::VEC3 SCREEN_SCALE = { 15.0f, 10.0f, 0.25f };
+	constexpr SceneTables::VEC3 SCREEN_POSITION = { 0.0f, 19.0f, -4.85f };
+	const glm::vec3 MONITOR_SCREEN_SCALE(SCREEN_SCALE.x, SCREEN_SCALE.y, SCREEN_SCALE.z);
+	const glm::vec3 MONITOR_SCREEN_POSITION(SCREEN_POSITION.x, SCREEN_POSITION.y, SCREEN_POSITION.z);
+
+	// the live monitor content is rendered at 20 Hz and skipped when
+	// the screen covers fewer pixels than this
+	const int MONITOR_TEXTURE_WIDTH = 600;
+	const int MONITOR_TEXTURE_HEIGHT = 400;
+	const float MONITOR_UPDATE_RATE = 20.0f;
+	const float MONITOR_MIN_SCREEN_PIXELS = 32.0f;
+	// GPU time per frame for all texture views together
+	const float RENDER_TARGET_BUDGET_MS = 2.0f;
+
+	// the image files of the scene's textures and their tags, in the
+	// order of their texture slots
+	struct SCENE_TEXTURE
+	{
+		const char* filename;
+		const char* tag;
+	};
+	const SCENE_TEXTURE SCENE_TEXTURES[] = {
+		{ "textures/wood_texture.jpg", "wood" },
+		{ "textures/black_wood_texture.jpg", "black_wood" },
+		{ "textures/black_brushed_metal_texture.jpg", "black_metal" },
+		{ "textures/snhu_one.jpg", "monitor_screen" },
+		{ "textures/white_texture.jpg", "white" } };
+	const int SCENE_TEXTURE_COUNT = sizeof(SCENE_TEXTURES) / sizeof(SCENE_TEXTURES[0]);
+
+	// local bounds of the basic meshes, indexed by MESH_TYPE
+	constexpr SceneTables::BOUNDS MESH_LOCAL_BOUNDS[] = {
+		{ { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } },    // MESH_BOX
+		{ { -1.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 1.0f } },     // MESH_PLANE
+		{ { -1.0f, 0.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } } };   // MESH_CYLINDER
+
+	glm::vec3 ToVec3(const SceneTables::VEC3& value)
+	{
+		return(glm::vec3(value.x, value.y, value.z));
+	}
+
+	// ---------- the office scene ----------
+	// scale, rotation (X, Y, Z degrees), position, mesh, material,
+	// texture, UV scale and pickable object of every basic shape
+	constexpr SceneTables::PART_DESC OFFICE_ROOM_PARTS[] = {
+		// the floor and the wall, both using the wood material and texture
+		{ { 20.0f, 1.0f, 15.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, SceneManager::MESH_PLANE, "woodMat", "wood", 1.0f, 1.0f, SceneManager::OBJECT_FLOOR },
+		// TODO: Change wall material and texture
+		{ { 20.0f, 1.0f, 20.0f }, { 90.0f, 0.0f, 0.0f }, { 0.0f, 15.0f, -15.0f }, SceneManager::MESH_PLANE, "woodMat", "wood", 1.0f, 1.0f, SceneManager::OBJECT_WALL },
+
+		// the desk tabletop
+		{ { 24.0f, 0.75f, 16.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 10.0f, 0.0f }, SceneManager::MESH_BOX, "blackWoodMat", "black_wood", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		// the left leg and its three pieces
+		{ { 1.25f, 10.0f, 1.25f }, { 0.0f, 0.0f, 0.0f }, { -9.0f, 5.0f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		{ { 1.25f, 1.25f, 1.25f }, { 0.0f, 0.0f, 0.0f }, { -8.0f, 9.0f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		{ { 1.25f, 0.5f, 12.0f }, { 0.0f, 0.0f, 0.0f }, { -8.0f, 9.5f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		{ { 1.25f, 0.5f, 12.0f }, { 0.0f, 0.0f, 0.0f }, { -9.0f, 0.25f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		// the right leg and its three pieces
+		{ { 1.25f, 10.0f, 1.25f }, { 0.0f, 0.0f, 0.0f }, { 9.0f, 5.0f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		{ { 1.25f, 1.25f, 1.25f }, { 0.0f, 0.0f, 0.0f }, { 8.0f, 9.0f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		{ { 1.25f, 0.5f, 12.0f }, { 0.0f, 0.0f, 0.0f }, { 8.0f, 9.5f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+		{ { 1.25f, 0.5f, 15.0f }, { 0.0f, 0.0f, 0.0f }, { 9.0f, 0.25f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_DESK },
+
+		// the monitor stand: lower flat base, upper base, arm and upper flat base
+		{ { 2.0f, 0.25f, 2.0f }, { 0.0f, 0.0f, 0.0f }, { -5.0f, 10.5f, -6.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MONITOR },
+		{ { 0.5f, 2.0f, 0.5f }, { 0.0f, 0.0f, 0.0f }, { -5.0f, 10.75f, -6.0f }, SceneManager::MESH_CYLINDER, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MONITOR },
+		{ { 0.5f, 6.0f, 0.5f }, { 0.0f, 0.0f, -30.0f }, { -5.0f, 12.5f, -6.0f }, SceneManager::MESH_CYLINDER, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MONITOR },
+		{ { 2.0f, 1.0f, 2.0f }, { 90.0f, 0.0f, 0.0f }, { -1.5f, 17.0f, -5.5f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MONITOR },
+		// the monitor housing and its screen; the screen texture is
+		// chosen every frame, this is the image shown until then
+		{ { 15.5f, 10.5f, 0.5f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 19.0f, -5.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MONITOR },
+		{ SCREEN_SCALE, { 0.0f, 0.0f, 0.0f }, SCREEN_POSITION, SceneManager::MESH_BOX, "monitorScreenMat", "monitor_screen", 1.0f, 1.0f, SceneManager::OBJECT_MONITOR },
+
+		// the keyboard base
+		{ { 10.0f, 0.25f, 4.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 10.5f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_KEYBOARD } };
+
+	// the keyboard keys, 6 rows of 17, half a unit apart
+	constexpr SceneTables::PART_DESC KEYBOARD_FIRST_KEY =
+		{ { 0.35f, 0.35f, 0.35f }, { 0.0f, 0.0f, 0.0f }, { -4.0f, 10.5f, -1.0f }, SceneManager::MESH_BOX, "whiteMat", "white", 1.0f, 1.0f, SceneManager::OBJECT_KEYBOARD };
+
+	constexpr SceneTables::PART_DESC OFFICE_MOUSE_PARTS[] = {
+		// the mouse base and hand rest
+		{ { 1.25f, 0.5f, 1.75f }, { 0.0f, 0.0f, 0.0f }, { 7.0f, 10.5f, 0.0f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MOUSE },
+		{ { 1.25f, 0.75f, 0.875f }, { 0.0f, 0.0f, 0.0f }, { 7.0f, 10.5f, 0.45f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MOUSE },
+		// the primary, secondary and middle buttons
+		{ { 0.5f, 0.75f, 0.75f }, { 0.0f, 0.0f, 0.0f }, { 6.7f, 10.5f, -0.45f }, SceneManager::MESH_BOX, "whiteMat", "white", 1.0f, 1.0f, SceneManager::OBJECT_MOUSE },
+		{ { 0.5f, 0.75f, 0.75f }, { 0.0f, 0.0f, 0.0f }, { 7.3f, 10.5f, -0.45f }, SceneManager::MESH_BOX, "whiteMat", "white", 1.0f, 1.0f, SceneManager::OBJECT_MOUSE },
+		{ { 0.05f, 1.00f, 0.6f }, { 0.0f, 0.0f, 0.0f }, { 7.0f, 10.5f, -0.45f }, SceneManager::MESH_BOX, "blackMetalMat", "black_metal", 1.0f, 1.0f, SceneManager::OBJECT_MOUSE } };
+
+	constexpr auto OFFICE_PARTS = SceneTables::Concatenate(
+		SceneTables::Concatenate(
+			SceneTables::ToArray(OFFICE_ROOM_PARTS),
+			SceneTables::MakeGrid<17, 6>(KEYBOARD_FIRST_KEY, 0.5f, 0.5f)),
+		SceneTables::ToArray(OFFICE_MOUSE_PARTS));
+
+	// the model matrices and world bounds; being constexpr, they are
+	// computed by the compiler and stored in the executable
+	constexpr auto OFFICE_BAKED = SceneTables::BakeTable(OFFICE_PARTS, MESH_LOCAL_BOUNDS);
+
+	// the meshes by the names used in the world chunk files
+	const WorldStreamer::MESH_INFO STREAMED_MESHES[] = {
+		{ "box", SceneManager::MESH_BOX, MESH_LOCAL_BOUNDS[SceneManager::MESH_BOX] },
+		{ "plane", SceneManager::MESH_PLANE, MESH_LOCAL_BOUNDS[SceneManager::MESH_PLANE] },
+		{ "cylinder", SceneManager::MESH_CYLINDER, MESH_LOCAL_BOUNDS[SceneManager::MESH_CYLINDER] } };
+
+	// the office floor written by WriteOfficeFloor() starts behind the
+	// initial camera, with the workstations in a regular grid
+	const float WORKSTATION_SPACING_X = 40.0f;
+	const float WORKSTATION_SPACING_Z = 30.0f;
+	const float WORKSTATION_FIRST_Z = 60.0f;
+
+	// a workstation is the office table without its room; the floor
+	// repeats it, and its impostor stands in for it in the distance
+	const char* g_WorkstationAssemblyName = "workstation";
+
+	bool IsWorkstationPart(const SceneTables::PART_DESC& part)
+	{
+		return((part.object != SceneManager::OBJECT_FLOOR) && (part.object != SceneManager::OBJECT_WALL));
+	}
+
+	MeshLibrary::MESH_ID ToMeshID(int mesh)
+	{
+		switch (mesh)
+		{
+		case SceneManager::MESH_PLANE:
+			return(MeshLibrary::MESH_PLANE);
+		case SceneManager::MESH_CYLINDER:
+			return(MeshLibrary::MESH_CYLINDER);
+		default:
+			return(MeshLibrary::MESH_BOX);
+		}
+	}
+
+	// the components of an entity that is drawn
+	EntityWorld::COMPONENT_MASK GetDrawMask()
+	{
+		return(
+			EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM) |
+			EntityWorld::MaskOf(EntityWorld::COMPONENT_MESH) |
+			EntityWorld::MaskOf(EntityWorld::COMPONENT_MATERIAL) |
+			EntityWorld::MaskOf(EntityWorld::COMPONENT_BOUNDS));
+	}
 }
 
 /***********************************************************
@@ -34,8 +195,45 @@ namespace
 SceneManager::SceneManager(ShaderManager* pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
 	m_loadedTextures = 0;  // Initialize texture counter
+	m_pRenderTargets = NULL;
+	m_monitorTarget = -1;
+	m_pMonitorVideo = NULL;
+	m_pDrawList = NULL;
+	m_drawObject = OBJECT_NONE;
+	m_drawObjectParts = 0;
+	m_pLayeredRenderer = NULL;
+	m_sceneUniforms.program = 0;
+	m_layeredUniforms.program = 0;
+	m_pickUniforms.program = 0;
+	m_pEntities = new EntityWorld();
+	m_pSystemWorkers = new WorkerPool();
+	m_pAssets = new AssetPipeline(*m_pSystemWorkers);
+	m_bLoadingStarted = false;
+	m_bSerialLoading = false;
+	m_pWorldStreamer = NULL;
+	m_collisionStreamVersion = 0;
+	m_pImpostors = NULL;
+	m_bGpuCulling = true;
+	m_pGpuCuller = NULL;
+	m_bDrawListBuilt = false;
+	m_culledStructureVersion = UINT64_MAX;
+	m_materialVersion = 0;
+	m_culledMaterialVersion = 0;
+	m_dynamicCulledStart = 0;
+	m_pointLightLimit = MAX_POINT_LIGHTS;
+	m_bVertexLighting = false;
+	m_lodBias = 1.0f;
+	m_vertexLitProgram = 0;
+	m_vertexLitShader.m_programID = 0;
+	m_vertexLitUniforms.program = 0;
+	m_bLightCostView = false;
+	m_lightCostProgram = 0;
+	m_frameCounters = {};
+	m_lightCostShader.m_programID = 0;
+	m_lightCostUniforms.program = 0;
+	m_monitorScreenEntity.index = 0;
+	m_monitorScreenEntity.generation = 0;
 }
 
 /***********************************************************
@@ -45,20 +243,77 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	ClearOverrides();
+	for (std::map<std::string, uint32_t>::iterator it = m_overrideTextureCache.begin(); it != m_overrideTextureCache.end(); ++it)
+	{
+		glDeleteTextures(1, &it->second);
+	}
+	m_overrideTextureCache.clear();
+
+	if (NULL != m_pMonitorVideo)
+	{
+		delete m_pMonitorVideo;
+		m_pMonitorVideo = NULL;
+	}
+	if (NULL != m_pRenderTargets)
+	{
+		delete m_pRenderTargets;
+		m_pRenderTargets = NULL;
+	}
+
+	if (NULL != m_pLayeredRenderer)
+	{
+		delete m_pLayeredRenderer;
+		m_pLayeredRenderer = NULL;
+	}
+	m_drawUniforms.Destroy();
+
+	if (NULL != m_pWorldStreamer)
+	{
+		delete m_pWorldStreamer;
+		m_pWorldStreamer = NULL;
+	}
+	if (NULL != m_pImpostors)
+	{
+		delete m_pImpostors;
+		m_pImpostors = NULL;
+	}
+	if (NULL != m_pGpuCuller)
+	{
+		delete m_pGpuCuller;
+		m_pGpuCuller = NULL;
+	}
+	if (m_vertexLitProgram != 0)
+	{
+		glDeleteProgram(m_vertexLitProgram);
+		m_vertexLitProgram = 0;
+	}
+	if (m_lightCostProgram != 0)
+	{
+		glDeleteProgram(m_lightCostProgram);
+		m_lightCostProgram = 0;
+	}
+	// the programs belong to this class, not the shader managers
+	m_vertexLitShader.m_programID = 0;
+	m_lightCostShader.m_programID = 0;
+	delete m_pAssets;
+	m_pAssets = NULL;
+	delete m_pSystemWorkers;
+	m_pSystemWorkers = NULL;
+	delete m_pEntities;
+	m_pEntities = NULL;
+
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
+	m_sceneMeshes.Destroy();
 }
 
 /***********************************************************
- *  CreateGLTexture()
+ *  LoadGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for loading textures from image files
+ *  on the calling thread.  It returns 0 on failure.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+uint32_t SceneManager::LoadGLTexture(const char* filename)
 {
 	int width = 0;
 	int height = 0;
@@ -81,47 +336,204 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	{
 		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		textureID = UploadGLTexture(image, width, height, colorChannels);
 
 		// free the image data from local memory
 		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
-		return true;
+		return textureID;
 	}
 
 	std::cout << "Could not load image:" << filename << std::endl;
 
 	// Error loading the image
-	return false;
+	return 0;
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for creating a texture from decoded
+ *  image data, configuring the texture mapping parameters in
+ *  OpenGL and generating the mipmaps.  It returns 0 on
+ *  failure.
+ ***********************************************************/
+uint32_t SceneManager::UploadGLTexture(const unsigned char* image, int width, int height, int colorChannels)
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// if the loaded image is in RGB format
+	if (colorChannels == 3)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	// if the loaded image is in RGBA format - it supports transparency
+	else if (colorChannels == 4)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+	else
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(1, &textureID);
+		return 0;
+	}
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	return textureID;
+}
+
+/***********************************************************
+ *  LoadGLTextureAsync()
+ *
+ *  This coroutine is used for loading a texture in the
+ *  background: the file is read on the IO thread, decoded
+ *  on the workers and uploaded on the GL thread, where the
+ *  task finishes.  Its result is 0 on failure.
+ ***********************************************************/
+AssetTask<uint32_t> SceneManager::LoadGLTextureAsync(std::string filename)
+{
+	co_await m_pAssets->ToIOThread();
+	double start = StartupTimeline::Now();
+	std::vector<unsigned char> contents;
+	bool bRead = AssetPipeline::ReadFile(filename.c_str(), contents);
+	StartupTimeline::AddSpan("read " + filename, start);
+
+	AssetPipeline::DECODED_IMAGE image = {};
+	if (bRead)
+	{
+		co_await m_pAssets->ToWorkers();
+		start = StartupTimeline::Now();
+		AssetPipeline::DecodeImage(contents, image);
+		StartupTimeline::AddSpan("decode " + filename, start);
+	}
+
+	co_await m_pAssets->ToGLThread();
+	uint32_t textureID = 0;
+	if (NULL != image.pixels)
+	{
+		std::cout << "Successfully loaded image:" << filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.channels << std::endl;
+		start = StartupTimeline::Now();
+		textureID = UploadGLTexture(image.pixels, image.width, image.height, image.channels);
+		StartupTimeline::AddSpan("upload " + filename, start);
+		AssetPipeline::FreeImage(image);
+	}
+	else
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+	}
+	co_return textureID;
+}
+
+/***********************************************************
+ *  LoadSceneTexturesAsync()
+ *
+ *  This coroutine is used for loading the textures of the
+ *  scene.  The loads all start at once and are joined in
+ *  order, so the texture slots do not depend on which load
+ *  finishes first.
+ ***********************************************************/
+AssetTask<bool> SceneManager::LoadSceneTexturesAsync()
+{
+	AssetTask<uint32_t> loads[SCENE_TEXTURE_COUNT];
+	for (int i = 0; i < SCENE_TEXTURE_COUNT; i++)
+	{
+		loads[i] = LoadGLTextureAsync(SCENE_TEXTURES[i].filename);
+	}
+
+	// every load finishes on the GL thread, so the registration
+	// below runs there as well
+	bool bLoaded = true;
+	for (int i = 0; i < SCENE_TEXTURE_COUNT; i++)
+	{
+		AssetTask<uint32_t>& load = loads[i];
+		uint32_t textureID = co_await load;
+		bLoaded = ((textureID != 0) && RegisterGLTexture(textureID, SCENE_TEXTURES[i].tag)) && bLoaded;
+	}
+	co_return bLoaded;
+}
+
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method is used for loading the textures of the
+ *  scene one after the other on the calling thread, which
+ *  reads, decodes and uploads each of them.
+ ***********************************************************/
+bool SceneManager::LoadSceneTextures()
+{
+	bool bLoaded = true;
+	for (int i = 0; i < SCENE_TEXTURE_COUNT; i++)
+	{
+		double start = StartupTimeline::Now();
+		bLoaded = CreateGLTexture(SCENE_TEXTURES[i].filename, SCENE_TEXTURES[i].tag) && bLoaded;
+		StartupTimeline::AddSpan(std::string("load ") + SCENE_TEXTURES[i].filename, start);
+	}
+	return(bLoaded);
+}
+
+/***********************************************************
+ *  GenerateMeshesAsync()
+ *
+ *  This coroutine is used for building the geometry of the
+ *  scene meshes on the workers.  It finishes there; the
+ *  meshes are uploaded by PrepareScene().
+ ***********************************************************/
+AssetTask<bool> SceneManager::GenerateMeshesAsync()
+{
+	co_await m_pAssets->ToWorkers();
+	double start = StartupTimeline::Now();
+	m_sceneMeshes.Generate();
+	StartupTimeline::AddSpan("generate meshes", start);
+	co_return true;
+}
+
+/***********************************************************
+ *  CreateGLTexture()
+ *
+ *  This method is used for loading a texture from an image
+ *  file into the next available texture slot in memory.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+{
+	GLuint textureID = LoadGLTexture(filename);
+	if (0 == textureID)
+	{
+		return false;
+	}
+
+	// register the loaded texture and associate it with the special tag string
+	return RegisterGLTexture(textureID, tag);
+}
+
+/***********************************************************
+ *  RegisterGLTexture()
+ *
+ *  This method is used for placing an existing texture into
+ *  the next available texture slot under the passed in tag.
+ ***********************************************************/
+bool SceneManager::RegisterGLTexture(uint32_t textureID, std::string tag)
+{
+	if (m_loadedTextures >= 16)
+	{
+		std::cout << "No free texture slot for " << tag << std::endl;
+		return false;
+	}
+
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].tag = tag;
+	m_loadedTextures++;
+
+	return true;
 }
 
 /***********************************************************
@@ -186,7 +598,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -239,11 +651,31 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a defined
+ *  material, or -1 when no material has the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const char* tag)
+{
+	for (size_t index = 0; index < m_objectMaterials.size(); index++)
+	{
+		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		{
+			return((int)index);
+		}
+	}
+
+	return(-1);
+}
+
 /***********************************************************
  *  SetTransformations()
  *
  *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  of the next recorded draw using the passed in
+ *  transformation values.
  ***********************************************************/
 void SceneManager::SetTransformations(
 	glm::vec3 scaleXYZ,
@@ -271,17 +703,15 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationZ * rotationY * rotationX * scale;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	// the matrix is sent to the shader when the draw list is submitted
+	m_drawState.model = modelView;
 }
 
 /***********************************************************
  *  SetShaderColor()
  *
  *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  for the next recorded draw command
  ***********************************************************/
 void SceneManager::SetShaderColor(
 	float redColorValue,
@@ -297,67 +727,73 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_drawState.textureSlot = -1;
+	m_drawState.bVideoTexture = false;
+	m_drawState.color = currentColor;
 }
 
 /***********************************************************
  *  SetShaderTexture()
  *
  *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  associated with the passed in tag for the next recorded
+ *  draw command.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	int textureID = -1;
+	textureID = FindTextureSlot(textureTag);
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	// the slot is resolved once here rather than for every view
+	m_drawState.textureSlot = textureID;
+	m_drawState.bVideoTexture = false;
+}
+
+/***********************************************************
+ *  SetShaderVideoTexture()
+ *
+ *  This method is used for drawing the next recorded draw
+ *  command with the current frame of the monitor video.
+ ***********************************************************/
+void SceneManager::SetShaderVideoTexture()
+{
+	m_drawState.bVideoTexture = (NULL != m_pMonitorVideo);
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  ApplyVideoTexture()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for setting the Y, U and V planes of
+ *  the monitor video into the program of the passed in
+ *  handles.  The video mode itself is a per-draw value.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::ApplyVideoTexture(const SCENE_UNIFORMS& uniforms)
 {
-	if (NULL != m_pShaderManager)
+	if (NULL != m_pMonitorVideo)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		uniforms.bVideoFullRange.Set(m_pMonitorVideo->IsFullRange());
+		uniforms.videoPlaneY.Set(SAMPLER_UNIT{ FindTextureSlot("video_y") });
+		uniforms.videoPlaneU.Set(SAMPLER_UNIT{ FindTextureSlot("video_u") });
+		uniforms.videoPlaneV.Set(SAMPLER_UNIT{ FindTextureSlot("video_v") });
 	}
 }
 
 /***********************************************************
  *  SetShaderMaterial()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for selecting the material of the
+ *  next recorded draw command.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
+	// an unknown tag keeps the previous material, as the shader
+	// uniforms did before the draw list
+	int materialIndex = FindMaterialIndex(materialTag);
+	if (materialIndex >= 0)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+		m_drawState.materialIndex = materialIndex;
 	}
 }
 
@@ -369,6 +805,26 @@ void SceneManager::SetShaderMaterial(
 /**************************************************************/
 
 
+/***********************************************************
+ *  StartLoading()
+ *
+ *  This method is used for starting the loads that need no
+ *  OpenGL context.  The file reads and the decoding run on
+ *  the loading threads at once, and the uploads wait in the
+ *  GL thread's queue until PrepareScene() runs it.
+ ***********************************************************/
+void SceneManager::StartLoading()
+{
+	if (m_bLoadingStarted || m_bSerialLoading)
+	{
+		return;
+	}
+
+	m_textureLoad = LoadSceneTexturesAsync();
+	m_meshGeneration = GenerateMeshesAsync();
+	m_bLoadingStarted = true;
+}
+
 /***********************************************************
  *  PrepareScene()
  *
@@ -378,130 +834,1671 @@ void SceneManager::SetShaderMaterial(
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
+	// the images are read and decoded in the background, unless
+	// StartLoading() already started them before the context existed
+	// or the scene is loaded on this thread
+	StartLoading();
+
+	// the uniform handles of the main program and the buffer of its
+	// per-draw block
+	m_drawUniforms.Create();
+	ResolveSceneUniforms(m_pShaderManager, m_sceneUniforms);
+
 	// Define materials for my objects
 	DefineObjectMaterials();
 
 	// Set up lighting before loading objects and textures
+	CreateLightEntities();
 	SetupSceneLights();
 
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	// in the rendered 3D scene, and all of them share one
+	// vertex array; the uploads of the decoded images run
+	// while the workers finish building them
+	double start = 0.0;
+	if (m_bSerialLoading)
+	{
+		start = StartupTimeline::Now();
+		m_sceneMeshes.Generate();
+		StartupTimeline::AddSpan("generate meshes", start);
+	}
+	else
+	{
+		m_pAssets->Wait(m_meshGeneration);
+	}
+	start = StartupTimeline::Now();
+	if (m_sceneMeshes.Load() == false)
+	{
+		std::cout << "Could not create the scene meshes" << std::endl;
+	}
+	StartupTimeline::AddSpan("upload meshes", start);
+
+	// upload the rest of the decoded images as they become ready
+	bool bTexturesLoaded = false;
+	if (m_bSerialLoading)
+	{
+		bTexturesLoaded = LoadSceneTextures();
+	}
+	else
+	{
+		start = StartupTimeline::Now();
+		bTexturesLoaded = m_pAssets->Wait(m_textureLoad);
+		StartupTimeline::AddSpan("wait for textures", start);
+	}
+	if (bTexturesLoaded == false)
+	{
+		std::cout << "WARNING: some scene textures could not be loaded" << std::endl;
+	}
 
-	// --- Load Textures ---
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadCylinderMesh();
+	// the monitor plays the requested video, decoded in the background
+	if (!m_monitorVideoFile.empty())
+	{
+		m_pMonitorVideo = new VideoTexture();
+		if (m_pMonitorVideo->Open(m_monitorVideoFile.c_str()))
+		{
+			RegisterGLTexture(m_pMonitorVideo->GetPlaneTexture(VideoTexture::PLANE_Y), "video_y");
+			RegisterGLTexture(m_pMonitorVideo->GetPlaneTexture(VideoTexture::PLANE_U), "video_u");
+			RegisterGLTexture(m_pMonitorVideo->GetPlaneTexture(VideoTexture::PLANE_V), "video_v");
+		}
+		else
+		{
+			delete m_pMonitorVideo;
+			m_pMonitorVideo = NULL;
+		}
+	}
 
-	// --- Load Textures ---
-	// Load the wood texture to be used for the wooden table.
-	CreateGLTexture("textures/wood_texture.jpg", "wood");
-	CreateGLTexture("textures/black_wood_texture.jpg", "black_wood");
-	CreateGLTexture("textures/black_brushed_metal_texture.jpg", "black_metal");
-	CreateGLTexture("textures/snhu_one.jpg", "monitor_screen");
-	CreateGLTexture("textures/white_texture.jpg", "white");
+	// otherwise it shows a live view rendered into a texture, with the
+	// static screen image as the fallback until its first update
+	m_pRenderTargets = new RenderTargetManager(m_pShaderManager, RENDER_TARGET_BUDGET_MS);
+	if (NULL == m_pMonitorVideo)
+	{
+		m_monitorTarget = m_pRenderTargets->CreateTarget(
+			MONITOR_TEXTURE_WIDTH, MONITOR_TEXTURE_HEIGHT, MONITOR_UPDATE_RATE,
+			glm::vec4(0.02f, 0.05f, 0.12f, 1.0f),
+			[this](double time) { RenderMonitorContent(time); });
+	}
+	if (m_monitorTarget >= 0)
+	{
+		glm::mat4 screenModel = glm::translate(MONITOR_SCREEN_POSITION) * glm::scale(MONITOR_SCREEN_SCALE);
+		m_pRenderTargets->SetTargetSurface(
+			m_monitorTarget,
+			BoundingVolumes::TransformUnitBox(screenModel),
+			glm::vec3(0.0f, 0.0f, 1.0f),
+			MONITOR_MIN_SCREEN_PIXELS);
+		RegisterGLTexture(m_pRenderTargets->GetTextureID(m_monitorTarget), "monitor_live");
+	}
 
 	BindGLTextures();
+
+	// the objects look up their textures, so they come after them
+	CreateSceneEntities();
+
+	// the layered program needs the same lights as the main one
+	m_pLayeredRenderer = new LayeredRenderer();
+	if (m_pLayeredRenderer->Initialize(
+		"shaders/layeredVertexShader.glsl",
+		"shaders/layeredGeometryShader.glsl",
+		"shaders/fragmentShader.glsl") &&
+		ResolveSceneUniforms(m_pLayeredRenderer->GetShaderManager(), m_layeredUniforms))
+	{
+		ShaderManager* pMainShader = m_pShaderManager;
+		m_pShaderManager = m_pLayeredRenderer->GetShaderManager();
+		m_pShaderManager->use();
+		SetupSceneLights();
+		m_pShaderManager = pMainShader;
+		m_pShaderManager->use();
+	}
+	else
+	{
+		delete m_pLayeredRenderer;
+		m_pLayeredRenderer = NULL;
+	}
+
+	// the streamed workstations fade into impostors in the distance
+	CreateImpostors();
+
+	// the main views are culled by a compute shader where supported
+	CreateGpuCuller();
+
+	// the lowest quality tier switches to the vertex lit program
+	CreateVertexLitProgram();
+	// and the light cost view to the one that counts the lighting work
+	CreateLightCostProgram();
 }
 
 /***********************************************************
- *  RenderScene()
+ *  UpdateRenderTargets()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method refreshes the live textures before the main
+ *  scene samples them.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::UpdateRenderTargets(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3 viewPosition,
+	int viewportWidth,
+	int viewportHeight,
+	bool bForceUpdate)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// ---------- Render the Plane (Floor) ----------
-	// Transform for the plane
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 15.0f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-
-	// Use the wood material and texture for the plane
-	SetShaderMaterial("woodMat"); // Material defined in DefineObjectMaterials()
-	SetShaderTexture("wood");     // Texture loaded with tag "wood"
+	if (NULL != m_pMonitorVideo)
+	{
+		m_pMonitorVideo->Update();
+	}
+	if (NULL != m_pRenderTargets)
+	{
+		m_pRenderTargets->UpdateTargets(view, projection, viewPosition, viewportWidth, viewportHeight, bForceUpdate);
+	}
+}
 
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawPlaneMesh();
-	// ---------------------------------------------
+/***********************************************************
+ *  SetMonitorVideo()
+ *
+ *  This method selects the video file that is opened by
+ *  PrepareScene() and played on the monitor screen.
+ ***********************************************************/
+void SceneManager::SetMonitorVideo(const char* filename)
+{
+	m_monitorVideoFile = (NULL != filename) ? filename : "";
+}
 
-	// ---------- Render the Plane (Wall) ----------
-	// Transform for the plane
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 20.0f);
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(0.0f, 15.0f, -15.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+/***********************************************************
+ *  CreateSceneEntities()
+ *
+ *  This method is used for creating the entities of the 3D
+ *  scene from the office table.  Their model matrices and
+ *  bounds were computed at compile time, so they are static
+ *  and the transform system never visits them.
+ ***********************************************************/
+void SceneManager::CreateSceneEntities()
+{
+	EntityWorld::COMPONENT_MASK partMask =
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_MESH) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_MATERIAL) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_BOUNDS) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_STATIC);
 
-	// TODO: Change wall material and texture
-	SetShaderMaterial("woodMat"); // Material defined in DefineObjectMaterials()
-	SetShaderTexture("wood");     // Texture loaded with tag "wood"
+	// the parts of each object are numbered in table order
+	uint32_t objectParts[OBJECT_COUNT] = {};
 
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawPlaneMesh();
-	// ---------------------------------------------
+	for (size_t i = 0; i < OFFICE_PARTS.size(); i++)
+	{
+		const SceneTables::PART_DESC& part = OFFICE_PARTS[i];
+		const SceneTables::BAKED_PART& baked = OFFICE_BAKED[i];
+		EntityWorld::ENTITY entity = m_pEntities->CreateEntity(partMask);
+
+		EntityWorld::TRANSFORM_COMPONENT* pTransform = m_pEntities->GetComponent<EntityWorld::TRANSFORM_COMPONENT>(entity);
+		pTransform->scale = ToVec3(part.scale);
+		pTransform->rotationDegrees = ToVec3(part.rotationDegrees);
+		pTransform->position = ToVec3(part.position);
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				pTransform->model[column][row] = baked.model[column * 4 + row];
+			}
+		}
 
-	// Render the desk
-	RenderDesk();
+		m_pEntities->GetComponent<EntityWorld::MESH_COMPONENT>(entity)->mesh = part.mesh;
 
-	// Render the monitor
-	RenderMonitor();
+		EntityWorld::MATERIAL_COMPONENT* pMaterial = m_pEntities->GetComponent<EntityWorld::MATERIAL_COMPONENT>(entity);
+		pMaterial->materialIndex = FindMaterialIndex(part.material);
+		pMaterial->textureSlot = FindTextureSlot(part.texture);
+		pMaterial->bVideoTexture = false;
+		pMaterial->color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		pMaterial->UVscale = glm::vec2(part.uScale, part.vScale);
+		pMaterial->pickID = 0;
+		if (part.object != OBJECT_NONE)
+		{
+			pMaterial->pickID = ((uint32_t)part.object << PICK_PART_BITS) | objectParts[part.object]++;
+		}
 
-	// Render the keyboard
-	RenderKeyboard();
+		EntityWorld::BOUNDS_COMPONENT* pBounds = m_pEntities->GetComponent<EntityWorld::BOUNDS_COMPONENT>(entity);
+		pBounds->local.minimum = ToVec3(MESH_LOCAL_BOUNDS[part.mesh].minimum);
+		pBounds->local.maximum = ToVec3(MESH_LOCAL_BOUNDS[part.mesh].maximum);
+		pBounds->world.minimum = ToVec3(baked.bounds.minimum);
+		pBounds->world.maximum = ToVec3(baked.bounds.maximum);
 
-	// Render the mouse
-	RenderMouse();
+		// the screen switches to the video or the live view later
+		if (strcmp(part.texture, "monitor_screen") == 0)
+		{
+			m_monitorScreenEntity = entity;
+		}
+	}
 }
 
-void SceneManager::SetupSceneLights()
+/***********************************************************
+ *  CreateImpostors()
+ *
+ *  This method is used for baking the impostor of the
+ *  workstation from the office table, drawn the way the
+ *  scene draws its parts, and for sending the scene lights
+ *  to the impostor program.
+ ***********************************************************/
+void SceneManager::CreateImpostors()
 {
-	// Enable custom lighting
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_pImpostors = new ImpostorRenderer();
+	if (m_pImpostors->Initialize(
+		&m_sceneMeshes,
+		"shaders/vertexShader.glsl",
+		"shaders/impostorBakeFragmentShader.glsl",
+		"shaders/impostorVertexShader.glsl",
+		"shaders/impostorFragmentShader.glsl") == false)
+	{
+		delete m_pImpostors;
+		m_pImpostors = NULL;
+		return;
+	}
 
-	// ------------------ Directional Light ------------------
-	// Global directional light (simulating sunlight)
-	m_pShaderManager->setVec3Value("directionalLight.direction", -0.2f, -1.0f, -0.3f);
-	// Lower ambient to soften overall brightness
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.1f, 0.1f, 0.1f);
-	// Moderate diffuse light for direct illumination
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.6f, 0.6f, 0.6f);
-	// Slightly reduced specular highlights
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+	std::vector<ImpostorRenderer::BAKE_PART> parts;
+	for (size_t i = 0; i < OFFICE_PARTS.size(); i++)
+	{
+		const SceneTables::PART_DESC& part = OFFICE_PARTS[i];
+		if (!IsWorkstationPart(part))
+		{
+			continue;
+		}
 
-	// ------------------ Point Light ------------------
-	// A point light to fill in shadowed areas
-	m_pShaderManager->setVec3Value("pointLights[0].position", 0.0f, 12.0f, 0.0f);
-	// Lower ambient contribution for the point light
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-	// Reduced diffuse intensity for softer lighting
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.6f, 0.6f, 0.6f);
-	// Reduced specular intensity
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+		ImpostorRenderer::BAKE_PART bakePart;
+		bakePart.mesh = ToMeshID(part.mesh);
+		bakePart.textureSlot = FindTextureSlot(part.texture);
+		bakePart.bounds.minimum = ToVec3(OFFICE_BAKED[i].bounds.minimum);
+		bakePart.bounds.maximum = ToVec3(OFFICE_BAKED[i].bounds.maximum);
 
-	// Deactivate any additional point lights (assuming 5 total)
-	for (int i = 1; i < 5; i++)
-	{
-		std::string uniformName = "pointLights[" + std::to_string(i) + "].bActive";
-		m_pShaderManager->setBoolValue(uniformName.c_str(), false);
+		DRAW_UNIFORMS& record = bakePart.uniforms;
+		record = {};
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				record.model[column][row] = OFFICE_BAKED[i].model[column * 4 + row];
+			}
+		}
+		record.objectColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		int materialIndex = FindMaterialIndex(part.material);
+		if (materialIndex >= 0)
+		{
+			record.diffuseColor = m_objectMaterials[materialIndex].diffuseColor;
+			record.specularColor = m_objectMaterials[materialIndex].specularColor;
+			record.shininess = m_objectMaterials[materialIndex].shininess;
+		}
+		record.UVscale = glm::vec2(part.uScale, part.vScale);
+		record.bUseTexture = (bakePart.textureSlot >= 0) ? 1 : 0;
+		parts.push_back(bakePart);
 	}
+	m_pImpostors->BakeAtlas(g_WorkstationAssemblyName, parts);
+
+	ResolveLightUniforms(m_pImpostors->GetProgram(), m_impostorLights);
+	glUseProgram(m_pImpostors->GetProgram());
+	SetLightUniforms(m_impostorLights);
+	m_pShaderManager->use();
 }
 
-void SceneManager::DefineObjectMaterials()
+/***********************************************************
+ *  CreateGpuCuller()
+ *
+ *  This method is used for building the programs that cull
+ *  and draw the draw list on the GPU, and for sending the
+ *  scene lights to the drawing program.
+ ***********************************************************/
+void SceneManager::CreateGpuCuller()
+{
+	if (m_bGpuCulling == false)
+	{
+		return;
+	}
+
+	m_pGpuCuller = new GpuCuller();
+	if (m_pGpuCuller->Initialize(
+		&m_sceneMeshes,
+		"shaders/cullComputeShader.glsl",
+		"shaders/indirectVertexShader.glsl",
+		"shaders/fragmentShader.glsl") == false)
+	{
+		delete m_pGpuCuller;
+		m_pGpuCuller = NULL;
+		return;
+	}
+
+	ResolveLightUniforms(m_pGpuCuller->GetProgram(), m_culledLights);
+	glUseProgram(m_pGpuCuller->GetProgram());
+	SetLightUniforms(m_culledLights);
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  BuildSceneProgram()
+ *
+ *  This method is used for building a variant of the scene
+ *  program from a vertex shader and the scene's fragment
+ *  shader compiled with the passed in defines, for looking
+ *  up its uniforms and for sending it the scene lights.
+ ***********************************************************/
+GLuint SceneManager::BuildSceneProgram(
+	const char* vertexShaderFile,
+	const char* fragmentDefines,
+	const char* name,
+	ShaderManager& shader,
+	SCENE_UNIFORMS& uniforms)
+{
+	GLuint program = 0;
+	GLuint vertexShader = ShaderCompiler::CompileShader(GL_VERTEX_SHADER, vertexShaderFile, "");
+	GLuint fragmentShader = ShaderCompiler::CompileShader(GL_FRAGMENT_SHADER, "shaders/fragmentShader.glsl", fragmentDefines);
+	if ((vertexShader != 0) && (fragmentShader != 0))
+	{
+		GLuint shaders[2] = { vertexShader, fragmentShader };
+		program = ShaderCompiler::LinkProgram(shaders, 2, name);
+	}
+	if (vertexShader != 0)
+	{
+		glDeleteShader(vertexShader);
+	}
+	if (fragmentShader != 0)
+	{
+		glDeleteShader(fragmentShader);
+	}
+	if (program == 0)
+	{
+		return(0);
+	}
+
+	shader.m_programID = program;
+	if (ResolveSceneUniforms(&shader, uniforms) == false)
+	{
+		glDeleteProgram(program);
+		shader.m_programID = 0;
+		uniforms.program = 0;
+		return(0);
+	}
+
+	glUseProgram(program);
+	uniforms.bUseLighting.Set(true);
+	SetLightUniforms(uniforms.lights);
+	m_pShaderManager->use();
+	return(program);
+}
+
+/***********************************************************
+ *  CreateVertexLitProgram()
+ *
+ *  This method is used for building the program that lights
+ *  the scene at the vertices, from its own vertex shader and
+ *  the scene's fragment shader with VERTEX_LIGHTING defined.
+ ***********************************************************/
+void SceneManager::CreateVertexLitProgram()
+{
+	m_vertexLitProgram = BuildSceneProgram(
+		"shaders/vertexLitVertexShader.glsl", "#define VERTEX_LIGHTING\n", "vertex lit",
+		m_vertexLitShader, m_vertexLitUniforms);
+	if (m_vertexLitProgram == 0)
+	{
+		std::cout << "WARNING: the vertex lit program is not available, every quality tier lights per pixel" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  CreateLightCostProgram()
+ *
+ *  This method is used for building the program of the light
+ *  cost view, the scene's shaders with LIGHT_COST defined,
+ *  whose fragments output how many lights they evaluated and
+ *  textures they fetched instead of their color.
+ ***********************************************************/
+void SceneManager::CreateLightCostProgram()
+{
+	m_lightCostProgram = BuildSceneProgram(
+		"shaders/vertexShader.glsl", "#define LIGHT_COST\n", "light cost",
+		m_lightCostShader, m_lightCostUniforms);
+	if (m_lightCostProgram == 0)
+	{
+		std::cout << "WARNING: the light cost program is not available" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  SetLightCostView()
+ *
+ *  This method is used for switching the main views to the
+ *  program of the light cost view and back.
+ ***********************************************************/
+bool SceneManager::SetLightCostView(bool bLightCostView)
+{
+	m_bLightCostView = bLightCostView && (m_lightCostProgram != 0);
+	return(m_bLightCostView == bLightCostView);
+}
+
+/***********************************************************
+ *  SetQualitySettings()
+ *
+ *  This method is used for applying a quality tier: the
+ *  number of point lights is sent again to every program
+ *  that lights the scene, the level of detail bias goes to
+ *  the GPU culling and the CPU path, the finest cylinder is
+ *  rebuilt with the sides of the tier, and the vertex lit
+ *  program replaces the others in the main views when the
+ *  tier asks for it.
+ ***********************************************************/
+void SceneManager::SetQualitySettings(const QualityTuner::QUALITY_SETTINGS& settings)
+{
+	m_pointLightLimit = std::clamp(settings.pointLights, 0, (int)MAX_POINT_LIGHTS);
+	m_bVertexLighting = settings.bVertexLighting && (m_vertexLitProgram != 0);
+	m_lodBias = settings.lodBias;
+	if (NULL != m_pGpuCuller)
+	{
+		m_pGpuCuller->SetLodBias(settings.lodBias);
+	}
+	m_sceneMeshes.SetCylinderSlices(settings.cylinderSlices);
+
+	m_pShaderManager->use();
+	SetLightUniforms(m_sceneUniforms.lights);
+	if (NULL != m_pLayeredRenderer)
+	{
+		glUseProgram(m_layeredUniforms.program);
+		SetLightUniforms(m_layeredUniforms.lights);
+	}
+	if (m_vertexLitProgram != 0)
+	{
+		glUseProgram(m_vertexLitProgram);
+		SetLightUniforms(m_vertexLitUniforms.lights);
+	}
+	if (m_lightCostProgram != 0)
+	{
+		glUseProgram(m_lightCostProgram);
+		SetLightUniforms(m_lightCostUniforms.lights);
+	}
+	if (NULL != m_pImpostors)
+	{
+		glUseProgram(m_pImpostors->GetProgram());
+		SetLightUniforms(m_impostorLights);
+	}
+	if (NULL != m_pGpuCuller)
+	{
+		glUseProgram(m_pGpuCuller->GetProgram());
+		SetLightUniforms(m_culledLights);
+	}
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  StartWorldStreaming()
+ *
+ *  This method is used for streaming the chunks of a world
+ *  index file into the entity world.  The parts of a chunk
+ *  use the materials and textures of the scene by tag.
+ ***********************************************************/
+bool SceneManager::StartWorldStreaming(const char* indexFile, size_t memoryBudget)
+{
+	if (NULL != m_pWorldStreamer)
+	{
+		delete m_pWorldStreamer;
+		m_pWorldStreamer = NULL;
+	}
+
+	m_pWorldStreamer = new WorldStreamer(
+		*m_pAssets,
+		*m_pEntities,
+		STREAMED_MESHES,
+		sizeof(STREAMED_MESHES) / sizeof(STREAMED_MESHES[0]),
+		[this](const WorldStreamer::CHUNK_PART& part, EntityWorld::MATERIAL_COMPONENT& material)
+		{
+			material.materialIndex = FindMaterialIndex(part.material.c_str());
+			material.textureSlot = FindTextureSlot(part.texture.c_str());
+		},
+		m_pImpostors,
+		memoryBudget);
+
+	if (m_pWorldStreamer->LoadIndex(indexFile) == false)
+	{
+		delete m_pWorldStreamer;
+		m_pWorldStreamer = NULL;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateWorldStreaming()
+ *
+ *  This method is used for loading and unloading the world
+ *  chunks around the camera, and for fading their assemblies
+ *  into their impostors with the distance.
+ ***********************************************************/
+void SceneManager::UpdateWorldStreaming(const glm::vec3& cameraPosition, const glm::vec3& cameraVelocity)
+{
+	if (NULL != m_pWorldStreamer)
+	{
+		m_pWorldStreamer->Update(cameraPosition, cameraVelocity);
+	}
+	if (NULL != m_pImpostors)
+	{
+		m_pImpostors->Update(cameraPosition);
+	}
+}
+
+/***********************************************************
+ *  SubmitImpostors()
+ *
+ *  This method is used for drawing the impostors of the
+ *  distant assemblies into the current view.
+ ***********************************************************/
+void SceneManager::SubmitImpostors(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (NULL != m_pImpostors)
+	{
+		m_pImpostors->Draw(view, projection);
+	}
+}
+
+/***********************************************************
+ *  WriteOfficeFloor()
+ *
+ *  This method is used for writing a floor of copies of the
+ *  office workstation, without its room, as world chunks of
+ *  two by two workstations on a floor tile each.  Every
+ *  workstation is an assembly that has an impostor.
+ ***********************************************************/
+bool SceneManager::WriteOfficeFloor(const char* indexFile, int columns, int rows)
+{
+	std::ofstream index(indexFile);
+	if (!index.is_open())
+	{
+		std::cout << "Could not create world index file:" << indexFile << std::endl;
+		return(false);
+	}
+	index << "# office floor of " << columns << "x" << rows << " workstations" << std::endl;
+
+	std::filesystem::path folder = std::filesystem::path(indexFile).parent_path();
+	const char* meshNames[] = { "box", "plane", "cylinder" };
+	int chunkCount = 0;
+
+	for (int chunkRow = 0; chunkRow * 2 < rows; chunkRow++)
+	{
+		for (int chunkColumn = 0; chunkColumn * 2 < columns; chunkColumn++)
+		{
+			std::string chunkName = "office_chunk_" + std::to_string(chunkColumn) + "_" + std::to_string(chunkRow) + ".txt";
+			std::ofstream chunkFile(folder / chunkName);
+			if (!chunkFile.is_open())
+			{
+				std::cout << "Could not create world chunk file:" << (folder / chunkName).string() << std::endl;
+				return(false);
+			}
+
+			// the floor tile covers the two by two workstations
+			glm::vec3 tileCenter(
+				(chunkColumn * 2 + 0.5f - (columns - 1) * 0.5f) * WORKSTATION_SPACING_X,
+				0.0f,
+				WORKSTATION_FIRST_Z + (chunkRow * 2 + 0.5f) * WORKSTATION_SPACING_Z);
+			SceneTables::PART_DESC tile = {
+				{ WORKSTATION_SPACING_X, 1.0f, WORKSTATION_SPACING_Z }, { 0.0f, 0.0f, 0.0f },
+				{ tileCenter.x, tileCenter.y, tileCenter.z }, MESH_PLANE, "woodMat", "wood", 4.0f, 3.0f, OBJECT_NONE };
+			chunkFile << WorldStreamer::FormatPartLine(tile, meshNames[MESH_PLANE]) << std::endl;
+			int partCount = 1;
+			int assemblyCount = 0;
+			std::string assemblies;
+			BoundingVolumes::BOX chunkBounds;
+			chunkBounds.minimum = tileCenter - glm::vec3(WORKSTATION_SPACING_X, 0.0f, WORKSTATION_SPACING_Z);
+			chunkBounds.maximum = tileCenter + glm::vec3(WORKSTATION_SPACING_X, 0.0f, WORKSTATION_SPACING_Z);
+
+			for (int row = chunkRow * 2; (row < chunkRow * 2 + 2) && (row < rows); row++)
+			{
+				for (int column = chunkColumn * 2; (column < chunkColumn * 2 + 2) && (column < columns); column++)
+				{
+					glm::vec3 offset(
+						(column - (columns - 1) * 0.5f) * WORKSTATION_SPACING_X,
+						0.0f,
+						WORKSTATION_FIRST_Z + row * WORKSTATION_SPACING_Z);
+					assemblies += WorldStreamer::FormatAssembly(g_WorkstationAssemblyName, offset);
+
+					for (size_t i = 0; i < OFFICE_PARTS.size(); i++)
+					{
+						SceneTables::PART_DESC part = OFFICE_PARTS[i];
+						if (!IsWorkstationPart(part))
+						{
+							continue;
+						}
+						part.position.x += offset.x;
+						part.position.y += offset.y;
+						part.position.z += offset.z;
+						chunkFile << WorldStreamer::FormatPartLine(part, meshNames[part.mesh], assemblyCount) << std::endl;
+						partCount++;
+
+						// a translation moves the baked bounds along
+						chunkBounds.minimum = glm::min(chunkBounds.minimum, ToVec3(OFFICE_BAKED[i].bounds.minimum) + offset);
+						chunkBounds.maximum = glm::max(chunkBounds.maximum, ToVec3(OFFICE_BAKED[i].bounds.maximum) + offset);
+					}
+					assemblyCount++;
+				}
+			}
+
+			index << WorldStreamer::FormatIndexLine(chunkName.c_str(), partCount, chunkBounds) << assemblies << std::endl;
+			chunkCount++;
+		}
+	}
+
+	std::cout << "INFO: Wrote " << columns * rows << " workstations in " << chunkCount << " world chunks to " << indexFile << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  BuildDrawList()
+ *
+ *  This method is used for running the entity systems once
+ *  per frame, no matter how many views draw the scene.  The
+ *  structural changes queued during the last frame are
+ *  applied first, then the transform system runs on the
+ *  worker threads.  With the GPU culling the objects stay
+ *  on the GPU and only their changes are uploaded; the draw
+ *  list is gathered when a pass culled on the CPU asks for
+ *  it.
+ ***********************************************************/
+void SceneManager::BuildDrawList()
+{
+	m_pEntities->PlaybackCommands();
+	SceneSystems::UpdateTransforms(*m_pEntities, m_pSystemWorkers);
+	UpdateMonitorScreen();
+
+	m_bDrawListBuilt = false;
+	if (NULL != m_pGpuCuller)
+	{
+		UpdateCulledObjects();
+		m_frameCounters.drawItems = (int)(m_culledObjects.size() + m_cpuDrawList.size());
+		return;
+	}
+
+	GatherDrawList();
+	m_frameCounters.drawItems = (int)m_sceneDrawList.size();
+}
+
+/***********************************************************
+ *  GatherDrawList()
+ *
+ *  This method is used for gathering the draw list from the
+ *  scene entities, sorted by render state, the first time
+ *  it is needed after BuildDrawList().  The parts of an
+ *  assembly whose impostor has taken over are left out.
+ ***********************************************************/
+void SceneManager::GatherDrawList()
+{
+	if (m_bDrawListBuilt)
+	{
+		return;
+	}
+	m_bDrawListBuilt = true;
+
+	m_sceneDrawList.clear();
+	m_pEntities->ForEachChunk(GetDrawMask(), [this](const EntityWorld::CHUNK_VIEW& chunk)
+		{
+			const EntityWorld::IMPOSTOR_COMPONENT* impostors = chunk.Get<EntityWorld::IMPOSTOR_COMPONENT>();
+			DRAW_ITEM item;
+			for (int i = 0; i < chunk.count; i++)
+			{
+				float impostorFade = 0.0f;
+				if ((NULL != impostors) && (NULL != m_pImpostors))
+				{
+					impostorFade = m_pImpostors->GetFade(impostors[i].instance);
+					if (impostorFade >= 1.0f)
+					{
+						continue;
+					}
+				}
+
+				ReadDrawItem(chunk, i, item);
+				item.impostorFade = impostorFade;
+				m_sceneDrawList.push_back(item);
+			}
+		});
+
+	SortDrawList(m_sceneDrawList);
+}
+
+/***********************************************************
+ *  ReadDrawItem()
+ *
+ *  This method is used for reading the draw of an entity
+ *  from the component arrays of its chunk.  The impostor
+ *  fade is left to the caller.
+ ***********************************************************/
+void SceneManager::ReadDrawItem(const EntityWorld::CHUNK_VIEW& chunk, int row, DRAW_ITEM& item)
+{
+	const EntityWorld::TRANSFORM_COMPONENT& transform = chunk.Get<EntityWorld::TRANSFORM_COMPONENT>()[row];
+	const EntityWorld::MESH_COMPONENT& mesh = chunk.Get<EntityWorld::MESH_COMPONENT>()[row];
+	const EntityWorld::MATERIAL_COMPONENT& material = chunk.Get<EntityWorld::MATERIAL_COMPONENT>()[row];
+	const EntityWorld::BOUNDS_COMPONENT& bounds = chunk.Get<EntityWorld::BOUNDS_COMPONENT>()[row];
+
+	item.model = transform.model;
+	item.bounds = bounds.world;
+	item.mesh = (MESH_TYPE)mesh.mesh;
+	item.materialIndex = material.materialIndex;
+	item.textureSlot = material.textureSlot;
+	item.bVideoTexture = material.bVideoTexture;
+	item.color = material.color;
+	item.UVscale = material.UVscale;
+	item.pickID = material.pickID;
+	item.impostorFade = 0.0f;
+	item.sortKey = GetSortKey(item);
+}
+
+/***********************************************************
+ *  UpdateCulledObjects()
+ *
+ *  This method is used for keeping the objects of the GPU
+ *  culling in step with the entities.  They are all handed
+ *  over again when entities were created, destroyed or
+ *  moved between chunks, or when the monitor screen changed
+ *  texture; otherwise only the drawables that are not
+ *  static are, whose transform system ran this frame.  The
+ *  fades of the impostors go up every frame, for the shader
+ *  to leave out the parts they have taken over.
+ ***********************************************************/
+void SceneManager::UpdateCulledObjects()
+{
+	if ((m_pEntities->GetStructureVersion() != m_culledStructureVersion) ||
+		(m_materialVersion != m_culledMaterialVersion))
+	{
+		UploadCulledObjects();
+	}
+	else if (m_dynamicCulledStart < (int)m_culledObjects.size())
+	{
+		UploadDynamicCulledObjects();
+	}
+
+	if (NULL != m_pImpostors)
+	{
+		const std::vector<float>& fades = m_pImpostors->GetFades();
+		m_pGpuCuller->SetImpostorFades(fades.data(), (int)fades.size());
+	}
+}
+
+/***********************************************************
+ *  UploadCulledObjects()
+ *
+ *  This method is used for handing every drawable entity to
+ *  the GPU culling: its record and its bounds.  The static
+ *  ones come first, so the others are one range that can be
+ *  written again on its own.  The video screen samples the
+ *  video planes, which the indirect draws do not bind, so it
+ *  is drawn on the CPU path.
+ ***********************************************************/
+void SceneManager::UploadCulledObjects()
+{
+	m_culledRecords.clear();
+	m_culledObjects.clear();
+	m_cpuDrawList.clear();
+
+	DRAW_UNIFORMS record = {};
+	EntityWorld::COMPONENT_MASK staticMask = EntityWorld::MaskOf(EntityWorld::COMPONENT_STATIC);
+	m_pEntities->ForEachChunk(GetDrawMask() | staticMask, [&](const EntityWorld::CHUNK_VIEW& chunk)
+		{
+			AppendCulledObjects(chunk, record);
+		});
+	m_dynamicCulledStart = (int)m_culledObjects.size();
+	m_pEntities->ForEachChunk(GetDrawMask(), [&](const EntityWorld::CHUNK_VIEW& chunk)
+		{
+			AppendCulledObjects(chunk, record);
+		}, staticMask);
+
+	m_pGpuCuller->SetObjects(m_culledRecords, m_culledObjects);
+	m_culledStructureVersion = m_pEntities->GetStructureVersion();
+	m_culledMaterialVersion = m_materialVersion;
+}
+
+/***********************************************************
+ *  AppendCulledObjects()
+ *
+ *  This method is used for adding the entities of a chunk
+ *  to the objects of the GPU culling, or to the items of the
+ *  CPU path for the video screen.  An object of an assembly
+ *  keeps the impostor instance whose fade hides it.
+ ***********************************************************/
+void SceneManager::AppendCulledObjects(const EntityWorld::CHUNK_VIEW& chunk, DRAW_UNIFORMS& record)
+{
+	const EntityWorld::IMPOSTOR_COMPONENT* impostors = chunk.Get<EntityWorld::IMPOSTOR_COMPONENT>();
+	DRAW_ITEM item;
+	for (int i = 0; i < chunk.count; i++)
+	{
+		ReadDrawItem(chunk, i, item);
+		if (item.bVideoTexture)
+		{
+			m_cpuDrawList.push_back(item);
+			continue;
+		}
+
+		FillDrawRecord(item, record);
+		m_culledRecords.push_back(record);
+
+		GpuCuller::CULL_OBJECT object = {};
+		object.minimum = glm::vec4(item.bounds.minimum, 1.0f);
+		object.maximum = glm::vec4(item.bounds.maximum, 1.0f);
+		object.mesh = (GLint)ToMeshID(item.mesh);
+		object.textureSlot = item.textureSlot;
+		object.impostor = ((NULL != impostors) && (NULL != m_pImpostors)) ? impostors[i].instance : -1;
+		m_culledObjects.push_back(object);
+	}
+}
+
+/***********************************************************
+ *  UploadDynamicCulledObjects()
+ *
+ *  This method is used for writing the records and bounds
+ *  of the drawables that are not static over their range of
+ *  the GPU objects.  The entities are in the same rows as
+ *  when the objects were handed over, so they are read in
+ *  the same order.
+ ***********************************************************/
+void SceneManager::UploadDynamicCulledObjects()
+{
+	int first = m_dynamicCulledStart;
+	int index = first;
+	m_pEntities->ForEachChunk(GetDrawMask(), [&](const EntityWorld::CHUNK_VIEW& chunk)
+		{
+			DRAW_ITEM item;
+			for (int i = 0; (i < chunk.count) && (index < (int)m_culledObjects.size()); i++)
+			{
+				ReadDrawItem(chunk, i, item);
+				if (item.bVideoTexture)
+				{
+					continue;
+				}
+
+				FillDrawRecord(item, m_culledRecords[index]);
+				m_culledObjects[index].minimum = glm::vec4(item.bounds.minimum, 1.0f);
+				m_culledObjects[index].maximum = glm::vec4(item.bounds.maximum, 1.0f);
+				index++;
+			}
+		}, EntityWorld::MaskOf(EntityWorld::COMPONENT_STATIC));
+
+	m_pGpuCuller->UpdateObjects(first, index - first, m_culledRecords.data() + first, m_culledObjects.data() + first);
+}
+
+/***********************************************************
+ *  SubmitDrawList()
+ *
+ *  This method is used for drawing the recorded scene into
+ *  the current view.
+ ***********************************************************/
+void SceneManager::SubmitDrawList(const glm::mat4& viewProjection)
+{
+	GatherDrawList();
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(viewProjection);
+	SubmitDrawItems(m_sceneDrawList, &frustum, 1, m_pShaderManager, 0);
+}
+
+/***********************************************************
+ *  SubmitDrawList()
+ *
+ *  This method is used for drawing the recorded scene into
+ *  the current view, culled and compacted into indirect
+ *  draws by the GPU when it can be.  The main thread then
+ *  only culls the few items left to the CPU path.
+ ***********************************************************/
+void SceneManager::SubmitDrawList(const glm::mat4& view, const glm::mat4& projection)
+{
+	// the light cost view and the vertex lit tier draw the whole list
+	// with their own program; the cost view measures the per pixel
+	// lighting even in the vertex lit tier
+	if (m_bLightCostView)
+	{
+		SubmitDrawListWith(&m_lightCostShader, m_lightCostUniforms, view, projection);
+		return;
+	}
+	if (m_bVertexLighting)
+	{
+		SubmitDrawListWith(&m_vertexLitShader, m_vertexLitUniforms, view, projection);
+		return;
+	}
+
+	if (NULL == m_pGpuCuller)
+	{
+		SubmitDrawItems(m_sceneDrawList, view, projection);
+		return;
+	}
+
+	m_pGpuCuller->Draw(view, projection);
+	m_frameCounters.drawCalls++;
+	m_frameCounters.gpuCulledObjects += (int)m_culledObjects.size();
+	SubmitDrawItems(m_cpuDrawList, view, projection);
+}
+
+/***********************************************************
+ *  SubmitDrawListWith()
+ *
+ *  This method is used for drawing the recorded scene into
+ *  the current view with a variant of the scene program,
+ *  which gets the view's matrices here, culled and its
+ *  levels of detail chosen on the CPU.
+ ***********************************************************/
+void SceneManager::SubmitDrawListWith(ShaderManager* pShader, const SCENE_UNIFORMS& uniforms, const glm::mat4& view, const glm::mat4& projection)
+{
+	GatherDrawList();
+	pShader->use();
+	uniforms.view.Set(view);
+	uniforms.projection.Set(projection);
+	uniforms.viewPosition.Set(glm::vec3(glm::inverse(view)[3]));
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(projection * view);
+	LOD_VIEW lodView = GetLodView(view, projection);
+	SubmitDrawItems(m_sceneDrawList, &frustum, 1, pShader, 0, &lodView);
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene into a
+ *  single view by recording and submitting the draw list.
+ ***********************************************************/
+void SceneManager::RenderScene(const glm::mat4& viewProjection)
+{
+	AllocationTracker::BeginScope("RenderScene");
+	BuildDrawList();
+	SubmitDrawList(viewProjection);
+	AllocationTracker::EndScope();
+}
+
+/***********************************************************
+ *  SubmitDrawListLayered()
+ *
+ *  This method is used for drawing the recorded scene into
+ *  several views with a single submission.  Every item that
+ *  any view can see is drawn once, instanced per view; the
+ *  viewports or the layered framebuffer must be bound.
+ ***********************************************************/
+bool SceneManager::SubmitDrawListLayered(const std::vector<LayeredRenderer::LAYERED_VIEW>& views)
+{
+	if ((NULL == m_pLayeredRenderer) || (m_pLayeredRenderer->Begin(views) == false))
+	{
+		return(false);
+	}
+	GatherDrawList();
+
+	// the planes are only needed for this submission
+	BoundingVolumes::FRUSTUM* frustums = FrameArena::GetThreadArena().AllocateArray<BoundingVolumes::FRUSTUM>(views.size());
+	for (size_t i = 0; i < views.size(); i++)
+	{
+		frustums[i] = BoundingVolumes::ExtractFrustum(views[i].projection * views[i].view);
+	}
+
+	SubmitDrawItems(m_sceneDrawList, frustums, (int)views.size(), m_pLayeredRenderer->GetShaderManager(), m_pLayeredRenderer->GetViewCount());
+
+	m_pLayeredRenderer->End();
+	return(true);
+}
+
+/***********************************************************
+ *  TakeFrameCounters()
+ *
+ *  This method is used for handing out the work counted
+ *  since the last call and starting the counts over.  The
+ *  size of the draw list is kept until it is built again.
+ ***********************************************************/
+SceneManager::FRAME_COUNTERS SceneManager::TakeFrameCounters()
+{
+	FRAME_COUNTERS counters = m_frameCounters;
+	m_frameCounters = {};
+	m_frameCounters.drawItems = counters.drawItems;
+	return(counters);
+}
+
+/***********************************************************
+ *  SubmitPickDrawList()
+ *
+ *  This method is used for drawing the pickable items of
+ *  the recorded scene that are inside the pick frustum.  Only
+ *  the model matrix and the pick handle are set per draw.
+ ***********************************************************/
+void SceneManager::SubmitPickDrawList(const glm::mat4& viewProjection, ShaderManager* pPickShader)
+{
+	if (NULL == pPickShader)
+	{
+		return;
+	}
+
+	// the picker builds its program after the scene, so its handles
+	// are looked up on first use
+	if (m_pickUniforms.program != pPickShader->m_programID)
+	{
+		m_pickUniforms.program = pPickShader->m_programID;
+		m_pickUniforms.model.Resolve(m_pickUniforms.program, "model");
+		m_pickUniforms.pickID.Resolve(m_pickUniforms.program, "pickID");
+	}
+
+	GatherDrawList();
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(viewProjection);
+	m_sceneMeshes.Bind();
+
+	for (size_t i = 0; i < m_sceneDrawList.size(); i++)
+	{
+		const DRAW_ITEM& item = m_sceneDrawList[i];
+		if ((item.pickID == 0) || (BoundingVolumes::IsBoxVisible(frustum, item.bounds) == false))
+		{
+			continue;
+		}
+
+		m_pickUniforms.model.Set(item.model);
+		m_pickUniforms.pickID.Set((int)item.pickID);
+		m_sceneMeshes.Draw(ToMeshID(item.mesh), 1);
+	}
+}
+
+/***********************************************************
+ *  BuildCollisionWorld()
+ *
+ *  This method is used for turning every object of the scene
+ *  into a collider made of the triangles of its mesh.
+ ***********************************************************/
+void SceneManager::BuildCollisionWorld(CollisionWorld& world)
+{
+	for (int i = 0; i < MeshLibrary::MESH_COUNT; i++)
+	{
+		MeshLibrary::BuildGeometry((MeshLibrary::MESH_ID)i, m_collisionVertices[i], m_collisionIndices[i]);
+	}
+
+	// places the objects
+	BuildDrawList();
+	FillCollisionWorld(world);
+
+	std::cout << "INFO: Collision world has " << world.GetColliderCount() << " colliders with "
+		<< world.GetTriangleCount() << " triangles" << std::endl;
+}
+
+/***********************************************************
+ *  UpdateCollisionWorld()
+ *
+ *  This method is used for building the collision world
+ *  again after the world streamer has installed or removed
+ *  a chunk, so the camera collides with what is loaded.
+ *  Chunks change every few seconds at most, so the whole
+ *  hierarchy is rebuilt rather than refitted.
+ ***********************************************************/
+void SceneManager::UpdateCollisionWorld(CollisionWorld& world)
+{
+	if ((NULL == m_pWorldStreamer) || (m_pWorldStreamer->GetResidentVersion() == m_collisionStreamVersion))
+	{
+		return;
+	}
+
+	FillCollisionWorld(world);
+}
+
+/***********************************************************
+ *  FillCollisionWorld()
+ *
+ *  This method is used for adding a collider for every
+ *  entity that is drawn.  The entities are read directly
+ *  rather than through the draw list, which leaves out the
+ *  parts hidden behind their impostors.
+ ***********************************************************/
+void SceneManager::FillCollisionWorld(CollisionWorld& world)
+{
+	world.Clear();
+	m_pEntities->ForEachChunk(GetDrawMask(), [this, &world](const EntityWorld::CHUNK_VIEW& chunk)
+		{
+			const EntityWorld::TRANSFORM_COMPONENT* transforms = chunk.Get<EntityWorld::TRANSFORM_COMPONENT>();
+			const EntityWorld::MESH_COMPONENT* meshes = chunk.Get<EntityWorld::MESH_COMPONENT>();
+			for (int i = 0; i < chunk.count; i++)
+			{
+				int mesh = MeshLibrary::MESH_BOX;
+				if (meshes[i].mesh == MESH_PLANE)
+				{
+					mesh = MeshLibrary::MESH_PLANE;
+				}
+				else if (meshes[i].mesh == MESH_CYLINDER)
+				{
+					mesh = MeshLibrary::MESH_CYLINDER;
+				}
+
+				world.AddMesh(
+					m_collisionVertices[mesh].data(),
+					(int)(m_collisionVertices[mesh].size() / MeshLibrary::VERTEX_FLOATS),
+					MeshLibrary::VERTEX_FLOATS,
+					m_collisionIndices[mesh].data(),
+					(int)m_collisionIndices[mesh].size(),
+					transforms[i].model);
+			}
+		});
+	world.Build();
+
+	if (NULL != m_pWorldStreamer)
+	{
+		m_collisionStreamVersion = m_pWorldStreamer->GetResidentVersion();
+	}
+}
+
+/***********************************************************
+ *  GetPickObject()
+ *
+ *  This method is used for getting the object of a pick
+ *  handle.
+ ***********************************************************/
+SceneManager::SCENE_OBJECT SceneManager::GetPickObject(uint32_t pickID)
+{
+	uint32_t object = pickID >> PICK_PART_BITS;
+	if (object >= (uint32_t)OBJECT_COUNT)
+	{
+		return(OBJECT_NONE);
+	}
+	return((SCENE_OBJECT)object);
+}
+
+/***********************************************************
+ *  GetPickPart()
+ *
+ *  This method is used for getting the part of a pick
+ *  handle, the index of the draw within its object.
+ ***********************************************************/
+int SceneManager::GetPickPart(uint32_t pickID)
+{
+	return((int)(pickID & ((1u << PICK_PART_BITS) - 1)));
+}
+
+/***********************************************************
+ *  GetObjectName()
+ *
+ *  This method is used for getting a printable name of a
+ *  scene object.
+ ***********************************************************/
+const char* SceneManager::GetObjectName(SCENE_OBJECT object)
+{
+	switch (object)
+	{
+	case OBJECT_FLOOR:
+		return("floor");
+	case OBJECT_WALL:
+		return("wall");
+	case OBJECT_DESK:
+		return("desk");
+	case OBJECT_MONITOR:
+		return("monitor");
+	case OBJECT_KEYBOARD:
+		return("keyboard");
+	case OBJECT_MOUSE:
+		return("mouse");
+	default:
+		return("nothing");
+	}
+}
+
+/***********************************************************
+ *  BeginDrawList()
+ *
+ *  This method is used for starting to record draw commands
+ *  into the passed in list with a default draw state.
+ ***********************************************************/
+void SceneManager::BeginDrawList(std::vector<DRAW_ITEM>& drawList)
+{
+	drawList.clear();
+	m_pDrawList = &drawList;
+	ResetDrawState();
+}
+
+/***********************************************************
+ *  ResetDrawState()
+ *
+ *  This method is used for restoring the default draw state
+ *  before a list or the scene entities are recorded.
+ ***********************************************************/
+void SceneManager::ResetDrawState()
+{
+	m_drawState.model = glm::mat4(1.0f);
+	m_drawState.mesh = MESH_BOX;
+	m_drawState.materialIndex = -1;
+	m_drawState.textureSlot = -1;
+	m_drawState.bVideoTexture = false;
+	m_drawState.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	m_drawState.UVscale = glm::vec2(1.0f, 1.0f);
+	m_drawState.sortKey = 0;
+	m_drawState.pickID = 0;
+	m_drawState.impostorFade = 0.0f;
+	m_drawObject = OBJECT_NONE;
+	m_drawObjectParts = 0;
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for recording a draw of one of the
+ *  basic meshes with the current draw state.  The world
+ *  bounds used for culling are computed here, once.
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE mesh)
+{
+	if (NULL == m_pDrawList)
+	{
+		return;
+	}
+
+	BoundingVolumes::BOX localBounds;
+	localBounds.minimum = ToVec3(MESH_LOCAL_BOUNDS[mesh].minimum);
+	localBounds.maximum = ToVec3(MESH_LOCAL_BOUNDS[mesh].maximum);
+
+	DRAW_ITEM item = m_drawState;
+	item.mesh = mesh;
+	item.bounds = BoundingVolumes::TransformBox(localBounds, item.model);
+	item.sortKey = GetSortKey(item);
+
+	item.pickID = 0;
+	if (m_drawObject != OBJECT_NONE)
+	{
+		item.pickID = ((uint32_t)m_drawObject << PICK_PART_BITS) | m_drawObjectParts;
+		m_drawObjectParts++;
+	}
+
+	m_pDrawList->push_back(item);
+}
+
+/***********************************************************
+ *  GetSortKey()
+ *
+ *  This method is used for computing the key that orders a
+ *  draw by render state.
+ ***********************************************************/
+uint32_t SceneManager::GetSortKey(const DRAW_ITEM& item)
+{
+	// group by texture first, then material, then mesh; solid colors
+	// and the video sort after the textured draws
+	uint32_t textureKey = item.bVideoTexture ? 0xFE : ((item.textureSlot < 0) ? 0xFF : (uint32_t)item.textureSlot);
+	uint32_t materialKey = (uint32_t)(item.materialIndex + 1) & 0xFF;
+	return((textureKey << 16) | (materialKey << 8) | (uint32_t)item.mesh);
+}
+
+/***********************************************************
+ *  SortDrawList()
+ *
+ *  This method is used for ordering the recorded draws by
+ *  render state.  The sort is stable so draws that share a
+ *  state keep their recorded order.
+ ***********************************************************/
+void SceneManager::SortDrawList(std::vector<DRAW_ITEM>& drawList)
+{
+	std::stable_sort(drawList.begin(), drawList.end(),
+		[](const DRAW_ITEM& a, const DRAW_ITEM& b) { return a.sortKey < b.sortKey; });
+	m_pDrawList = NULL;
+}
+
+/***********************************************************
+ *  SubmitDrawItems()
+ *
+ *  This method is used for drawing the items of a list that
+ *  are inside the view frustum, at the levels of detail of
+ *  the quality tier for the view.
+ ***********************************************************/
+void SceneManager::SubmitDrawItems(const std::vector<DRAW_ITEM>& drawList, const glm::mat4& view, const glm::mat4& projection)
+{
+	BoundingVolumes::FRUSTUM frustum = BoundingVolumes::ExtractFrustum(projection * view);
+	LOD_VIEW lodView = GetLodView(view, projection);
+	SubmitDrawItems(drawList, &frustum, 1, m_pShaderManager, 0, &lodView);
+}
+
+/***********************************************************
+ *  SubmitDrawItems()
+ *
+ *  This method is used for drawing the items of a list that
+ *  are inside any of the view frustums with the passed in
+ *  shader.  The per-draw values go through the DrawUniforms
+ *  block, uploaded once for the whole list.  A
+ *  layeredViewCount above zero draws every item instanced
+ *  once per view.  The vertex array of the meshes is bound
+ *  once for the whole list.  With a view for the levels of
+ *  detail the meshes are drawn at the level chosen for it,
+ *  otherwise at their finest.
+ ***********************************************************/
+void SceneManager::SubmitDrawItems(
+	const std::vector<DRAW_ITEM>& drawList,
+	const BoundingVolumes::FRUSTUM* frustums,
+	int frustumCount,
+	ShaderManager* pShader,
+	int layeredViewCount,
+	const LOD_VIEW* pLodView)
+{
+	if (NULL == pShader)
+	{
+		return;
+	}
+
+	PerfCounters::BeginScope("SubmitDrawItems");
+	const SCENE_UNIFORMS& uniforms = GetSceneUniforms(pShader);
+
+	// the per-draw values of every visible item are written into the
+	// block records first and uploaded in one call; a draw then only
+	// selects its record, and sets the sampler when the texture changes
+	FrameArena& arena = FrameArena::GetThreadArena();
+	const DRAW_ITEM** visibleItems = arena.AllocateArray<const DRAW_ITEM*>(drawList.size());
+	int visibleCount = 0;
+
+	// a draw without a material keeps the previous one, as the shader
+	// uniforms did before the block
+	DRAW_UNIFORMS record = {};
+	m_drawUniforms.Begin();
+	for (size_t i = 0; i < drawList.size(); i++)
+	{
+		const DRAW_ITEM& item = drawList[i];
+		bool bVisible = false;
+		for (int j = 0; (j < frustumCount) && !bVisible; j++)
+		{
+			bVisible = BoundingVolumes::IsBoxVisible(frustums[j], item.bounds);
+		}
+		if (bVisible == false)
+		{
+			continue;
+		}
+
+		FillDrawRecord(item, record);
+		m_drawUniforms.Append(record);
+		visibleItems[visibleCount++] = &item;
+	}
+	m_drawUniforms.Upload();
+
+	int instanceCount = std::max(layeredViewCount, 1);
+	m_sceneMeshes.Bind();
+
+	// the texture of the previous draw; the first draw sets it
+	bool bFirst = true;
+	int lastTexture = -1;
+	bool bLastVideo = false;
+
+	for (int i = 0; i < visibleCount; i++)
+	{
+		const DRAW_ITEM& item = *visibleItems[i];
+		m_drawUniforms.Bind(i);
+
+		if (item.bVideoTexture)
+		{
+			if (bFirst || !bLastVideo)
+			{
+				ApplyVideoTexture(uniforms);
+			}
+		}
+		else if ((item.textureSlot >= 0) && (bFirst || (item.textureSlot != lastTexture)))
+		{
+			uniforms.objectTexture.Set(SAMPLER_UNIT{ item.textureSlot });
+			lastTexture = item.textureSlot;
+		}
+		bLastVideo = item.bVideoTexture;
+		bFirst = false;
+
+		int lod = (NULL != pLodView) ? SelectLod(item, *pLodView) : 0;
+		m_sceneMeshes.Draw(ToMeshID(item.mesh), instanceCount, lod);
+		m_frameCounters.triangles += m_sceneMeshes.GetRange(ToMeshID(item.mesh), lod).indexCount / 3 * instanceCount;
+	}
+	m_frameCounters.drawCalls += visibleCount;
+	m_frameCounters.cpuVisibleItems += visibleCount;
+	m_frameCounters.cpuCulledItems += (int)drawList.size() - visibleCount;
+	PerfCounters::EndScope();
+}
+
+/***********************************************************
+ *  GetLodView()
+ *
+ *  This method is used for getting what the levels of
+ *  detail are chosen from out of a view's matrices.
+ ***********************************************************/
+SceneManager::LOD_VIEW SceneManager::GetLodView(const glm::mat4& view, const glm::mat4& projection)
+{
+	LOD_VIEW lodView;
+	lodView.position = glm::vec3(glm::inverse(view)[3]);
+	lodView.projectionScale = projection[1][1];
+	lodView.bOrthographic = (projection[3][3] == 1.0f);
+	return(lodView);
+}
+
+/***********************************************************
+ *  SelectLod()
+ *
+ *  This method is used for choosing the level of detail of
+ *  an item's mesh as the culling shader does: from the
+ *  fraction of the viewport height its bounding sphere
+ *  covers, with the bias of the quality tier.
+ ***********************************************************/
+int SceneManager::SelectLod(const DRAW_ITEM& item, const LOD_VIEW& lodView) const
+{
+	glm::vec3 center = (item.bounds.minimum + item.bounds.maximum) * 0.5f;
+	float radius = glm::length(item.bounds.maximum - item.bounds.minimum) * 0.5f;
+	float size = radius * lodView.projectionScale;
+	if (lodView.bOrthographic == false)
+	{
+		size /= std::max(glm::distance(lodView.position, center), radius);
+	}
+	return(MeshLibrary::SelectLod(ToMeshID(item.mesh), size, m_lodBias));
+}
+
+/***********************************************************
+ *  FillDrawRecord()
+ *
+ *  This method is used for writing the per-draw values of
+ *  an item into its DrawUniforms record.
+ ***********************************************************/
+void SceneManager::FillDrawRecord(const DRAW_ITEM& item, DRAW_UNIFORMS& record) const
+{
+	record.model = item.model;
+	if (item.materialIndex >= 0)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[item.materialIndex];
+		record.diffuseColor = material.diffuseColor;
+		record.specularColor = material.specularColor;
+		record.shininess = material.shininess;
+	}
+	record.objectColor = item.color;
+	record.UVscale = item.UVscale;
+	record.bUseTexture = (item.bVideoTexture || (item.textureSlot >= 0)) ? 1 : 0;
+	record.bUseVideoTexture = item.bVideoTexture ? 1 : 0;
+	record.impostorFade = item.impostorFade;
+}
+
+/***********************************************************
+ *  CreateLightEntities()
+ *
+ *  This method is used for creating the light sources of the
+ *  scene as entities with a transform and a light component.
+ ***********************************************************/
+void SceneManager::CreateLightEntities()
+{
+	EntityWorld::COMPONENT_MASK lightMask =
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_LIGHT);
+
+	// ------------------ Directional Light ------------------
+	// Global directional light (simulating sunlight)
+	EntityWorld::ENTITY sun = m_pEntities->CreateEntity(lightMask);
+	m_pEntities->GetComponent<EntityWorld::TRANSFORM_COMPONENT>(sun)->scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	EntityWorld::LIGHT_COMPONENT* pLight = m_pEntities->GetComponent<EntityWorld::LIGHT_COMPONENT>(sun);
+	pLight->type = EntityWorld::LIGHT_DIRECTIONAL;
+	pLight->direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+	// Lower ambient to soften overall brightness
+	pLight->ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+	// Moderate diffuse light for direct illumination
+	pLight->diffuse = glm::vec3(0.6f, 0.6f, 0.6f);
+	// Slightly reduced specular highlights
+	pLight->specular = glm::vec3(0.8f, 0.8f, 0.8f);
+
+	// ------------------ Point Light ------------------
+	// A point light to fill in shadowed areas
+	EntityWorld::ENTITY fill = m_pEntities->CreateEntity(lightMask);
+	EntityWorld::TRANSFORM_COMPONENT* pTransform = m_pEntities->GetComponent<EntityWorld::TRANSFORM_COMPONENT>(fill);
+	pTransform->scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	pTransform->position = glm::vec3(0.0f, 12.0f, 0.0f);
+	pLight = m_pEntities->GetComponent<EntityWorld::LIGHT_COMPONENT>(fill);
+	pLight->type = EntityWorld::LIGHT_POINT;
+	// Lower ambient contribution for the point light
+	pLight->ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+	// Reduced diffuse intensity for softer lighting
+	pLight->diffuse = glm::vec3(0.6f, 0.6f, 0.6f);
+	// Reduced specular intensity
+	pLight->specular = glm::vec3(0.8f, 0.8f, 0.8f);
+
+	// ------------------ Accent Lights ------------------
+	// Dim point lights at the corners of the desk area that add
+	// highlights from the sides.  They follow the fill light, so the
+	// lower quality tiers, which use fewer point lights, drop these
+	// first and keep the fill light
+	const glm::vec3 accentPositions[] = {
+		glm::vec3(-8.0f, 6.0f, 8.0f),
+		glm::vec3(8.0f, 6.0f, 8.0f),
+		glm::vec3(-8.0f, 6.0f, -8.0f),
+		glm::vec3(8.0f, 6.0f, -8.0f) };
+	for (const glm::vec3& position : accentPositions)
+	{
+		EntityWorld::ENTITY accent = m_pEntities->CreateEntity(lightMask);
+		pTransform = m_pEntities->GetComponent<EntityWorld::TRANSFORM_COMPONENT>(accent);
+		pTransform->scale = glm::vec3(1.0f, 1.0f, 1.0f);
+		pTransform->position = position;
+		pLight = m_pEntities->GetComponent<EntityWorld::LIGHT_COMPONENT>(accent);
+		pLight->type = EntityWorld::LIGHT_POINT;
+		// No ambient, so the tiers only change the highlights
+		pLight->ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+		pLight->diffuse = glm::vec3(0.15f, 0.15f, 0.15f);
+		pLight->specular = glm::vec3(0.3f, 0.3f, 0.3f);
+	}
+}
+
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is used for enabling the lighting of the
+ *  scene shader and sending it the light entities.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	const SCENE_UNIFORMS& uniforms = GetSceneUniforms(m_pShaderManager);
+
+	// Enable custom lighting
+	uniforms.bUseLighting.Set(true);
+	SetLightUniforms(uniforms.lights);
+}
+
+/***********************************************************
+ *  SetLightUniforms()
+ *
+ *  This method is used for sending the light entities to the
+ *  program in use.  The first directional light and up to
+ *  five point lights, fewer in the lower quality tiers, are
+ *  used; the unused point lights are turned off.
+ ***********************************************************/
+void SceneManager::SetLightUniforms(const LIGHT_UNIFORMS* handles)
+{
+	handles[0].bActive.Set(false);
+
+	int pointLightCount = 0;
+	bool bDirectionalSet = false;
+	EntityWorld::COMPONENT_MASK lightMask =
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_LIGHT);
+	m_pEntities->ForEachChunk(lightMask, [&](const EntityWorld::CHUNK_VIEW& chunk)
+		{
+			const EntityWorld::TRANSFORM_COMPONENT* transforms = chunk.Get<EntityWorld::TRANSFORM_COMPONENT>();
+			const EntityWorld::LIGHT_COMPONENT* lights = chunk.Get<EntityWorld::LIGHT_COMPONENT>();
+			for (int i = 0; i < chunk.count; i++)
+			{
+				const EntityWorld::LIGHT_COMPONENT& light = lights[i];
+				const LIGHT_UNIFORMS* pHandles = NULL;
+				if ((light.type == EntityWorld::LIGHT_DIRECTIONAL) && !bDirectionalSet)
+				{
+					pHandles = &handles[0];
+					pHandles->direction.Set(light.direction);
+					bDirectionalSet = true;
+				}
+				else if ((light.type == EntityWorld::LIGHT_POINT) && (pointLightCount < m_pointLightLimit))
+				{
+					pHandles = &handles[1 + pointLightCount];
+					pHandles->position.Set(transforms[i].position);
+					pointLightCount++;
+				}
+				else
+				{
+					continue;
+				}
+
+				pHandles->ambient.Set(light.ambient);
+				pHandles->diffuse.Set(light.diffuse);
+				pHandles->specular.Set(light.specular);
+				pHandles->bActive.Set(true);
+			}
+		});
+
+	// Deactivate any additional point lights (assuming 5 total)
+	for (int i = pointLightCount; i < MAX_POINT_LIGHTS; i++)
+	{
+		handles[1 + i].bActive.Set(false);
+	}
+}
+
+/***********************************************************
+ *  ResolveSceneUniforms()
+ *
+ *  This method is used for looking up the uniforms of a
+ *  linked scene program once, and for connecting its
+ *  DrawUniforms block to the per-draw buffer.
+ ***********************************************************/
+bool SceneManager::ResolveSceneUniforms(const ShaderManager* pShader, SCENE_UNIFORMS& uniforms)
+{
+	uniforms.program = pShader->m_programID;
+	uniforms.bUseLighting.Resolve(uniforms.program, "bUseLighting");
+	uniforms.view.Resolve(uniforms.program, "view");
+	uniforms.projection.Resolve(uniforms.program, "projection");
+	uniforms.viewPosition.Resolve(uniforms.program, "viewPosition");
+	uniforms.objectTexture.Resolve(uniforms.program, "objectTexture");
+	uniforms.bVideoFullRange.Resolve(uniforms.program, "bVideoFullRange");
+	uniforms.videoPlaneY.Resolve(uniforms.program, "videoPlaneY");
+	uniforms.videoPlaneU.Resolve(uniforms.program, "videoPlaneU");
+	uniforms.videoPlaneV.Resolve(uniforms.program, "videoPlaneV");
+	ResolveLightUniforms(uniforms.program, uniforms.lights);
+
+	return(DrawUniformBuffer::BindProgram(uniforms.program));
+}
+
+/***********************************************************
+ *  ResolveLightUniforms()
+ *
+ *  This method is used for looking up the directional light
+ *  and the point lights of a program that declares them as
+ *  the scene shaders do.
+ ***********************************************************/
+void SceneManager::ResolveLightUniforms(GLuint program, LIGHT_UNIFORMS* lights)
+{
+	for (int i = 0; i <= MAX_POINT_LIGHTS; i++)
+	{
+		std::string prefix = (i == 0) ?
+			std::string(g_DirectionalLightName) + "." :
+			std::string(g_PointLightsName) + "[" + std::to_string(i - 1) + "].";
+		LIGHT_UNIFORMS& light = lights[i];
+		if (i == 0)
+		{
+			light.direction.Resolve(program, (prefix + "direction").c_str());
+		}
+		else
+		{
+			light.position.Resolve(program, (prefix + "position").c_str());
+		}
+		light.ambient.Resolve(program, (prefix + "ambient").c_str());
+		light.diffuse.Resolve(program, (prefix + "diffuse").c_str());
+		light.specular.Resolve(program, (prefix + "specular").c_str());
+		light.bActive.Resolve(program, (prefix + "bActive").c_str());
+	}
+}
+
+/***********************************************************
+ *  GetSceneUniforms()
+ *
+ *  This method is used for finding the handles of the
+ *  program wrapped by a shader manager.
+ ***********************************************************/
+const SceneManager::SCENE_UNIFORMS& SceneManager::GetSceneUniforms(const ShaderManager* pShader) const
+{
+	if ((NULL != m_pLayeredRenderer) && (pShader == m_pLayeredRenderer->GetShaderManager()))
+	{
+		return(m_layeredUniforms);
+	}
+	if (pShader == &m_vertexLitShader)
+	{
+		return(m_vertexLitUniforms);
+	}
+	if (pShader == &m_lightCostShader)
+	{
+		return(m_lightCostUniforms);
+	}
+	return(m_sceneUniforms);
+}
+
+void SceneManager::DefineObjectMaterials()
 {
 	// Material for the plane (using the wood texture)
 	OBJECT_MATERIAL woodMat;
@@ -546,107 +2543,57 @@ void SceneManager::DefineObjectMaterials()
 	m_objectMaterials.push_back(whiteMat);
 }
 
-void SceneManager::RenderDesk() {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+/***********************************************************
+ *  SetMonitorScreenTexture()
+ *
+ *  This method is used for choosing what the monitor screen
+ *  shows: the video once it has a frame, otherwise the live
+ *  view once it has been rendered, otherwise the static image.
+ ***********************************************************/
+void SceneManager::SetMonitorScreenTexture()
+{
+	bool bShowVideo = (NULL != m_pMonitorVideo) && m_pMonitorVideo->HasFrame();
+	if (bShowVideo)
+	{
+		SetShaderVideoTexture();
+	}
+	else if ((NULL != m_pRenderTargets) && m_pRenderTargets->HasContent(m_monitorTarget))
+	{
+		SetShaderTexture("monitor_live");
+	}
+	else
+	{
+		SetShaderTexture("monitor_screen");
+	}
+}
 
-	// ---------- Render the Desk Tabletop ----------
-	// Transform for the tabletop
-	scaleXYZ = glm::vec3(24.0f, 0.75f, 16.0f);
-	positionXYZ = glm::vec3(0.0f, 10.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackWoodMat");  // Material defined for black wood
-	SetShaderTexture("black_wood");       // Texture loaded with tag "black_wood"
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG ----------
-	// Transform for the left leg
-	scaleXYZ = glm::vec3(1.25f, 10.0f, 1.25f);
-	positionXYZ = glm::vec3(-9.0f, 5.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the black metal material and texture for the leg
-	SetShaderMaterial("blackMetalMat");   // Material defined for metal parts
-	SetShaderTexture("black_metal");      // Texture loaded with tag "black_metal"
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG: Piece1 ----------
-	scaleXYZ = glm::vec3(1.25f, 1.25f, 1.25f);
-	positionXYZ = glm::vec3(-8.0f, 9.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the black metal material and texture for the leg
-	SetShaderMaterial("blackMetalMat");   // Material defined for metal parts
-	SetShaderTexture("black_metal");      // Texture loaded with tag "black_metal"
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG: Piece2 ----------
-	scaleXYZ = glm::vec3(1.25f, 0.5f, 12.0f);
-	positionXYZ = glm::vec3(-8.0f, 9.5f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the black metal material and texture for the leg
-	SetShaderMaterial("blackMetalMat");   // Material defined for metal parts
-	SetShaderTexture("black_metal");      // Texture loaded with tag "black_metal"
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG: Piece3 ----------
-	scaleXYZ = glm::vec3(1.25f, 0.5f, 12.0f);
-	positionXYZ = glm::vec3(-9.0f, 0.25f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the black metal material and texture for the leg
-	SetShaderMaterial("blackMetalMat");   // Material defined for metal parts
-	SetShaderTexture("black_metal");      // Texture loaded with tag "black_metal"
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - RIGHT LEG ----------
-	scaleXYZ = glm::vec3(1.25f, 10.0f, 1.25f);
-	positionXYZ = glm::vec3(9.0f, 5.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the same black metal material and texture for the right leg
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG: Piece1 ----------
-	scaleXYZ = glm::vec3(1.25f, 1.25f, 1.25f);
-	positionXYZ = glm::vec3(8.0f, 9.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the same black metal material and texture for the right leg
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG: Piece2 ----------
-	scaleXYZ = glm::vec3(1.25f, 0.5f, 12.0f);
-	positionXYZ = glm::vec3(8.0f, 9.5f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the same black metal material and texture for the right leg
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render Desk - LEFT LEG: Piece3 ----------
-	scaleXYZ = glm::vec3(1.25f, 0.5f, 15.0f);
-	positionXYZ = glm::vec3(9.0f, 0.25f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	// Use the same black metal material and texture for the right leg
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  UpdateMonitorScreen()
+ *
+ *  This method is used for applying the current choice of
+ *  the monitor screen texture to its entity.
+ ***********************************************************/
+void SceneManager::UpdateMonitorScreen()
+{
+	EntityWorld::MATERIAL_COMPONENT* pMaterial = m_pEntities->GetComponent<EntityWorld::MATERIAL_COMPONENT>(m_monitorScreenEntity);
+	if (NULL == pMaterial)
+	{
+		return;
+	}
+
+	// a new texture is handed to the GPU culling with the objects
+	SetMonitorScreenTexture();
+	if ((pMaterial->textureSlot != m_drawState.textureSlot) || (pMaterial->bVideoTexture != m_drawState.bVideoTexture))
+	{
+		pMaterial->textureSlot = m_drawState.textureSlot;
+		pMaterial->bVideoTexture = m_drawState.bVideoTexture;
+		m_materialVersion++;
+	}
 }
 
-void SceneManager::RenderMonitor() {
+void SceneManager::RenderMonitorContent(double time) {
+	PerfCounters::BeginScope("RenderMonitorContent");
+
 	// declare the variables for the transformations
 	glm::vec3 scaleXYZ;
 	float XrotationDegrees = 0.0f;
@@ -654,150 +2601,167 @@ void SceneManager::RenderMonitor() {
 	float ZrotationDegrees = 0.0f;
 	glm::vec3 positionXYZ;
 
-	// ---------- Render the stand lower flat base ----------
-	scaleXYZ = glm::vec3(2.0f, 0.25f, 2.0f);
-	positionXYZ = glm::vec3(-5.0f, 10.5f, -6.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render the stand upper base ----------
-	scaleXYZ = glm::vec3(0.5f, 2.0f, 0.5f);
-	positionXYZ = glm::vec3(-5.0f, 10.75f, -6.0f);
+	// the screen content is a small scene of its own, seen from a fixed
+	// camera with the aspect ratio of the screen
+	glm::vec3 cameraPosition = glm::vec3(0.0f, 3.0f, 12.0f);
+	glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+		MONITOR_SCREEN_SCALE.x / MONITOR_SCREEN_SCALE.y, 0.1f, 50.0f);
+	m_sceneUniforms.view.Set(view);
+	m_sceneUniforms.projection.Set(projection);
+	m_sceneUniforms.viewPosition.Set(cameraPosition);
+
+	BeginDrawList(m_monitorDrawList);
+
+	float angle = (float)fmod(time * 60.0, 360.0);
+
+	// ---------- Render the spinning box ----------
+	scaleXYZ = glm::vec3(2.5f, 2.5f, 2.5f);
+	positionXYZ = glm::vec3(-4.0f, 0.0f, 0.0f);
+	XrotationDegrees = angle * 0.5f;
+	YrotationDegrees = angle;
+	ZrotationDegrees = 0.0f;
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
+	SetShaderMaterial("whiteMat");
+	SetShaderColor(0.2f, 0.6f, 1.0f, 1.0f);
+	DrawMesh(MESH_BOX);
 
-	scaleXYZ = glm::vec3(0.5f, 6.0f, 0.5f);
-	positionXYZ = glm::vec3(-5.0f, 12.5f, -6.0f);
+	// ---------- Render the tumbling cylinder ----------
+	scaleXYZ = glm::vec3(1.0f, 3.0f, 1.0f);
+	positionXYZ = glm::vec3(0.0f, -1.5f, 0.0f);
 	XrotationDegrees = 0.0f;
 	YrotationDegrees = 0.0f;
-	ZrotationDegrees = -30.0f;
+	ZrotationDegrees = 20.0f * (float)sin(time * 2.0);
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
-
-	// ---------- Render the stand upper flat base ----------
-	scaleXYZ = glm::vec3(2.0f, 1.0f, 2.0f);
-	positionXYZ = glm::vec3(-1.5f, 17.0f, -5.5f);
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render the monitor screen ----------
-	scaleXYZ = glm::vec3(15.5f, 10.5f, 0.5f);
-	positionXYZ = glm::vec3(0.0f, 19.0f, -5.0f);
+	SetShaderMaterial("whiteMat");
+	SetShaderColor(1.0f, 0.6f, 0.1f, 1.0f);
+	DrawMesh(MESH_CYLINDER);
+
+	// ---------- Render the bouncing box ----------
+	scaleXYZ = glm::vec3(2.0f, 2.0f, 2.0f);
+	positionXYZ = glm::vec3(4.0f, 1.5f * (float)fabs(sin(time * 3.0)) - 0.5f, 0.0f);
 	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
+	YrotationDegrees = -angle;
 	ZrotationDegrees = 0.0f;
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render the monitor screen ----------
-	scaleXYZ = glm::vec3(15.0f, 10.0f, 0.25f);
-	positionXYZ = glm::vec3(0.0f, 19.0f, -4.85f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("monitorScreenMat");
-	SetShaderTexture("monitor_screen");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+	SetShaderMaterial("whiteMat");
+	SetShaderColor(0.3f, 0.9f, 0.4f, 1.0f);
+	DrawMesh(MESH_BOX);
+
+	SortDrawList(m_monitorDrawList);
+	SubmitDrawItems(m_monitorDrawList, view, projection);
+
+	PerfCounters::EndScope();
 }
 
-void SceneManager::RenderKeyboard() {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+/***********************************************************
+ *  OverrideTexture()
+ *
+ *  This method replaces the image behind a texture tag, so
+ *  the scene can be rendered with a texture variant.  The
+ *  original texture stays loaded for ClearOverrides().
+ ***********************************************************/
+bool SceneManager::OverrideTexture(std::string textureTag, const char* filename)
+{
+	int slot = FindTextureSlot(textureTag.c_str());
+	if (slot < 0)
+	{
+		std::cout << "Cannot override unknown texture tag:" << textureTag << std::endl;
+		return false;
+	}
 
-	// ---------- Render the keyboard base ----------
-	scaleXYZ = glm::vec3(10.0f, 0.25f, 4.0f);
-	positionXYZ = glm::vec3(0.0f, 10.5f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render the keyboard keys ----------
-	for (int j = 0; j < 6; j++) {
-		for (int i = 0; i < 17; i++) {
-			scaleXYZ = glm::vec3(0.35f, 0.35f, 0.35f);
-			positionXYZ = glm::vec3(-4.0f + (i / 2.0f), 10.5f, -1.0f + (j / 2.0f));
-			SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-			SetShaderMaterial("whiteMat"); // Material defined in DefineObjectMaterials()
-			SetShaderTexture("white");
-			SetTextureUVScale(1.0f, 1.0f);
-			m_basicMeshes->DrawBoxMesh();
+	GLuint textureID = 0;
+	std::map<std::string, uint32_t>::iterator cached = m_overrideTextureCache.find(filename);
+	if (cached != m_overrideTextureCache.end())
+	{
+		textureID = cached->second;
+	}
+	else
+	{
+		textureID = LoadGLTexture(filename);
+		if (0 == textureID)
+		{
+			return false;
 		}
+		m_overrideTextureCache[filename] = textureID;
 	}
-}
 
-void SceneManager::RenderMouse() {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	// remember the original only the first time the slot is overridden
+	if (m_overriddenTextures.find(slot) == m_overriddenTextures.end())
+	{
+		m_overriddenTextures[slot] = m_textureIDs[slot].ID;
+	}
+	m_textureIDs[slot].ID = textureID;
 
-	// ---------- Render the mouse base ----------
-	scaleXYZ = glm::vec3(1.25f, 0.5f, 1.75f);
-	positionXYZ = glm::vec3(7.0f, 10.5f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render the mouse hand rest ----------
-	scaleXYZ = glm::vec3(1.25f, 0.75f, 0.875f);
-	positionXYZ = glm::vec3(7.0f, 10.5f, 0.45f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	// ---------- Render the mouse's primary button ----------
-	scaleXYZ = glm::vec3(0.5f, 0.75f, 0.75f);
-	positionXYZ = glm::vec3(6.7f, 10.5f, -0.45f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("whiteMat");
-	SetShaderTexture("white");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+	glActiveTexture(GL_TEXTURE0 + slot);
+	glBindTexture(GL_TEXTURE_2D, textureID);
 
-	// ---------- Render the mouse's secondary button ----------
-	scaleXYZ = glm::vec3(0.5f, 0.75f, 0.75f);
-	positionXYZ = glm::vec3(7.3f, 10.5f, -0.45f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("whiteMat");
-	SetShaderTexture("white");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+	return true;
+}
 
-	// ---------- Render the mouse's middle button ----------
-	scaleXYZ = glm::vec3(0.05f, 1.00f, 0.6f);
-	positionXYZ = glm::vec3(7.0f, 10.5f, -0.45f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("blackMetalMat");
-	SetShaderTexture("black_metal");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  OverrideMaterial()
+ *
+ *  This method replaces the diffuse color and shininess of
+ *  a defined material until ClearOverrides() is called.
+ ***********************************************************/
+bool SceneManager::OverrideMaterial(std::string materialTag, glm::vec3 diffuseColor, float shininess)
+{
+	for (size_t index = 0; index < m_objectMaterials.size(); index++)
+	{
+		if (m_objectMaterials[index].tag.compare(materialTag) == 0)
+		{
+			bool bSaved = false;
+			for (size_t saved = 0; saved < m_overriddenMaterials.size(); saved++)
+			{
+				if (m_overriddenMaterials[saved].tag.compare(materialTag) == 0)
+				{
+					bSaved = true;
+				}
+			}
+			if (bSaved == false)
+			{
+				m_overriddenMaterials.push_back(m_objectMaterials[index]);
+			}
+
+			m_objectMaterials[index].diffuseColor = diffuseColor;
+			if (shininess > 0.0f)
+			{
+				m_objectMaterials[index].shininess = shininess;
+			}
+			return true;
+		}
+	}
+
+	std::cout << "Cannot override unknown material tag:" << materialTag << std::endl;
+	return false;
 }
+
+/***********************************************************
+ *  ClearOverrides()
+ *
+ *  This method puts back the textures and materials that
+ *  were replaced by OverrideTexture() and OverrideMaterial().
+ ***********************************************************/
+void SceneManager::ClearOverrides()
+{
+	for (std::map<int, uint32_t>::iterator it = m_overriddenTextures.begin(); it != m_overriddenTextures.end(); ++it)
+	{
+		m_textureIDs[it->first].ID = it->second;
+		glActiveTexture(GL_TEXTURE0 + it->first);
+		glBindTexture(GL_TEXTURE_2D, it->second);
+	}
+	m_overriddenTextures.clear();
+
+	for (size_t saved = 0; saved < m_overriddenMaterials.size(); saved++)
+	{
+		for (size_t index = 0; index < m_objectMaterials.size(); index++)
+		{
+			if (m_objectMaterials[index].tag.compare(m_overriddenMaterials[saved].tag) == 0)
+			{
+				m_objectMaterials[index] = m_overriddenMaterials[saved];
+			}
+		}
+	}
+	m_overriddenMaterials.clear();
+}
\ No newline at end of file
@@ -9,9 +9,22 @@
 
 #pragma once
 
+#include "AssetPipeline.h"
+#include "CollisionWorld.h"
+#include "EntityWorld.h"
+#include "GpuCuller.h"
+#include "ImpostorRenderer.h"
+#include "LayeredRenderer.h"
+#include "MeshLibrary.h"
+#include "QualityTuner.h"
+#include "RenderTargetManager.h"
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "ShaderUniforms.h"
+#include "VideoTexture.h"
+#include "WorkerPool.h"
+#include "WorldStreamer.h"
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -45,29 +58,303 @@ public:
 		std::string tag;
 	};
 
+	// basic shapes that can be drawn
+	enum MESH_TYPE
+	{
+		MESH_BOX,
+		MESH_PLANE,
+		MESH_CYLINDER
+	};
+
+	// the pickable objects of the scene; a pick handle combines the
+	// object with the index of the draw within it (its part)
+	enum SCENE_OBJECT
+	{
+		OBJECT_NONE,
+		OBJECT_FLOOR,
+		OBJECT_WALL,
+		OBJECT_DESK,
+		OBJECT_MONITOR,
+		OBJECT_KEYBOARD,
+		OBJECT_MOUSE,
+		OBJECT_COUNT
+	};
+
+	// one recorded draw command with its resolved render state
+	struct DRAW_ITEM
+	{
+		glm::mat4 model;
+		BoundingVolumes::BOX bounds;
+		MESH_TYPE mesh;
+		int materialIndex;      // -1 until a material has been set
+		int textureSlot;        // -1 draws with the solid color
+		bool bVideoTexture;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		uint32_t sortKey;
+		uint32_t pickID;        // 0 when the draw cannot be picked
+		float impostorFade;     // above 0 while an impostor takes over
+	};
+
+	// the eye that the draws culled on the CPU choose the levels of
+	// detail of their meshes for
+	struct LOD_VIEW
+	{
+		glm::vec3 position;
+		float projectionScale;  // projection[1][1]
+		bool bOrthographic;
+	};
+
+	// point lights of the scene shaders, TOTAL_POINT_LIGHTS in GLSL
+	static const int MAX_POINT_LIGHTS = 5;
+
+	// the handles of one light of the scene shaders
+	struct LIGHT_UNIFORMS
+	{
+		Uniform<glm::vec3> direction;
+		Uniform<glm::vec3> position;
+		Uniform<glm::vec3> ambient;
+		Uniform<glm::vec3> diffuse;
+		Uniform<glm::vec3> specular;
+		Uniform<bool> bActive;
+	};
+
+	// the uniforms of a scene program outside its DrawUniforms block,
+	// resolved once after the program is linked
+	struct SCENE_UNIFORMS
+	{
+		GLuint program;
+		Uniform<bool> bUseLighting;
+		Uniform<glm::mat4> view;
+		Uniform<glm::mat4> projection;
+		Uniform<glm::vec3> viewPosition;
+		Uniform<SAMPLER_UNIT> objectTexture;
+		Uniform<bool> bVideoFullRange;
+		Uniform<SAMPLER_UNIT> videoPlaneY;
+		Uniform<SAMPLER_UNIT> videoPlaneU;
+		Uniform<SAMPLER_UNIT> videoPlaneV;
+		// the directional light, then the point lights
+		LIGHT_UNIFORMS lights[MAX_POINT_LIGHTS + 1];
+	};
+
+	// the per-draw uniforms of the object picker's program
+	struct PICK_UNIFORMS
+	{
+		GLuint program;
+		Uniform<glm::mat4> model;
+		Uniform<int> pickID;
+	};
+
+	// the draw list work submitted since the counters were last taken;
+	// the draws of the GPU culling are chosen on the GPU, so only its
+	// objects and its indirect submissions are counted, and the
+	// impostors are not counted
+	struct FRAME_COUNTERS
+	{
+		int drawItems;           // drawn entities as of BuildDrawList()
+		int drawCalls;
+		int triangles;           // of the draws culled on the CPU
+		int cpuVisibleItems;
+		int cpuCulledItems;
+		int gpuCulledObjects;    // objects tested, once per view
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
+	// the basic shapes, every one in the same vertex array
+	MeshLibrary m_sceneMeshes;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// original texture IDs and materials replaced by overrides
+	std::map<int, uint32_t> m_overriddenTextures;
+	std::vector<OBJECT_MATERIAL> m_overriddenMaterials;
+	// textures loaded for overrides, kept for reuse by filename
+	std::map<std::string, uint32_t> m_overrideTextureCache;
+	// views rendered into textures, such as the live monitor screen
+	RenderTargetManager* m_pRenderTargets;
+	int m_monitorTarget;
+	// optional looping video shown on the monitor instead
+	std::string m_monitorVideoFile;
+	VideoTexture* m_pMonitorVideo;
+
+	// the scene's draw list sorted by render state, which the views
+	// culled on the CPU cull and submit; with the GPU culling it is only
+	// gathered in the frames a pass needs it
+	std::vector<DRAW_ITEM> m_sceneDrawList;
+	bool m_bDrawListBuilt;
+	std::vector<DRAW_ITEM> m_monitorDrawList;
+	// the list being recorded and the state for its next draw
+	std::vector<DRAW_ITEM>* m_pDrawList;
+	DRAW_ITEM m_drawState;
+	// the object being recorded and the number of its draws so far
+	SCENE_OBJECT m_drawObject;
+	uint32_t m_drawObjectParts;
+	// draws the list into many views in one pass, when supported
+	LayeredRenderer* m_pLayeredRenderer;
+	// the uniform handles of the main, layered and pick programs, and
+	// the records of the per-draw uniform block
+	SCENE_UNIFORMS m_sceneUniforms;
+	SCENE_UNIFORMS m_layeredUniforms;
+	PICK_UNIFORMS m_pickUniforms;
+	DrawUniformBuffer m_drawUniforms;
 
+	// the scene objects and lights are entities created once by
+	// PrepareScene(); the systems update them and the draw list is
+	// gathered from their chunks every frame
+	EntityWorld* m_pEntities;
+	WorkerPool* m_pSystemWorkers;
+	// loads the textures on the IO thread, the system workers and the
+	// GL thread
+	AssetPipeline* m_pAssets;
+	// the texture loads and the mesh building started by StartLoading()
+	// and finished by PrepareScene(), which makes them itself on the
+	// main thread when loading serially
+	bool m_bLoadingStarted;
+	bool m_bSerialLoading;
+	AssetTask<bool> m_textureLoad;
+	AssetTask<bool> m_meshGeneration;
+	// the chunks of a large world loaded around the camera, when
+	// StartWorldStreaming() was called
+	WorldStreamer* m_pWorldStreamer;
+	// the streamed chunks the collision world was built with
+	uint64_t m_collisionStreamVersion;
+	// the triangles of each basic mesh, shared by all its colliders
+	std::vector<float> m_collisionVertices[MeshLibrary::MESH_COUNT];
+	std::vector<GLuint> m_collisionIndices[MeshLibrary::MESH_COUNT];
+	// the streamed workstations are drawn as impostors in the distance,
+	// lit by the scene lights through their own handles
+	ImpostorRenderer* m_pImpostors;
+	LIGHT_UNIFORMS m_impostorLights[MAX_POINT_LIGHTS + 1];
+	// culls the draw list and draws it with indirect commands on the
+	// GPU, unless turned off or unsupported; the draws it cannot make,
+	// the video screen, are kept for the CPU path
+	bool m_bGpuCulling;
+	GpuCuller* m_pGpuCuller;
+	LIGHT_UNIFORMS m_culledLights[MAX_POINT_LIGHTS + 1];
+	std::vector<GpuCuller::CULL_OBJECT> m_culledObjects;
+	std::vector<DRAW_UNIFORMS> m_culledRecords;
+	std::vector<DRAW_ITEM> m_cpuDrawList;
+	// the objects stay on the GPU until entities are created, destroyed
+	// or moved, or the monitor screen changes texture; the drawables
+	// that are not static, from m_dynamicCulledStart on, go up every
+	// frame
+	uint64_t m_culledStructureVersion;
+	uint32_t m_materialVersion;
+	uint32_t m_culledMaterialVersion;
+	int m_dynamicCulledStart;
+	// the quality tier: the point lights sent to the programs, the
+	// program that lights the vertices, used instead of the main one
+	// and of the GPU culling while the tier asks for it, and the level
+	// of detail bias, which the draws culled on the CPU apply as well
+	int m_pointLightLimit;
+	bool m_bVertexLighting;
+	float m_lodBias;
+	GLuint m_vertexLitProgram;
+	ShaderManager m_vertexLitShader;
+	SCENE_UNIFORMS m_vertexLitUniforms;
+	// the program that counts the lighting work of every fragment, used
+	// for the main views while the light cost view is on
+	bool m_bLightCostView;
+	GLuint m_lightCostProgram;
+	ShaderManager m_lightCostShader;
+	SCENE_UNIFORMS m_lightCostUniforms;
+	// the work submitted since TakeFrameCounters()
+	FRAME_COUNTERS m_frameCounters;
+	// the monitor screen switches between the video, the live view and
+	// the static image as they become available
+	EntityWorld::ENTITY m_monitorScreenEntity;
+
+	// decode an image file into a new OpenGL texture object
+	uint32_t LoadGLTexture(const char* filename);
+	uint32_t UploadGLTexture(const unsigned char* image, int width, int height, int colorChannels);
+	// the same through the asset pipeline, and the scene's textures
+	// loaded that way
+	AssetTask<uint32_t> LoadGLTextureAsync(std::string filename);
+	AssetTask<bool> LoadSceneTexturesAsync();
+	// the scene's textures loaded on the calling thread
+	bool LoadSceneTextures();
+	// build the geometry of the scene meshes on the workers
+	AssetTask<bool> GenerateMeshesAsync();
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// associate an existing texture object with the next free slot
+	bool RegisterGLTexture(uint32_t textureID, std::string tag);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
 	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureSlot(const char* tag);
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const char* tag);
+
+	// start recording draw commands into a list
+	void BeginDrawList(std::vector<DRAW_ITEM>& drawList);
+	void ResetDrawState();
+	// create the entities of the scene objects, from the compile time
+	// office table, and the lights
+	void CreateSceneEntities();
+	void CreateLightEntities();
+	// bake the impostor of the workstation; needs the textures bound
+	void CreateImpostors();
+	// build the GPU culling programs and send them the scene lights
+	void CreateGpuCuller();
+	// build a variant of the scene program from a vertex shader and the
+	// scene's fragment shader with defines; returns 0 on failure
+	GLuint BuildSceneProgram(const char* vertexShaderFile, const char* fragmentDefines, const char* name, ShaderManager& shader, SCENE_UNIFORMS& uniforms);
+	// build the program of the vertex lighting tier
+	void CreateVertexLitProgram();
+	// build the program of the light cost view
+	void CreateLightCostProgram();
+	// draw the whole list into one view with a variant program
+	void SubmitDrawListWith(ShaderManager* pShader, const SCENE_UNIFORMS& uniforms, const glm::mat4& view, const glm::mat4& projection);
+	// gather the draw list from the entities, once per frame at most
+	void GatherDrawList();
+	static void ReadDrawItem(const EntityWorld::CHUNK_VIEW& chunk, int row, DRAW_ITEM& item);
+	// add a collider for every entity that is drawn, including the
+	// parts shown as impostors, and build the hierarchy
+	void FillCollisionWorld(CollisionWorld& world);
+	// keep the objects of the GPU culling in step with the entities:
+	// all of them after a change of the scene, else those that move
+	void UpdateCulledObjects();
+	void UploadCulledObjects();
+	void AppendCulledObjects(const EntityWorld::CHUNK_VIEW& chunk, DRAW_UNIFORMS& record);
+	void UploadDynamicCulledObjects();
+	// record a draw of a basic mesh with the current draw state
+	void DrawMesh(MESH_TYPE mesh);
+	// the render state order of a draw
+	static uint32_t GetSortKey(const DRAW_ITEM& item);
+	// order a recorded list to minimize shader state changes
+	void SortDrawList(std::vector<DRAW_ITEM>& drawList);
+	// draw the items of a list that are inside the view frustum; with
+	// a view to choose them for, at the levels of detail of the tier
+	void SubmitDrawItems(const std::vector<DRAW_ITEM>& drawList, const glm::mat4& view, const glm::mat4& projection);
+	void SubmitDrawItems(
+		const std::vector<DRAW_ITEM>& drawList,
+		const BoundingVolumes::FRUSTUM* frustums,
+		int frustumCount,
+		ShaderManager* pShader,
+		int layeredViewCount,
+		const LOD_VIEW* pLodView = NULL);
+	static LOD_VIEW GetLodView(const glm::mat4& view, const glm::mat4& projection);
+	// the level of detail of an item's mesh seen from the view
+	int SelectLod(const DRAW_ITEM& item, const LOD_VIEW& lodView) const;
+	void ApplyVideoTexture(const SCENE_UNIFORMS& uniforms);
+	// the DrawUniforms record of an item; a record of an item without
+	// a material keeps the material already in it
+	void FillDrawRecord(const DRAW_ITEM& item, DRAW_UNIFORMS& record) const;
+	// look up the uniforms of a linked scene program and connect its
+	// DrawUniforms block; false when the program has no such block
+	bool ResolveSceneUniforms(const ShaderManager* pShader, SCENE_UNIFORMS& uniforms);
+	// the handles that belong to the main, layered or vertex lit program
+	const SCENE_UNIFORMS& GetSceneUniforms(const ShaderManager* pShader) const;
 
 	// set the transformation values 
 	// into the transform buffer
@@ -87,30 +374,122 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
 
-	// set the UV scale for the texture mapping
-	void SetTextureUVScale(
-		float u, float v);
+	// use the planes of the current video frame as the texture
+	void SetShaderVideoTexture();
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
 
 	// set up the light sources for the scene
 	void SetupSceneLights();
+	// send the light entities through the handles of a program in use
+	void SetLightUniforms(const LIGHT_UNIFORMS* handles);
+	static void ResolveLightUniforms(GLuint program, LIGHT_UNIFORMS* lights);
 
 	void DefineObjectMaterials();
-	void RenderDesk();
-	void RenderMonitor();
-	void RenderKeyboard();
-	void RenderMouse();
+	// draw the content shown on the monitor screen
+	void RenderMonitorContent(double time);
+	// choose the texture of the monitor screen for the next draw, and
+	// apply the choice to the screen entity every frame
+	void SetMonitorScreenTexture();
+	void UpdateMonitorScreen();
 
 public:
 
+	// start reading and decoding the textures and building the meshes
+	// on the loading threads; needs no context, so it can run while the
+	// window is created.  PrepareScene() starts them when it was not
+	// called
+	void StartLoading();
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
-	void RenderScene();
+
+	// run the entity systems once per frame and bring the draws of the
+	// entities up to date for the views
+	void BuildDrawList();
+	// cull the draw list against one view and draw what is visible;
+	// the view's matrices and viewport must already be set
+	void SubmitDrawList(const glm::mat4& viewProjection);
+	// the same, culled on the GPU when it can be
+	void SubmitDrawList(const glm::mat4& view, const glm::mat4& projection);
+	// draw the main views with the program that counts the lighting
+	// work, for the light cost view; returns false when it is turned
+	// on but not available
+	bool SetLightCostView(bool bLightCostView);
+	// build and submit in one step, for a single view
+	void RenderScene(const glm::mat4& viewProjection);
+	// submit the draw list once into up to LayeredRenderer::MAX_VIEWS
+	// viewports or layers; returns false when layered rendering is not
+	// supported and the views must be drawn one at a time
+	bool SubmitDrawListLayered(const std::vector<LayeredRenderer::LAYERED_VIEW>& views);
+
+	// draw the pickable items of the draw list with the object picker's
+	// shader, setting its model and pickID uniforms
+	void SubmitPickDrawList(const glm::mat4& viewProjection, ShaderManager* pPickShader);
+	// split a pick handle into its object and part
+	static SCENE_OBJECT GetPickObject(uint32_t pickID);
+	static int GetPickPart(uint32_t pickID);
+	static const char* GetObjectName(SCENE_OBJECT object);
+
+	// add the triangles of every scene object to a collision world
+	// and build its hierarchy
+	void BuildCollisionWorld(CollisionWorld& world);
+	// build the collision world again when streamed chunks have been
+	// installed or removed; call after UpdateWorldStreaming()
+	void UpdateCollisionWorld(CollisionWorld& world);
+
+	// stream the chunks of a world index file into the scene around
+	// the camera; call after PrepareScene()
+	bool StartWorldStreaming(const char* indexFile, size_t memoryBudget);
+	// load and unload chunks and fade the impostors for the camera;
+	// call before BuildDrawList()
+	void UpdateWorldStreaming(const glm::vec3& cameraPosition, const glm::vec3& cameraVelocity);
+	// the memory of the resident chunks of the streamed world
+	size_t GetStreamedMemory() const { return (NULL != m_pWorldStreamer) ? m_pWorldStreamer->GetMemoryUsed() : 0; }
+	// draw the impostors of the distant assemblies into a view, after
+	// its draw list
+	void SubmitImpostors(const glm::mat4& view, const glm::mat4& projection);
+	// write a floor of office workstations as world chunk files, two by
+	// two workstations per chunk, and their index file
+	static bool WriteOfficeFloor(const char* indexFile, int columns, int rows);
+
+	// play a Y4M video on the monitor; call before PrepareScene()
+	void SetMonitorVideo(const char* filename);
+	// cull the main views on the CPU even where compute shaders are
+	// supported; call before PrepareScene()
+	void SetGpuCulling(bool bEnabled) { m_bGpuCulling = bEnabled; }
+	// build the meshes and load the textures on the main thread within
+	// PrepareScene(), with no loading threads; call before StartLoading()
+	void SetSerialLoading(bool bEnabled) { m_bSerialLoading = bEnabled; }
+	// apply the lights, lighting and level of detail of a quality tier;
+	// call after PrepareScene()
+	void SetQualitySettings(const QualityTuner::QUALITY_SETTINGS& settings);
+
+	// refresh the textures of the secondary views that are due and
+	// visible from the main view, and upload the next video frame;
+	// call before BuildDrawList()
+	void UpdateRenderTargets(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3 viewPosition,
+		int viewportWidth,
+		int viewportHeight,
+		bool bForceUpdate = false);
+
+	// temporarily replace the image of a loaded texture
+	bool OverrideTexture(std::string textureTag, const char* filename);
+	// temporarily replace the colors of a defined material
+	bool OverrideMaterial(std::string materialTag, glm::vec3 diffuseColor, float shininess);
+	// restore every overridden texture and material
+	void ClearOverrides();
+
+	// the work submitted since the last call, which starts the counts
+	// over; call once per frame
+	FRAME_COUNTERS TakeFrameCounters();
 
 };
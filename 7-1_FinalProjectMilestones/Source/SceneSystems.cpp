@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesystems.cpp
+// ============
+// per frame systems run over the scene entities
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneSystems.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method runs the transform system over every chunk
+ *  with a transform component that is not static.
+ ***********************************************************/
+void SceneSystems::UpdateTransforms(EntityWorld& world, WorkerPool* pPool)
+{
+	EntityWorld::COMPONENT_MASK mask = EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM);
+	// static entities were placed when they were created
+	EntityWorld::COMPONENT_MASK excluded = EntityWorld::MaskOf(EntityWorld::COMPONENT_STATIC);
+	if (pPool != NULL)
+	{
+		world.ParallelForEachChunk(*pPool, mask, UpdateTransformChunk, excluded);
+	}
+	else
+	{
+		world.ForEachChunk(mask, UpdateTransformChunk, excluded);
+	}
+}
+
+/***********************************************************
+ *  UpdateTransformChunk()
+ *
+ *  This method writes translation * rotZ * rotY * rotX *
+ *  scale, the order SetTransformations() uses, straight from
+ *  the sines and cosines instead of multiplying four
+ *  matrices, so one pass over the chunk is limited by memory
+ *  rather than arithmetic.
+ ***********************************************************/
+void SceneSystems::UpdateTransformChunk(const EntityWorld::CHUNK_VIEW& chunk)
+{
+	const float DEGREES_TO_RADIANS = 3.14159265358979f / 180.0f;
+
+	EntityWorld::TRANSFORM_COMPONENT* transforms = chunk.Get<EntityWorld::TRANSFORM_COMPONENT>();
+	EntityWorld::BOUNDS_COMPONENT* bounds = chunk.Get<EntityWorld::BOUNDS_COMPONENT>();
+
+	for (int i = 0; i < chunk.count; i++)
+	{
+		EntityWorld::TRANSFORM_COMPONENT& transform = transforms[i];
+		glm::vec3 angles = transform.rotationDegrees * DEGREES_TO_RADIANS;
+		float sx = sinf(angles.x), cx = cosf(angles.x);
+		float sy = sinf(angles.y), cy = cosf(angles.y);
+		float sz = sinf(angles.z), cz = cosf(angles.z);
+
+		glm::mat4& model = transform.model;
+		model[0] = glm::vec4(
+			cy * cz,
+			cy * sz,
+			-sy,
+			0.0f) * transform.scale.x;
+		model[1] = glm::vec4(
+			cz * sy * sx - sz * cx,
+			sz * sy * sx + cz * cx,
+			cy * sx,
+			0.0f) * transform.scale.y;
+		model[2] = glm::vec4(
+			cz * sy * cx + sz * sx,
+			sz * sy * cx - cz * sx,
+			cy * cx,
+			0.0f) * transform.scale.z;
+		model[3] = glm::vec4(transform.position, 1.0f);
+	}
+
+	if (bounds != NULL)
+	{
+		for (int i = 0; i < chunk.count; i++)
+		{
+			bounds[i].world = BoundingVolumes::TransformBox(bounds[i].local, transforms[i].model);
+		}
+	}
+}
@@ -0,0 +1,22 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesystems.h
+// ============
+// per frame systems run over the scene entities
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EntityWorld.h"
+#include "WorkerPool.h"
+
+class SceneSystems
+{
+public:
+	// rebuild the model matrix of every non static transform from its
+	// scale, rotation and position, and the world bounds of the entities
+	// that have them; runs on the worker threads when a pool is passed in
+	static void UpdateTransforms(EntityWorld& world, WorkerPool* pPool);
+
+private:
+	static void UpdateTransformChunk(const EntityWorld::CHUNK_VIEW& chunk);
+};
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenetables.h
+// ============
+// built-in scene content declared as tables evaluated at compile time
+//
+// A built-in scene is a constexpr array of PART_DESC entries, one per basic
+// shape, with the same scale, rotation and position values as the
+// SetTransformations() calls it replaces.  BakeTable() turns the array into
+// model matrices and world bounds while the program is compiled, so the
+// static part of the scene costs no transform work at run time.  The math
+// here is written without the standard library functions, which are not
+// constexpr, and without glm, whose types are not literal types in every
+// configuration.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+class SceneTables
+{
+public:
+	struct VEC3
+	{
+		float x;
+		float y;
+		float z;
+	};
+
+	// local bounds of a mesh, or world bounds of a placed part
+	struct BOUNDS
+	{
+		VEC3 minimum;
+		VEC3 maximum;
+	};
+
+	// one basic shape of a built-in scene
+	struct PART_DESC
+	{
+		VEC3 scale;
+		VEC3 rotationDegrees;   // applied X, then Y, then Z
+		VEC3 position;
+		int mesh;
+		const char* material;
+		const char* texture;
+		float uScale;
+		float vScale;
+		int object;             // the pickable object the part belongs to
+	};
+
+	// what BakeTable() computes for a part
+	struct BAKED_PART
+	{
+		float model[16];        // column major, as glm stores it
+		BOUNDS bounds;
+	};
+
+	// sine and cosine of an angle in degrees
+	static constexpr double SinDegrees(double degrees)
+	{
+		// reduce to [-180, 180] so the series converges quickly
+		while (degrees > 180.0)
+		{
+			degrees -= 360.0;
+		}
+		while (degrees < -180.0)
+		{
+			degrees += 360.0;
+		}
+
+		double x = degrees * (3.14159265358979323846 / 180.0);
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 16; n++)
+		{
+			term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+			sum += term;
+		}
+		return(sum);
+	}
+
+	static constexpr double CosDegrees(double degrees)
+	{
+		return(SinDegrees(degrees + 90.0));
+	}
+
+	// translation * rotZ * rotY * rotX * scale, the order of
+	// SceneManager::SetTransformations(), and the bounds of the mesh
+	// placed by it
+	static constexpr BAKED_PART BakePart(const PART_DESC& part, const BOUNDS& local)
+	{
+		double sx = SinDegrees(part.rotationDegrees.x), cx = CosDegrees(part.rotationDegrees.x);
+		double sy = SinDegrees(part.rotationDegrees.y), cy = CosDegrees(part.rotationDegrees.y);
+		double sz = SinDegrees(part.rotationDegrees.z), cz = CosDegrees(part.rotationDegrees.z);
+
+		double rotation[3][3] = {
+			{ cy * cz, cy * sz, -sy },
+			{ cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx },
+			{ cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx } };
+		double scale[3] = { part.scale.x, part.scale.y, part.scale.z };
+		double position[3] = { part.position.x, part.position.y, part.position.z };
+
+		BAKED_PART baked = {};
+		for (int column = 0; column < 3; column++)
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				baked.model[column * 4 + row] = (float)(rotation[column][row] * scale[column]);
+			}
+			baked.model[column * 4 + 3] = 0.0f;
+		}
+		for (int row = 0; row < 3; row++)
+		{
+			baked.model[12 + row] = (float)position[row];
+		}
+		baked.model[15] = 1.0f;
+
+		// the transformed center plus the half extents projected onto
+		// the world axes, as BoundingVolumes::TransformBox() does
+		double center[3] = {
+			(local.minimum.x + local.maximum.x) * 0.5,
+			(local.minimum.y + local.maximum.y) * 0.5,
+			(local.minimum.z + local.maximum.z) * 0.5 };
+		double extent[3] = {
+			(local.maximum.x - local.minimum.x) * 0.5,
+			(local.maximum.y - local.minimum.y) * 0.5,
+			(local.maximum.z - local.minimum.z) * 0.5 };
+		double worldCenter[3] = { position[0], position[1], position[2] };
+		double worldExtent[3] = { 0.0, 0.0, 0.0 };
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 3; column++)
+			{
+				double element = rotation[column][row] * scale[column];
+				worldCenter[row] += element * center[column];
+				worldExtent[row] += ((element < 0.0) ? -element : element) * extent[column];
+			}
+		}
+
+		baked.bounds.minimum = { (float)(worldCenter[0] - worldExtent[0]), (float)(worldCenter[1] - worldExtent[1]), (float)(worldCenter[2] - worldExtent[2]) };
+		baked.bounds.maximum = { (float)(worldCenter[0] + worldExtent[0]), (float)(worldCenter[1] + worldExtent[1]), (float)(worldCenter[2] + worldExtent[2]) };
+		return(baked);
+	}
+
+	// bake every part of a table; meshBounds holds the local bounds of
+	// each mesh, indexed by PART_DESC::mesh
+	template <size_t N, size_t M>
+	static constexpr std::array<BAKED_PART, N> BakeTable(const std::array<PART_DESC, N>& parts, const BOUNDS (&meshBounds)[M])
+	{
+		std::array<BAKED_PART, N> baked = {};
+		for (size_t i = 0; i < N; i++)
+		{
+			baked[i] = BakePart(parts[i], meshBounds[parts[i].mesh]);
+		}
+		return(baked);
+	}
+
+	// a table written as a plain array, so the compiler counts the parts
+	template <size_t N>
+	static constexpr std::array<PART_DESC, N> ToArray(const PART_DESC (&parts)[N])
+	{
+		std::array<PART_DESC, N> result = {};
+		for (size_t i = 0; i < N; i++)
+		{
+			result[i] = parts[i];
+		}
+		return(result);
+	}
+
+	// join two tables, such as hand placed parts and a generated grid
+	template <size_t N, size_t M>
+	static constexpr std::array<PART_DESC, N + M> Concatenate(const std::array<PART_DESC, N>& first, const std::array<PART_DESC, M>& second)
+	{
+		std::array<PART_DESC, N + M> result = {};
+		for (size_t i = 0; i < N; i++)
+		{
+			result[i] = first[i];
+		}
+		for (size_t i = 0; i < M; i++)
+		{
+			result[N + i] = second[i];
+		}
+		return(result);
+	}
+
+	// a grid of copies of one part, stepped along X for the columns and
+	// along Z for the rows
+	template <size_t COLUMNS, size_t ROWS>
+	static constexpr std::array<PART_DESC, COLUMNS * ROWS> MakeGrid(const PART_DESC& first, float columnStep, float rowStep)
+	{
+		std::array<PART_DESC, COLUMNS * ROWS> grid = {};
+		for (size_t row = 0; row < ROWS; row++)
+		{
+			for (size_t column = 0; column < COLUMNS; column++)
+			{
+				PART_DESC part = first;
+				part.position.x = first.position.x + columnStep * column;
+				part.position.z = first.position.z + rowStep * row;
+				grid[row * COLUMNS + column] = part;
+			}
+		}
+		return(grid);
+	}
+};
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercompiler.cpp
+// ============
+// compile variants of the GLSL files with extra defines
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderCompiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/***********************************************************
+ *  ReadShaderFile()
+ *
+ *  This method reads the source text of a shader.
+ ***********************************************************/
+bool ShaderCompiler::ReadShaderFile(const char* filename, std::string& source)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open shader file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+	source = text.str();
+	return(true);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method compiles one shader stage.  The defines are
+ *  inserted after the #version line, which must stay the
+ *  first line of the source, and which is replaced when a
+ *  version is passed in.
+ ***********************************************************/
+GLuint ShaderCompiler::CompileShader(GLenum type, const char* filename, const std::string& defines, const char* version)
+{
+	std::string source;
+	if ((NULL == filename) || (ReadShaderFile(filename, source) == false))
+	{
+		return(0);
+	}
+
+	size_t versionEnd = 0;
+	if (source.compare(0, 8, "#version") == 0)
+	{
+		versionEnd = source.find('\n');
+		versionEnd = (versionEnd == std::string::npos) ? source.size() : versionEnd + 1;
+	}
+	if (NULL != version)
+	{
+		source.replace(0, versionEnd, version);
+		versionEnd = strlen(version);
+	}
+	source.insert(versionEnd, defines);
+
+	GLuint shader = glCreateShader(type);
+	const char* text = source.c_str();
+	glShaderSource(shader, 1, &text, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "Could not compile shader " << filename << ":" << std::endl << log << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+
+	return(shader);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method links compiled shaders into a program, and
+ *  returns 0 when they do not link.
+ ***********************************************************/
+GLuint ShaderCompiler::LinkProgram(const GLuint* shaders, int shaderCount, const char* name)
+{
+	GLuint program = glCreateProgram();
+	for (int i = 0; i < shaderCount; i++)
+	{
+		glAttachShader(program, shaders[i]);
+	}
+	glLinkProgram(program);
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		std::cout << "Could not link the " << name << " shader program:" << std::endl << log << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
@@ -0,0 +1,31 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercompiler.h
+// ============
+// compile variants of the GLSL files with extra defines
+//
+// ShaderManager loads a program from a vertex and a fragment file as they
+// are.  The renderers that need another variant of a file, such as the
+// scene's fragment shader with LAYERED_VIEWS or VERTEX_LIGHTING defined, or
+// that need other stages, compile them here: the defines go after the
+// #version line, which can also be replaced by a newer one.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+class ShaderCompiler
+{
+public:
+	// read the source text of a shader file
+	static bool ReadShaderFile(const char* filename, std::string& source);
+	// compile one stage; the #version line must be the first line of
+	// the file.  It is replaced by version when one is given, and the
+	// defines are inserted after it.  Returns 0 on failure
+	static GLuint CompileShader(GLenum type, const char* filename, const std::string& defines, const char* version = NULL);
+	// link compiled stages into a program, 0 when they do not link;
+	// the name is for the message
+	static GLuint LinkProgram(const GLuint* shaders, int shaderCount, const char* name);
+};
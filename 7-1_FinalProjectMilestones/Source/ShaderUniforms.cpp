@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.cpp
+// ============
+// uniform handles resolved once per program, and the per-draw uniform block
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniforms.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_DrawBlockName = "DrawUniforms";
+	// records reserved when the buffer is created
+	const int INITIAL_RECORDS = 256;
+}
+
+/***********************************************************
+ *  FindUniform()
+ *
+ *  This method returns the location of a uniform of a linked
+ *  program after checking its declared type and, for an
+ *  array, its size.  Uniforms the compiler removed as unused
+ *  are not an error unless the caller requires them.  GL
+ *  only names an array of a basic type by its first element,
+ *  so an array is looked up without an index.
+ ***********************************************************/
+GLint ShaderUniforms::FindUniform(GLuint program, const char* name, GLenum expectedType, GLint arraySize, bool bRequired)
+{
+	if ((program == 0) || (NULL == name))
+	{
+		return(-1);
+	}
+
+	GLuint index = GL_INVALID_INDEX;
+	glGetUniformIndices(program, 1, &name, &index);
+	if (index == GL_INVALID_INDEX)
+	{
+		if (bRequired)
+		{
+			std::cout << "Could not find uniform " << name << " in program " << program << std::endl;
+		}
+		return(-1);
+	}
+
+	GLint type = 0;
+	glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_TYPE, &type);
+	if ((GLenum)type != expectedType)
+	{
+		std::cout << "WARNING: uniform " << name << " is declared as " << GetTypeName((GLenum)type)
+			<< " in program " << program << " but used as " << GetTypeName(expectedType) << std::endl;
+		return(-1);
+	}
+
+	GLint size = 0;
+	glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_SIZE, &size);
+	if (size < arraySize)
+	{
+		std::cout << "WARNING: uniform " << name << " has " << size << " elements in program "
+			<< program << " but " << arraySize << " are written" << std::endl;
+		return(-1);
+	}
+
+	return(glGetUniformLocation(program, name));
+}
+
+/***********************************************************
+ *  Set()
+ *
+ *  This method writes a view into the program in use,
+ *  resolving the handles first when the program is not the
+ *  one they were resolved for.
+ ***********************************************************/
+void ViewUniforms::Set(GLuint program, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition)
+{
+	if (program != m_program)
+	{
+		m_program = program;
+		m_view.Resolve(m_program, "view");
+		m_projection.Resolve(m_program, "projection");
+		m_viewPosition.Resolve(m_program, "viewPosition");
+	}
+
+	m_view.Set(view);
+	m_projection.Set(projection);
+	m_viewPosition.Set(viewPosition);
+}
+
+/***********************************************************
+ *  GetTypeName()
+ *
+ *  This method returns the GLSL name of a uniform type.
+ ***********************************************************/
+const char* ShaderUniforms::GetTypeName(GLenum type)
+{
+	switch (type)
+	{
+	case GL_BOOL:
+		return("bool");
+	case GL_INT:
+		return("int");
+	case GL_FLOAT:
+		return("float");
+	case GL_FLOAT_VEC2:
+		return("vec2");
+	case GL_FLOAT_VEC3:
+		return("vec3");
+	case GL_FLOAT_VEC4:
+		return("vec4");
+	case GL_FLOAT_MAT4:
+		return("mat4");
+	case GL_SAMPLER_2D:
+		return("sampler2D");
+	default:
+		return("another type");
+	}
+}
+
+/***********************************************************
+ *  DrawUniformBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DrawUniformBuffer::DrawUniformBuffer()
+{
+	m_buffer = 0;
+	m_stride = sizeof(DRAW_UNIFORMS);
+	m_capacity = 0;
+	m_count = 0;
+}
+
+/***********************************************************
+ *  ~DrawUniformBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DrawUniformBuffer::~DrawUniformBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method creates the buffer and computes the distance
+ *  between records from the offset alignment of the context.
+ ***********************************************************/
+bool DrawUniformBuffer::Create()
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment < 1)
+	{
+		alignment = 1;
+	}
+	m_stride = ((sizeof(DRAW_UNIFORMS) + alignment - 1) / alignment) * alignment;
+
+	glGenBuffers(1, &m_buffer);
+	if (m_buffer == 0)
+	{
+		std::cout << "Could not create the draw uniform buffer" << std::endl;
+		return(false);
+	}
+
+	m_capacity = m_stride * INITIAL_RECORDS;
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_records.reserve((size_t)m_capacity);
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the buffer.
+ ***********************************************************/
+void DrawUniformBuffer::Destroy()
+{
+	if (m_buffer != 0)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+	m_capacity = 0;
+	m_count = 0;
+	m_records.clear();
+}
+
+/***********************************************************
+ *  BindProgram()
+ *
+ *  This method connects the DrawUniforms block of a program
+ *  to the binding point of the buffer.
+ ***********************************************************/
+bool DrawUniformBuffer::BindProgram(GLuint program)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(program, g_DrawBlockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		std::cout << "Could not find the " << g_DrawBlockName << " block in program " << program << std::endl;
+		return(false);
+	}
+
+	// the block may end right after its last member, before the
+	// padding of the record
+	GLint blockSize = 0;
+	glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+	if ((blockSize > (GLint)sizeof(DRAW_UNIFORMS)) || (blockSize <= (GLint)offsetof(DRAW_UNIFORMS, impostorFade)))
+	{
+		std::cout << "WARNING: the " << g_DrawBlockName << " block of program " << program << " takes "
+			<< blockSize << " bytes, DRAW_UNIFORMS " << sizeof(DRAW_UNIFORMS) << std::endl;
+	}
+
+	glUniformBlockBinding(program, blockIndex, BLOCK_BINDING);
+	return(true);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method starts a new set of records.
+ ***********************************************************/
+void DrawUniformBuffer::Begin()
+{
+	m_count = 0;
+	m_records.clear();
+}
+
+/***********************************************************
+ *  Append()
+ *
+ *  This method adds the record of the next draw and returns
+ *  its index for Bind().
+ ***********************************************************/
+int DrawUniformBuffer::Append(const DRAW_UNIFORMS& record)
+{
+	size_t offset = m_records.size();
+	m_records.resize(offset + (size_t)m_stride);
+	memcpy(&m_records[offset], &record, sizeof(DRAW_UNIFORMS));
+	return(m_count++);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method sends the records to the buffer.  The old
+ *  storage is orphaned first, so the upload does not wait for
+ *  draws still reading the previous set.
+ ***********************************************************/
+void DrawUniformBuffer::Upload()
+{
+	if ((m_buffer == 0) || (m_count == 0))
+	{
+		return;
+	}
+
+	GLsizeiptr size = (GLsizeiptr)m_records.size();
+	if (size > m_capacity)
+	{
+		m_capacity = size;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, &m_records[0]);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method points the block binding at the record of a
+ *  draw.
+ ***********************************************************/
+void DrawUniformBuffer::Bind(int index) const
+{
+	if ((m_buffer == 0) || (index < 0) || (index >= m_count))
+	{
+		return;
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, BLOCK_BINDING, m_buffer, m_stride * index, sizeof(DRAW_UNIFORMS));
+}
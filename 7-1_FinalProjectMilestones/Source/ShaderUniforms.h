@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.h
+// ============
+// uniform handles resolved once per program, and the per-draw uniform block
+//
+// A Uniform<T> keeps the location of one uniform, looked up by name when
+// the program has been linked, and writes values of exactly the type T.
+// The GLSL type that goes with each C++ type is given by GLSL_TYPE<T>, so
+// a handle of an unsupported type, or a value of another type than the
+// handle's, does not compile.  Resolving a handle also checks T against
+// the type the program declares, which reports a shader edit that changes
+// a type when the program is loaded rather than as a silently failing
+// glUniform*() call later.  A UniformArray<T, COUNT> does the same for an
+// array of a basic type, which GL only names by its first element, and
+// writes all of its elements with one call.
+//
+// The values that change with every draw are kept out of the default
+// uniform block: DrawUniformBuffer lays out one DRAW_UNIFORMS record per
+// draw of a list, uploads them all at once and selects a draw's record
+// with a single range binding.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <type_traits>
+#include <vector>
+
+// the texture unit read by a sampler uniform
+struct SAMPLER_UNIT
+{
+	int unit;
+};
+
+// the GLSL type of a C++ uniform type and how to write it; there is no
+// general definition, so only the types below can be used
+template <typename T>
+struct GLSL_TYPE;
+
+template <>
+struct GLSL_TYPE<bool>
+{
+	static const GLenum VALUE = GL_BOOL;
+	static void Write(GLint location, bool value) { glUniform1i(location, value ? 1 : 0); }
+};
+
+template <>
+struct GLSL_TYPE<int>
+{
+	static const GLenum VALUE = GL_INT;
+	static void Write(GLint location, int value) { glUniform1i(location, value); }
+	static void WriteArray(GLint location, GLsizei count, const int* values) { glUniform1iv(location, count, values); }
+};
+
+template <>
+struct GLSL_TYPE<float>
+{
+	static const GLenum VALUE = GL_FLOAT;
+	static void Write(GLint location, float value) { glUniform1f(location, value); }
+	static void WriteArray(GLint location, GLsizei count, const float* values) { glUniform1fv(location, count, values); }
+};
+
+template <>
+struct GLSL_TYPE<glm::vec2>
+{
+	static const GLenum VALUE = GL_FLOAT_VEC2;
+	static void Write(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, &value[0]); }
+};
+
+template <>
+struct GLSL_TYPE<glm::vec3>
+{
+	static const GLenum VALUE = GL_FLOAT_VEC3;
+	static void Write(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+};
+
+template <>
+struct GLSL_TYPE<glm::vec4>
+{
+	static const GLenum VALUE = GL_FLOAT_VEC4;
+	static void Write(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, &value[0]); }
+	static void WriteArray(GLint location, GLsizei count, const glm::vec4* values) { glUniform4fv(location, count, &values[0][0]); }
+};
+
+template <>
+struct GLSL_TYPE<glm::mat4>
+{
+	static const GLenum VALUE = GL_FLOAT_MAT4;
+	static void Write(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+};
+
+template <>
+struct GLSL_TYPE<SAMPLER_UNIT>
+{
+	static const GLenum VALUE = GL_SAMPLER_2D;
+	static void Write(GLint location, const SAMPLER_UNIT& value) { glUniform1i(location, value.unit); }
+};
+
+class ShaderUniforms
+{
+public:
+	// the location of a uniform of a linked program, or of the first
+	// element of an array of at least arraySize elements; -1 when the
+	// program does not use it, which is reported when bRequired, or uses
+	// it with another type than expectedType or as a shorter array, which
+	// is always reported
+	static GLint FindUniform(GLuint program, const char* name, GLenum expectedType, GLint arraySize = 1, bool bRequired = false);
+	// the GLSL spelling of a uniform type, for the messages
+	static const char* GetTypeName(GLenum type);
+};
+
+template <typename T>
+class Uniform
+{
+public:
+	Uniform() : m_location(-1) {}
+
+	// look up the uniform once the program is linked; returns false
+	// when the program does not use it, and writes are then ignored.
+	// A required uniform that is missing is reported
+	bool Resolve(GLuint program, const char* name, bool bRequired = false)
+	{
+		m_location = ShaderUniforms::FindUniform(program, name, GLSL_TYPE<T>::VALUE, 1, bRequired);
+		return(m_location >= 0);
+	}
+
+	bool IsValid() const { return m_location >= 0; }
+
+	// write a value into the program in use; the value must have the
+	// handle's type, an int is not taken for a bool
+	template <typename V>
+	void Set(const V& value) const
+	{
+		static_assert(std::is_same<V, T>::value, "the value does not have the type of the uniform");
+		if (m_location >= 0)
+		{
+			GLSL_TYPE<T>::Write(m_location, value);
+		}
+	}
+
+private:
+	GLint m_location;
+};
+
+template <typename T, int COUNT>
+class UniformArray
+{
+public:
+	UniformArray() : m_location(-1) {}
+
+	// look up the array by its name, without an index, once the program
+	// is linked; as Uniform<T>::Resolve()
+	bool Resolve(GLuint program, const char* name, bool bRequired = false)
+	{
+		m_location = ShaderUniforms::FindUniform(program, name, GLSL_TYPE<T>::VALUE, COUNT, bRequired);
+		return(m_location >= 0);
+	}
+
+	bool IsValid() const { return m_location >= 0; }
+
+	// write every element into the program in use with one call
+	void Set(const T (&values)[COUNT]) const
+	{
+		if (m_location >= 0)
+		{
+			GLSL_TYPE<T>::WriteArray(m_location, COUNT, values);
+		}
+	}
+
+private:
+	// the location of the first element; the others follow it
+	GLint m_location;
+};
+
+// the camera uniforms of the scene programs, for the code that sets a
+// view on whichever program a shader manager holds; the handles are
+// looked up again only when that program changes
+class ViewUniforms
+{
+public:
+	ViewUniforms() : m_program(0) {}
+
+	// write the view into the program, which must be in use; uniforms
+	// the program does not declare are skipped
+	void Set(GLuint program, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition);
+
+private:
+	// the program the handles were resolved for
+	GLuint m_program;
+	Uniform<glm::mat4> m_view;
+	Uniform<glm::mat4> m_projection;
+	Uniform<glm::vec3> m_viewPosition;
+};
+
+// std140 layout of the DrawUniforms block of the scene shaders
+struct DRAW_UNIFORMS
+{
+	glm::mat4 model;
+	glm::vec4 objectColor;
+	// the Material struct: vec3 diffuseColor, vec3 specularColor and
+	// float shininess, the last one packed after the specular color
+	glm::vec3 diffuseColor;
+	float padding;
+	glm::vec3 specularColor;
+	float shininess;
+	glm::vec2 UVscale;
+	// GLSL bools take four bytes in a block
+	GLint bUseTexture;
+	GLint bUseVideoTexture;
+	// 0 draws the part, 1 leaves it to the impostor of its assembly
+	float impostorFade;
+	// the record is a whole number of vec4 rows
+	float fadePadding[3];
+};
+
+static_assert(sizeof(DRAW_UNIFORMS) == 144, "DRAW_UNIFORMS must match the std140 layout of DrawUniforms");
+
+class DrawUniformBuffer
+{
+public:
+	// binding point of the DrawUniforms block; 0 is the LayeredViews block
+	static const GLuint BLOCK_BINDING = 1;
+
+	// constructor
+	DrawUniformBuffer();
+	// destructor
+	~DrawUniformBuffer();
+
+	// create the buffer; needs a current context
+	bool Create();
+	void Destroy();
+	// connect a program's DrawUniforms block to the binding point;
+	// false when the program has no such block
+	static bool BindProgram(GLuint program);
+
+	// start a new set of records, replacing the previous one
+	void Begin();
+	// add the record of the next draw and return its index
+	int Append(const DRAW_UNIFORMS& record);
+	// upload the records added since Begin() in one call
+	void Upload();
+	// select the record of a draw for the block
+	void Bind(int index) const;
+
+private:
+	GLuint m_buffer;
+	// records are placed at multiples of the offset alignment
+	GLsizeiptr m_stride;
+	GLsizeiptr m_capacity;
+	int m_count;
+	std::vector<unsigned char> m_records;
+};
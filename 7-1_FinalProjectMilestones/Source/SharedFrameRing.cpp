@@ -0,0 +1,529 @@
+///////////////////////////////////////////////////////////////////////////////
+// sharedframering.cpp
+// ============
+// publish rendered frames into a named shared memory ring buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SharedFrameRing.h"
+
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#include <ctime>
+#endif
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// alignment of the pixel data inside a slot and of the slot size
+	const size_t PIXEL_ALIGNMENT = 64;
+	const size_t SLOT_ALIGNMENT = 4096;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return((value + alignment - 1) & ~(alignment - 1));
+	}
+}
+
+/***********************************************************
+ *  SharedFrameRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SharedFrameRing::SharedFrameRing()
+	: m_readback(3)
+{
+	m_bProducer = false;
+	m_pMapping = NULL;
+	m_mappingSize = 0;
+	m_pHeader = NULL;
+	m_mappingHandle = -1;
+	m_nextSequence = 1;
+	m_publishedCount = 0;
+	m_skippedCount = 0;
+	m_startTime = 0.0;
+}
+
+/***********************************************************
+ *  ~SharedFrameRing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SharedFrameRing::~SharedFrameRing()
+{
+	Close();
+}
+
+/***********************************************************
+ *  MapRegion()
+ *
+ *  This method creates or opens the named shared memory
+ *  object and maps it into the address space.
+ ***********************************************************/
+bool SharedFrameRing::MapRegion(const char* name, size_t size, bool bCreate)
+{
+#ifdef _WIN32
+	HANDLE hMapping = NULL;
+	if (bCreate)
+	{
+		hMapping = CreateFileMappingA(
+			INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			(DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF),
+			name);
+	}
+	else
+	{
+		hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	}
+	if (NULL == hMapping)
+	{
+		std::cout << "SharedFrameRing: could not open mapping " << name << std::endl;
+		return(false);
+	}
+
+	void* pView = MapViewOfFile(hMapping, bCreate ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+	if (NULL == pView)
+	{
+		CloseHandle(hMapping);
+		std::cout << "SharedFrameRing: could not map view of " << name << std::endl;
+		return(false);
+	}
+	m_mappingHandle = (intptr_t)hMapping;
+	m_pMapping = (unsigned char*)pView;
+#else
+	// POSIX shared memory names must start with a single slash
+	std::string objectName = name;
+	if (objectName.empty() || (objectName[0] != '/'))
+	{
+		objectName = "/" + objectName;
+	}
+
+	int fd = -1;
+	if (bCreate)
+	{
+		fd = shm_open(objectName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+		if ((fd >= 0) && (ftruncate(fd, (off_t)size) != 0))
+		{
+			close(fd);
+			shm_unlink(objectName.c_str());
+			fd = -1;
+		}
+	}
+	else
+	{
+		fd = shm_open(objectName.c_str(), O_RDONLY, 0);
+		struct stat info;
+		if ((fd >= 0) && (fstat(fd, &info) == 0))
+		{
+			size = (size_t)info.st_size;
+		}
+	}
+	if (fd < 0)
+	{
+		std::cout << "SharedFrameRing: could not open shared memory " << objectName << std::endl;
+		return(false);
+	}
+
+	void* pView = mmap(NULL, size, bCreate ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == pView)
+	{
+		close(fd);
+		if (bCreate)
+		{
+			shm_unlink(objectName.c_str());
+		}
+		std::cout << "SharedFrameRing: could not map shared memory " << objectName << std::endl;
+		return(false);
+	}
+	m_mappingHandle = fd;
+	m_pMapping = (unsigned char*)pView;
+	m_name = objectName;
+#endif
+
+	m_mappingSize = size;
+	return(true);
+}
+
+/***********************************************************
+ *  CreateProducer()
+ *
+ *  This method creates the shared memory ring and writes
+ *  its header.  A larger frame replaces the ring with one
+ *  sized for it, see GrowSlots().
+ ***********************************************************/
+bool SharedFrameRing::CreateProducer(const char* name, int slotCount, int maxWidth, int maxHeight)
+{
+	Close();
+
+	if ((slotCount < 2) || (maxWidth <= 0) || (maxHeight <= 0))
+	{
+		return(false);
+	}
+
+	size_t headerSize = AlignUp(sizeof(SHARED_RING_HEADER), SLOT_ALIGNMENT);
+	size_t pixelOffset = AlignUp(sizeof(SHARED_FRAME_SLOT), PIXEL_ALIGNMENT);
+	size_t slotSize = AlignUp(pixelOffset + ((size_t)maxWidth * 4 * maxHeight), SLOT_ALIGNMENT);
+	size_t totalSize = headerSize + (slotSize * slotCount);
+
+	m_name = name;
+	if (MapRegion(name, totalSize, true) == false)
+	{
+		return(false);
+	}
+	m_bProducer = true;
+
+	memset(m_pMapping, 0, totalSize);
+
+	// the atomics live in shared memory, so construct them in place
+	m_pHeader = new (m_pMapping) SHARED_RING_HEADER;
+	m_pHeader->slotCount = (uint32_t)slotCount;
+	m_pHeader->slotSize = (uint32_t)slotSize;
+	m_pHeader->maxWidth = (uint32_t)maxWidth;
+	m_pHeader->maxHeight = (uint32_t)maxHeight;
+	m_pHeader->headerSize = (uint32_t)headerSize;
+#ifdef _WIN32
+	m_pHeader->producerId = (uint32_t)GetCurrentProcessId();
+#else
+	m_pHeader->producerId = (uint32_t)getpid();
+#endif
+	m_pHeader->latestSequence.store(0);
+	m_pHeader->notifyCounter.store(0);
+	m_pHeader->reserved = 0;
+
+	for (int i = 0; i < slotCount; i++)
+	{
+		SHARED_FRAME_SLOT* pSlot = new (m_pMapping + headerSize + (slotSize * i)) SHARED_FRAME_SLOT;
+		pSlot->lock.store(0);
+		pSlot->pixelOffset = (uint32_t)pixelOffset;
+	}
+
+	// the magic is written last so consumers never see a half-built header
+	m_pHeader->version = RING_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	m_pHeader->magic = RING_MAGIC;
+
+	m_nextSequence = 1;
+	m_startTime = glfwGetTime();
+
+	std::cout << "INFO: Shared frame ring '" << name << "' created, " << slotCount << " slots of "
+		<< maxWidth << "x" << maxHeight << " (" << (totalSize / (1024 * 1024)) << " MB)" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  OpenConsumer()
+ *
+ *  This method maps an existing ring that was created by a
+ *  running producer.
+ ***********************************************************/
+bool SharedFrameRing::OpenConsumer(const char* name)
+{
+	Close();
+
+	// a size of zero maps the whole object on Windows, and POSIX
+	// picks the real size up from fstat
+	if (MapRegion(name, 0, false) == false)
+	{
+		return(false);
+	}
+	m_bProducer = false;
+	m_pHeader = (SHARED_RING_HEADER*)m_pMapping;
+
+	if ((m_pHeader->magic != RING_MAGIC) || (m_pHeader->version != RING_VERSION))
+	{
+		std::cout << "SharedFrameRing: " << name << " is not a compatible frame ring" << std::endl;
+		Close();
+		return(false);
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method unmaps the ring.  The producer also removes
+ *  the name so that stale rings do not linger.
+ ***********************************************************/
+void SharedFrameRing::Close()
+{
+	if (m_bProducer)
+	{
+		m_readback.Destroy();
+	}
+
+	if (NULL != m_pMapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pMapping);
+		CloseHandle((HANDLE)m_mappingHandle);
+#else
+		munmap(m_pMapping, m_mappingSize);
+		close((int)m_mappingHandle);
+		if (m_bProducer)
+		{
+			shm_unlink(m_name.c_str());
+		}
+#endif
+	}
+
+	m_pMapping = NULL;
+	m_pHeader = NULL;
+	m_mappingSize = 0;
+	m_mappingHandle = -1;
+	m_bProducer = false;
+}
+
+/***********************************************************
+ *  GetSlot()
+ *
+ *  This method returns the slot that a sequence number
+ *  maps to.  Sequence numbers start at 1.
+ ***********************************************************/
+SharedFrameRing::SHARED_FRAME_SLOT* SharedFrameRing::GetSlot(uint64_t sequence) const
+{
+	size_t index = (size_t)((sequence - 1) % m_pHeader->slotCount);
+	return((SHARED_FRAME_SLOT*)(m_pMapping + m_pHeader->headerSize + ((size_t)m_pHeader->slotSize * index)));
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is called once per frame after the scene has
+ *  been rendered.  It schedules the asynchronous readback of
+ *  the back buffer; the pixels reach shared memory when the
+ *  readback completes a few frames later.  If the GPU falls
+ *  behind, frames are dropped instead of stalling.
+ ***********************************************************/
+void SharedFrameRing::CaptureFrame(int width, int height, uint64_t frameNumber)
+{
+	if ((m_bProducer == false) || (NULL == m_pHeader))
+	{
+		return;
+	}
+
+	FrameReadback::ReadbackHandler publish =
+		[this](const FrameReadback::READBACK_FRAME& frame) { PublishFrame(frame); };
+
+	if ((width > (int)m_pHeader->maxWidth) || (height > (int)m_pHeader->maxHeight))
+	{
+		if (GrowSlots(width, height) == false)
+		{
+			m_skippedCount++;
+			return;
+		}
+	}
+
+	glReadBuffer(GL_BACK);
+	m_readback.QueueReadback(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frameNumber, 0, false, publish);
+}
+
+/***********************************************************
+ *  GrowSlots()
+ *
+ *  This method is called when the framebuffer has grown
+ *  past the slots.  The readbacks in flight still fit the
+ *  old ring and are published there, then the old header is
+ *  marked as replaced and a ring sized for the new frame is
+ *  created under the same name.  When that fails, as it does
+ *  on Windows while a consumer keeps the old mapping open,
+ *  publishing stops with one message.
+ ***********************************************************/
+bool SharedFrameRing::GrowSlots(int width, int height)
+{
+	FlushPendingFrames();
+
+	std::string name = m_name;
+	int slotCount = (int)m_pHeader->slotCount;
+	int maxWidth = std::max(width, (int)m_pHeader->maxWidth);
+	int maxHeight = std::max(height, (int)m_pHeader->maxHeight);
+
+	m_pHeader->magic = 0;
+	NotifyConsumers();
+
+	if (CreateProducer(name.c_str(), slotCount, maxWidth, maxHeight) == false)
+	{
+		std::cout << "WARNING: Shared frame ring '" << name << "' could not grow to " << width << "x" << height
+			<< ", frame publishing stopped" << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  FlushPendingFrames()
+ *
+ *  This method publishes the readbacks still in flight.
+ ***********************************************************/
+void SharedFrameRing::FlushPendingFrames()
+{
+	if (m_bProducer)
+	{
+		m_readback.Flush(
+			[this](const FrameReadback::READBACK_FRAME& frame) { PublishFrame(frame); });
+	}
+}
+
+/***********************************************************
+ *  PublishFrame()
+ *
+ *  This method copies a mapped readback buffer into the next
+ *  slot using the seqlock protocol described in the header.
+ ***********************************************************/
+void SharedFrameRing::PublishFrame(const FrameReadback::READBACK_FRAME& frame)
+{
+	uint64_t sequence = m_nextSequence++;
+	SHARED_FRAME_SLOT* pSlot = GetSlot(sequence);
+
+	// mark the slot as being written before touching the pixels
+	pSlot->lock.store((sequence * 2) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	unsigned char* pDestination = (unsigned char*)pSlot + pSlot->pixelOffset;
+	memcpy(pDestination, frame.pixels, (size_t)frame.stride * frame.height);
+
+	pSlot->sequence = sequence;
+	pSlot->frameNumber = frame.frameNumber;
+	pSlot->timestamp = frame.queueTime - m_startTime;
+	pSlot->width = (uint32_t)frame.width;
+	pSlot->height = (uint32_t)frame.height;
+	pSlot->stride = (uint32_t)frame.stride;
+	pSlot->format = (uint32_t)frame.format;
+
+	// an even lock value means the slot now holds a complete frame
+	pSlot->lock.store((sequence * 2) + 2, std::memory_order_release);
+	m_pHeader->latestSequence.store(sequence, std::memory_order_release);
+	m_publishedCount++;
+
+	NotifyConsumers();
+}
+
+/***********************************************************
+ *  NotifyConsumers()
+ *
+ *  This method bumps the notify word and wakes any consumer
+ *  sleeping on it.
+ ***********************************************************/
+void SharedFrameRing::NotifyConsumers()
+{
+	m_pHeader->notifyCounter.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+	// a shared (not private) futex so waiters in other processes wake up
+	syscall(SYS_futex, (uint32_t*)&m_pHeader->notifyCounter, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+/***********************************************************
+ *  WaitForFrame()
+ *
+ *  This method blocks the consumer until the producer has
+ *  published a frame newer than lastSequence.
+ ***********************************************************/
+uint64_t SharedFrameRing::WaitForFrame(uint64_t lastSequence, int timeoutMilliseconds)
+{
+	if (NULL == m_pHeader)
+	{
+		return(0);
+	}
+
+	std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+
+	while (true)
+	{
+		uint32_t notifyValue = m_pHeader->notifyCounter.load(std::memory_order_acquire);
+		uint64_t latest = m_pHeader->latestSequence.load(std::memory_order_acquire);
+		if (latest > lastSequence)
+		{
+			return(latest);
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now >= deadline)
+		{
+			return(0);
+		}
+
+#ifdef __linux__
+		long long remaining = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+		struct timespec timeout;
+		timeout.tv_sec = (time_t)(remaining / 1000000000LL);
+		timeout.tv_nsec = (long)(remaining % 1000000000LL);
+		// returns immediately if the counter moved since it was read
+		syscall(SYS_futex, (uint32_t*)&m_pHeader->notifyCounter, FUTEX_WAIT, notifyValue, &timeout, NULL, 0);
+#else
+		(void)notifyValue;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+	}
+}
+
+/***********************************************************
+ *  AcquireFrame()
+ *
+ *  This method returns the slot holding the given frame if
+ *  it is complete and has not been overwritten yet.
+ ***********************************************************/
+const SharedFrameRing::SHARED_FRAME_SLOT* SharedFrameRing::AcquireFrame(uint64_t sequence, uint64_t& lockValue) const
+{
+	if ((NULL == m_pHeader) || (sequence == 0))
+	{
+		return(NULL);
+	}
+
+	const SHARED_FRAME_SLOT* pSlot = GetSlot(sequence);
+	uint64_t value = pSlot->lock.load(std::memory_order_acquire);
+	if (value != ((sequence * 2) + 2))
+	{
+		return(NULL);
+	}
+
+	lockValue = value;
+	return(pSlot);
+}
+
+/***********************************************************
+ *  ValidateFrame()
+ *
+ *  This method is called after the consumer has finished
+ *  reading an acquired slot.  False means the producer
+ *  reused the slot meanwhile and the data may be torn.
+ ***********************************************************/
+bool SharedFrameRing::ValidateFrame(const SHARED_FRAME_SLOT* pSlot, uint64_t lockValue) const
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return(pSlot->lock.load(std::memory_order_relaxed) == lockValue);
+}
+
+/***********************************************************
+ *  GetPixels()
+ *
+ *  This method returns the pixel data of an acquired slot.
+ ***********************************************************/
+const unsigned char* SharedFrameRing::GetPixels(const SHARED_FRAME_SLOT* pSlot) const
+{
+	return((const unsigned char*)pSlot + pSlot->pixelOffset);
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// sharedframering.h
+// ============
+// publish rendered frames into a named shared memory ring buffer
+//
+// The mapping starts with a SHARED_RING_HEADER followed by slotCount slots.
+// Each slot is a SHARED_FRAME_SLOT header and the pixel data of one frame,
+// RGBA8 with rows ordered bottom-to-top as OpenGL returns them.
+//
+// Every slot carries a sequence number used as a seqlock: it is odd while
+// the producer is writing the slot and even once the frame is complete.  A
+// consumer reads the pixels in place and checks the sequence again when it
+// is done; if it changed, the producer lapped the consumer and the frame
+// must be discarded.  No copies are made on the consumer side.
+//
+// Consumers wait for new frames on the header's notify word, which is a
+// futex on Linux.  Other platforms fall back to short polling sleeps.
+//
+// When the framebuffer grows past the slot size the producer replaces the
+// ring with a larger one under the same name.  It clears the magic of the
+// old header first, so a consumer that sees IsReplaced() opens the name
+// again to follow it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameReadback.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class SharedFrameRing
+{
+public:
+	static const uint32_t RING_MAGIC = 0x46524E47;   // 'FRNG'
+	static const uint32_t RING_VERSION = 1;
+
+	struct SHARED_RING_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;
+		uint32_t slotSize;         // bytes from one slot header to the next
+		uint32_t maxWidth;
+		uint32_t maxHeight;
+		uint32_t headerSize;       // offset of the first slot
+		uint32_t producerId;
+		// sequence number of the most recently completed frame, 0 if none
+		std::atomic<uint64_t> latestSequence;
+		// bumped after every published frame, consumers futex-wait on it
+		std::atomic<uint32_t> notifyCounter;
+		uint32_t reserved;
+	};
+
+	struct SHARED_FRAME_SLOT
+	{
+		// seqlock word, odd while the slot is being written
+		std::atomic<uint64_t> lock;
+		uint64_t sequence;         // ring-wide frame sequence number
+		uint64_t frameNumber;      // render loop frame counter
+		double timestamp;          // seconds since the producer started
+		uint32_t width;
+		uint32_t height;
+		uint32_t stride;
+		uint32_t format;           // GL format enum of the pixel data
+		uint32_t pixelOffset;      // from the start of this slot
+		uint32_t reserved;
+	};
+
+	// constructor
+	SharedFrameRing();
+	// destructor
+	~SharedFrameRing();
+
+	// producer side: create the named mapping sized for maxWidth x maxHeight
+	bool CreateProducer(const char* name, int slotCount, int maxWidth, int maxHeight);
+	// producer side: queue a readback of the back buffer for this frame and
+	// publish any earlier frames whose readback has finished
+	void CaptureFrame(int width, int height, uint64_t frameNumber);
+	// producer side: wait for outstanding readbacks during shutdown
+	void FlushPendingFrames();
+
+	// consumer side: map an existing ring read-only
+	bool OpenConsumer(const char* name);
+	// consumer side: block until a frame newer than lastSequence exists or
+	// the timeout expires; returns the latest sequence, 0 on timeout
+	uint64_t WaitForFrame(uint64_t lastSequence, int timeoutMilliseconds);
+	// consumer side: get the slot holding the given sequence, or NULL when
+	// it has already been overwritten; lockValue receives the seqlock word
+	const SHARED_FRAME_SLOT* AcquireFrame(uint64_t sequence, uint64_t& lockValue) const;
+	// consumer side: true if the slot still holds the frame after reading
+	bool ValidateFrame(const SHARED_FRAME_SLOT* pSlot, uint64_t lockValue) const;
+	// consumer side: pointer to the pixels of an acquired slot
+	const unsigned char* GetPixels(const SHARED_FRAME_SLOT* pSlot) const;
+	// consumer side: true once the producer has replaced the mapped ring
+	bool IsReplaced() const { return (NULL != m_pHeader) && (m_pHeader->magic != RING_MAGIC); }
+
+	// release the mapping (the producer also unlinks the name)
+	void Close();
+
+	uint64_t GetPublishedCount() const { return m_publishedCount; }
+	uint64_t GetSkippedCount() const { return m_skippedCount; }
+	const FrameReadback& GetReadback() const { return m_readback; }
+
+private:
+	std::string m_name;
+	bool m_bProducer;
+	unsigned char* m_pMapping;
+	size_t m_mappingSize;
+	SHARED_RING_HEADER* m_pHeader;
+	// platform handle of the mapping (file descriptor or HANDLE)
+	intptr_t m_mappingHandle;
+	uint64_t m_nextSequence;
+	uint64_t m_publishedCount;
+	uint64_t m_skippedCount;
+	double m_startTime;
+
+	FrameReadback m_readback;
+
+	SHARED_FRAME_SLOT* GetSlot(uint64_t sequence) const;
+	// replace the ring with one whose slots hold width x height frames
+	bool GrowSlots(int width, int height);
+	// copy a finished readback into the next ring slot
+	void PublishFrame(const FrameReadback::READBACK_FRAME& frame);
+	// wake every consumer blocked in WaitForFrame
+	void NotifyConsumers();
+	bool MapRegion(const char* name, size_t size, bool bCreate);
+};
@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////////////////////////////
+// startuptimeline.cpp
+// ============
+// record what every thread does from launch until the first frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StartupTimeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	struct SPAN
+	{
+		std::string name;
+		double start;
+		double end;
+		// threads are numbered in the order they first add a span, so
+		// the thread of main() is 0
+		int thread;
+	};
+
+	// set while the static objects are constructed, before main()
+	const std::chrono::steady_clock::time_point g_launchTime = std::chrono::steady_clock::now();
+
+	std::mutex g_mutex;
+	std::vector<SPAN> g_spans;
+	std::vector<std::thread::id> g_threads;
+	bool g_bFinished = false;
+
+	// the number of the calling thread; g_mutex must be held
+	int GetThreadNumber()
+	{
+		std::thread::id id = std::this_thread::get_id();
+		for (size_t i = 0; i < g_threads.size(); i++)
+		{
+			if (g_threads[i] == id)
+			{
+				return((int)i);
+			}
+		}
+		g_threads.push_back(id);
+		return((int)g_threads.size() - 1);
+	}
+
+	std::string GetThreadName(int thread)
+	{
+		return((thread == 0) ? std::string("main") : "loader " + std::to_string(thread));
+	}
+
+	// the name with the characters JSON strings cannot hold escaped
+	std::string EscapeJson(const std::string& text)
+	{
+		std::string escaped;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			if ((text[i] == '"') || (text[i] == '\\'))
+			{
+				escaped += '\\';
+			}
+			escaped += text[i];
+		}
+		return(escaped);
+	}
+
+	bool WriteTrace(const char* traceFile)
+	{
+		std::ofstream file(traceFile);
+		if (!file.is_open())
+		{
+			return(false);
+		}
+
+		// complete events, with the times in microseconds
+		file << "{\"traceEvents\":[" << std::endl;
+		for (size_t i = 0; i < g_spans.size(); i++)
+		{
+			const SPAN& span = g_spans[i];
+			file << "{\"name\":\"" << EscapeJson(span.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+				<< ",\"ts\":" << (long long)(span.start * 1000.0)
+				<< ",\"dur\":" << (long long)((span.end - span.start) * 1000.0) << "},"
+				<< std::endl;
+		}
+		for (size_t i = 0; i < g_threads.size(); i++)
+		{
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+				<< ",\"args\":{\"name\":\"" << GetThreadName((int)i) << "\"}}" << ((i + 1 < g_threads.size()) ? "," : "") << std::endl;
+		}
+		file << "]}" << std::endl;
+		return(file.good());
+	}
+}
+
+/***********************************************************
+ *  Now()
+ *
+ *  This method returns the time since the launch.
+ ***********************************************************/
+double StartupTimeline::Now()
+{
+	return(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_launchTime).count());
+}
+
+/***********************************************************
+ *  AddSpan()
+ *
+ *  This method records a phase of the calling thread.
+ ***********************************************************/
+void StartupTimeline::AddSpan(const std::string& name, double start, double end)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	if (g_bFinished)
+	{
+		return;
+	}
+
+	SPAN span;
+	span.name = name;
+	span.start = start;
+	span.end = end;
+	span.thread = GetThreadNumber();
+	g_spans.push_back(span);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method logs the recorded phases in the order they
+ *  started, and the time from the launch to the first
+ *  frame, and stops recording.
+ ***********************************************************/
+void StartupTimeline::Finish(const char* traceFile)
+{
+	double firstFrame = Now();
+
+	std::lock_guard<std::mutex> lock(g_mutex);
+	if (g_bFinished)
+	{
+		return;
+	}
+	g_bFinished = true;
+
+	std::stable_sort(g_spans.begin(), g_spans.end(),
+		[](const SPAN& first, const SPAN& second) { return(first.start < second.start); });
+
+	std::cout << "INFO: Startup timeline, first frame presented after " << firstFrame << " ms:" << std::endl;
+	for (size_t i = 0; i < g_spans.size(); i++)
+	{
+		const SPAN& span = g_spans[i];
+		char line[64];
+		snprintf(line, sizeof(line), "  %8.1f - %8.1f ms  %-10s", span.start, span.end, GetThreadName(span.thread).c_str());
+		std::cout << line << span.name << std::endl;
+	}
+
+	if (NULL != traceFile)
+	{
+		if (WriteTrace(traceFile))
+		{
+			std::cout << "INFO: Startup trace written to " << traceFile << std::endl;
+		}
+		else
+		{
+			std::cout << "Could not write startup trace file:" << traceFile << std::endl;
+		}
+	}
+
+	g_spans.clear();
+	g_spans.shrink_to_fit();
+}
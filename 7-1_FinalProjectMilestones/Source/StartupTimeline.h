@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+// startuptimeline.h
+// ============
+// record what every thread does from launch until the first frame
+//
+// The phases of the startup add a span, its start and end in milliseconds
+// since the program was launched, from whichever thread runs them.  When
+// the first frame has been presented, Finish() logs the spans in order of
+// their start with the thread that ran them and the time to the first
+// frame, and can write them as a trace file in the Trace Event format
+// that chrome://tracing and Perfetto open.  Spans added after Finish()
+// are ignored, so the loads of a running scene are not recorded.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+class StartupTimeline
+{
+public:
+	// milliseconds since the program was launched
+	static double Now();
+
+	// record a phase that ran on the calling thread from start to end;
+	// safe to call from any thread
+	static void AddSpan(const std::string& name, double start, double end);
+	static void AddSpan(const std::string& name, double start) { AddSpan(name, start, Now()); }
+
+	// log the timeline, and write it to the trace file when one is
+	// passed in; call once, after the first frame has been presented
+	static void Finish(const char* traceFile);
+};
@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+// telemetrypublisher.cpp
+// ============
+// stream the statistics of every frame to monitoring over a local socket
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TelemetryPublisher.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// how often the telemetry thread drains the ring; at 60 frames per
+	// second a few frames are sent together
+	const int SERVE_INTERVAL_MILLISECONDS = 50;
+	// a client this far behind is disconnected
+	const size_t MAX_PENDING_BYTES = 256 * 1024;
+	// clients served at once
+	const size_t MAX_CLIENTS = 8;
+
+#ifdef _WIN32
+	typedef SOCKET SOCKET_HANDLE;
+	const intptr_t NO_SOCKET = (intptr_t)INVALID_SOCKET;
+#else
+	typedef int SOCKET_HANDLE;
+	const intptr_t NO_SOCKET = -1;
+#endif
+
+	int GetProcessIdentifier()
+	{
+#ifdef _WIN32
+		return((int)GetCurrentProcessId());
+#else
+		return((int)getpid());
+#endif
+	}
+
+	// switch a socket to calls that return instead of waiting
+	bool SetNonBlocking(intptr_t socket)
+	{
+#ifdef _WIN32
+		u_long bNonBlocking = 1;
+		return(ioctlsocket((SOCKET_HANDLE)socket, FIONBIO, &bNonBlocking) == 0);
+#else
+		int flags = fcntl((SOCKET_HANDLE)socket, F_GETFL, 0);
+		return((flags >= 0) && (fcntl((SOCKET_HANDLE)socket, F_SETFL, flags | O_NONBLOCK) == 0));
+#endif
+	}
+
+	// keep a send to a client that has gone from raising SIGPIPE, which
+	// would end the process; Linux passes MSG_NOSIGNAL to send()
+	// instead, and Windows has no such signal
+	bool SetNoSignal(intptr_t socket)
+	{
+#ifdef __APPLE__
+		int bNoSignal = 1;
+		return(setsockopt((SOCKET_HANDLE)socket, SOL_SOCKET, SO_NOSIGPIPE, &bNoSignal, sizeof(bNoSignal)) == 0);
+#else
+		(void)socket;
+		return(true);
+#endif
+	}
+
+	// true when a failed call only means it would have had to wait
+	bool WouldBlock()
+	{
+#ifdef _WIN32
+		return(WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+		return((errno == EAGAIN) || (errno == EWOULDBLOCK));
+#endif
+	}
+
+	// remove the socket file at a path; returns false, removing
+	// nothing, when something else than a socket is there, so a
+	// mistyped --telemetry path cannot delete a user's file
+	bool RemoveSocketFile(const char* path)
+	{
+#ifdef _WIN32
+		// Windows keeps a Unix domain socket as a reparse point with
+		// its own tag
+		WIN32_FIND_DATAA findData;
+		HANDLE find = FindFirstFileA(path, &findData);
+		if (find == INVALID_HANDLE_VALUE)
+		{
+			return(true);
+		}
+		FindClose(find);
+		if (((findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) ||
+			(findData.dwReserved0 != IO_REPARSE_TAG_AF_UNIX))
+		{
+			return(false);
+		}
+		DeleteFileA(path);
+#else
+		struct stat status;
+		if (lstat(path, &status) != 0)
+		{
+			return(true);
+		}
+		if (!S_ISSOCK(status.st_mode))
+		{
+			return(false);
+		}
+		unlink(path);
+#endif
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  TelemetryPublisher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TelemetryPublisher::TelemetryPublisher()
+{
+	memset(m_ring, 0, sizeof(m_ring));
+	m_writeIndex = 0;
+	m_readIndex = 0;
+	m_droppedCount = 0;
+	m_listenSocket = NO_SOCKET;
+	m_bStop = false;
+	m_bStarted = false;
+}
+
+/***********************************************************
+ *  ~TelemetryPublisher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TelemetryPublisher::~TelemetryPublisher()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method creates the listening socket and starts the
+ *  telemetry thread.  A socket file left behind by an
+ *  earlier run is removed first; any other file at the
+ *  path is left alone and the socket is not created.
+ ***********************************************************/
+bool TelemetryPublisher::Start(const char* socketPath)
+{
+	if (m_bStarted || (NULL == socketPath))
+	{
+		return(false);
+	}
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		std::cout << "Could not create telemetry socket, the path is too long: " << socketPath << std::endl;
+		return(false);
+	}
+	strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+	if (!RemoveSocketFile(socketPath))
+	{
+		std::cout << "Could not create telemetry socket, " << socketPath << " exists and is not a socket" << std::endl;
+		return(false);
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		std::cout << "Could not initialize Winsock for the telemetry socket" << std::endl;
+		return(false);
+	}
+#endif
+	m_listenSocket = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_listenSocket == NO_SOCKET)
+	{
+		std::cout << "Could not create telemetry socket " << socketPath << std::endl;
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return(false);
+	}
+
+	if ((bind((SOCKET_HANDLE)m_listenSocket, (const sockaddr*)&address, sizeof(address)) != 0) ||
+		(listen((SOCKET_HANDLE)m_listenSocket, (int)MAX_CLIENTS) != 0) ||
+		!SetNonBlocking(m_listenSocket))
+	{
+		std::cout << "Could not listen on telemetry socket " << socketPath << std::endl;
+		CloseSocket(m_listenSocket);
+		m_listenSocket = NO_SOCKET;
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return(false);
+	}
+
+	m_socketPath = socketPath;
+	m_bStop = false;
+	m_bStarted = true;
+	m_thread = std::thread(&TelemetryPublisher::ServeLoop, this);
+
+	std::cout << "INFO: Publishing frame telemetry on " << m_socketPath << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method stops the telemetry thread, which sends the
+ *  frames still queued first, and closes every socket.
+ ***********************************************************/
+void TelemetryPublisher::Stop()
+{
+	if (!m_bStarted)
+	{
+		return;
+	}
+
+	m_bStop = true;
+	m_thread.join();
+
+	for (size_t i = 0; i < m_clients.size(); i++)
+	{
+		CloseSocket(m_clients[i].socket);
+	}
+	m_clients.clear();
+	CloseSocket(m_listenSocket);
+	m_listenSocket = NO_SOCKET;
+	RemoveSocketFile(m_socketPath.c_str());
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	m_bStarted = false;
+
+	std::cout << "INFO: Frame telemetry published " << GetPublishedCount()
+		<< " frames, dropped " << GetDroppedCount() << std::endl;
+}
+
+/***********************************************************
+ *  Publish()
+ *
+ *  This method copies the statistics of a frame into the
+ *  ring.  It never waits: when the telemetry thread has not
+ *  caught up, the frame is dropped and counted.
+ ***********************************************************/
+void TelemetryPublisher::Publish(const FRAME_STATS& stats)
+{
+	uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+	if (writeIndex - m_readIndex.load(std::memory_order_acquire) >= RING_SIZE)
+	{
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	RING_SLOT& slot = m_ring[writeIndex & (RING_SIZE - 1)];
+	slot.stats = stats;
+	slot.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  ServeLoop()
+ *
+ *  This method is the telemetry thread.  It accepts new
+ *  clients, drains the ring and sends the lines until it is
+ *  stopped.  The ring is drained even without clients, so
+ *  a client that connects gets the current frames.
+ ***********************************************************/
+void TelemetryPublisher::ServeLoop()
+{
+	m_batch.reserve(RING_SIZE * 256);
+
+	bool bStopping = false;
+	while (!bStopping)
+	{
+		// the frames queued before the stop are still sent
+		bStopping = m_bStop.load();
+
+		AcceptClients();
+		if (DrainRing(GetResidentMemory()) > 0)
+		{
+			SendBatch();
+		}
+
+		if (!bStopping)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(SERVE_INTERVAL_MILLISECONDS));
+		}
+	}
+}
+
+/***********************************************************
+ *  AcceptClients()
+ *
+ *  This method takes the connections that are waiting on
+ *  the listening socket.
+ ***********************************************************/
+void TelemetryPublisher::AcceptClients()
+{
+	while (true)
+	{
+		intptr_t clientSocket = (intptr_t)accept((SOCKET_HANDLE)m_listenSocket, NULL, NULL);
+		if (clientSocket == NO_SOCKET)
+		{
+			return;
+		}
+
+		if ((m_clients.size() >= MAX_CLIENTS) || !SetNonBlocking(clientSocket) || !SetNoSignal(clientSocket))
+		{
+			CloseSocket(clientSocket);
+			continue;
+		}
+
+		CLIENT client;
+		client.socket = clientSocket;
+		m_clients.push_back(client);
+		std::cout << "INFO: Telemetry client connected, " << m_clients.size() << " connected" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  DrainRing()
+ *
+ *  This method formats the frames queued since the last
+ *  drain into the batch and frees their slots.
+ ***********************************************************/
+int TelemetryPublisher::DrainRing(uint64_t residentBytes)
+{
+	static const int processId = GetProcessIdentifier();
+
+	m_batch.clear();
+	uint64_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+	uint64_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+	for (uint64_t i = readIndex; i < writeIndex; i++)
+	{
+		AppendLine(m_ring[i & (RING_SIZE - 1)], residentBytes, processId, m_batch);
+	}
+	m_readIndex.store(writeIndex, std::memory_order_release);
+
+	return((int)(writeIndex - readIndex));
+}
+
+/***********************************************************
+ *  SendBatch()
+ *
+ *  This method adds the batch to what every client still
+ *  has to take and sends as much of it as the client takes
+ *  without waiting.  Clients that closed the connection or
+ *  fell too far behind are dropped.
+ ***********************************************************/
+void TelemetryPublisher::SendBatch()
+{
+	for (size_t i = 0; i < m_clients.size();)
+	{
+		CLIENT& client = m_clients[i];
+		client.pending += m_batch;
+
+		bool bClosed = false;
+		size_t sent = 0;
+		while (sent < client.pending.size())
+		{
+#ifdef _WIN32
+			int result = send((SOCKET_HANDLE)client.socket, client.pending.data() + sent, (int)(client.pending.size() - sent), 0);
+#elif defined(MSG_NOSIGNAL)
+			ssize_t result = send((SOCKET_HANDLE)client.socket, client.pending.data() + sent, client.pending.size() - sent, MSG_NOSIGNAL);
+#else
+			ssize_t result = send((SOCKET_HANDLE)client.socket, client.pending.data() + sent, client.pending.size() - sent, 0);
+#endif
+			if (result <= 0)
+			{
+				bClosed = (result == 0) || !WouldBlock();
+				break;
+			}
+			sent += (size_t)result;
+		}
+		client.pending.erase(0, sent);
+
+		if (bClosed || (client.pending.size() > MAX_PENDING_BYTES))
+		{
+			std::cout << "INFO: Telemetry client " << (bClosed ? "disconnected" : "dropped, it fell behind") << std::endl;
+			CloseSocket(client.socket);
+			m_clients.erase(m_clients.begin() + i);
+			continue;
+		}
+		i++;
+	}
+}
+
+/***********************************************************
+ *  AppendLine()
+ *
+ *  This method writes a frame as a line of the InfluxDB
+ *  line protocol: the measurement and its tag, the fields,
+ *  with i after the integers, and the timestamp in
+ *  nanoseconds.
+ ***********************************************************/
+void TelemetryPublisher::AppendLine(const RING_SLOT& slot, uint64_t residentBytes, int processId, std::string& text)
+{
+	const FRAME_STATS& stats = slot.stats;
+	char line[512];
+	int length = snprintf(line, sizeof(line),
+		"frame,pid=%d number=%" PRIu64 "i,cpu_ms=%.3f,gpu_ms=%.3f,draws=%di,triangles=%di,"
+		"items=%di,cpu_visible=%di,cpu_culled=%di,gpu_objects=%di,"
+		"arena_bytes=%" PRIu64 "i,streamed_bytes=%" PRIu64 "i,resident_bytes=%" PRIu64 "i %" PRId64 "\n",
+		processId, stats.frameNumber, stats.cpuMilliseconds, stats.gpuMilliseconds,
+		stats.drawCalls, stats.triangles, stats.drawItems, stats.cpuVisibleItems,
+		stats.cpuCulledItems, stats.gpuCulledObjects,
+		stats.frameArenaBytes, stats.streamedBytes, residentBytes, slot.timestamp);
+	if ((length > 0) && (length < (int)sizeof(line)))
+	{
+		text.append(line, (size_t)length);
+	}
+}
+
+/***********************************************************
+ *  GetResidentMemory()
+ *
+ *  This method returns the physical memory the process
+ *  uses, or 0 where it cannot be read.
+ ***********************************************************/
+uint64_t TelemetryPublisher::GetResidentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return((uint64_t)counters.WorkingSetSize);
+	}
+	return(0);
+#else
+	FILE* pFile = fopen("/proc/self/statm", "r");
+	if (NULL == pFile)
+	{
+		return(0);
+	}
+	unsigned long long totalPages = 0;
+	unsigned long long residentPages = 0;
+	int fields = fscanf(pFile, "%llu %llu", &totalPages, &residentPages);
+	fclose(pFile);
+	if (fields != 2)
+	{
+		return(0);
+	}
+	return((uint64_t)residentPages * (uint64_t)sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/***********************************************************
+ *  CloseSocket()
+ *
+ *  This method closes a socket of either platform.
+ ***********************************************************/
+void TelemetryPublisher::CloseSocket(intptr_t socket)
+{
+	if (socket == NO_SOCKET)
+	{
+		return;
+	}
+#ifdef _WIN32
+	closesocket((SOCKET_HANDLE)socket);
+#else
+	close((SOCKET_HANDLE)socket);
+#endif
+}
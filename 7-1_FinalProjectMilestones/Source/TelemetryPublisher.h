@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// telemetrypublisher.h
+// ============
+// stream the statistics of every frame to monitoring over a local socket
+//
+// The render thread copies the statistics of a frame into a fixed ring
+// with one producer and one consumer, which costs a copy and two atomic
+// operations and never waits; when the ring is full the frame is dropped
+// and counted instead.  A background thread drains the ring a few dozen
+// times a second, adds the resident memory of the process, and sends
+// every frame as a line of the InfluxDB line protocol to the clients
+// connected to a Unix domain socket:
+//
+//   frame,pid=1234 number=42i,cpu_ms=3.1,gpu_ms=5.2,draws=37i,... 1700000000000000000
+//
+// Clients that fall too far behind are disconnected rather than slowing
+// the thread down.  On Windows the socket is an AF_UNIX socket of
+// Winsock, available since Windows 10.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TelemetryPublisher
+{
+public:
+	// the statistics of one frame
+	struct FRAME_STATS
+	{
+		uint64_t frameNumber;
+		// of the latest frame whose GPU time has arrived, a few frames
+		// earlier; negative when the frames are not timed yet
+		double cpuMilliseconds;
+		double gpuMilliseconds;
+		int drawCalls;
+		int triangles;
+		int drawItems;
+		int cpuVisibleItems;
+		int cpuCulledItems;
+		int gpuCulledObjects;
+		// memory of the render thread's frame arena and of the
+		// resident chunks of a streamed world
+		uint64_t frameArenaBytes;
+		uint64_t streamedBytes;
+	};
+
+	// frames the ring holds, a power of two
+	static const uint32_t RING_SIZE = 256;
+
+	// constructor
+	TelemetryPublisher();
+	// destructor
+	~TelemetryPublisher();
+
+	// create the socket at the passed in path, replacing a stale one,
+	// and start serving it
+	bool Start(const char* socketPath);
+	// stop serving, disconnect the clients and remove the socket
+	void Stop();
+
+	// render thread: queue the statistics of a frame
+	void Publish(const FRAME_STATS& stats);
+
+	uint64_t GetPublishedCount() const { return m_writeIndex.load(std::memory_order_relaxed); }
+	uint64_t GetDroppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+
+private:
+	struct RING_SLOT
+	{
+		FRAME_STATS stats;
+		// nanoseconds since the Unix epoch when the frame was queued
+		int64_t timestamp;
+	};
+
+	struct CLIENT
+	{
+		intptr_t socket;
+		// bytes the client has not taken yet
+		std::string pending;
+	};
+
+	RING_SLOT m_ring[RING_SIZE];
+	// the producer's and the consumer's position, on their own cache
+	// lines; only the render thread moves the first and only the
+	// telemetry thread the second
+	alignas(64) std::atomic<uint64_t> m_writeIndex;
+	alignas(64) std::atomic<uint64_t> m_readIndex;
+	std::atomic<uint64_t> m_droppedCount;
+
+	std::string m_socketPath;
+	// platform handle of the listening socket (SOCKET or descriptor)
+	intptr_t m_listenSocket;
+	std::thread m_thread;
+	std::atomic<bool> m_bStop;
+	bool m_bStarted;
+
+	// owned by the telemetry thread
+	std::vector<CLIENT> m_clients;
+	std::string m_batch;
+
+	void ServeLoop();
+	void AcceptClients();
+	// move the queued frames into the batch as lines
+	int DrainRing(uint64_t residentBytes);
+	// queue the batch for every client and send what they take
+	void SendBatch();
+	static void AppendLine(const RING_SLOT& slot, uint64_t residentBytes, int processId, std::string& text);
+	static uint64_t GetResidentMemory();
+	static void CloseSocket(intptr_t socket);
+};
@@ -0,0 +1,496 @@
+///////////////////////////////////////////////////////////////////////////////
+// videotexture.cpp
+// ============
+// looping Y4M video decoded on a background thread into plane textures
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VideoTexture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// longest stream header accepted before the file is rejected
+	const size_t MAX_Y4M_LINE = 1024;
+}
+
+/***********************************************************
+ *  VideoTexture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VideoTexture::VideoTexture(int ringSize)
+{
+	m_ringSize = (ringSize < 2) ? 2 : ringSize;
+	m_bPersistent = false;
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		m_planeTextures[i] = 0;
+	}
+	m_firstFrameOffset = 0;
+	m_width = 0;
+	m_height = 0;
+	m_chromaWidth = 0;
+	m_chromaHeight = 0;
+	m_frameSize = 0;
+	m_frameDuration = 1.0 / 30.0;
+	m_bFullRange = false;
+	m_bStopDecoder = false;
+	m_nextDecodeIndex = 0;
+	m_bOpen = false;
+	m_bHasFrame = false;
+	m_bClockStarted = false;
+	m_framesShown = 0;
+	m_framesDropped = 0;
+}
+
+/***********************************************************
+ *  ~VideoTexture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VideoTexture::~VideoTexture()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method reads the stream header, creates the plane
+ *  textures and the upload ring, and starts the decoder.
+ ***********************************************************/
+bool VideoTexture::Open(const char* filename)
+{
+	Close();
+
+	m_file.open(filename, std::ios::in | std::ios::binary);
+	if (!m_file.is_open())
+	{
+		std::cout << "Could not open video:" << filename << std::endl;
+		return(false);
+	}
+	if (ReadHeader() == false)
+	{
+		std::cout << "Unsupported video:" << filename << ", expected a 4:2:0 YUV4MPEG2 stream" << std::endl;
+		m_file.close();
+		return(false);
+	}
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glGenTextures(PLANE_COUNT, m_planeTextures);
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		int width = (i == PLANE_Y) ? m_width : m_chromaWidth;
+		int height = (i == PLANE_Y) ? m_height : m_chromaHeight;
+
+		glBindTexture(GL_TEXTURE_2D, m_planeTextures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+	// persistent mapping needs OpenGL 4.4 or ARB_buffer_storage
+	m_bPersistent = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+	const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	m_slots.resize(m_ringSize);
+	for (int i = 0; i < m_ringSize; i++)
+	{
+		UPLOAD_SLOT& slot = m_slots[i];
+		slot.pMapped = NULL;
+		slot.pWrite = NULL;
+		slot.state = SLOT_FREE;
+		slot.frameIndex = 0;
+		slot.fence = NULL;
+
+		glGenBuffers(1, &slot.pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+		if (m_bPersistent)
+		{
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_frameSize, NULL, mapFlags);
+			slot.pMapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_frameSize, mapFlags);
+			slot.pWrite = slot.pMapped;
+			if (NULL == slot.pMapped)
+			{
+				// storage is immutable, so a fresh buffer is needed for staging
+				glDeleteBuffers(1, &slot.pbo);
+				glGenBuffers(1, &slot.pbo);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+			}
+		}
+		if (NULL == slot.pMapped)
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, m_frameSize, NULL, GL_STREAM_DRAW);
+			slot.staging.resize(m_frameSize);
+			slot.pWrite = slot.staging.data();
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	m_bStopDecoder = false;
+	m_nextDecodeIndex = 0;
+	m_bHasFrame = false;
+	m_bClockStarted = false;
+	m_framesShown = 0;
+	m_framesDropped = 0;
+	m_bOpen = true;
+	m_decoder = std::thread(&VideoTexture::DecoderLoop, this);
+
+	std::cout << "INFO: Playing video " << filename << ", " << m_width << "x" << m_height
+		<< " at " << (1.0 / m_frameDuration) << " fps"
+		<< (m_bPersistent ? " through persistently mapped buffers" : " through staging copies") << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method stops the decoder thread and frees the file,
+ *  the upload ring and the plane textures.
+ ***********************************************************/
+void VideoTexture::Close()
+{
+	if (m_decoder.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStopDecoder = true;
+		}
+		m_slotFreed.notify_all();
+		m_decoder.join();
+	}
+
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		UPLOAD_SLOT& slot = m_slots[i];
+		if (NULL != slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		if (NULL != slot.pMapped)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &slot.pbo);
+	}
+	m_slots.clear();
+
+	if (0 != m_planeTextures[0])
+	{
+		glDeleteTextures(PLANE_COUNT, m_planeTextures);
+		for (int i = 0; i < PLANE_COUNT; i++)
+		{
+			m_planeTextures[i] = 0;
+		}
+	}
+
+	if (m_file.is_open())
+	{
+		m_file.close();
+	}
+	m_bOpen = false;
+	m_bHasFrame = false;
+}
+
+/***********************************************************
+ *  GetPlaneTexture()
+ *
+ *  This method returns the texture holding one plane.
+ ***********************************************************/
+GLuint VideoTexture::GetPlaneTexture(int plane) const
+{
+	if ((plane < 0) || (plane >= PLANE_COUNT))
+	{
+		return(0);
+	}
+	return(m_planeTextures[plane]);
+}
+
+/***********************************************************
+ *  ReadHeader()
+ *
+ *  This method parses the YUV4MPEG2 stream header.  Only
+ *  the 4:2:0 chroma layouts are accepted.
+ ***********************************************************/
+bool VideoTexture::ReadHeader()
+{
+	std::string header;
+	if (!std::getline(m_file, header) || (header.size() > MAX_Y4M_LINE))
+	{
+		return(false);
+	}
+
+	std::istringstream tokens(header);
+	std::string token;
+	tokens >> token;
+	if (token != "YUV4MPEG2")
+	{
+		return(false);
+	}
+
+	int frameRateNumerator = 30;
+	int frameRateDenominator = 1;
+	m_width = 0;
+	m_height = 0;
+	m_bFullRange = false;
+	while (tokens >> token)
+	{
+		switch (token[0])
+		{
+		case 'W':
+			m_width = atoi(token.c_str() + 1);
+			break;
+		case 'H':
+			m_height = atoi(token.c_str() + 1);
+			break;
+		case 'F':
+			sscanf(token.c_str() + 1, "%d:%d", &frameRateNumerator, &frameRateDenominator);
+			break;
+		case 'C':
+			if (token.compare(0, 4, "C420") != 0)
+			{
+				return(false);
+			}
+			break;
+		case 'X':
+			if (token == "XCOLORRANGE=FULL")
+			{
+				m_bFullRange = true;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	if ((m_width <= 0) || (m_height <= 0) || (frameRateNumerator <= 0) || (frameRateDenominator <= 0))
+	{
+		return(false);
+	}
+
+	m_chromaWidth = (m_width + 1) / 2;
+	m_chromaHeight = (m_height + 1) / 2;
+	m_frameSize = (size_t)m_width * m_height + 2 * (size_t)m_chromaWidth * m_chromaHeight;
+	m_frameDuration = (double)frameRateDenominator / (double)frameRateNumerator;
+	m_firstFrameOffset = m_file.tellg();
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadFrame()
+ *
+ *  This method reads the planes of the next frame into the
+ *  destination, restarting from the first frame at the end
+ *  of the file so the video loops.
+ ***********************************************************/
+bool VideoTexture::ReadFrame(unsigned char* destination)
+{
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		std::string frameHeader;
+		if (std::getline(m_file, frameHeader) &&
+			(frameHeader.compare(0, 5, "FRAME") == 0) &&
+			m_file.read((char*)destination, m_frameSize))
+		{
+			return(true);
+		}
+
+		// at the end, or a truncated last frame, so start over
+		m_file.clear();
+		m_file.seekg(m_firstFrameOffset);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  DecoderLoop()
+ *
+ *  This method is the body of the decoder thread.  It fills
+ *  free ring slots with frames in order and never touches
+ *  the OpenGL context.
+ ***********************************************************/
+void VideoTexture::DecoderLoop()
+{
+	while (true)
+	{
+		UPLOAD_SLOT* pSlot = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_slotFreed.wait(lock, [this, &pSlot]()
+			{
+				if (m_bStopDecoder)
+				{
+					return true;
+				}
+				for (size_t i = 0; i < m_slots.size(); i++)
+				{
+					if (m_slots[i].state == SLOT_FREE)
+					{
+						pSlot = &m_slots[i];
+						return true;
+					}
+				}
+				return false;
+			});
+			if (m_bStopDecoder)
+			{
+				return;
+			}
+			pSlot->state = SLOT_DECODING;
+		}
+
+		bool bRead = ReadFrame(pSlot->pWrite);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (bRead == false)
+		{
+			pSlot->state = SLOT_FREE;
+			std::cout << "Video decoding stopped, the file could not be read" << std::endl;
+			return;
+		}
+		pSlot->frameIndex = m_nextDecodeIndex++;
+		pSlot->state = SLOT_READY;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method returns the slots whose uploads the GPU has
+ *  finished to the decoder and uploads the newest decoded
+ *  frame that is due.  Older due frames are dropped so the
+ *  video keeps its speed when the render loop is slow.
+ ***********************************************************/
+void VideoTexture::Update()
+{
+	if (m_bOpen == false)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (m_bClockStarted == false)
+	{
+		m_startTime = now;
+		m_bClockStarted = true;
+	}
+	double playTime = std::chrono::duration<double>(now - m_startTime).count();
+
+	bool bFreed = false;
+	UPLOAD_SLOT* pNewest = NULL;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_slots.size(); i++)
+		{
+			UPLOAD_SLOT& slot = m_slots[i];
+			if (slot.state == SLOT_UPLOADING)
+			{
+				GLenum result = glClientWaitSync(slot.fence, 0, 0);
+				if ((result == GL_ALREADY_SIGNALED) || (result == GL_CONDITION_SATISFIED))
+				{
+					glDeleteSync(slot.fence);
+					slot.fence = NULL;
+					slot.state = SLOT_FREE;
+					bFreed = true;
+				}
+			}
+			else if ((slot.state == SLOT_READY) && ((slot.frameIndex * m_frameDuration) <= playTime))
+			{
+				if ((NULL == pNewest) || (slot.frameIndex > pNewest->frameIndex))
+				{
+					if (NULL != pNewest)
+					{
+						pNewest->state = SLOT_FREE;
+						m_framesDropped++;
+					}
+					pNewest = &slot;
+				}
+				else
+				{
+					slot.state = SLOT_FREE;
+					m_framesDropped++;
+				}
+				bFreed = true;
+			}
+		}
+
+		if (NULL != pNewest)
+		{
+			pNewest->state = SLOT_UPLOADING;
+		}
+	}
+
+	if (bFreed)
+	{
+		m_slotFreed.notify_one();
+	}
+	if (NULL != pNewest)
+	{
+		UploadSlot(*pNewest);
+	}
+}
+
+/***********************************************************
+ *  UploadSlot()
+ *
+ *  This method copies the planes of a slot from its buffer
+ *  into the textures and fences the copy.
+ ***********************************************************/
+void VideoTexture::UploadSlot(UPLOAD_SLOT& slot)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+
+	if (NULL == slot.pMapped)
+	{
+		// orphan the buffer so the copy never waits on a previous upload
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, m_frameSize, NULL, GL_STREAM_DRAW);
+		void* pBuffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_frameSize,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (NULL != pBuffer)
+		{
+			memcpy(pBuffer, slot.staging.data(), m_frameSize);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+	}
+
+	GLint previousTexture = 0;
+	GLint previousAlignment = 4;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	size_t lumaSize = (size_t)m_width * m_height;
+	size_t chromaSize = (size_t)m_chromaWidth * m_chromaHeight;
+	size_t offsets[PLANE_COUNT] = { 0, lumaSize, lumaSize + chromaSize };
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		int width = (i == PLANE_Y) ? m_width : m_chromaWidth;
+		int height = (i == PLANE_Y) ? m_height : m_chromaHeight;
+
+		glBindTexture(GL_TEXTURE_2D, m_planeTextures[i]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, (const void*)offsets[i]);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_bHasFrame = true;
+	m_framesShown++;
+}
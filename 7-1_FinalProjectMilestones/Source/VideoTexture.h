@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// videotexture.h
+// ============
+// looping Y4M video decoded on a background thread into plane textures
+//
+// Frames are read straight into a ring of pixel unpack buffers.  When the
+// context supports buffer storage the buffers stay persistently mapped, so
+// the decoder thread writes into GPU visible memory and the render thread
+// only issues the texture copies and a fence per frame.  Without buffer
+// storage the render thread copies each frame into an orphaned buffer.
+//
+// The Y, U and V planes are kept in three single channel textures and are
+// converted to RGB in the fragment shader.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VideoTexture
+{
+public:
+	enum VIDEO_PLANE
+	{
+		PLANE_Y,
+		PLANE_U,
+		PLANE_V,
+		PLANE_COUNT
+	};
+
+	// constructor
+	VideoTexture(int ringSize = 4);
+	// destructor
+	~VideoTexture();
+
+	// open a 4:2:0 Y4M file, create the textures and start decoding;
+	// playback starts with the first Update()
+	bool Open(const char* filename);
+	// stop the decoder and free the GL objects
+	void Close();
+
+	// called once per frame on the render thread to release finished
+	// uploads and upload the newest frame that is due
+	void Update();
+
+	// true once the first frame has been uploaded
+	bool HasFrame() const { return m_bHasFrame; }
+	GLuint GetPlaneTexture(int plane) const;
+	// true for full range (JPEG) levels, false for video levels
+	bool IsFullRange() const { return m_bFullRange; }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	uint64_t GetFramesShown() const { return m_framesShown; }
+	uint64_t GetFramesDropped() const { return m_framesDropped; }
+
+private:
+	enum SLOT_STATE
+	{
+		SLOT_FREE,        // may be filled by the decoder
+		SLOT_DECODING,    // being filled by the decoder
+		SLOT_READY,       // holds a decoded frame waiting for upload
+		SLOT_UPLOADING    // copied to the textures, waiting for its fence
+	};
+
+	struct UPLOAD_SLOT
+	{
+		GLuint pbo;
+		// persistently mapped memory, or NULL when staging is used
+		unsigned char* pMapped;
+		std::vector<unsigned char> staging;
+		// where the decoder writes, either of the two above
+		unsigned char* pWrite;
+		SLOT_STATE state;
+		uint64_t frameIndex;
+		GLsync fence;
+	};
+
+	int m_ringSize;
+	std::vector<UPLOAD_SLOT> m_slots;
+	// buffer storage is available, slots that could not be mapped
+	// still fall back to staging copies
+	bool m_bPersistent;
+	GLuint m_planeTextures[PLANE_COUNT];
+
+	std::ifstream m_file;
+	std::streamoff m_firstFrameOffset;
+	int m_width;
+	int m_height;
+	int m_chromaWidth;
+	int m_chromaHeight;
+	size_t m_frameSize;
+	double m_frameDuration;
+	bool m_bFullRange;
+
+	std::thread m_decoder;
+	std::mutex m_mutex;
+	std::condition_variable m_slotFreed;
+	bool m_bStopDecoder;
+	uint64_t m_nextDecodeIndex;
+
+	bool m_bOpen;
+	bool m_bHasFrame;
+	bool m_bClockStarted;
+	std::chrono::steady_clock::time_point m_startTime;
+	uint64_t m_framesShown;
+	uint64_t m_framesDropped;
+
+	bool ReadHeader();
+	// read the next frame, rewinding to the first one at the end
+	bool ReadFrame(unsigned char* destination);
+	void DecoderLoop();
+	void UploadSlot(UPLOAD_SLOT& slot);
+};
@@ -8,33 +8,73 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "AllocationTracker.h"
+#include "PerfCounters.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
+
+	// orthographic views show this much of the scene vertically and
+	// look at it from this far away
+	const float ORTHO_VIEW_HEIGHT = 36.0f;
+	const float ORTHO_VIEW_DISTANCE = 60.0f;
+	// the point the orthographic views are centered on
+	const glm::vec3 ORTHO_VIEW_CENTER = glm::vec3(0.0f, 12.0f, -4.0f);
+
+	// screenshots and recordings are written to this folder
+	const char* g_CaptureFolder = "captures";
+	const int CAPTURE_FRAME_RATE = 60;
+
+	// the programs of the lighting cost heatmap
+	const char* g_LightCostVertexShader = "shaders/lightCostVertexShader.glsl";
+	const char* g_LightCostFragmentShader = "shaders/lightCostFragmentShader.glsl";
+
+	// radius of the sphere around the camera that collides with the
+	// scene, and seconds between reports of the collision queries
+	const float CAMERA_COLLISION_RADIUS = 0.5f;
+	const double COLLISION_REPORT_INTERVAL = 5.0;
+
+	// the smallest fraction of the window resolution the views are
+	// rendered at
+	const float MIN_RENDER_SCALE = 0.25f;
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
 	Camera* g_pCamera = nullptr;
 
-	// these variables are used for mouse movement processing
-	float gLastX = WINDOW_WIDTH / 2.0f;
-	float gLastY = WINDOW_HEIGHT / 2.0f;
-	bool gFirstMouse = true;
+	// the keys that move the camera while they are held
+	struct MOVEMENT_KEY
+	{
+		int key;
+		Camera_Movement direction;
+	};
+	const MOVEMENT_KEY MOVEMENT_KEYS[] = {
+		{ GLFW_KEY_W, FORWARD },
+		{ GLFW_KEY_S, BACKWARD },
+		{ GLFW_KEY_A, LEFT },
+		{ GLFW_KEY_D, RIGHT },
+		{ GLFW_KEY_Q, UP },
+		{ GLFW_KEY_E, DOWN } };
+
+	// seconds between reports of the input latency
+	const double INPUT_REPORT_INTERVAL = 5.0;
 
 	// time between current frame and last frame
 	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	double gLastFrame = 0.0;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
@@ -52,6 +92,37 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_pCaptureManager = NULL;
+	m_pLightCostView = NULL;
+	m_bMultiView = false;
+	for (int i = 0; i < MOVEMENT_KEY_COUNT; i++)
+	{
+		m_bMovementKeyDown[i] = false;
+	}
+	m_inputTime = 0.0;
+	m_cameraLatency = LATENCY_STATS();
+	m_displayLatency = LATENCY_STATS();
+	m_frameEventCount = 0;
+	m_frameEventTimes = 0.0;
+	m_frameEventSquares = 0.0;
+	m_frameOldestEvent = 0.0;
+	m_latencyReportTime = 0.0;
+	m_latchCount = 0;
+	m_latchSeconds = 0.0;
+	m_bPickRequested = false;
+	m_pCollisionWorld = NULL;
+	m_bCollision = true;
+	m_collisionReportTime = 0.0;
+	m_collisionReportFrames = 0;
+	m_cameraVelocity = glm::vec3(0.0f);
+	m_renderScale = 1.0f;
+	m_scaledFramebuffer = 0;
+	m_scaledColorBuffer = 0;
+	m_scaledDepthBuffer = 0;
+	m_scaledWidth = 0;
+	m_scaledHeight = 0;
+	m_sceneWidth = WINDOW_WIDTH;
+	m_sceneHeight = WINDOW_HEIGHT;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 10.0f, 36.0f);
@@ -59,6 +130,9 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+
+	m_views.resize(1);
+	SetupView(m_views[0], VIEW_PERSPECTIVE, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
 
 /***********************************************************
@@ -71,6 +145,17 @@ ViewManager::~ViewManager()
 	// free up allocated memory
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
+	if (NULL != m_pCaptureManager)
+	{
+		delete m_pCaptureManager;
+		m_pCaptureManager = NULL;
+	}
+	if (NULL != m_pLightCostView)
+	{
+		delete m_pLightCostView;
+		m_pLightCostView = NULL;
+	}
+	DestroyScaledFramebuffer();
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -104,11 +189,11 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// tell GLFW to capture all mouse events
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	// this callback is used to receive mouse moving events
-	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
-
-	// Register the mouse scroll callback
-	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Wheel_Callback);
+	// the keyboard and mouse events are queued with their times and
+	// applied at the next frame
+	m_inputQueue.Attach(window);
+	m_inputTime = glfwGetTime();
+	m_latencyReportTime = m_inputTime;
 
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
@@ -116,82 +201,475 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 	m_pWindow = window;
 
+	// the capture manager only creates its GL objects on first use
+	m_pCaptureManager = new CaptureManager(g_CaptureFolder, CAPTURE_FRAME_RATE);
+	// and so does the lighting cost heatmap
+	m_pLightCostView = new LightCostView(g_LightCostVertexShader, g_LightCostFragmentShader);
+
 	return(window);
 }
 
 /***********************************************************
- *  Mouse_Position_Callback()
+ *  ProcessInputEvents()
  *
- *  This method is automatically called from GLFW whenever
- *  the mouse is moved within the active GLFW display window.
+ *  This method is called to apply the queued input events
+ *  in the order they happened.  Between two events the held
+ *  movement keys move the camera, so it moves for exactly
+ *  as long as a key was down, up to the passed in time of
+ *  the frame.
  ***********************************************************/
-void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
+void ViewManager::ProcessInputEvents(double time)
 {
-	// when the first mouse move event is received, this needs to be recorded so that
-	// all subsequent mouse moves can correctly calculate the X position offset and Y
-	// position offset for proper operation
-	if (gFirstMouse)
+	InputQueue::INPUT_EVENT event;
+	while (m_inputQueue.Pop(event))
 	{
-		gLastX = xMousePos;
-		gLastY = yMousePos;
-		gFirstMouse = false;
+		MoveCamera(event.time);
+		AddLatency(m_cameraLatency, time - event.time);
+		m_frameOldestEvent = (m_frameEventCount == 0) ? event.time : m_frameOldestEvent;
+		m_frameEventTimes += event.time;
+		m_frameEventSquares += event.time * event.time;
+		m_frameEventCount++;
+
+		switch (event.type)
+		{
+		case InputQueue::EVENT_KEY:
+			ProcessKeyEvent(event.code, event.action);
+			break;
+		case InputQueue::EVENT_MOUSE_BUTTON:
+			// a left click selects the object under the cursor
+			if ((event.code == GLFW_MOUSE_BUTTON_LEFT) && (event.action == GLFW_PRESS))
+			{
+				m_bPickRequested = true;
+			}
+			break;
+		case InputQueue::EVENT_MOUSE_MOVE:
+			// move the 3D camera according to the mouse offsets
+			g_pCamera->ProcessMouseMovement((float)event.x, (float)event.y);
+			break;
+		case InputQueue::EVENT_SCROLL:
+			// Adjust the camera's movement speed based on the scroll input.
+			g_pCamera->ProcessMouseScroll(static_cast<float>(event.y));
+			break;
+		}
 	}
 
-	// calculate the X offset and Y offset values for moving the 3D camera accordingly
-	float xOffset = xMousePos - gLastX;
-	float yOffset = gLastY - yMousePos; // reversed since y-coordinates go from bottom to top
+	MoveCamera(time);
+}
 
-	// set the current positions into the last position variables
-	gLastX = xMousePos;
-	gLastY = yMousePos;
+/***********************************************************
+ *  ProcessKeyEvent()
+ *
+ *  This method is called to apply one key event: the
+ *  movement keys change their held state, the others act
+ *  once when they are pressed.
+ ***********************************************************/
+void ViewManager::ProcessKeyEvent(int key, int action)
+{
+	// process camera zooming, panning and moving up and down
+	for (int i = 0; i < MOVEMENT_KEY_COUNT; i++)
+	{
+		if (MOVEMENT_KEYS[i].key == key)
+		{
+			if (action != GLFW_REPEAT)
+			{
+				m_bMovementKeyDown[i] = (action == GLFW_PRESS);
+			}
+			return;
+		}
+	}
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	if (action != GLFW_PRESS)
+	{
+		return;
+	}
+
+	switch (key)
+	{
+	// close the window if the escape key has been pressed
+	case GLFW_KEY_ESCAPE:
+		glfwSetWindowShouldClose(m_pWindow, true);
+		break;
+
+	// P and O switch the single view between perspective and
+	// orthographic projection, V toggles the four view layout
+	case GLFW_KEY_P:
+		bOrthographicProjection = false;
+		break;
+	case GLFW_KEY_O:
+		bOrthographicProjection = true;
+		break;
+	case GLFW_KEY_V:
+		m_bMultiView = !m_bMultiView;
+		break;
+
+	// F12 saves a screenshot, F9 starts and stops a Y4M recording
+	// and F10 a raw RGBA recording
+	case GLFW_KEY_F12:
+		if (NULL != m_pCaptureManager)
+		{
+			m_pCaptureManager->RequestScreenshot();
+		}
+		break;
+	case GLFW_KEY_F9:
+		if (NULL != m_pCaptureManager)
+		{
+			m_pCaptureManager->ToggleRecording(CaptureManager::VIDEO_Y4M);
+		}
+		break;
+	case GLFW_KEY_F10:
+		if (NULL != m_pCaptureManager)
+		{
+			m_pCaptureManager->ToggleRecording(CaptureManager::VIDEO_RAW);
+		}
+		break;
+
+	// C turns the camera collision off and on again
+	case GLFW_KEY_C:
+		m_bCollision = !m_bCollision;
+		std::cout << "INFO: Camera collision " << (m_bCollision ? "on" : "off") << std::endl;
+		break;
+
+	// F7 shows the light evaluations of every pixel, then its texture
+	// fetches, then the scene again
+	case GLFW_KEY_F7:
+		if (NULL != m_pLightCostView)
+		{
+			m_pLightCostView->CycleMode();
+		}
+		break;
+	}
 }
 
 /***********************************************************
- *  ProcessKeyboardEvents()
+ *  MoveCamera()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is called to move the camera by the held
+ *  movement keys from the time of the previous input up to
+ *  the passed in time.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::MoveCamera(double untilTime)
 {
-	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (untilTime <= m_inputTime)
 	{
-		glfwSetWindowShouldClose(m_pWindow, true);
+		return;
+	}
+
+	float seconds = (float)(untilTime - m_inputTime);
+	for (int i = 0; i < MOVEMENT_KEY_COUNT; i++)
+	{
+		if (m_bMovementKeyDown[i])
+		{
+			g_pCamera->ProcessKeyboard(MOVEMENT_KEYS[i].direction, seconds);
+		}
+	}
+	m_inputTime = untilTime;
+}
+
+/***********************************************************
+ *  FramePresented()
+ *
+ *  This method is called after the buffers are swapped, to
+ *  measure how long the input events applied in the frame
+ *  took to reach the display, and to report the latency
+ *  every few seconds.
+ ***********************************************************/
+void ViewManager::FramePresented()
+{
+	double time = glfwGetTime();
+	if (m_frameEventCount > 0)
+	{
+		// the sums over the latencies of the events follow from the
+		// sums over their times
+		double count = (double)m_frameEventCount;
+		m_displayLatency.count += m_frameEventCount;
+		m_displayLatency.sum += count * time - m_frameEventTimes;
+		m_displayLatency.sumSquares += count * time * time - 2.0 * time * m_frameEventTimes + m_frameEventSquares;
+		m_displayLatency.worst = std::max(m_displayLatency.worst, time - m_frameOldestEvent);
+		m_frameEventCount = 0;
+		m_frameEventTimes = 0.0;
+		m_frameEventSquares = 0.0;
+	}
+
+	if ((time - m_latencyReportTime < INPUT_REPORT_INTERVAL) || (m_cameraLatency.count == 0))
+	{
+		return;
+	}
+
+	std::cout << "INFO: Input latency over " << m_cameraLatency.count << " events: "
+		<< GetAverageMs(m_cameraLatency) << " ms to the camera (jitter " << GetJitterMs(m_cameraLatency)
+		<< " ms, worst " << (m_cameraLatency.worst * 1000.0) << " ms), "
+		<< GetAverageMs(m_displayLatency) << " ms to the display (jitter " << GetJitterMs(m_displayLatency)
+		<< " ms, worst " << (m_displayLatency.worst * 1000.0) << " ms)";
+	if (m_latchCount > 0)
+	{
+		std::cout << ", views latched " << (m_latchSeconds / m_latchCount * 1000.0) << " ms after the frame start";
+	}
+	if (m_inputQueue.GetDroppedCount() > 0)
+	{
+		std::cout << ", " << m_inputQueue.GetDroppedCount() << " events dropped so far";
+	}
+	std::cout << std::endl;
+
+	m_cameraLatency = LATENCY_STATS();
+	m_displayLatency = LATENCY_STATS();
+	m_latchCount = 0;
+	m_latchSeconds = 0.0;
+	m_latencyReportTime = time;
+}
+
+/***********************************************************
+ *  AddLatency()
+ *
+ *  This method is called to add the latency of one event.
+ ***********************************************************/
+void ViewManager::AddLatency(LATENCY_STATS& stats, double seconds)
+{
+	seconds = std::max(seconds, 0.0);
+	stats.count++;
+	stats.sum += seconds;
+	stats.sumSquares += seconds * seconds;
+	stats.worst = std::max(stats.worst, seconds);
+}
+
+/***********************************************************
+ *  GetAverageMs()
+ *
+ *  This method returns the average latency in milliseconds.
+ ***********************************************************/
+double ViewManager::GetAverageMs(const LATENCY_STATS& stats)
+{
+	if (stats.count == 0)
+	{
+		return(0.0);
+	}
+	return(stats.sum / stats.count * 1000.0);
+}
+
+/***********************************************************
+ *  GetJitterMs()
+ *
+ *  This method returns the standard deviation of the
+ *  latency in milliseconds.
+ ***********************************************************/
+double ViewManager::GetJitterMs(const LATENCY_STATS& stats)
+{
+	if (stats.count == 0)
+	{
+		return(0.0);
+	}
+	double average = stats.sum / stats.count;
+	double variance = (stats.sumSquares / stats.count) - (average * average);
+	return(std::sqrt(std::max(variance, 0.0)) * 1000.0);
+}
+
+/***********************************************************
+ *  SetCollisionWorld()
+ *
+ *  This method is used for setting the scene geometry that
+ *  the camera collides with.
+ ***********************************************************/
+void ViewManager::SetCollisionWorld(CollisionWorld* pCollisionWorld)
+{
+	m_pCollisionWorld = pCollisionWorld;
+	m_collisionReportTime = glfwGetTime();
+	m_collisionReportFrames = 0;
+}
+
+/***********************************************************
+ *  SetRenderScale()
+ *
+ *  This method is used for setting the fraction of the
+ *  window resolution the views are rendered at.
+ ***********************************************************/
+void ViewManager::SetRenderScale(float renderScale)
+{
+	m_renderScale = glm::clamp(renderScale, MIN_RENDER_SCALE, 1.0f);
+	if (m_renderScale >= 1.0f)
+	{
+		DestroyScaledFramebuffer();
+	}
+}
+
+/***********************************************************
+ *  BindSceneFramebuffer()
+ *
+ *  This method is used for binding the framebuffer the views
+ *  are rendered into: the window's at full scale, otherwise
+ *  a smaller one that is created or resized as needed.
+ ***********************************************************/
+void ViewManager::BindSceneFramebuffer(int framebufferWidth, int framebufferHeight, int& width, int& height)
+{
+	width = framebufferWidth;
+	height = framebufferHeight;
+	if (m_renderScale >= 1.0f)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return;
+	}
+
+	width = std::max(1, (int)(framebufferWidth * m_renderScale));
+	height = std::max(1, (int)(framebufferHeight * m_renderScale));
+	if ((m_scaledFramebuffer != 0) && (width == m_scaledWidth) && (height == m_scaledHeight))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_scaledFramebuffer);
+		return;
 	}
 
-	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	DestroyScaledFramebuffer();
+	glGenRenderbuffers(1, &m_scaledColorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_scaledColorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_scaledDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_scaledDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_scaledFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_scaledFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_scaledColorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_scaledDepthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		std::cout << "WARNING: Could not create the scaled framebuffer, rendering at full resolution" << std::endl;
+		DestroyScaledFramebuffer();
+		m_renderScale = 1.0f;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		width = framebufferWidth;
+		height = framebufferHeight;
+		return;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	m_scaledWidth = width;
+	m_scaledHeight = height;
+}
+
+/***********************************************************
+ *  DestroyScaledFramebuffer()
+ *
+ *  This method is used for freeing the scaled framebuffer.
+ ***********************************************************/
+void ViewManager::DestroyScaledFramebuffer()
+{
+	if (m_scaledFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_scaledFramebuffer);
+		m_scaledFramebuffer = 0;
+	}
+	if (m_scaledColorBuffer != 0)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		glDeleteRenderbuffers(1, &m_scaledColorBuffer);
+		m_scaledColorBuffer = 0;
 	}
+	if (m_scaledDepthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_scaledDepthBuffer);
+		m_scaledDepthBuffer = 0;
+	}
+	m_scaledWidth = 0;
+	m_scaledHeight = 0;
+}
 
-	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+/***********************************************************
+ *  ResolveCameraCollision()
+ *
+ *  This method is used for sweeping the camera from where it
+ *  was to where the keyboard moved it, stopping and sliding
+ *  at the scene geometry, and for reporting the average
+ *  work of the collision queries every few seconds.
+ ***********************************************************/
+void ViewManager::ResolveCameraCollision(glm::vec3 previousPosition)
+{
+	if (NULL == m_pCollisionWorld)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		return;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+
+	if (m_bCollision && (g_pCamera->Position != previousPosition))
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		g_pCamera->Position = m_pCollisionWorld->MoveSphere(previousPosition, g_pCamera->Position, CAMERA_COLLISION_RADIUS);
 	}
+	m_collisionReportFrames++;
 
-	// for moving camera view up and down
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	double currentTime = glfwGetTime();
+	if (currentTime - m_collisionReportTime < COLLISION_REPORT_INTERVAL)
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		return;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+
+	const CollisionWorld::COLLISION_STATS& stats = m_pCollisionWorld->GetStats();
+	if (stats.queries > 0)
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		double frames = (double)m_collisionReportFrames;
+		std::cout << "INFO: Camera collision per frame: "
+			<< (stats.queries / frames) << " queries, "
+			<< (stats.nodesVisited / frames) << " nodes, "
+			<< (stats.collidersTested / frames) << " colliders, "
+			<< (stats.trianglesTested / frames) << " triangles, "
+			<< (stats.contacts / frames) << " contacts, "
+			<< (stats.seconds * 1000.0 / frames) << " ms" << std::endl;
 	}
+	m_pCollisionWorld->ResetStats();
+	m_collisionReportTime = currentTime;
+	m_collisionReportFrames = 0;
+}
+
+/***********************************************************
+ *  ConsumePickRequest()
+ *
+ *  This method is used for getting the framebuffer pixel of
+ *  a pending click and the view it landed in.  While the
+ *  cursor is captured for the camera it is hidden, so the
+ *  center of the main view is picked instead.
+ ***********************************************************/
+bool ViewManager::ConsumePickRequest(int& viewIndex, int& x, int& y)
+{
+	if (!m_bPickRequested || (NULL == m_pWindow) || m_views.empty())
+	{
+		return(false);
+	}
+	m_bPickRequested = false;
+
+	if (glfwGetInputMode(m_pWindow, GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
+	{
+		viewIndex = 0;
+		x = m_views[0].x + m_views[0].width / 2;
+		y = m_views[0].y + m_views[0].height / 2;
+		return(true);
+	}
+
+	// cursor positions are in window coordinates from the top left
+	double cursorX = 0.0;
+	double cursorY = 0.0;
+	int windowWidth = 0;
+	int windowHeight = 0;
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	glfwGetCursorPos(m_pWindow, &cursorX, &cursorY);
+	glfwGetWindowSize(m_pWindow, &windowWidth, &windowHeight);
+	glfwGetFramebufferSize(m_pWindow, &framebufferWidth, &framebufferHeight);
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return(false);
+	}
+	x = (int)(cursorX * framebufferWidth / windowWidth);
+	y = framebufferHeight - 1 - (int)(cursorY * framebufferHeight / windowHeight);
+	// the views are laid out in the scaled framebuffer
+	if (m_scaledFramebuffer != 0)
+	{
+		x = x * m_scaledWidth / framebufferWidth;
+		y = y * m_scaledHeight / framebufferHeight;
+	}
+
+	for (size_t i = 0; i < m_views.size(); i++)
+	{
+		const VIEW_INFO& view = m_views[i];
+		if ((x >= view.x) && (x < view.x + view.width) && (y >= view.y) && (y < view.y + view.height))
+		{
+			viewIndex = (int)i;
+			return(true);
+		}
+	}
+
+	return(false);
 }
 
 /***********************************************************
@@ -203,38 +681,211 @@ void ViewManager::ProcessKeyboardEvents()
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	AllocationTracker::BeginScope("PrepareSceneView");
+	PerfCounters::BeginScope("PrepareSceneView");
 
 	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
+	double currentFrame = glfwGetTime();
+	gDeltaTime = (float)(currentFrame - gLastFrame);
 	gLastFrame = currentFrame;
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// apply the input events queued since the previous frame at
+	// their times
+	glm::vec3 previousPosition = g_pCamera->Position;
+	ProcessInputEvents(currentFrame);
+	ResolveCameraCollision(previousPosition);
+
+	// smoothed over a few frames, so one long frame does not throw the
+	// prediction of the world streaming far ahead
+	if (gDeltaTime > 0.0f)
+	{
+		glm::vec3 velocity = (g_pCamera->Position - previousPosition) / gDeltaTime;
+		m_cameraVelocity = glm::mix(m_cameraVelocity, velocity, 0.2f);
+	}
+
+	int framebufferWidth = WINDOW_WIDTH;
+	int framebufferHeight = WINDOW_HEIGHT;
+	if (NULL != m_pWindow)
+	{
+		glfwGetFramebufferSize(m_pWindow, &framebufferWidth, &framebufferHeight);
+	}
+	// the views are laid out in the framebuffer they are rendered into
+	BindSceneFramebuffer(framebufferWidth, framebufferHeight, framebufferWidth, framebufferHeight);
+	m_sceneWidth = framebufferWidth;
+	m_sceneHeight = framebufferHeight;
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	if (m_bMultiView)
+	{
+		// perspective top left, top view top right, front view bottom
+		// left and side view bottom right
+		int halfWidth = framebufferWidth / 2;
+		int halfHeight = framebufferHeight / 2;
+		m_views.resize(4);
+		SetupView(m_views[0], VIEW_PERSPECTIVE, 0, halfHeight, halfWidth, framebufferHeight - halfHeight);
+		SetupView(m_views[1], VIEW_ORTHO_TOP, halfWidth, halfHeight, framebufferWidth - halfWidth, framebufferHeight - halfHeight);
+		SetupView(m_views[2], VIEW_ORTHO_FRONT, 0, 0, halfWidth, halfHeight);
+		SetupView(m_views[3], VIEW_ORTHO_SIDE, halfWidth, 0, framebufferWidth - halfWidth, halfHeight);
+	}
+	else
+	{
+		m_views.resize(1);
+		SetupView(m_views[0], bOrthographicProjection ? VIEW_ORTHO_FRONT : VIEW_PERSPECTIVE,
+			0, 0, framebufferWidth, framebufferHeight);
+	}
 
-	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	// the main view is active until another view is applied
+	ApplyView(0);
+
+	PerfCounters::EndScope();
+	AllocationTracker::EndScope();
+}
+
+/***********************************************************
+ *  LatchViews()
+ *
+ *  This method is used for moving the camera views to the
+ *  input that arrived while the frame was prepared, just
+ *  before they are drawn.  The events are polled again and
+ *  applied, and the views of the interactive camera are
+ *  rebuilt in place; the layout and the orthographic views
+ *  stay as PrepareSceneView() set them until the next frame.
+ ***********************************************************/
+void ViewManager::LatchViews()
+{
+	if ((NULL == m_pWindow) || m_views.empty())
+	{
+		return;
+	}
+
+	glfwPollEvents();
+	double time = glfwGetTime();
+	glm::vec3 previousPosition = g_pCamera->Position;
+	ProcessInputEvents(time);
+	if ((NULL != m_pCollisionWorld) && m_bCollision && (g_pCamera->Position != previousPosition))
+	{
+		g_pCamera->Position = m_pCollisionWorld->MoveSphere(previousPosition, g_pCamera->Position, CAMERA_COLLISION_RADIUS);
+	}
+
+	for (size_t i = 0; i < m_views.size(); i++)
+	{
+		VIEW_INFO& view = m_views[i];
+		if (view.type == VIEW_PERSPECTIVE)
+		{
+			SetupView(view, view.type, view.x, view.y, view.width, view.height);
+		}
+	}
+	ApplyView(0);
+
+	// how much later than the start of the frame the camera was read
+	m_latchCount++;
+	m_latchSeconds += time - gLastFrame;
+}
+
+/***********************************************************
+ *  SetupView()
+ *
+ *  This method is used for calculating the view and
+ *  projection matrices of one viewport.  The projection
+ *  uses the aspect ratio of the viewport.
+ ***********************************************************/
+void ViewManager::SetupView(VIEW_INFO& viewInfo, VIEW_TYPE type, int x, int y, int width, int height)
+{
+	viewInfo.type = type;
+	viewInfo.x = x;
+	viewInfo.y = y;
+	viewInfo.width = (width > 0) ? width : 1;
+	viewInfo.height = (height > 0) ? height : 1;
+
+	GLfloat aspect = (GLfloat)viewInfo.width / (GLfloat)viewInfo.height;
+	float halfHeight = ORTHO_VIEW_HEIGHT * 0.5f;
+	float halfWidth = halfHeight * aspect;
+
+	switch (type)
+	{
+	case VIEW_ORTHO_FRONT:
+		viewInfo.position = ORTHO_VIEW_CENTER + glm::vec3(0.0f, 0.0f, ORTHO_VIEW_DISTANCE);
+		viewInfo.view = glm::lookAt(viewInfo.position, ORTHO_VIEW_CENTER, glm::vec3(0.0f, 1.0f, 0.0f));
+		viewInfo.projection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, 0.1f, ORTHO_VIEW_DISTANCE * 2.0f);
+		break;
+	case VIEW_ORTHO_TOP:
+		viewInfo.position = ORTHO_VIEW_CENTER + glm::vec3(0.0f, ORTHO_VIEW_DISTANCE, 0.0f);
+		viewInfo.view = glm::lookAt(viewInfo.position, ORTHO_VIEW_CENTER, glm::vec3(0.0f, 0.0f, -1.0f));
+		viewInfo.projection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, 0.1f, ORTHO_VIEW_DISTANCE * 2.0f);
+		break;
+	case VIEW_ORTHO_SIDE:
+		viewInfo.position = ORTHO_VIEW_CENTER + glm::vec3(ORTHO_VIEW_DISTANCE, 0.0f, 0.0f);
+		viewInfo.view = glm::lookAt(viewInfo.position, ORTHO_VIEW_CENTER, glm::vec3(0.0f, 1.0f, 0.0f));
+		viewInfo.projection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, 0.1f, ORTHO_VIEW_DISTANCE * 2.0f);
+		break;
+	default:
+		// get the current view matrix from the camera
+		viewInfo.position = g_pCamera->Position;
+		viewInfo.view = g_pCamera->GetViewMatrix();
+		// define the current projection matrix
+		viewInfo.projection = glm::perspective(glm::radians(g_pCamera->Zoom), aspect, 0.1f, 100.0f);
+		break;
+	}
+}
+
+/***********************************************************
+ *  ApplyView()
+ *
+ *  This method is used for selecting one of the viewports
+ *  for the following draw commands.
+ ***********************************************************/
+void ViewManager::ApplyView(int index)
+{
+	if ((index < 0) || (index >= (int)m_views.size()))
+	{
+		return;
+	}
+
+	const VIEW_INFO& viewInfo = m_views[index];
+	glViewport(viewInfo.x, viewInfo.y, viewInfo.width, viewInfo.height);
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		// set the view and projection matrices and the view position
+		// of the camera into the shader for proper rendering
+		m_viewUniforms.Set(m_pShaderManager->m_programID, viewInfo.view, viewInfo.projection, viewInfo.position);
 	}
 }
 
-void ViewManager::Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double xOffset, double yOffset)
+/***********************************************************
+ *  FinishSceneView()
+ *
+ *  This method is called after the 3D scene has been rendered
+ *  to capture the finished frame when a screenshot or video
+ *  recording is active.
+ ***********************************************************/
+void ViewManager::FinishSceneView()
 {
-	// Adjust the camera's movement speed based on the scroll input.
-	g_pCamera->ProcessMouseScroll(static_cast<float>(yOffset));
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
+
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	glfwGetFramebufferSize(m_pWindow, &framebufferWidth, &framebufferHeight);
+
+	// stretch the scaled views over the window, which is what the
+	// capture and the display see
+	if (m_scaledFramebuffer != 0)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_scaledFramebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, m_scaledWidth, m_scaledHeight, 0, 0, framebufferWidth, framebufferHeight,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// restore the full window viewport after the per-view ones
+	glViewport(0, 0, framebufferWidth, framebufferHeight);
+
+	if (NULL != m_pCaptureManager)
+	{
+		m_pCaptureManager->CaptureFrame(framebufferWidth, framebufferHeight);
+	}
 }
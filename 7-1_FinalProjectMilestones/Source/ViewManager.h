@@ -10,34 +10,129 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "CaptureManager.h"
+#include "CollisionWorld.h"
+#include "InputQueue.h"
+#include "LightCostView.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+#include <vector>
+
 class ViewManager
 {
 public:
+	// the cameras a viewport can show
+	enum VIEW_TYPE
+	{
+		VIEW_PERSPECTIVE,     // the interactive camera
+		VIEW_ORTHO_FRONT,
+		VIEW_ORTHO_TOP,
+		VIEW_ORTHO_SIDE
+	};
+
+	// one viewport of the window and the camera shown in it
+	struct VIEW_INFO
+	{
+		VIEW_TYPE type;
+		// viewport rectangle in framebuffer pixels
+		int x;
+		int y;
+		int width;
+		int height;
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 position;
+	};
+
 	// constructor
 	ViewManager(
 		ShaderManager* pShaderManager);
 	// destructor
 	~ViewManager();
 
-	// mouse position callback for mouse interaction with the 3D scene
-	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
-
-	// mouse scroll callback for adjusting camera speed
-	static void Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double xOffset, double yOffset);
-
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// the camera uniforms of the shader manager's program
+	ViewUniforms m_viewUniforms;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// screenshot and video capture of the display window
+	CaptureManager* m_pCaptureManager;
+	// the heatmap of the lighting cost of every pixel, cycled by F7
+	LightCostView* m_pLightCostView;
+	// the viewports of the current frame, set by PrepareSceneView();
+	// the first one is the main view
+	std::vector<VIEW_INFO> m_views;
+	// show the four view layout instead of a single view
+	bool m_bMultiView;
+	// the keyboard and mouse events since the previous frame, the
+	// movement keys held after the last one applied, and its time
+	InputQueue m_inputQueue;
+	static const int MOVEMENT_KEY_COUNT = 6;
+	bool m_bMovementKeyDown[MOVEMENT_KEY_COUNT];
+	double m_inputTime;
+	// how long the events took to reach the camera and the display,
+	// reported every few seconds
+	struct LATENCY_STATS
+	{
+		int count = 0;
+		double sum = 0.0;
+		double sumSquares = 0.0;
+		double worst = 0.0;
+	};
+	LATENCY_STATS m_cameraLatency;
+	LATENCY_STATS m_displayLatency;
+	int m_frameEventCount;
+	double m_frameEventTimes;
+	double m_frameEventSquares;
+	double m_frameOldestEvent;
+	double m_latencyReportTime;
+	// the time from the start of the frame to the latch of the views
+	int m_latchCount;
+	double m_latchSeconds;
+	// a click that has not been handed to the object picker yet
+	bool m_bPickRequested;
+	// the camera collides with this world unless C turned it off
+	CollisionWorld* m_pCollisionWorld;
+	bool m_bCollision;
+	// the collision queries are reported every few seconds
+	double m_collisionReportTime;
+	uint32_t m_collisionReportFrames;
+	// smoothed camera movement per second, for the world streaming
+	glm::vec3 m_cameraVelocity;
+	// below 1 the views are rendered into a smaller framebuffer, which
+	// is stretched over the window before the capture
+	float m_renderScale;
+	GLuint m_scaledFramebuffer;
+	GLuint m_scaledColorBuffer;
+	GLuint m_scaledDepthBuffer;
+	int m_scaledWidth;
+	int m_scaledHeight;
+	// the size of the framebuffer the views of the frame are laid out in
+	int m_sceneWidth;
+	int m_sceneHeight;
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// apply the queued input events for interaction with the 3D scene
+	void ProcessInputEvents(double time);
+	void ProcessKeyEvent(int key, int action);
+	// move the camera by the held keys up to a time
+	void MoveCamera(double untilTime);
+	static void AddLatency(LATENCY_STATS& stats, double seconds);
+	static double GetAverageMs(const LATENCY_STATS& stats);
+	static double GetJitterMs(const LATENCY_STATS& stats);
+	// keep the camera from moving through the scene geometry
+	void ResolveCameraCollision(glm::vec3 previousPosition);
+	// bind the framebuffer the views are rendered into, resized to the
+	// scaled window; returns its size
+	void BindSceneFramebuffer(int framebufferWidth, int framebufferHeight, int& width, int& height);
+	void DestroyScaledFramebuffer();
+	// fill in the camera matrices of a viewport
+	void SetupView(VIEW_INFO& viewInfo, VIEW_TYPE type, int x, int y, int width, int height);
 
 public:
 	// create the initial OpenGL display window
@@ -45,4 +140,42 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// read the latest input into the camera views just before they are
+	// submitted, after the CPU work of the frame
+	void LatchViews();
+
+	// called after the scene has been rendered, before the buffers swap
+	void FinishSceneView();
+	// called after the buffers swap, to measure the input latency
+	void FramePresented();
+
+	// the viewports of the current frame, and the size of the
+	// framebuffer they are in
+	int GetViewCount() const { return (int)m_views.size(); }
+	int GetSceneWidth() const { return m_sceneWidth; }
+	int GetSceneHeight() const { return m_sceneHeight; }
+	const VIEW_INFO& GetView(int index) const { return m_views[index]; }
+	// set the viewport and the shader matrices of one view
+	void ApplyView(int index);
+	// the scene geometry the camera collides with, or NULL
+	void SetCollisionWorld(CollisionWorld* pCollisionWorld);
+	// the lighting cost heatmap, which the views are drawn through
+	// while it is on; NULL before the window is created
+	LightCostView* GetLightCostView() { return m_pLightCostView; }
+	// the fraction of the window resolution the views are rendered at,
+	// from the quality tier; takes effect at the next frame
+	void SetRenderScale(float renderScale);
+
+	// the pixel of the last click in the views' framebuffer, which is
+	// smaller than the window's when the render scale is below 1, and
+	// the view it is in;
+	// returns false when there was no click since the previous call
+	bool ConsumePickRequest(int& viewIndex, int& x, int& y);
+
+	// the camera of the main view
+	const glm::mat4& GetViewMatrix() const { return m_views[0].view; }
+	const glm::mat4& GetProjectionMatrix() const { return m_views[0].projection; }
+	glm::vec3 GetViewPosition() const { return m_views[0].position; }
+	glm::vec3 GetCameraVelocity() const { return m_cameraVelocity; }
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.cpp
+// ============
+// fixed size pool of worker threads consuming a shared task queue
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WorkerPool.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	// task slots reserved when the pool starts, more than a frame queues
+	const size_t INITIAL_TASK_SLOTS = 256;
+}
+
+/***********************************************************
+ *  WorkerPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WorkerPool::WorkerPool(int threadCount)
+{
+	m_tasks.resize(INITIAL_TASK_SLOTS);
+	m_taskHead = 0;
+	m_taskCount = 0;
+	m_runningCount = 0;
+	m_bShutdown = false;
+
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+		if (threadCount < 1)
+		{
+			threadCount = 1;
+		}
+	}
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~WorkerPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_taskAvailable.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method queues a task for the next idle worker.
+ ***********************************************************/
+void WorkerPool::Submit(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_taskCount == m_tasks.size())
+		{
+			GrowTasks();
+		}
+		m_tasks[(m_taskHead + m_taskCount) % m_tasks.size()] = std::move(task);
+		m_taskCount++;
+	}
+	m_taskAvailable.notify_one();
+}
+
+/***********************************************************
+ *  WaitIdle()
+ *
+ *  This method blocks until every queued task has run.
+ ***********************************************************/
+void WorkerPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_taskFinished.wait(lock, [this]() { return (m_taskCount == 0) && (m_runningCount == 0); });
+}
+
+/***********************************************************
+ *  WaitForCapacity()
+ *
+ *  This method throttles a producer so the queue does not
+ *  grow without bound when the workers fall behind.
+ ***********************************************************/
+void WorkerPool::WaitForCapacity(int maxOutstanding)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_taskFinished.wait(lock, [this, maxOutstanding]() { return ((int)m_taskCount + m_runningCount) < maxOutstanding; });
+}
+
+/***********************************************************
+ *  GetOutstandingCount()
+ *
+ *  This method returns the number of unfinished tasks.
+ ***********************************************************/
+int WorkerPool::GetOutstandingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return((int)m_taskCount + m_runningCount);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the body of every worker thread.  It runs
+ *  tasks until the pool shuts down and the queue is empty.
+ ***********************************************************/
+void WorkerPool::WorkerLoop()
+{
+	while (true)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this]() { return m_bShutdown || (m_taskCount > 0); });
+			if (m_taskCount == 0)
+			{
+				return;
+			}
+			// the slot is emptied so its captures are released now
+			task = std::move(m_tasks[m_taskHead]);
+			m_tasks[m_taskHead] = nullptr;
+			m_taskHead = (m_taskHead + 1) % m_tasks.size();
+			m_taskCount--;
+			m_runningCount++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_runningCount--;
+		}
+		m_taskFinished.notify_all();
+	}
+}
+
+/***********************************************************
+ *  GrowTasks()
+ *
+ *  This method doubles the ring of tasks when it is full,
+ *  moving the queued tasks to the start of the new one.  It
+ *  is called with the mutex held.
+ ***********************************************************/
+void WorkerPool::GrowTasks()
+{
+	std::vector<Task> tasks(m_tasks.size() * 2);
+	for (size_t i = 0; i < m_taskCount; i++)
+	{
+		tasks[i] = std::move(m_tasks[(m_taskHead + i) % m_tasks.size()]);
+	}
+	m_tasks.swap(tasks);
+	m_taskHead = 0;
+}
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.h
+// ============
+// fixed size pool of worker threads consuming a shared task queue
+//
+// The queue is a ring of task slots reserved up front, so queuing a task
+// whose captures fit in std::function's own storage allocates nothing.
+// The ring only grows when more tasks are queued at once than ever
+// before; a full ring does not block, since tasks may queue tasks.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	// constructor - a threadCount of 0 uses one thread per hardware
+	// thread, minus one for the thread that owns the GL context
+	WorkerPool(int threadCount = 0);
+	// destructor - finishes the queued tasks before joining
+	~WorkerPool();
+
+	// add a task to the back of the queue
+	void Submit(Task task);
+	// block until the queue is empty and no task is running
+	void WaitIdle();
+	// block until fewer than maxOutstanding tasks are queued or running
+	void WaitForCapacity(int maxOutstanding);
+
+	int GetThreadCount() const { return (int)m_threads.size(); }
+	// number of tasks queued or currently running
+	int GetOutstandingCount();
+
+private:
+	std::vector<std::thread> m_threads;
+	// the ring of queued tasks: m_taskCount of them from m_taskHead on
+	std::vector<Task> m_tasks;
+	size_t m_taskHead;
+	size_t m_taskCount;
+	std::mutex m_mutex;
+	// signaled when a task is queued or the pool shuts down
+	std::condition_variable m_taskAvailable;
+	// signaled whenever a task finishes
+	std::condition_variable m_taskFinished;
+	int m_runningCount;
+	bool m_bShutdown;
+
+	void WorkerLoop();
+	// double the ring, keeping the queued tasks in order
+	void GrowTasks();
+};
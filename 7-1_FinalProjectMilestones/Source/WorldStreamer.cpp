@@ -0,0 +1,693 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.cpp
+// ============
+// load and unload the chunks of a large world around the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WorldStreamer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// chunks nearer than this are loaded, chunks farther than the
+	// unload radius are removed; the gap keeps a chunk on the border
+	// from being loaded and unloaded over and over
+	const float LOAD_RADIUS = 90.0f;
+	const float UNLOAD_RADIUS = 120.0f;
+	// how far ahead the camera's movement is followed
+	const float LOOKAHEAD_SECONDS = 1.5f;
+	// chunk files read or parsed at the same time
+	const int MAX_LOADS_IN_FLIGHT = 2;
+	// entities created and destroyed per frame
+	const int INSTALL_BUDGET = 128;
+	const int REMOVE_BUDGET = 256;
+
+	// parse "x,y,z" into a vector
+	bool ParseVec3(const std::string& text, glm::vec3& value)
+	{
+		return(sscanf(text.c_str(), "%f,%f,%f", &value.x, &value.y, &value.z) == 3);
+	}
+
+	SceneTables::VEC3 ToTableVec3(const glm::vec3& value)
+	{
+		SceneTables::VEC3 result = { value.x, value.y, value.z };
+		return(result);
+	}
+
+	glm::vec3 ToVec3(const SceneTables::VEC3& value)
+	{
+		return(glm::vec3(value.x, value.y, value.z));
+	}
+}
+
+/***********************************************************
+ *  WorldStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WorldStreamer::WorldStreamer(
+	AssetPipeline& assets,
+	EntityWorld& world,
+	const MESH_INFO* meshes,
+	int meshCount,
+	MaterialResolver resolver,
+	ImpostorRenderer* pImpostors,
+	size_t memoryBudget)
+	: m_assets(assets), m_world(world), m_meshes(meshes, meshes + meshCount), m_resolver(resolver)
+{
+	m_pImpostors = pImpostors;
+	m_memoryBudget = memoryBudget;
+	m_memoryUsed = 0;
+	m_residentVersion = 0;
+}
+
+/***********************************************************
+ *  ~WorldStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WorldStreamer::~WorldStreamer()
+{
+	// the loads write into their chunks, so they must finish first
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (m_chunks[i]->state == CHUNK_LOADING)
+		{
+			m_assets.Wait(m_chunks[i]->load);
+		}
+		if (NULL != m_pImpostors)
+		{
+			for (size_t j = 0; j < m_chunks[i]->impostors.size(); j++)
+			{
+				m_pImpostors->RemoveInstance(m_chunks[i]->impostors[j]);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  LoadIndex()
+ *
+ *  This method reads the chunk lines of an index file.  The
+ *  chunk files are found relative to the index file, and the
+ *  impostors of the assemblies are placed at once.
+ ***********************************************************/
+bool WorldStreamer::LoadIndex(const char* indexFile)
+{
+	std::ifstream file(indexFile);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open world index file:" << indexFile << std::endl;
+		return(false);
+	}
+
+	std::filesystem::path folder = std::filesystem::path(indexFile).parent_path();
+	std::string line;
+	int lineNumber = 0;
+	bool bSuccess = true;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t first = line.find_first_not_of(" \t\r");
+		if ((first == std::string::npos) || (line[first] == '#'))
+		{
+			continue;
+		}
+		if (line.compare(first, 6, "chunk ") != 0)
+		{
+			std::cout << "World index line " << lineNumber << ": expected a chunk line" << std::endl;
+			bSuccess = false;
+			continue;
+		}
+
+		std::unique_ptr<CHUNK> pChunk(new CHUNK());
+		pChunk->partCount = 0;
+		pChunk->state = CHUNK_UNLOADED;
+		pChunk->priority = 0.0f;
+		pChunk->bounds.minimum = glm::vec3(0.0f);
+		pChunk->bounds.maximum = glm::vec3(0.0f);
+
+		std::istringstream tokens(line.substr(first + 6));
+		std::string token;
+		bool bValid = true;
+		while (bValid && (tokens >> token))
+		{
+			size_t equals = token.find('=');
+			std::string key = token.substr(0, equals);
+			std::string value = (equals == std::string::npos) ? std::string() : token.substr(equals + 1);
+			if (key == "file")
+			{
+				pChunk->file = (folder / value).string();
+			}
+			else if (key == "parts")
+			{
+				pChunk->partCount = atoi(value.c_str());
+			}
+			else if (key == "min")
+			{
+				bValid = ParseVec3(value, pChunk->bounds.minimum);
+			}
+			else if (key == "max")
+			{
+				bValid = ParseVec3(value, pChunk->bounds.maximum);
+			}
+			else if (key == "assembly")
+			{
+				size_t at = value.find('@');
+				glm::vec3 position(0.0f);
+				bValid = (at != std::string::npos) && ParseVec3(value.substr(at + 1), position);
+				int instance = -1;
+				if (bValid && (NULL != m_pImpostors))
+				{
+					instance = m_pImpostors->AddInstance(m_pImpostors->FindAtlas(value.substr(0, at).c_str()), position);
+				}
+				pChunk->impostors.push_back(instance);
+			}
+			else
+			{
+				bValid = false;
+			}
+		}
+		if (!bValid || pChunk->file.empty())
+		{
+			std::cout << "World index line " << lineNumber << ": expected file=, parts=, min=, max= and assembly=<name>@x,y,z" << std::endl;
+			if (NULL != m_pImpostors)
+			{
+				for (size_t i = 0; i < pChunk->impostors.size(); i++)
+				{
+					m_pImpostors->RemoveInstance(pChunk->impostors[i]);
+				}
+			}
+			bSuccess = false;
+			continue;
+		}
+		m_chunks.push_back(std::move(pChunk));
+	}
+
+	m_loadQueue.reserve(m_chunks.size());
+	std::cout << "INFO: Streaming " << m_chunks.size() << " world chunks from " << indexFile
+		<< " within " << (m_memoryBudget / 1024) << " KB" << std::endl;
+	return(bSuccess && !m_chunks.empty());
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method ranks the chunks around the camera, finishes
+ *  and starts loads, and spends the per-frame entity budget
+ *  on the chunks being installed or removed.
+ ***********************************************************/
+void WorldStreamer::Update(const glm::vec3& cameraPosition, const glm::vec3& cameraVelocity)
+{
+	glm::vec3 predictedPosition = cameraPosition + cameraVelocity * LOOKAHEAD_SECONDS;
+
+	m_loadQueue.clear();
+	int loadsInFlight = 0;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		CHUNK& chunk = *m_chunks[i];
+		chunk.priority = std::min(
+			BoundingVolumes::DistanceToBox(chunk.bounds, cameraPosition),
+			BoundingVolumes::DistanceToBox(chunk.bounds, predictedPosition));
+
+		// a finished load is installed, or dropped when the camera
+		// has left the chunk behind in the meantime
+		if ((chunk.state == CHUNK_LOADING) && chunk.load.IsReady())
+		{
+			if (chunk.load.GetResult() && (chunk.priority < UNLOAD_RADIUS))
+			{
+				chunk.state = CHUNK_INSTALLING;
+				chunk.entities.reserve(chunk.parts.size());
+			}
+			else
+			{
+				chunk.parts.clear();
+				chunk.parts.shrink_to_fit();
+				chunk.state = CHUNK_UNLOADED;
+				m_memoryUsed -= EstimateMemory(chunk.partCount);
+			}
+			chunk.load = AssetTask<bool>();
+		}
+
+		if (chunk.state == CHUNK_LOADING)
+		{
+			loadsInFlight++;
+		}
+		else if ((chunk.state == CHUNK_UNLOADED) && (chunk.priority < LOAD_RADIUS))
+		{
+			m_loadQueue.push_back((int)i);
+		}
+		else if (((chunk.state == CHUNK_INSTALLING) || (chunk.state == CHUNK_RESIDENT)) &&
+			(chunk.priority > UNLOAD_RADIUS))
+		{
+			StartUnload(chunk);
+		}
+	}
+
+	// the nearest chunks load first
+	std::sort(m_loadQueue.begin(), m_loadQueue.end(),
+		[this](int a, int b) { return m_chunks[a]->priority < m_chunks[b]->priority; });
+	for (size_t i = 0; (i < m_loadQueue.size()) && (loadsInFlight < MAX_LOADS_IN_FLIGHT); i++)
+	{
+		CHUNK& chunk = *m_chunks[m_loadQueue[i]];
+		size_t memory = EstimateMemory(chunk.partCount);
+		if (MakeRoom(memory, chunk.priority) == false)
+		{
+			// the farther chunks in the queue would not fit either
+			break;
+		}
+		m_memoryUsed += memory;
+		chunk.state = CHUNK_LOADING;
+		chunk.load = LoadChunkAsync(&chunk);
+		loadsInFlight++;
+	}
+
+	// spend the entity budgets, nearest installs and any removal first
+	int installBudget = INSTALL_BUDGET;
+	int removeBudget = REMOVE_BUDGET;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		CHUNK& chunk = *m_chunks[i];
+		if ((chunk.state == CHUNK_UNLOADING) && (removeBudget > 0))
+		{
+			removeBudget = RemoveParts(chunk, removeBudget);
+		}
+	}
+	while (installBudget > 0)
+	{
+		CHUNK* pNearest = NULL;
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			if ((m_chunks[i]->state == CHUNK_INSTALLING) &&
+				((NULL == pNearest) || (m_chunks[i]->priority < pNearest->priority)))
+			{
+				pNearest = m_chunks[i].get();
+			}
+		}
+		if (NULL == pNearest)
+		{
+			break;
+		}
+		installBudget = InstallParts(*pNearest, installBudget);
+	}
+}
+
+/***********************************************************
+ *  GetResidentCount()
+ *
+ *  This method returns the number of chunks whose entities
+ *  have all been created.
+ ***********************************************************/
+int WorldStreamer::GetResidentCount() const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (m_chunks[i]->state == CHUNK_RESIDENT)
+		{
+			count++;
+		}
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  EstimateMemory()
+ *
+ *  This method estimates the memory a chunk holds while it is
+ *  loaded, the larger of its parsed parts and its entities.
+ ***********************************************************/
+size_t WorldStreamer::EstimateMemory(int partCount)
+{
+	size_t entityMemory =
+		sizeof(EntityWorld::ENTITY) +
+		sizeof(EntityWorld::TRANSFORM_COMPONENT) +
+		sizeof(EntityWorld::MESH_COMPONENT) +
+		sizeof(EntityWorld::MATERIAL_COMPONENT) +
+		sizeof(EntityWorld::BOUNDS_COMPONENT) +
+		sizeof(EntityWorld::IMPOSTOR_COMPONENT);
+	return((size_t)partCount * std::max(entityMemory, sizeof(CHUNK_PART)));
+}
+
+/***********************************************************
+ *  LoadChunkAsync()
+ *
+ *  This coroutine reads a chunk file on the IO thread and
+ *  parses it on the workers, where the task finishes.
+ ***********************************************************/
+AssetTask<bool> WorldStreamer::LoadChunkAsync(CHUNK* pChunk)
+{
+	co_await m_assets.ToIOThread();
+	std::vector<unsigned char> contents;
+	if (AssetPipeline::ReadFile(pChunk->file.c_str(), contents) == false)
+	{
+		co_return false;
+	}
+
+	co_await m_assets.ToWorkers();
+	co_return ParseChunk(contents, pChunk->file, pChunk->parts);
+}
+
+/***********************************************************
+ *  ParseChunk()
+ *
+ *  This method parses the part lines of a chunk file and
+ *  bakes their model matrices and world bounds.
+ ***********************************************************/
+bool WorldStreamer::ParseChunk(const std::vector<unsigned char>& contents, const std::string& file, std::vector<CHUNK_PART>& parts) const
+{
+	std::istringstream lines(std::string(contents.begin(), contents.end()));
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+
+		size_t first = line.find_first_not_of(" \t\r");
+		if ((first == std::string::npos) || (line[first] == '#'))
+		{
+			continue;
+		}
+		if (line.compare(first, 5, "part ") != 0)
+		{
+			std::cout << file << " line " << lineNumber << ": expected a part line" << std::endl;
+			return(false);
+		}
+
+		CHUNK_PART part;
+		part.scale = glm::vec3(1.0f);
+		part.rotationDegrees = glm::vec3(0.0f);
+		part.position = glm::vec3(0.0f);
+		part.UVscale = glm::vec2(1.0f);
+		part.assembly = -1;
+		const MESH_INFO* pMesh = NULL;
+
+		std::istringstream tokens(line.substr(first + 5));
+		std::string token;
+		bool bValid = true;
+		while (bValid && (tokens >> token))
+		{
+			size_t equals = token.find('=');
+			std::string key = token.substr(0, equals);
+			std::string value = (equals == std::string::npos) ? std::string() : token.substr(equals + 1);
+			if (key == "mesh")
+			{
+				pMesh = FindMesh(value);
+				bValid = (NULL != pMesh);
+			}
+			else if (key == "scale")
+			{
+				bValid = ParseVec3(value, part.scale);
+			}
+			else if (key == "rotation")
+			{
+				bValid = ParseVec3(value, part.rotationDegrees);
+			}
+			else if (key == "position")
+			{
+				bValid = ParseVec3(value, part.position);
+			}
+			else if (key == "material")
+			{
+				part.material = value;
+			}
+			else if (key == "texture")
+			{
+				part.texture = value;
+			}
+			else if (key == "uv")
+			{
+				bValid = (sscanf(value.c_str(), "%f,%f", &part.UVscale.x, &part.UVscale.y) == 2);
+			}
+			else if (key == "assembly")
+			{
+				bValid = (sscanf(value.c_str(), "%d", &part.assembly) == 1);
+			}
+			else
+			{
+				bValid = false;
+			}
+		}
+		if (!bValid || (NULL == pMesh))
+		{
+			std::cout << file << " line " << lineNumber << ": could not parse " << token << std::endl;
+			return(false);
+		}
+
+		// the same baking as the compile time scene tables
+		SceneTables::PART_DESC desc = {};
+		desc.scale = ToTableVec3(part.scale);
+		desc.rotationDegrees = ToTableVec3(part.rotationDegrees);
+		desc.position = ToTableVec3(part.position);
+		SceneTables::BAKED_PART baked = SceneTables::BakePart(desc, pMesh->bounds);
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				part.model[column][row] = baked.model[column * 4 + row];
+			}
+		}
+		part.mesh = pMesh->mesh;
+		part.localBounds.minimum = ToVec3(pMesh->bounds.minimum);
+		part.localBounds.maximum = ToVec3(pMesh->bounds.maximum);
+		part.worldBounds.minimum = ToVec3(baked.bounds.minimum);
+		part.worldBounds.maximum = ToVec3(baked.bounds.maximum);
+		parts.push_back(part);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  FindMesh()
+ *
+ *  This method finds a mesh by the name used in the files.
+ ***********************************************************/
+const WorldStreamer::MESH_INFO* WorldStreamer::FindMesh(const std::string& name) const
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		if (name == m_meshes[i].name)
+		{
+			return(&m_meshes[i]);
+		}
+	}
+	return(NULL);
+}
+
+/***********************************************************
+ *  StartUnload()
+ *
+ *  This method starts removing the entities of a chunk.  Its
+ *  memory is counted as free at once, the entities go over
+ *  the next frames.
+ ***********************************************************/
+void WorldStreamer::StartUnload(CHUNK& chunk)
+{
+	SetPartsResident(chunk, false);
+	chunk.parts.clear();
+	chunk.parts.shrink_to_fit();
+	chunk.state = CHUNK_UNLOADING;
+	m_memoryUsed -= EstimateMemory(chunk.partCount);
+}
+
+/***********************************************************
+ *  SetPartsResident()
+ *
+ *  This method tells the impostors of a chunk whether its
+ *  parts can be drawn in their place.
+ ***********************************************************/
+void WorldStreamer::SetPartsResident(CHUNK& chunk, bool bResident)
+{
+	if (NULL == m_pImpostors)
+	{
+		return;
+	}
+	for (size_t i = 0; i < chunk.impostors.size(); i++)
+	{
+		m_pImpostors->SetPartsResident(chunk.impostors[i], bResident);
+	}
+}
+
+/***********************************************************
+ *  MakeRoom()
+ *
+ *  This method unloads the farthest chunks until the memory
+ *  fits, as long as they are farther than the chunk that
+ *  needs the room.
+ ***********************************************************/
+bool WorldStreamer::MakeRoom(size_t memory, float priority)
+{
+	while (m_memoryUsed + memory > m_memoryBudget)
+	{
+		CHUNK* pFarthest = NULL;
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			CHUNK& chunk = *m_chunks[i];
+			if (((chunk.state == CHUNK_INSTALLING) || (chunk.state == CHUNK_RESIDENT)) &&
+				(chunk.priority > priority) &&
+				((NULL == pFarthest) || (chunk.priority > pFarthest->priority)))
+			{
+				pFarthest = &chunk;
+			}
+		}
+		if (NULL == pFarthest)
+		{
+			return(false);
+		}
+		StartUnload(*pFarthest);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  InstallParts()
+ *
+ *  This method creates the entities of the next parts of a
+ *  chunk, no more than the budget, and returns the budget
+ *  left.  The parsed parts are freed once all are created,
+ *  and the parts of the assemblies are shown from then on.
+ ***********************************************************/
+int WorldStreamer::InstallParts(CHUNK& chunk, int budget)
+{
+	EntityWorld::COMPONENT_MASK partMask =
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_TRANSFORM) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_MESH) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_MATERIAL) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_BOUNDS) |
+		EntityWorld::MaskOf(EntityWorld::COMPONENT_STATIC);
+
+	while ((budget > 0) && (chunk.entities.size() < chunk.parts.size()))
+	{
+		const CHUNK_PART& part = chunk.parts[chunk.entities.size()];
+		int impostor = -1;
+		if ((part.assembly >= 0) && (part.assembly < (int)chunk.impostors.size()))
+		{
+			impostor = chunk.impostors[part.assembly];
+		}
+		EntityWorld::ENTITY entity = m_world.CreateEntity(
+			(impostor >= 0) ? (partMask | EntityWorld::MaskOf(EntityWorld::COMPONENT_IMPOSTOR)) : partMask);
+
+		EntityWorld::TRANSFORM_COMPONENT* pTransform = m_world.GetComponent<EntityWorld::TRANSFORM_COMPONENT>(entity);
+		pTransform->scale = part.scale;
+		pTransform->rotationDegrees = part.rotationDegrees;
+		pTransform->position = part.position;
+		pTransform->model = part.model;
+
+		m_world.GetComponent<EntityWorld::MESH_COMPONENT>(entity)->mesh = part.mesh;
+
+		EntityWorld::MATERIAL_COMPONENT* pMaterial = m_world.GetComponent<EntityWorld::MATERIAL_COMPONENT>(entity);
+		pMaterial->materialIndex = -1;
+		pMaterial->textureSlot = -1;
+		pMaterial->bVideoTexture = false;
+		pMaterial->color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		pMaterial->UVscale = part.UVscale;
+		pMaterial->pickID = 0;
+		if (m_resolver)
+		{
+			m_resolver(part, *pMaterial);
+		}
+
+		EntityWorld::BOUNDS_COMPONENT* pBounds = m_world.GetComponent<EntityWorld::BOUNDS_COMPONENT>(entity);
+		pBounds->local = part.localBounds;
+		pBounds->world = part.worldBounds;
+
+		if (impostor >= 0)
+		{
+			m_world.GetComponent<EntityWorld::IMPOSTOR_COMPONENT>(entity)->instance = impostor;
+		}
+
+		chunk.entities.push_back(entity);
+		budget--;
+	}
+
+	if (chunk.entities.size() == chunk.parts.size())
+	{
+		chunk.parts.clear();
+		chunk.parts.shrink_to_fit();
+		chunk.state = CHUNK_RESIDENT;
+		SetPartsResident(chunk, true);
+		m_residentVersion++;
+	}
+	return(budget);
+}
+
+/***********************************************************
+ *  RemoveParts()
+ *
+ *  This method destroys the last entities of a chunk, no more
+ *  than the budget, and returns the budget left.
+ ***********************************************************/
+int WorldStreamer::RemoveParts(CHUNK& chunk, int budget)
+{
+	while ((budget > 0) && !chunk.entities.empty())
+	{
+		m_world.DestroyEntity(chunk.entities.back());
+		chunk.entities.pop_back();
+		budget--;
+	}
+
+	if (chunk.entities.empty())
+	{
+		chunk.entities.shrink_to_fit();
+		chunk.state = CHUNK_UNLOADED;
+		m_residentVersion++;
+	}
+	return(budget);
+}
+
+/***********************************************************
+ *  FormatIndexLine()
+ *
+ *  This method formats the index line of a chunk file.
+ ***********************************************************/
+std::string WorldStreamer::FormatIndexLine(const char* chunkFile, int partCount, const BoundingVolumes::BOX& bounds)
+{
+	char line[512];
+	snprintf(line, sizeof(line), "chunk file=%s parts=%d min=%g,%g,%g max=%g,%g,%g",
+		chunkFile, partCount,
+		bounds.minimum.x, bounds.minimum.y, bounds.minimum.z,
+		bounds.maximum.x, bounds.maximum.y, bounds.maximum.z);
+	return(line);
+}
+
+/***********************************************************
+ *  FormatAssembly()
+ *
+ *  This method formats an assembly for an index line.
+ ***********************************************************/
+std::string WorldStreamer::FormatAssembly(const char* name, const glm::vec3& position)
+{
+	char token[256];
+	snprintf(token, sizeof(token), " assembly=%s@%g,%g,%g", name, position.x, position.y, position.z);
+	return(token);
+}
+
+/***********************************************************
+ *  FormatPartLine()
+ *
+ *  This method formats the line of a part in a chunk file.
+ ***********************************************************/
+std::string WorldStreamer::FormatPartLine(const SceneTables::PART_DESC& part, const char* meshName, int assembly)
+{
+	char line[512];
+	snprintf(line, sizeof(line), "part mesh=%s scale=%g,%g,%g rotation=%g,%g,%g position=%g,%g,%g material=%s texture=%s uv=%g,%g",
+		meshName,
+		part.scale.x, part.scale.y, part.scale.z,
+		part.rotationDegrees.x, part.rotationDegrees.y, part.rotationDegrees.z,
+		part.position.x, part.position.y, part.position.z,
+		part.material, part.texture,
+		part.uScale, part.vScale);
+	if (assembly >= 0)
+	{
+		return(std::string(line) + " assembly=" + std::to_string(assembly));
+	}
+	return(line);
+}
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.h
+// ============
+// load and unload the chunks of a large world around the camera
+//
+// The world is split into chunk files listed in an index file, one line
+// per chunk with its file, its part count and its bounds, so the streamer
+// can rank every chunk without reading it.  A chunk file holds one line
+// per basic shape in the key=value form of the batch job files:
+//
+//   part mesh=box scale=1,1,1 rotation=0,0,0 position=0,0,0
+//        material=<tag> texture=<tag> uv=1,1 [assembly=<n>]
+//
+// An index line may also place assemblies, such as a workstation, with
+// assembly=<name>@x,y,z; the parts that name the assembly's index in their
+// line belong to it.  With an ImpostorRenderer, every assembly with a
+// baked atlas is shown as an impostor from the start, and its parts take
+// over near the camera once their chunk is resident.
+//
+// Every frame the chunks are ranked by their distance to the camera and
+// to where the camera will be after LOOKAHEAD_SECONDS at its current
+// velocity.  The nearest chunks that are not loaded go into a priority
+// queue; their files are read on the IO thread and parsed and baked on the
+// workers, a few at a time.  Parsed chunks become entities a limited number
+// of parts per frame, and chunks beyond the unload radius are removed the
+// same way, so neither shows up as a long frame.  When the resident chunks
+// would exceed the memory budget, the farthest one is unloaded first, or
+// the load waits.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AssetPipeline.h"
+#include "BoundingVolumes.h"
+#include "EntityWorld.h"
+#include "ImpostorRenderer.h"
+#include "SceneTables.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class WorldStreamer
+{
+public:
+	// a mesh the chunk files can name, with its local bounds
+	struct MESH_INFO
+	{
+		const char* name;
+		int mesh;
+		SceneTables::BOUNDS bounds;
+	};
+
+	// one basic shape of a chunk, parsed and baked on the workers
+	struct CHUNK_PART
+	{
+		glm::vec3 scale;
+		glm::vec3 rotationDegrees;
+		glm::vec3 position;
+		glm::mat4 model;
+		BoundingVolumes::BOX localBounds;
+		BoundingVolumes::BOX worldBounds;
+		int mesh;
+		std::string material;
+		std::string texture;
+		glm::vec2 UVscale;
+		int assembly;       // -1 when the part belongs to no assembly
+	};
+
+	// fills the material of a new entity from the tags of its part
+	typedef std::function<void(const CHUNK_PART& part, EntityWorld::MATERIAL_COMPONENT& material)> MaterialResolver;
+
+	// constructor - pImpostors may be NULL, then the assemblies are
+	// always drawn with their parts
+	WorldStreamer(
+		AssetPipeline& assets,
+		EntityWorld& world,
+		const MESH_INFO* meshes,
+		int meshCount,
+		MaterialResolver resolver,
+		ImpostorRenderer* pImpostors,
+		size_t memoryBudget);
+	// destructor - waits for the loads in flight and removes the
+	// impostors, the entities stay
+	~WorldStreamer();
+
+	// read the chunk list of an index file
+	bool LoadIndex(const char* indexFile);
+
+	// rank the chunks, start and finish loads, and create or destroy
+	// a limited number of entities; call once per frame outside the
+	// entity systems
+	void Update(const glm::vec3& cameraPosition, const glm::vec3& cameraVelocity);
+
+	int GetChunkCount() const { return (int)m_chunks.size(); }
+	int GetResidentCount() const;
+	size_t GetMemoryUsed() const { return m_memoryUsed; }
+	// changes whenever a chunk has become resident or has been removed
+	uint64_t GetResidentVersion() const { return m_residentVersion; }
+
+	// write an index line, an assembly to append to it and a chunk file
+	// line, for the generators
+	static std::string FormatIndexLine(const char* chunkFile, int partCount, const BoundingVolumes::BOX& bounds);
+	static std::string FormatAssembly(const char* name, const glm::vec3& position);
+	static std::string FormatPartLine(const SceneTables::PART_DESC& part, const char* meshName, int assembly = -1);
+
+private:
+	enum CHUNK_STATE
+	{
+		CHUNK_UNLOADED,
+		CHUNK_LOADING,      // read and parsed in the background
+		CHUNK_INSTALLING,   // parsed, entities being created
+		CHUNK_RESIDENT,
+		CHUNK_UNLOADING     // entities being destroyed
+	};
+
+	struct CHUNK
+	{
+		std::string file;
+		BoundingVolumes::BOX bounds;
+		int partCount;
+		CHUNK_STATE state;
+		// distance to the nearer of the camera and its predicted
+		// position, lower is more urgent
+		float priority;
+		// the load in flight and what it parsed
+		AssetTask<bool> load;
+		std::vector<CHUNK_PART> parts;
+		// the entities created so far
+		std::vector<EntityWorld::ENTITY> entities;
+		// the impostor instances of the chunk's assemblies, -1 for an
+		// assembly without an atlas
+		std::vector<int> impostors;
+	};
+
+	AssetPipeline& m_assets;
+	EntityWorld& m_world;
+	std::vector<MESH_INFO> m_meshes;
+	MaterialResolver m_resolver;
+	ImpostorRenderer* m_pImpostors;
+	size_t m_memoryBudget;
+	// estimated memory of the chunks that are loading or loaded
+	size_t m_memoryUsed;
+	std::vector<std::unique_ptr<CHUNK> > m_chunks;
+	// the chunks to load, nearest first, rebuilt every update
+	std::vector<int> m_loadQueue;
+	uint64_t m_residentVersion;
+
+	// memory of a chunk with partCount parts while it is loaded
+	static size_t EstimateMemory(int partCount);
+
+	AssetTask<bool> LoadChunkAsync(CHUNK* pChunk);
+	bool ParseChunk(const std::vector<unsigned char>& contents, const std::string& file, std::vector<CHUNK_PART>& parts) const;
+	const MESH_INFO* FindMesh(const std::string& name) const;
+
+	void StartUnload(CHUNK& chunk);
+	// let the parts of a chunk's assemblies replace their impostors
+	void SetPartsResident(CHUNK& chunk, bool bResident);
+	// make room for a chunk of the given size by unloading chunks that
+	// are farther than priority; false when there is not enough
+	bool MakeRoom(size_t memory, float priority);
+	// create or destroy up to budget entities, returns what is left
+	int InstallParts(CHUNK& chunk, int budget);
+	int RemoveParts(CHUNK& chunk, int budget);
+};
@@ -0,0 +1,127 @@
+#version 430 core
+// one invocation per object: test its bounds against the view frustum,
+// choose the level of detail of its mesh from its size on the screen and
+// append a draw command for it when it is visible, to the commands of the
+// texture slot of the object.  An object whose impostor has taken over is
+// left out
+layout (local_size_x = 64) in;
+
+#define MAX_LODS 3
+#define MAX_SCENE_TEXTURES 16
+
+// the bounds of an object and its mesh, as in GpuCuller
+struct CullObject {
+    vec4 minimum;
+    vec4 maximum;
+    int mesh;
+    int textureSlot;
+    // the impostor instance whose fade hides the object, or -1
+    int impostor;
+    int padding;
+};
+
+// one level of detail of a mesh in the shared geometry buffers; it is
+// drawn while the object covers at least minimumSize of the viewport
+// height, the coarsest level has 0
+struct MeshLod {
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    float minimumSize;
+};
+
+// the command layout of glMultiDrawElementsIndirect
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer CullObjects
+{
+    CullObject objects[];
+};
+layout (std430, binding = 1) readonly buffer MeshLods
+{
+    MeshLod lods[];
+};
+layout (std430, binding = 2) writeonly buffer DrawCommands
+{
+    DrawCommand commands[];
+};
+// the commands appended for each texture slot
+layout (std430, binding = 3) buffer DrawCounts
+{
+    uint drawCounts[MAX_SCENE_TEXTURES];
+};
+// the fade of every impostor instance, 1 once it has taken over
+layout (std430, binding = 5) readonly buffer ImpostorFades
+{
+    float impostorFades[];
+};
+
+uniform int objectCount;
+// the planes of BoundingVolumes::ExtractFrustum(), facing inward
+uniform vec4 frustumPlanes[6];
+uniform vec3 viewPosition;
+uniform bool bOrthographic;
+// the vertical scale of the projection, projection[1][1]
+uniform float projectionScale;
+// scales minimumSize of every level; the quality tiers raise it to draw
+// the coarser levels from nearer
+uniform float lodBias;
+// the first command of each texture slot, which has room for all of its
+// objects
+uniform int batchStarts[MAX_SCENE_TEXTURES];
+
+void main()
+{
+    int index = int(gl_GlobalInvocationID.x);
+    if(index >= objectCount)
+    {
+        return;
+    }
+    int impostor = objects[index].impostor;
+    if((impostor >= 0) && (impostorFades[impostor] >= 1.0))
+    {
+        return;
+    }
+
+    // the box corner furthest along each plane normal, as on the CPU
+    vec3 minimum = objects[index].minimum.xyz;
+    vec3 maximum = objects[index].maximum.xyz;
+    for(int i = 0; i < 6; i++)
+    {
+        vec4 plane = frustumPlanes[i];
+        vec3 corner = mix(minimum, maximum, greaterThanEqual(plane.xyz, vec3(0.0)));
+        if(dot(plane.xyz, corner) + plane.w < 0.0)
+        {
+            return;
+        }
+    }
+
+    // the fraction of the viewport height covered by the bounding
+    // sphere; the camera inside the sphere sees it fill the view
+    vec3 center = (minimum + maximum) * 0.5;
+    float radius = length(maximum - minimum) * 0.5;
+    float size = radius * projectionScale;
+    if(bOrthographic == false)
+    {
+        size /= max(distance(viewPosition, center), radius);
+    }
+
+    int first = objects[index].mesh * MAX_LODS;
+    MeshLod lod = lods[first];
+    for(int i = 1; (i < MAX_LODS) && (size < lod.minimumSize * lodBias) && (lods[first + i].indexCount > 0u); i++)
+    {
+        lod = lods[first + i];
+    }
+
+    // the instance of the draw is the object, which selects its record;
+    // untextured objects are drawn with the first texture slot
+    int batch = clamp(objects[index].textureSlot, 0, MAX_SCENE_TEXTURES - 1);
+    uint slot = uint(batchStarts[batch]) + atomicAdd(drawCounts[batch], 1u);
+    commands[slot] = DrawCommand(lod.indexCount, 1u, lod.firstIndex, lod.baseVertex, uint(index));
+}
@@ -50,30 +50,119 @@ struct SpotLight {
 
 #define TOTAL_POINT_LIGHTS 5
 
-uniform bool bUseTexture=false;
+#ifdef INDIRECT_DRAWS
+// the draws culled and compacted on the GPU read the values of their
+// object from a storage buffer with the same layout as the block; they
+// are drawn in groups that share a texture, set on objectTexture
+struct DrawRecord {
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+layout (std430) readonly buffer DrawRecords
+{
+    DrawRecord drawRecords[];
+};
+flat in int fragmentObjectIndex;
+// from the fade of the object's impostor instance
+flat in float fragmentImpostorFade;
+#define objectColor drawRecords[fragmentObjectIndex].objectColor
+#define material drawRecords[fragmentObjectIndex].material
+#define UVscale drawRecords[fragmentObjectIndex].UVscale
+#define bUseTexture drawRecords[fragmentObjectIndex].bUseTexture
+#define bUseVideoTexture drawRecords[fragmentObjectIndex].bUseVideoTexture
+#define impostorFade fragmentImpostorFade
+#else
+// the values of one draw; the application keeps one record per draw in a
+// uniform buffer and binds the record before the draw.  Every stage that
+// uses the block declares it the same way
+layout (std140) uniform DrawUniforms
+{
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+#endif
+uniform sampler2D objectTexture;
+
 uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
 uniform vec3 viewPosition;
 uniform DirectionalLight directionalLight;
 uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
 uniform SpotLight spotLight;
-uniform Material material;
-uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
+// video frames are stored as separate Y, U and V plane textures
+uniform bool bVideoFullRange=false;
+uniform sampler2D videoPlaneY;
+uniform sampler2D videoPlaneU;
+uniform sampler2D videoPlaneV;
+
+#ifdef LAYERED_VIEWS
+// the layered program draws several views in one pass, each with its own eye
+#define MAX_LAYERED_VIEWS 16
+layout (std140) uniform LayeredViews
+{
+    mat4 viewProjection[MAX_LAYERED_VIEWS];
+    vec4 viewPositions[MAX_LAYERED_VIEWS];
+};
+flat in int fragmentViewIndex;
+#define EYE_POSITION viewPositions[fragmentViewIndex].xyz
+#else
+#define EYE_POSITION viewPosition
+#endif
+
+#ifdef VERTEX_LIGHTING
+// the lowest quality tier lights the vertices instead of every fragment
+in vec3 vertexDiffuseLight;
+in vec3 vertexSpecularLight;
+#endif
+
+#ifdef LIGHT_COST
+// the light cost view counts the lights each fragment evaluates and the
+// textures it fetches, wherever they happen, and outputs the counts to be
+// added up per pixel instead of the color
+float lightEvaluations = 0.0;
+float textureFetches = 0.0;
+#define COUNT_LIGHT() lightEvaluations += 1.0
+#define COUNT_FETCHES(count) textureFetches += float(count)
+#else
+#define COUNT_LIGHT()
+#define COUNT_FETCHES(count)
+#endif
 
 // function prototypes
+float DitherThreshold(vec2 pixel);
+vec4 SampleObjectTexture(vec2 textureCoordinate);
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {    
+    // a part of an assembly fading into its impostor leaves the pixels
+    // the impostor has taken over, in an ordered dither pattern
+    if((impostorFade > 0.0) && (DitherThreshold(gl_FragCoord.xy) < impostorFade))
+    {
+        discard;
+    }
+
     if(bUseLighting == true)
     {
         vec3 phongResult = vec3(0.0f);
+#ifdef VERTEX_LIGHTING
+        vec3 surfaceColor = (bUseTexture == true) ? vec3(SampleObjectTexture(fragmentTextureCoordinate)) : vec3(objectColor);
+        phongResult = vertexDiffuseLight * surfaceColor + vertexSpecularLight;
+#else
         // properties
         vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
+        vec3 viewDir = normalize(EYE_POSITION - fragmentPosition);
     
         // == =====================================================
         // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
@@ -99,10 +188,11 @@ void main()
         {
             phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
         }
+#endif
     
         if(bUseTexture == true)
         {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
+            fragmentColor = vec4(phongResult, (SampleObjectTexture(fragmentTextureCoordinate)).a);
         }
         else
         {
@@ -113,18 +203,23 @@ void main()
     {
         if(bUseTexture == true)
         {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+            fragmentColor = SampleObjectTexture(fragmentTextureCoordinate * UVscale);
         }
         else
         {
             fragmentColor = objectColor;
         }
     }
+
+#ifdef LIGHT_COST
+    fragmentColor = vec4(lightEvaluations, textureFetches, 1.0, 1.0);
+#endif
 }
 
 // calculates the color when using a directional light.
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
 {
+    COUNT_LIGHT();
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
     vec3 specular = vec3(0.0f);
@@ -138,9 +233,9 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
     }
     else
     {
@@ -155,6 +250,7 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
 // calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
+    COUNT_LIGHT();
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
     vec3 specular= vec3(0.0f);
@@ -170,8 +266,8 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
         specular = light.specular * specularComponent * material.specularColor;
     }
     else
@@ -187,6 +283,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 // calculates the color when using a spot light.
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
+    COUNT_LIGHT();
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
     vec3 specular = vec3(0.0f);
@@ -207,9 +304,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
     }
     else
     {
@@ -223,3 +320,54 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
 }
+
+// samples the object texture, converting video frames from YUV to RGB
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+#ifdef INDIRECT_DRAWS
+    // the video is drawn by the CPU path, which keeps the plane samplers
+    // out of the texture units of the indirect draws
+    COUNT_FETCHES(1);
+    return texture(objectTexture, textureCoordinate);
+#else
+    if(bUseVideoTexture == false)
+    {
+        COUNT_FETCHES(1);
+        return texture(objectTexture, textureCoordinate);
+    }
+
+    // video rows are stored top to bottom
+    vec2 videoCoordinate = vec2(textureCoordinate.x, 1.0 - textureCoordinate.y);
+    COUNT_FETCHES(3);
+    float y = texture(videoPlaneY, videoCoordinate).r;
+    float u = texture(videoPlaneU, videoCoordinate).r - 0.5;
+    float v = texture(videoPlaneV, videoCoordinate).r - 0.5;
+    if(bVideoFullRange == false)
+    {
+        // expand video levels (16-235, 16-240) to the full range
+        y = (y - 16.0 / 255.0) * (255.0 / 219.0);
+        u = u * (255.0 / 224.0);
+        v = v * (255.0 / 224.0);
+    }
+
+    // BT.601
+    vec3 rgb = vec3(
+        y + 1.402 * v,
+        y - 0.344136 * u - 0.714136 * v,
+        y + 1.772 * u);
+    return vec4(clamp(rgb, 0.0, 1.0), 1.0);
+#endif
+}
+
+// the 4x4 ordered dither threshold of a pixel, between 0 and 1; the
+// impostor shader keeps exactly the pixels this one discards
+float DitherThreshold(vec2 pixel)
+{
+    const float bayer[16] = float[16](
+        0.0, 8.0, 2.0, 10.0,
+        12.0, 4.0, 14.0, 6.0,
+        3.0, 11.0, 1.0, 9.0,
+        15.0, 7.0, 13.0, 5.0);
+    ivec2 cell = ivec2(mod(pixel, 4.0));
+    return (bayer[cell.y * 4 + cell.x] + 0.5) / 16.0;
+}
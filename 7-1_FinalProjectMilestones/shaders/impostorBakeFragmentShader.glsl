@@ -0,0 +1,47 @@
+#version 330 core
+// the frames of an impostor: the unlit color with its coverage, and the
+// normal with the strength of the specular highlight.  The depth is the
+// framebuffer's own
+layout (location = 0) out vec4 bakedColor;
+layout (location = 1) out vec4 bakedNormal;
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+struct Material {
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+// the per-draw values, declared exactly as in the scene shaders
+layout (std140) uniform DrawUniforms
+{
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+
+uniform sampler2D objectTexture;
+
+void main()
+{
+    // the lit scene samples the textures without the UV scale, and
+    // the impostors are always lit
+    vec4 color = objectColor;
+    if(bUseTexture == true)
+    {
+        color = texture(objectTexture, fragmentTextureCoordinate);
+    }
+    bakedColor = vec4(color.rgb, 1.0);
+
+    // the scene lights the mesh normals as they are, so the impostor
+    // keeps them the same way
+    float specularStrength = dot(material.specularColor, vec3(0.299, 0.587, 0.114));
+    bakedNormal = vec4(normalize(fragmentVertexNormal) * 0.5 + 0.5, clamp(specularStrength, 0.0, 1.0));
+}
@@ -0,0 +1,154 @@
+#version 330 core
+out vec4 fragmentColor;
+
+in vec3 fragmentPosition;
+in vec2 frameCoordinate;
+flat in vec3 fragmentToViewer;
+flat in vec4 fragmentFrames;
+flat in float fragmentFade;
+
+struct DirectionalLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    bool bActive;
+};
+
+struct PointLight {
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    bool bActive;
+};
+
+#define TOTAL_POINT_LIGHTS 5
+// the frames of the atlases, as in ImpostorRenderer
+#define YAW_FRAMES 16.0
+#define ELEVATION_FRAMES 4.0
+// the baked frames keep no material, the highlights share one shininess
+#define IMPOSTOR_SHININESS 32.0
+
+uniform mat4 viewProjection;
+uniform vec3 viewPosition;
+uniform vec3 viewDirection;
+uniform bool bOrthographic;
+uniform float radius;
+uniform sampler2D colorAtlas;
+uniform sampler2D normalAtlas;
+uniform sampler2D depthAtlas;
+uniform DirectionalLight directionalLight;
+uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+
+// function prototypes
+float DitherThreshold(vec2 pixel);
+vec2 GetAtlasCoordinate(float yawFrame);
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 color, vec3 normal, vec3 viewDir, float specularStrength);
+vec3 CalcPointLight(PointLight light, vec3 color, vec3 normal, vec3 fragPos, vec3 viewDir, float specularStrength);
+
+void main()
+{
+    // the impostor keeps the pixels its fading parts leave
+    if(DitherThreshold(gl_FragCoord.xy) >= fragmentFade)
+    {
+        discard;
+    }
+
+    vec2 first = GetAtlasCoordinate(fragmentFrames.x);
+    vec2 second = GetAtlasCoordinate(fragmentFrames.y);
+    float weight = fragmentFrames.w;
+
+    // the empty texels are zero, so the blend is premultiplied
+    vec4 color = mix(texture(colorAtlas, first), texture(colorAtlas, second), weight);
+    if(color.a < 0.5)
+    {
+        discard;
+    }
+    color.rgb /= color.a;
+
+    // normals and depths do not blend, they come from the nearer frame
+    // unless it has nothing at this texel
+    vec2 nearest = (weight < 0.5) ? first : second;
+    float depth = texture(depthAtlas, nearest).r;
+    if(depth >= 1.0)
+    {
+        nearest = (weight < 0.5) ? second : first;
+        depth = texture(depthAtlas, nearest).r;
+    }
+    vec4 normalSample = texture(normalAtlas, nearest);
+
+    // the bake depth is linear over the bounding sphere, with its
+    // center at one half
+    vec3 position = fragmentPosition + fragmentToViewer * (1.0 - 2.0 * depth) * radius;
+    vec4 clipPosition = viewProjection * vec4(position, 1.0);
+    gl_FragDepth = (clipPosition.z / clipPosition.w) * 0.5 + 0.5;
+
+    vec3 normal = normalize(normalSample.xyz * 2.0 - 1.0);
+    vec3 viewDir = bOrthographic ? viewDirection : normalize(viewPosition - position);
+    vec3 result = vec3(0.0);
+    if(directionalLight.bActive == true)
+    {
+        result += CalcDirectionalLight(directionalLight, color.rgb, normal, viewDir, normalSample.a);
+    }
+    for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+    {
+        if(pointLights[i].bActive == true)
+        {
+            result += CalcPointLight(pointLights[i], color.rgb, normal, position, viewDir, normalSample.a);
+        }
+    }
+    fragmentColor = vec4(result, 1.0);
+}
+
+// the texture coordinate of the current texel in a frame of the
+// nearest elevation
+vec2 GetAtlasCoordinate(float yawFrame)
+{
+    return (vec2(yawFrame, fragmentFrames.z) + frameCoordinate) / vec2(YAW_FRAMES, ELEVATION_FRAMES);
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 color, vec3 normal, vec3 viewDir, float specularStrength)
+{
+    vec3 lightDirection = normalize(-light.direction);
+    float diff = max(dot(normal, lightDirection), 0.0);
+    vec3 reflectDir = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), IMPOSTOR_SHININESS);
+
+    vec3 ambient = light.ambient * color;
+    vec3 diffuse = light.diffuse * diff * color;
+    vec3 specular = light.specular * spec * specularStrength * color;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 color, vec3 normal, vec3 fragPos, vec3 viewDir, float specularStrength)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), IMPOSTOR_SHININESS);
+
+    vec3 ambient = light.ambient * color;
+    vec3 diffuse = light.diffuse * diff * color;
+    vec3 specular = light.specular * spec * specularStrength;
+    return (ambient + diffuse + specular);
+}
+
+// the 4x4 ordered dither threshold of a pixel, as in the scene's
+// fragment shader
+float DitherThreshold(vec2 pixel)
+{
+    const float bayer[16] = float[16](
+        0.0, 8.0, 2.0, 10.0,
+        12.0, 4.0, 14.0, 6.0,
+        3.0, 11.0, 1.0, 9.0,
+        15.0, 7.0, 13.0, 5.0);
+    ivec2 cell = ivec2(mod(pixel, 4.0));
+    return (bayer[cell.y * 4 + cell.x] + 0.5) / 16.0;
+}
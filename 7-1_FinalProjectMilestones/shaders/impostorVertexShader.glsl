@@ -0,0 +1,49 @@
+#version 330 core
+// one corner of the quad, and the center of the instance's bounding sphere
+// with its fade
+layout (location = 0) in vec2 inCorner;
+layout (location = 3) in vec4 inInstance;
+
+// the frames of the atlases, as in ImpostorRenderer
+#define YAW_FRAMES 16.0
+#define ELEVATION_FRAMES 4.0
+#define PI 3.14159265
+
+uniform mat4 viewProjection;
+uniform vec3 viewPosition;
+// the direction toward the viewer of an orthographic view
+uniform vec3 viewDirection;
+uniform bool bOrthographic;
+uniform float radius;
+
+out vec3 fragmentPosition;
+out vec2 frameCoordinate;
+flat out vec3 fragmentToViewer;
+// the atlas columns of the two nearest yaw frames, the row of the
+// nearest elevation and the weight of the second yaw frame
+flat out vec4 fragmentFrames;
+flat out float fragmentFade;
+
+void main()
+{
+    vec3 center = inInstance.xyz;
+    vec3 toViewer = bOrthographic ? viewDirection : normalize(viewPosition - center);
+
+    float yawFrame = fract(atan(toViewer.x, toViewer.z) / (2.0 * PI)) * YAW_FRAMES;
+    float firstYaw = floor(yawFrame);
+    float elevation = asin(clamp(toViewer.y, -1.0, 1.0)) / (0.5 * PI) * ELEVATION_FRAMES;
+    float elevationFrame = clamp(floor(elevation + 0.5), 0.0, ELEVATION_FRAMES - 1.0);
+    fragmentFrames = vec4(firstYaw, mod(firstYaw + 1.0, YAW_FRAMES), elevationFrame, yawFrame - firstYaw);
+
+    // the quad faces the viewer and is oriented like the bake camera,
+    // which kept the world's up direction
+    vec3 right = cross(vec3(0.0, 1.0, 0.0), toViewer);
+    right = (length(right) > 0.001) ? normalize(right) : vec3(1.0, 0.0, 0.0);
+    vec3 up = cross(toViewer, right);
+
+    fragmentPosition = center + (right * inCorner.x + up * inCorner.y) * radius;
+    frameCoordinate = inCorner * 0.5 + 0.5;
+    fragmentToViewer = toViewer;
+    fragmentFade = inInstance.w;
+    gl_Position = viewProjection * vec4(fragmentPosition, 1.0);
+}
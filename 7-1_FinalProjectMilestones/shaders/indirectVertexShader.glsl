@@ -0,0 +1,69 @@
+#version 430 core
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+// the object of the draw; an instanced attribute, so the base instance
+// of the draw command selects it
+layout (location = 3) in int inObjectIndex;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentObjectIndex;
+flat out float fragmentImpostorFade;
+
+struct Material {
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+// the DrawUniforms block of the scene shaders, one record per object
+struct DrawRecord {
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+
+layout (std430) readonly buffer DrawRecords
+{
+    DrawRecord drawRecords[];
+};
+
+// the impostor of the object, as in the culling shader, and the fades of
+// the impostor instances; the record's impostorFade is not written
+struct CullObject {
+    vec4 minimum;
+    vec4 maximum;
+    int mesh;
+    int textureSlot;
+    int impostor;
+    int padding;
+};
+layout (std430, binding = 0) readonly buffer CullObjects
+{
+    CullObject objects[];
+};
+layout (std430, binding = 5) readonly buffer ImpostorFades
+{
+    float impostorFades[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+   mat4 model = drawRecords[inObjectIndex].model;
+   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   fragmentVertexNormal = inVertexNormal;
+   fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentObjectIndex = inObjectIndex;
+   int impostor = objects[inObjectIndex].impostor;
+   fragmentImpostorFade = (impostor >= 0) ? impostorFades[impostor] : 0.0;
+}
@@ -0,0 +1,31 @@
+#version 410 core
+// routes each triangle to the viewport and layer of its view, for drivers
+// whose vertex shaders cannot write them
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec3 geometryPosition[];
+in vec3 geometryVertexNormal[];
+in vec2 geometryTextureCoordinate[];
+flat in int geometryViewIndex[];
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentViewIndex;
+
+void main()
+{
+   for(int i = 0; i < 3; i++)
+   {
+      fragmentPosition = geometryPosition[i];
+      fragmentVertexNormal = geometryVertexNormal[i];
+      fragmentTextureCoordinate = geometryTextureCoordinate[i];
+      fragmentViewIndex = geometryViewIndex[0];
+      gl_Position = gl_in[i].gl_Position;
+      gl_ViewportIndex = geometryViewIndex[0];
+      gl_Layer = geometryViewIndex[0];
+      EmitVertex();
+   }
+   EndPrimitive();
+}
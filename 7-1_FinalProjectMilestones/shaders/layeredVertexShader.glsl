@@ -0,0 +1,74 @@
+#version 410 core
+// LAYER_FROM_VERTEX_SHADER is defined by the application when the vertex
+// shader can write the viewport and layer; otherwise a geometry shader does
+#ifdef LAYER_FROM_VERTEX_SHADER
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+#define MAX_LAYERED_VIEWS 16
+
+// one entry per view, every draw is instanced once per view
+layout (std140) uniform LayeredViews
+{
+    mat4 viewProjection[MAX_LAYERED_VIEWS];
+    vec4 viewPositions[MAX_LAYERED_VIEWS];
+};
+
+struct Material {
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+// the per-draw values, declared exactly as in the fragment shader
+layout (std140) uniform DrawUniforms
+{
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+
+#ifdef LAYER_FROM_VERTEX_SHADER
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentViewIndex;
+#define OUT_POSITION fragmentPosition
+#define OUT_NORMAL fragmentVertexNormal
+#define OUT_TEXTURE_COORDINATE fragmentTextureCoordinate
+#define OUT_VIEW_INDEX fragmentViewIndex
+#else
+out vec3 geometryPosition;
+out vec3 geometryVertexNormal;
+out vec2 geometryTextureCoordinate;
+flat out int geometryViewIndex;
+#define OUT_POSITION geometryPosition
+#define OUT_NORMAL geometryVertexNormal
+#define OUT_TEXTURE_COORDINATE geometryTextureCoordinate
+#define OUT_VIEW_INDEX geometryViewIndex
+#endif
+
+void main()
+{
+   int viewIndex = gl_InstanceID;
+   vec4 worldPosition = model * vec4(inVertexPosition, 1.0);
+
+   OUT_POSITION = vec3(worldPosition);
+   OUT_NORMAL = inVertexNormal;
+   OUT_TEXTURE_COORDINATE = inTextureCoordinate;
+   OUT_VIEW_INDEX = viewIndex;
+   gl_Position = viewProjection[viewIndex] * worldPosition;
+
+#ifdef LAYER_FROM_VERTEX_SHADER
+   gl_ViewportIndex = viewIndex;
+   gl_Layer = viewIndex;
+#endif
+}
@@ -0,0 +1,106 @@
+#version 330 core
+out vec4 fragmentColor;
+
+// the summed light evaluations, texture fetches and shaded fragments of
+// every pixel of the views
+uniform sampler2D costTexture;
+// 0 shows the light evaluations, 1 the texture fetches
+uniform int costChannel;
+// the cost at the hot end of the color ramp
+uniform float costScale;
+
+// the legend in the bottom left corner: a row of text, the color ramp and
+// the tick labels under it, in glyphs of 3x5 pixels drawn GLYPH_SCALE
+// times larger
+#define MAX_LEGEND_GLYPHS 24
+#define GLYPH_SCALE 3
+#define LEGEND_MARGIN 12
+uniform int legendGlyphs[2 * MAX_LEGEND_GLYPHS];
+
+// the glyphs of GLYPH_CHARACTERS in LightCostView, "0123456789.ACEFGHILMSTVX",
+// one bit per pixel from the top left, row by row
+const int GLYPHS[24] = int[24](
+    31599, 11415, 29671, 29647, 23497, 31183, 31215, 29257, 31727, 31695,
+    2, 11245, 31015, 31143, 31140, 31087, 23533, 29847, 18727, 24557,
+    31183, 29842, 23402, 23213);
+
+// function prototypes
+vec3 HeatColor(float t);
+float TextCoverage(int row, ivec2 pixel);
+
+void main()
+{
+    vec4 cost = texelFetch(costTexture, ivec2(gl_FragCoord.xy), 0);
+    float value = (costChannel == 0) ? cost.r : cost.g;
+    // pixels no fragment reached stay dark, so a cost of zero can be told
+    // from the background
+    vec3 color = (cost.b > 0.0) ? HeatColor(value / costScale) : vec3(0.05);
+
+    ivec2 pixel = ivec2(gl_FragCoord.xy) - ivec2(LEGEND_MARGIN);
+    int cell = 4 * GLYPH_SCALE;
+    int rowHeight = 6 * GLYPH_SCALE;
+    int barWidth = MAX_LEGEND_GLYPHS * cell;
+    if((pixel.x >= -4) && (pixel.y >= -4) && (pixel.x < barWidth + 4) && (pixel.y < 3 * rowHeight + 4))
+    {
+        // a dark panel keeps the legend readable over any heat
+        color *= 0.25;
+        if((pixel.y >= rowHeight) && (pixel.y < 2 * rowHeight - GLYPH_SCALE) && (pixel.x >= 0) && (pixel.x < barWidth))
+        {
+            color = HeatColor((float(pixel.x) + 0.5) / float(barWidth));
+        }
+        else if(pixel.y >= 2 * rowHeight)
+        {
+            color = mix(color, vec3(1.0), TextCoverage(0, pixel - ivec2(0, 2 * rowHeight)));
+        }
+        else if(pixel.y < rowHeight)
+        {
+            color = mix(color, vec3(1.0), TextCoverage(1, pixel));
+        }
+    }
+
+    fragmentColor = vec4(color, 1.0);
+}
+
+// the ramp from no cost to costScale: black, blue, cyan, green, yellow and
+// red; anything above the scale is white
+vec3 HeatColor(float t)
+{
+    if(t > 1.0)
+    {
+        return vec3(1.0);
+    }
+
+    const vec3 stops[6] = vec3[6](
+        vec3(0.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 1.0),
+        vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0));
+    float position = clamp(t, 0.0, 1.0) * 5.0;
+    int stop = min(int(position), 4);
+    return mix(stops[stop], stops[stop + 1], position - float(stop));
+}
+
+// 1 where a glyph of a legend row covers the pixel, measured from the
+// bottom left of the row
+float TextCoverage(int row, ivec2 pixel)
+{
+    if((pixel.x < 0) || (pixel.y < 0))
+    {
+        return 0.0;
+    }
+    ivec2 cellPixel = pixel / GLYPH_SCALE;
+    int column = cellPixel.x / 4;
+    int x = cellPixel.x - column * 4;
+    // the glyph rows go from the top down
+    int y = 4 - cellPixel.y;
+    if((column < 0) || (column >= MAX_LEGEND_GLYPHS) || (x > 2) || (y < 0) || (y > 4))
+    {
+        return 0.0;
+    }
+
+    int glyph = legendGlyphs[row * MAX_LEGEND_GLYPHS + column];
+    if(glyph < 0)
+    {
+        return 0.0;
+    }
+    int bit = 14 - (y * 3 + x);
+    return float((GLYPHS[glyph] >> bit) & 1);
+}
\ No newline at end of file
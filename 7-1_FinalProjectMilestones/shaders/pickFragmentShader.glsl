@@ -0,0 +1,9 @@
+#version 330 core
+layout (location = 0) out uint fragmentPickID;
+
+flat in uint vertexPickID;
+
+void main()
+{
+   fragmentPickID = vertexPickID;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+
+// the ID of the drawn object; instanced draws add the instance index
+// times the stride, so a stride of 0 gives all instances the same ID
+uniform int pickID;
+uniform int pickInstanceStride = 0;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+flat out uint vertexPickID;
+
+void main()
+{
+   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   vertexPickID = uint(pickID + gl_InstanceID * pickInstanceStride);
+}
@@ -0,0 +1,96 @@
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+// the light at the vertex, interpolated over the triangle; the fragment
+// shader multiplies the diffuse part by the surface color
+out vec3 vertexDiffuseLight;
+out vec3 vertexSpecularLight;
+
+struct Material {
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+struct DirectionalLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    bool bActive;
+};
+
+struct PointLight {
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    bool bActive;
+};
+
+#define TOTAL_POINT_LIGHTS 5
+
+// the per-draw values, declared exactly as in the fragment shader
+layout (std140) uniform DrawUniforms
+{
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPosition;
+uniform DirectionalLight directionalLight;
+uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+
+// adds the light of one source at the vertex
+void AddLight(vec3 lightDirection, vec3 ambient, vec3 diffuse, vec3 specular, vec3 normal, vec3 viewDir)
+{
+    float diff = max(dot(normal, lightDirection), 0.0);
+    vec3 reflectDir = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vertexDiffuseLight += ambient + diffuse * diff * material.diffuseColor;
+    vertexSpecularLight += specular * spec * material.specularColor;
+}
+
+void main()
+{
+   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   fragmentVertexNormal = inVertexNormal;
+   fragmentTextureCoordinate = inTextureCoordinate;
+
+   // the same directional and point lights as the fragment shader, once
+   // per vertex; the scene sets no spot light
+   vertexDiffuseLight = vec3(0.0);
+   vertexSpecularLight = vec3(0.0);
+   vec3 norm = normalize(inVertexNormal);
+   vec3 viewDir = normalize(viewPosition - fragmentPosition);
+   if(directionalLight.bActive == true)
+   {
+       AddLight(normalize(-directionalLight.direction), directionalLight.ambient,
+           directionalLight.diffuse, directionalLight.specular, norm, viewDir);
+   }
+   for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+   {
+       if(pointLights[i].bActive == true)
+       {
+           AddLight(normalize(pointLights[i].position - fragmentPosition), pointLights[i].ambient,
+               pointLights[i].diffuse, pointLights[i].specular, norm, viewDir);
+       }
+   }
+}
\ No newline at end of file
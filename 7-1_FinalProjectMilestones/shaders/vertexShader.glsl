@@ -7,7 +7,24 @@ out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
 
-uniform mat4 model;
+struct Material {
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+// the per-draw values, declared exactly as in the fragment shader
+layout (std140) uniform DrawUniforms
+{
+    mat4 model;
+    vec4 objectColor;
+    Material material;
+    vec2 UVscale;
+    bool bUseTexture;
+    bool bUseVideoTexture;
+    float impostorFade;
+};
+
 uniform mat4 view;
 uniform mat4 projection;
 